@@ -52,22 +52,6 @@ typedef struct _api_t {
 
 void initApi();
 
-void json_valueStart(Serial *serial, const char *name);
-void json_null(Serial *serial, const char *name, int more);
-void json_int(Serial *serial, const char *name, int value, int more);
-void json_uint(Serial *serial, const char *name, unsigned int value, int more);
-void json_escapedString(Serial *serial, const char *name, const char *value, int more);
-void json_string(Serial *serial, const char *name, const char *value, int more);
-void json_float(Serial *serial, const char *name, float value, int precision, int more);
-void json_objStartString(Serial *serial, const char * label);
-void json_objStartInt(Serial *serial, int label);
-void json_objStart(Serial *serial);
-void json_objEnd(Serial *serial, int more);
-void json_arrayStart(Serial *serial, const char * name);
-void json_arrayElementString(Serial *serial, const char *value, int more);
-void json_arrayElementInt(Serial *serial, int value, int more);
-void json_arrayElementFloat(Serial *serial, float value, int precision, int more);
-void json_arrayEnd(Serial *serial, int more);
 void json_sendResult(Serial *serial, const char *messageName, int resultCode);
 
 int process_api(Serial *serial, char * buffer, size_t bufferSize);
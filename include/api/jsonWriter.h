@@ -0,0 +1,122 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef JSONWRITER_H_
+#define JSONWRITER_H_
+
+#include "cpp_guard.h"
+#include "serial.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+CPP_GUARD_BEGIN
+
+/* How many writers can hold a pooled buffer at once */
+#define JSON_WRITER_POOL_SIZE	2
+#define JSON_WRITER_BUFFER_SIZE	256
+
+/* One bit of nesting state per level */
+#define JSON_WRITER_MAX_DEPTH	32
+
+/*
+ * Formats JSON into a buffer and hands it to the serial a buffer at a
+ * time.  The writer tracks nesting and puts the commas between members
+ * itself, so callers never say whether more is coming.
+ *
+ * Every value takes a name.  Pass NULL for array elements and for the
+ * root object.
+ */
+struct json_writer {
+        Serial *serial;
+        char *buf;
+        size_t size;
+        size_t len;
+        int pool_slot;
+        unsigned int depth;
+        uint32_t members;
+};
+
+/**
+ * Sets up a writer on a buffer the caller owns.  A size of 0 makes the
+ * writer pass each token straight through to the serial.
+ */
+void jw_init(struct json_writer *w, Serial *serial, char *buf, size_t size);
+
+/**
+ * Sets up a writer on a buffer from the shared pool.  If the pool is
+ * empty the writer still works, just unbuffered.  Must be paired with
+ * jw_close.
+ */
+void jw_open(struct json_writer *w, Serial *serial);
+
+/**
+ * Flushes the writer and gives its buffer back to the pool if it came
+ * from there.
+ */
+void jw_close(struct json_writer *w);
+
+/**
+ * Sends whatever is buffered to the serial.  Needed before anyone else
+ * writes to the serial behind the writer's back.
+ */
+void jw_flush(struct json_writer *w);
+
+void jw_obj_start(struct json_writer *w, const char *name);
+void jw_obj_start_int(struct json_writer *w, int label);
+void jw_obj_end(struct json_writer *w);
+void jw_array_start(struct json_writer *w, const char *name);
+void jw_array_end(struct json_writer *w);
+
+void jw_null(struct json_writer *w, const char *name);
+void jw_int(struct json_writer *w, const char *name, int value);
+void jw_uint(struct json_writer *w, const char *name, unsigned int value);
+void jw_ll(struct json_writer *w, const char *name, long long value);
+void jw_float(struct json_writer *w, const char *name, float value,
+              int precision);
+void jw_double(struct json_writer *w, const char *name, double value,
+               int precision);
+
+/**
+ * Writes a quoted string as is.  A NULL value is written as null.
+ */
+void jw_string(struct json_writer *w, const char *name, const char *value);
+
+/**
+ * Writes a quoted string, escaping quotes and line breaks.
+ */
+void jw_escaped_string(struct json_writer *w, const char *name,
+                       const char *value);
+
+/**
+ * Starts a member whose value the caller writes itself, with jw_raw or
+ * straight to the serial after a jw_flush.
+ */
+void jw_key(struct json_writer *w, const char *name);
+
+/**
+ * Appends bytes with no formatting at all.
+ */
+void jw_raw(struct json_writer *w, const char *data, size_t len);
+
+CPP_GUARD_END
+
+#endif /* JSONWRITER_H_ */
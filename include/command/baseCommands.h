@@ -32,11 +32,15 @@ CPP_GUARD_BEGIN
 		{"showTasks", "Show status of running tasks", "", ShowTaskInfo}, \
 		{"version", "Gets the version numbers", "", GetVersion}, \
 		{"showStats", "Info on system statistics.","", ShowStats}, \
+		{"showPipelineStats", "Sample drops, queue depth and latency per consumer.","", ShowPipelineStats}, \
+		{"showSdStats", "SD card write and sync latency, throughput and remounts.","", ShowSdStats}, \
 		{"sysReset", "Reset the system", "", ResetSystem}
 
 void ShowTaskInfo(Serial *serial, unsigned int argc, char **argv);
 void GetVersion(Serial *serial, unsigned int argc, char **argv);
 void ShowStats(Serial *serial, unsigned int argc, char **argv);
+void ShowPipelineStats(Serial *serial, unsigned int argc, char **argv);
+void ShowSdStats(Serial *serial, unsigned int argc, char **argv);
 void ResetSystem(Serial *serial, unsigned int argc, char **argv);
 
 CPP_GUARD_END
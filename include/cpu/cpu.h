@@ -32,6 +32,17 @@ int cpu_init(void);
 void cpu_reset(int bootloader);
 const char * cpu_get_serialnumber(void);
 
+/**
+ * @return A free running count of CPU cycles.  Wraps, so only use the
+ * difference between two readings.
+ */
+uint32_t cpu_get_cycle_count(void);
+
+/**
+ * @return The number of cycles counted by cpu_get_cycle_count per us.
+ */
+uint32_t cpu_get_cycles_per_us(void);
+
 CPP_GUARD_END
 
 #endif /* CPU_H_ */
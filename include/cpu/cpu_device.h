@@ -24,11 +24,15 @@
 
 #include "cpp_guard.h"
 
+#include <stdint.h>
+
 CPP_GUARD_BEGIN
 
 int cpu_device_init(void);
 void cpu_device_reset(int bootloader);
 const char * cpu_device_get_serialnumber(void);
+uint32_t cpu_device_get_cycle_count(void);
+uint32_t cpu_device_get_cycles_per_us(void);
 
 CPP_GUARD_END
 
@@ -0,0 +1,221 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#ifndef BINARYLOG_H_
+#define BINARYLOG_H_
+
+#include "cpp_guard.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+CPP_GUARD_BEGIN
+
+/*
+ * The binary log format.  All values are little endian.
+ *
+ * A log starts with a header describing the channels:
+ *
+ *   char     magic[4]         BINARY_LOG_MAGIC
+ *   uint8_t  version          BINARY_LOG_VERSION
+ *   uint8_t  flags            BINARY_LOG_FLAG_*
+ *   uint16_t channel_count
+ *   uint16_t ms_per_tick
+ *
+ * If the flags have BINARY_LOG_FLAG_SEGMENT set the log is one part of a
+ * rotated session and the header goes on with:
+ *
+ *   uint32_t session          Shared by every part of the session
+ *   uint16_t part             Counts up from 0
+ *
+ * followed by channel_count channel descriptions:
+ *
+ *   uint8_t  type             enum binary_log_type
+ *   uint8_t  precision
+ *   uint16_t sample_rate      In Hz
+ *   float    min
+ *   float    max
+ *   uint8_t  label_len, char label[label_len]
+ *   uint8_t  units_len, char units[units_len]
+ *
+ * and then by the sample records:
+ *
+ *   uint16_t delta            Ticks since the previous record
+ *   uint32_t long_delta       Only if delta is BINARY_LOG_DELTA_LONG
+ *   uint32_t populated[]      SAMPLE_BITMAP_WORDS(channel_count) words
+ *   values                    Only the populated ones, in channel order,
+ *                             each binary_log_type_size bytes
+ *
+ * A delta of BINARY_LOG_DELTA_HEADER means the channels changed and is
+ * followed by a new header.  Deltas restart from tick 0 after a header.
+ *
+ * If the header has BINARY_LOG_FLAG_DELTA set the records are packed
+ * instead.  varint is an unsigned LEB128 value and zigzag maps signed
+ * values onto it so that small values of either sign stay short:
+ *
+ *   varint   code             ticks since the previous record << 2, or'd
+ *                             with the enum binary_log_record kind
+ *
+ * A BINARY_LOG_RECORD_HEADER code has no ticks and is followed by a new
+ * header.  A BINARY_LOG_RECORD_KEYFRAME is followed by the full state
+ * of every channel and then the row.  Keyframes start each header and
+ * repeat every BINARY_LOG_KEYFRAME_ROWS rows so that a reader can pick
+ * the stream up again:
+ *
+ *   char     sync[4]          BINARY_LOG_KEYFRAME_SYNC
+ *   zigzag   values[channel_count]
+ *
+ * A row is:
+ *
+ *   uint8_t  populated[]      (channel_count + 7) / 8 bytes
+ *   uint8_t  changed[]        One bit per populated channel, set if its
+ *                             value differs from the last one written
+ *   zigzag   deltas[]         Only for the changed channels, the change
+ *                             from the last value written
+ *
+ * Integer values are packed as they are.  Float and double values are
+ * first rounded to the channel precision, as the CSV log does, and
+ * stored as value * 10^precision.
+ */
+#define BINARY_LOG_MAGIC	"RCPB"
+#define BINARY_LOG_MAGIC_LEN	4
+#define BINARY_LOG_VERSION	1
+
+#define BINARY_LOG_DELTA_HEADER	0xfffe
+#define BINARY_LOG_DELTA_LONG	0xffff
+
+#define BINARY_LOG_FLAG_DELTA	0x01
+#define BINARY_LOG_FLAG_SEGMENT	0x02
+
+#define BINARY_LOG_KEYFRAME_ROWS	250
+#define BINARY_LOG_KEYFRAME_SYNC	"RCPK"
+#define BINARY_LOG_KEYFRAME_SYNC_LEN	4
+#define BINARY_LOG_MAX_PRECISION	9
+#define BINARY_LOG_VARINT_MAX	10
+
+enum binary_log_record {
+        BINARY_LOG_RECORD_ROW = 0,
+        BINARY_LOG_RECORD_KEYFRAME,
+        BINARY_LOG_RECORD_HEADER,
+};
+
+#define BINARY_LOG_RECORD_BITS	2
+
+enum binary_log_type {
+        BINARY_LOG_TYPE_INT = 0,
+        BINARY_LOG_TYPE_LONGLONG,
+        BINARY_LOG_TYPE_FLOAT,
+        BINARY_LOG_TYPE_DOUBLE,
+};
+
+struct _ChannelDescriptor;
+union _ChannelValue;
+struct sample;
+
+/**
+ * Writes len bytes of data to wherever the log is going.
+ * @return 0 on success, non-zero otherwise.
+ */
+typedef int binary_log_write_func(const void *data, const size_t len);
+
+struct binary_log_writer {
+        binary_log_write_func *write;
+        bool has_header;
+        bool compressed;
+        bool segmented;
+        uint32_t session;
+        uint16_t part;
+        uint32_t layout;
+        size_t ticks;
+        unsigned int rows;
+        /* Last value written per channel when compressed */
+        int64_t *last;
+        size_t last_capacity;
+};
+
+/**
+ * @return The type a channel's values are stored as.
+ */
+enum binary_log_type binary_log_get_type(
+        const struct _ChannelDescriptor *cd);
+
+/**
+ * @return The number of bytes a value of the given type takes up.
+ */
+size_t binary_log_type_size(const enum binary_log_type type);
+
+/**
+ * @return A channel value as an integer count of 10^-precision units,
+ * rounded the same way the CSV log rounds.  Two values that pack the
+ * same read back the same.
+ */
+int64_t binary_log_packed_value(const struct _ChannelDescriptor *cd,
+                                const union _ChannelValue *value);
+
+/**
+ * Packs value into buf as a varint.  buf must have room for
+ * BINARY_LOG_VARINT_MAX bytes.
+ * @return The number of bytes used.
+ */
+size_t binary_log_put_varint(uint8_t *buf, uint64_t value);
+
+/**
+ * Maps a signed value onto an unsigned one so that values close to 0
+ * make short varints.
+ */
+uint64_t binary_log_zigzag(const int64_t value);
+
+/**
+ * Prepares a writer for a new log.  The first sample written will be
+ * preceded by the header.
+ * @param compressed true to pack records as described above.
+ */
+void binary_log_start(struct binary_log_writer *w,
+                      binary_log_write_func *write, const bool compressed);
+
+/**
+ * Marks the log as one part of a rotated session.  Call before the first
+ * sample so that the header carries it.
+ */
+void binary_log_segment(struct binary_log_writer *w, const uint32_t session,
+                        const uint16_t part);
+
+/**
+ * Makes the next packed record a keyframe so that a reader can start
+ * decoding from it.  Does nothing for unpacked logs, where every record
+ * stands on its own.
+ */
+void binary_log_keyframe(struct binary_log_writer *w);
+
+/**
+ * Writes a sample record, preceded by a header if this is the first
+ * sample of the log or if the channel table changed since the last one.
+ * @return 0 on success, non-zero if any write failed.
+ */
+int binary_log_write_sample(struct binary_log_writer *w,
+                            const struct sample *s);
+
+CPP_GUARD_END
+
+#endif /* BINARYLOG_H_ */
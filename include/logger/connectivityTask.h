@@ -29,6 +29,7 @@
 #include "sampleRecord.h"
 #include "serial.h"
 #include "task.h"
+#include "telemetryDelta.h"
 
 #include <stdint.h>
 #include <stdbool.h>
@@ -46,10 +47,33 @@ typedef struct _ConnParams {
     size_t periodicMeta;
     uint32_t connection_timeout;
     xQueueHandle sampleQueue;
+    /* What was last sent, when only changed channels go out */
+    struct telemetry_delta delta;
 } ConnParams;
 
 void queueTelemetryRecord(const LoggerMessage *msg);
 
+/*
+ * Hands a sample to each connectivity channel whose adaptive rate says
+ * it is due, and steps those rates as the queues fill or drain.
+ * @param sampled_rate The fastest rate of the channels in the sample.
+ * @param ticks The logger tick the sample was taken on.
+ */
+void queue_telemetry_sample(const LoggerMessage *msg, const int sampled_rate,
+                            const size_t ticks);
+
+/*
+ * Counts a sample that was meant for telemetry but never made it onto
+ * the queues.  Queue failures are counted automatically per channel.
+ */
+void telemetry_sample_dropped(const int sampled_rate, const size_t ticks);
+
+/*
+ * Drops the samples still waiting on the telemetry queues so the logger
+ * ring slots they pin come free.  Start and Stop messages stay queued.
+ */
+void telemetry_flush_queues(void);
+
 void startConnectivityTask(int16_t priority);
 
 void connectivityTask(void *params);
@@ -23,8 +23,10 @@
 #define FILEWRITER_H_
 
 #include "FreeRTOS.h"
+#include "binaryLog.h"
 #include "cpp_guard.h"
 #include "ff.h"
+#include "logIndex.h"
 #include "loggerConfig.h"
 #include "sampleRecord.h"
 
@@ -45,12 +47,88 @@ struct logging_status
         enum writing_status writing_status;
         portTickType flush_tick;
         char name[FILENAME_LEN];
+        unsigned char mode;
+        unsigned int prealloc;
+        uint32_t prealloc_limit;
+        bool journal;
+        unsigned int rotate_minutes;
+        unsigned int rotate_kb;
+        uint32_t session;
+        uint16_t part;
+        portTickType segment_tick;
+        portTickType start_tick;
+        bool start_pending;
+        struct binary_log_writer binary;
+        struct log_index index;
 };
 
 
 void startFileWriterTask( int priority );
 portBASE_TYPE queue_logfile_record(const LoggerMessage *msg);
 
+/**
+ * Counts a sample that was meant for the log file but never made it
+ * onto the file writer queue.  Queue failures are counted automatically.
+ */
+void logfile_sample_dropped(void);
+
+/**
+ * Sets the format of the log files, one of SD_LOGGING_MODE_CSV,
+ * SD_LOGGING_MODE_BINARY or SD_LOGGING_MODE_COMPRESSED.  Takes effect at
+ * the next log start.
+ */
+void set_logfile_mode(const unsigned char mode);
+unsigned char get_logfile_mode(void);
+
+/**
+ * Sets how many minutes of logging to reserve space for when a log
+ * file is opened, or 0 to grow the file as it is written.  The space is
+ * reserved a chunk at a time, ahead of the data, while the file writer
+ * is idle.  Only journaled logs are pre-allocated; a plain log cut
+ * short by a power loss would end in stale card data up to the reserved
+ * size.  Values above LOG_PREALLOC_MAX_MINUTES are clamped.  Takes
+ * effect at the next log start.
+ */
+void set_logfile_prealloc(const unsigned int minutes);
+unsigned int get_logfile_prealloc(void);
+
+/**
+ * Sets when a log rolls over to a new file, so that long sessions come
+ * in parts of a manageable size.  The parts share a session id and
+ * are numbered in the index and binary log headers.  0 turns off that
+ * limit.  Takes effect at the next log start.
+ * @param minutes How long each part may run for.
+ * @param kb How big each part may grow.
+ */
+void set_logfile_rotation(const unsigned int minutes, const unsigned int kb);
+unsigned int get_logfile_rotate_minutes(void);
+unsigned int get_logfile_rotate_kb(void);
+
+/**
+ * Sets whether log files are written in journaled frames (see
+ * logJournal.h) that survive a power cut.  Every journaled log on the
+ * card is cut back to its last good frame when the card is first
+ * scanned, at the first log start after boot or after a card error.
+ * A card swapped in between logs without an error is not recovered
+ * until the next boot.  Takes effect at the next log start.
+ */
+void set_logfile_journal(const bool journal);
+bool get_logfile_journal(void);
+
+/**
+ * Sets how many ms of samples we can afford to lose if the power is cut
+ * mid log.  Syncs are timed to fit the budget, so a larger one means
+ * fewer syncs and more throughput.
+ */
+void set_logfile_loss_budget(const unsigned int ms);
+unsigned int get_logfile_loss_budget(void);
+
+/**
+ * @return How many ms it took from the last log start until the first
+ * row made it into the log file.
+ */
+unsigned int get_logfile_start_latency(void);
+
 CPP_GUARD_END
 
 #endif /* FILEWRITER_H_ */
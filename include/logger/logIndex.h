@@ -0,0 +1,125 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#ifndef LOGINDEX_H_
+#define LOGINDEX_H_
+
+#include "cpp_guard.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+CPP_GUARD_BEGIN
+
+/*
+ * A sparse index of a log file so readers can jump to a time or a lap
+ * without scanning the whole log.  It is written next to the log as a
+ * file of the same name with the LOG_INDEX_EXT extension.  All values
+ * are little endian.
+ *
+ *   char     magic[4]         LOG_INDEX_MAGIC
+ *   uint8_t  version          LOG_INDEX_VERSION
+ *   uint8_t  reserved
+ *   uint32_t interval         Rows between periodic entries at the end
+ *   uint32_t count
+ *   uint32_t session          Shared by the parts of a rotated log, else 0
+ *   uint16_t part             Which part of the session this file is
+ *
+ * followed by count entries in log order:
+ *
+ *   uint32_t offset           Where the row starts in the log file
+ *   uint32_t ticks            Tick the row was sampled on
+ *   uint16_t lap              Lap count when the row was written
+ *   uint16_t flags            LOG_INDEX_FLAG_*
+ *
+ * An entry is taken every interval rows and at every lap change.  When
+ * the index fills up the periodic entries are thinned out and the
+ * interval doubles, so memory use stays fixed however long the log.
+ * Lap entries are always kept.
+ */
+#define LOG_INDEX_EXT		".idx"
+#define LOG_INDEX_MAGIC		"RCPI"
+#define LOG_INDEX_MAGIC_LEN	4
+#define LOG_INDEX_VERSION	2
+#define LOG_INDEX_INTERVAL	500
+
+#define LOG_INDEX_FLAG_LAP	0x01
+#define LOG_INDEX_FLAG_PERIODIC	0x02
+
+struct log_index_entry {
+        uint32_t offset;
+        uint32_t ticks;
+        uint16_t lap;
+        uint16_t flags;
+};
+
+struct log_index {
+        struct log_index_entry *entries;
+        size_t capacity;
+        size_t count;
+        unsigned int interval;
+        unsigned int rows;
+        int lap;
+        uint32_t session;
+        uint16_t part;
+};
+
+/**
+ * Writes len bytes of data to the index file.
+ * @return 0 on success, non-zero otherwise.
+ */
+typedef int log_index_write_func(const void *data, const size_t len);
+
+/**
+ * Allocates room for capacity entries.
+ * @return true if successful, false otherwise.
+ */
+bool init_log_index(struct log_index *li, const size_t capacity);
+
+/**
+ * Empties the index for a new log, which is not part of a session until
+ * the caller says otherwise.
+ */
+void reset_log_index(struct log_index *li);
+
+/**
+ * Tells the index about a row that is about to be written.
+ * @param offset Where in the log file the row will start.
+ * @param ticks The tick the row was sampled on.
+ * @param lap The current lap count.
+ * @return true if an entry was taken for this row.
+ */
+bool log_index_row(struct log_index *li, const uint32_t offset,
+                   const uint32_t ticks, const int lap);
+
+/**
+ * Writes out the index in the format described above.
+ * @return 0 on success, non-zero if any write failed.
+ */
+int write_log_index(const struct log_index *li,
+                    log_index_write_func *write);
+
+CPP_GUARD_END
+
+#endif /* LOGINDEX_H_ */
@@ -0,0 +1,135 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#ifndef LOGJOURNAL_H_
+#define LOGJOURNAL_H_
+
+#include "cpp_guard.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+CPP_GUARD_BEGIN
+
+/*
+ * Journaled log files wrap the log data, CSV or binary, in fixed size
+ * frames so that the good part of a file can be found again after a
+ * power cut.  Frames are LOG_JOURNAL_FRAME_SIZE bytes, one sector, and
+ * all values are little endian:
+ *
+ *   char     magic[2]         LOG_JOURNAL_MAGIC
+ *   uint16_t len              Payload bytes used, the rest is padding
+ *   uint32_t session          Same for every frame of a file
+ *   uint32_t seq              Position of the frame in the file, from 0
+ *   uint8_t  payload[LOG_JOURNAL_PAYLOAD]
+ *   uint32_t crc              CRC-32 of everything before it
+ *
+ * Frames are only ever appended, so a cut can only damage the end of a
+ * file.  A frame is written out partly full when the log is synced and
+ * the data carries on in the next one.  The session tells our frames
+ * apart from stale ones left in reused clusters.
+ */
+#define LOG_JOURNAL_EXT		".rcj"
+#define LOG_JOURNAL_MAGIC	"RJ"
+#define LOG_JOURNAL_MAGIC_LEN	2
+#define LOG_JOURNAL_FRAME_SIZE	512
+#define LOG_JOURNAL_HEADER_SIZE	12
+#define LOG_JOURNAL_PAYLOAD	(LOG_JOURNAL_FRAME_SIZE - \
+                                 LOG_JOURNAL_HEADER_SIZE - sizeof(uint32_t))
+
+struct log_journal_frame {
+        char magic[LOG_JOURNAL_MAGIC_LEN];
+        uint16_t len;
+        uint32_t session;
+        uint32_t seq;
+        uint8_t payload[LOG_JOURNAL_PAYLOAD];
+        uint32_t crc;
+};
+
+/**
+ * Writes len bytes of data to the log file.
+ * @return 0 on success, non-zero otherwise.
+ */
+typedef int log_journal_write_func(const void *data, const size_t len);
+
+/**
+ * Reads frame number index of the file into frame.
+ * @return true if the whole frame was read.
+ */
+typedef bool log_journal_read_func(const size_t index,
+                                   struct log_journal_frame *frame);
+
+struct log_journal {
+        struct log_journal_frame frame;
+        log_journal_write_func *write;
+        /* Payload bytes taken in since the start */
+        uint32_t bytes;
+};
+
+/**
+ * Prepares the journal for a new file.
+ * @param session A value unlikely to have been used on this card before.
+ */
+void log_journal_start(struct log_journal *j, log_journal_write_func *write,
+                       const uint32_t session);
+
+/**
+ * Carries on with an existing file that already holds seq frames.  Data
+ * not yet written out is kept.
+ */
+void log_journal_resume(struct log_journal *j, const uint32_t seq);
+
+/**
+ * Adds data to the journal, writing out frames as they fill up.
+ * @return 0 on success, else the error of the write that failed.
+ */
+int log_journal_append(struct log_journal *j, const void *data, size_t len);
+
+/**
+ * Writes out the current frame even if it isn't full.
+ * @return 0 on success, else the error of the write that failed.
+ */
+int log_journal_flush(struct log_journal *j);
+
+/**
+ * @return true if the frame is intact and belongs at position seq of
+ * the given session.
+ */
+bool log_journal_frame_valid(const struct log_journal_frame *frame,
+                             const uint32_t session, const uint32_t seq);
+
+/**
+ * Works out how many frames at the start of a file are good.  Only the
+ * end of a file can be damaged, so this takes a handful of reads.
+ * @param frames The number of whole frames in the file.
+ * @param frame Scratch space for the reads.
+ * @return The number of good frames.
+ */
+size_t log_journal_valid_frames(log_journal_read_func *read,
+                                const size_t frames,
+                                struct log_journal_frame *frame);
+
+CPP_GUARD_END
+
+#endif /* LOGJOURNAL_H_ */
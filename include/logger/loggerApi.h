@@ -35,6 +35,10 @@ CPP_GUARD_BEGIN
 {"hb", api_heart_beat}, \
 {"getVer", api_getVersion}, \
 {"getStatus", api_getStatus}, \
+{"getTiming", api_getTiming}, \
+{"resetTiming", api_resetTiming}, \
+{"getSdStats", api_getSdStats}, \
+{"resetSdStats", api_resetSdStats}, \
 {"getMeta", api_getMeta}, \
 {"log", api_log}, \
 {"getCapabilities", api_getCapabilities}, \
@@ -60,6 +64,7 @@ CPP_GUARD_BEGIN
 {"calImu", api_calibrateImu}, \
 {"getLogfile", api_getLogfile}, \
 {"setLogfileLevel", api_setLogfileLevel}, \
+{"setStreamFmt", api_setStreamFormat}, \
 {"getCanCfg", api_getCanConfig}, \
 {"setCanCfg", api_setCanConfig}, \
 {"getObd2Cfg", api_getObd2Config}, \
@@ -77,6 +82,10 @@ CPP_GUARD_BEGIN
 int api_getVersion(Serial *serial, const jsmntok_t *json);
 int api_getCapabilities(Serial *serial, const jsmntok_t *json);
 int api_getStatus(Serial *serial, const jsmntok_t *json);
+int api_getTiming(Serial *serial, const jsmntok_t *json);
+int api_resetTiming(Serial *serial, const jsmntok_t *json);
+int api_getSdStats(Serial *serial, const jsmntok_t *json);
+int api_resetSdStats(Serial *serial, const jsmntok_t *json);
 int api_systemReset(Serial *serial, const jsmntok_t *json);
 int api_factoryReset(Serial *serial, const jsmntok_t *json);
 int api_sampleData(Serial *serial, const jsmntok_t *json);
@@ -104,6 +113,7 @@ int api_setTimerConfig(Serial *serial, const jsmntok_t *json);
 int api_calibrateImu(Serial *serial, const jsmntok_t *json);
 int api_flashConfig(Serial *serial, const jsmntok_t *json);
 int api_setLogfileLevel(Serial *serial, const jsmntok_t *json);
+int api_setStreamFormat(Serial *serial, const jsmntok_t *json);
 int api_getLogfile(Serial *serial, const jsmntok_t *json);
 int api_getTrackDb(Serial *serial, const jsmntok_t *json);
 int api_addTrackDb(Serial *serial, const jsmntok_t *json);
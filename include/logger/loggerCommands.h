@@ -34,7 +34,14 @@ CPP_GUARD_BEGIN
 {"startTerminal", "Starts a debugging terminal session on the specified port.","<port> <baud> [echo 1|0]", StartTerminal },\
 {"viewLog", "Prints out logging messages to the terminal as they happen", "", ViewLog },\
 {"setLogLevel", "Sets the log level", "<level>", SetLogLevel },\
-{"logGpsData", "Enables logging of raw GPS data from the GPS Mouse", "<1|0>", LogGpsData }
+{"logGpsData", "Enables logging of raw GPS data from the GPS Mouse", "<1|0>", LogGpsData }, \
+{"staggerSampling", "Spreads channels of the same sample rate across ticks", "<1|0>", StaggerSampling }, \
+{"setPreroll", "Sets how many ms of samples to keep ahead of a log start", "<ms>", SetPreroll }, \
+{"setLogFormat", "Sets the SD log file format for the next log. 1 = CSV, 2 = binary, 3 = compressed binary", "<1|2|3>", SetLogFormat }, \
+{"setLogPrealloc", "Sets how many minutes of logging to reserve SD space for at journaled log start", "<minutes>", SetLogPrealloc }, \
+{"setLogJournal", "Writes log files so they survive a power cut, from the next log start", "<1|0>", SetLogJournal }, \
+{"setLogLossBudget", "Sets how many ms of samples a power cut may cost, trading off SD syncs", "<ms>", SetLogLossBudget }, \
+{"setLogRotate", "Sets how long or big a log file gets before rolling over to the next. 0 for no limit", "<minutes> <KB>", SetLogRotate }
 
 void ResetConfig(Serial *serial, unsigned int argc, char **argv);
 void TestSD(Serial *serial, unsigned int argc, char **argv);
@@ -43,6 +50,13 @@ void StartTerminal(Serial *serial, unsigned int argc, char **argv);
 void ViewLog(Serial *serial, unsigned int argc, char **argv);
 void SetLogLevel(Serial *serial, unsigned int argc, char **argv);
 void LogGpsData(Serial *serial, unsigned int argc, char **argv);
+void StaggerSampling(Serial *serial, unsigned int argc, char **argv);
+void SetPreroll(Serial *serial, unsigned int argc, char **argv);
+void SetLogFormat(Serial *serial, unsigned int argc, char **argv);
+void SetLogPrealloc(Serial *serial, unsigned int argc, char **argv);
+void SetLogJournal(Serial *serial, unsigned int argc, char **argv);
+void SetLogLossBudget(Serial *serial, unsigned int argc, char **argv);
+void SetLogRotate(Serial *serial, unsigned int argc, char **argv);
 
 CPP_GUARD_END
 
@@ -49,6 +49,9 @@ CPP_GUARD_BEGIN
 #define SLOW_LINK_MAX_TELEMETRY_SAMPLE_RATE SAMPLE_10Hz
 #define FAST_LINK_MAX_TELEMETRY_SAMPLE_RATE SAMPLE_50Hz
 
+/* Slowest a congested link is throttled down to */
+#define MIN_TELEMETRY_SAMPLE_RATE SAMPLE_1Hz
+
 
 //standard sample rates based on OS timer ticks
 #define SAMPLE_1000Hz						(TICK_RATE_HZ / 1000)
@@ -62,7 +65,13 @@ CPP_GUARD_BEGIN
 #define SAMPLE_1Hz 							(TICK_RATE_HZ / 1)
 #define SAMPLE_DISABLED 					0
 
+/*
+ * Platforms may raise this in capabilities.h for finer grained scaling
+ * maps.  Note that doing so changes the layout of the stored config.
+ */
+#ifndef ANALOG_SCALING_BINS
 #define ANALOG_SCALING_BINS					5
+#endif
 
 #define SCALING_MODE_RAW					0
 #define SCALING_MODE_LINEAR					1
@@ -494,6 +503,8 @@ typedef struct _ConnectivityConfig {
 
 #define SD_LOGGING_MODE_DISABLED					0
 #define SD_LOGGING_MODE_CSV							1
+#define SD_LOGGING_MODE_BINARY						2
+#define SD_LOGGING_MODE_COMPRESSED					3
 
 
 typedef struct _LoggerConfig {
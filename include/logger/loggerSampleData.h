@@ -26,6 +26,7 @@
 #include "loggerConfig.h"
 #include "sampleRecord.h"
 
+#include <stdbool.h>
 #include <stddef.h>
 
 CPP_GUARD_BEGIN
@@ -33,15 +34,37 @@ CPP_GUARD_BEGIN
 /**
  * Populates a struct sample object with channel data.  Note this does not
  * handle the timestamping.  That is done by creation and association of
- * a LoggerMessage object.
+ * a LoggerMessage object.  Only the channels due on logTick are visited;
+ * ticks with nothing due return SAMPLE_DISABLED in constant time.
  */
 int populate_sample_buffer(struct sample *s, size_t logTick);
 
-void init_channel_sample_buffer(LoggerConfig *loggerConfig,
-                                struct sample *s);
+/**
+ * @return The highest sample rate of the channels in the table that are
+ * due on logTick, or SAMPLE_DISABLED if none are.  Does not read any
+ * channel data.
+ */
+int get_sample_rate_due(const struct channel_table *t, size_t logTick);
+
+/**
+ * Fills in the channel descriptors and sample schedule of a channel table
+ * whose storage has already been allocated for the enabled channels.
+ */
+void init_channel_descriptors(LoggerConfig *loggerConfig,
+                              struct channel_table *t);
 
 float get_mapped_value(float value, ScalingMap *scalingMap);
 
+/**
+ * Enables or disables phase staggered sampling.  When enabled, channels
+ * that share a sample rate are spread out across the ticks of their sample
+ * period instead of all being sampled on the same tick.  Each sample still
+ * carries the time it was actually taken.  Takes effect the next time the
+ * sample buffers are initialized.
+ */
+void set_staggered_sampling(const bool enable);
+bool is_staggered_sampling(void);
+
 CPP_GUARD_END
 
 #endif /* LOGGERSAMPLEDATA_H_ */
@@ -0,0 +1,97 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef LOGGERTIMING_H_
+#define LOGGERTIMING_H_
+
+#include "cpp_guard.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+CPP_GUARD_BEGIN
+
+/*
+ * Histogram buckets are powers of two in us.  Bucket 0 holds 0us, bucket
+ * n holds [2^(n-1), 2^n) us and the last bucket holds everything longer.
+ */
+#define TIMING_HISTOGRAM_BUCKETS	16
+
+enum timing_histogram_id {
+        /* From the tick interrupt to the start of sampling */
+        TIMING_TICK_TO_SAMPLE = 0,
+        /* How long populating a sample took */
+        TIMING_SAMPLE_DURATION,
+        TIMING_HISTOGRAMS,
+};
+
+struct timing_histogram {
+        uint32_t buckets[TIMING_HISTOGRAM_BUCKETS];
+        uint32_t count;
+        uint32_t max_us;
+        uint32_t total_us;
+};
+
+/**
+ * Timestamps the tick.  Safe to call from the tick ISR.
+ */
+void logger_timing_tick(void);
+
+/**
+ * Timestamps the start of sampling and records how late it is relative
+ * to the last tick.
+ */
+void logger_timing_sample_start(void);
+
+/**
+ * Timestamps the end of sampling.
+ * @param sampled true if a sample was actually taken.  Ticks where
+ * nothing was due aren't recorded so they don't swamp the histogram.
+ */
+void logger_timing_sample_end(const bool sampled);
+
+void logger_timing_reset(void);
+
+/**
+ * Adds a single duration to a histogram.
+ */
+void timing_histogram_add(struct timing_histogram *h, const uint32_t us);
+
+/**
+ * @return The upper bound in us of the given bucket, or 0 for the last
+ * bucket which has none.
+ */
+uint32_t timing_histogram_bucket_limit(const unsigned int bucket);
+
+/**
+ * @return The given count of cpu cycles in us.
+ */
+uint32_t timing_cycles_to_us(const uint32_t cycles);
+
+const struct timing_histogram* get_logger_timing_histogram(
+        const enum timing_histogram_id id);
+
+const char* get_logger_timing_histogram_name(const enum timing_histogram_id id);
+
+CPP_GUARD_END
+
+#endif /* LOGGERTIMING_H_ */
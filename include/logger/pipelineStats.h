@@ -0,0 +1,105 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef PIPELINESTATS_H_
+#define PIPELINESTATS_H_
+
+#include "capabilities.h"
+#include "cpp_guard.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+CPP_GUARD_BEGIN
+
+/*
+ * The consumers of logger samples.  Telemetry channels follow the file
+ * writer, one per connectivity channel.
+ */
+enum pipeline_consumer {
+        PIPELINE_CONSUMER_FILE = 0,
+        PIPELINE_CONSUMER_TELEMETRY,
+};
+
+#define PIPELINE_CONSUMERS	(PIPELINE_CONSUMER_TELEMETRY + CONNECTIVITY_CHANNELS)
+
+/*
+ * Sample flow counters for a single consumer.  Depths are in messages
+ * and latencies are in ms from the tick the sample was taken to when
+ * the consumer finished with it.
+ */
+struct pipeline_stats {
+        uint32_t queued;
+        uint32_t queue_failures;
+        uint32_t overruns;
+        uint32_t depth_max;
+        uint32_t depth_total;
+        uint32_t latency_count;
+        uint32_t latency_max;
+        uint32_t latency_total;
+};
+
+/**
+ * Clears all pipeline counters.
+ */
+void pipeline_stats_reset(void);
+
+/**
+ * Records an attempt to queue a sample to a consumer.
+ * @param consumer The consumer the sample was queued to.
+ * @param success true if the sample made it onto the queue.
+ * @param depth The depth of the queue after the attempt.
+ */
+void pipeline_stats_enqueue(const size_t consumer, const bool success,
+                            const size_t depth);
+
+/**
+ * Records a sample that was lost to the consumer because the logger had
+ * no free sample buffer to put it in.
+ */
+void pipeline_stats_overrun(const size_t consumer);
+
+/**
+ * Records how long it took a consumer to handle a sample.
+ * @param consumer The consumer that handled the sample.
+ * @param sample_ticks The tick the sample was taken on.
+ */
+void pipeline_stats_latency(const size_t consumer, const size_t sample_ticks);
+
+/**
+ * @return The counters for the given consumer, or NULL if there is no
+ * such consumer.
+ */
+const struct pipeline_stats* get_pipeline_stats(const size_t consumer);
+
+/**
+ * @return A short name for the consumer, suitable for reports.
+ */
+const char* get_pipeline_consumer_name(const size_t consumer);
+
+uint32_t get_pipeline_depth_avg(const struct pipeline_stats *ps);
+uint32_t get_pipeline_latency_avg(const struct pipeline_stats *ps);
+
+CPP_GUARD_END
+
+#endif /* PIPELINESTATS_H_ */
@@ -0,0 +1,90 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#ifndef PREROLL_H_
+#define PREROLL_H_
+
+#include "cpp_guard.h"
+#include "sampleRecord.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+CPP_GUARD_BEGIN
+
+/*
+ * The pre-roll buffer keeps the most recent samples around while we are
+ * not logging so that the moment a log starts the file begins with the
+ * samples leading up to the trigger.  Samples are stored packed (only
+ * the populated values) in a ring buffer of PREROLL_BUFFER_SIZE bytes.
+ * Only the file writer task may touch the buffer.
+ */
+
+/**
+ * Sets how much history to keep ahead of a log start.  The buffer is
+ * allocated and freed lazily by preroll_add.
+ * @param ms The amount of history in ms.  0 disables the pre-roll.
+ * Values above PREROLL_MAX_MS are clamped.
+ */
+void preroll_set_duration(const size_t ms);
+
+/**
+ * @return The amount of history in ms that the pre-roll keeps.
+ */
+size_t preroll_get_duration(void);
+
+/**
+ * @return true if the pre-roll has been asked to keep any history.
+ */
+bool is_preroll_enabled(void);
+
+/**
+ * Adds a sample to the pre-roll, evicting the oldest samples that fall
+ * out of the requested duration or that are in the way of the new one.
+ * @return true if the sample was stored, false otherwise.
+ */
+bool preroll_add(const struct sample *s);
+
+/**
+ * @return The channel table that the stored samples were built from, or
+ * NULL if there is nothing stored.
+ */
+struct channel_table* preroll_get_table(void);
+
+/**
+ * Removes the oldest stored sample and decodes it into the given sample.
+ * The sample must have been initialized from the table returned by
+ * preroll_get_table.  If the layout of the table changed since the
+ * samples were stored, they are discarded.
+ * @return true if a sample was decoded, false if none are left.
+ */
+bool preroll_get(struct sample *s);
+
+/**
+ * Discards all stored samples.
+ */
+void preroll_clear(void);
+
+CPP_GUARD_END
+
+#endif /* PREROLL_H_ */
@@ -27,9 +27,11 @@
 #include "FreeRTOS.h"
 #include "loggerConfig.h"
 #include "queue.h"
+#include "scalingTable.h"
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 CPP_GUARD_BEGIN
 
@@ -54,12 +56,31 @@ enum SampleData {
     SampleData_Float,
     SampleData_Double_Noarg,
     SampleData_Double,
+    SampleData_Float_Kernel,
 };
 
-typedef struct _ChannelSample {
+/*
+ * Scaling parameters resolved from a channel's configuration when the
+ * channel table is built.  Kernels read these instead of the config so
+ * that the per sample work is a single call.
+ */
+union sample_kernel {
+        struct {
+                float scale;
+                float offset;
+        } linear;
+        const struct scaling_table *map;
+        unsigned int pulses;
+};
+
+/*
+ * The static description of a logged channel: its configuration and how
+ * to read its value.  These live in a channel_table that is shared by all
+ * of the sample buffers built from it.
+ */
+typedef struct _ChannelDescriptor {
     ChannelConfig *cfg;
     size_t channelIndex;
-    bool populated;
 
     enum SampleData sampleData;
     union {
@@ -71,20 +92,90 @@ typedef struct _ChannelSample {
         long long (*get_longlong_sample_noarg)();
         float (*get_float_sample_noarg)();
         double (*get_double_sample_noarg)();
+        float (*get_float_sample_kernel)(const struct _ChannelDescriptor *);
     };
+    union sample_kernel kernel;
+} ChannelDescriptor;
 
-    union {
-        int valueInt;
-        long long valueLongLong;
-        float valueFloat;
-        double valueDouble;
-    };
-} ChannelSample;
+typedef union _ChannelValue {
+    int valueInt;
+    long long valueLongLong;
+    float valueFloat;
+    double valueDouble;
+} ChannelValue;
+
+/*
+ * The number of distinct sample rates we can schedule.  This matches the
+ * set of rates that encodeSampleRate will hand out (1Hz - 1000Hz).
+ */
+#define SAMPLE_RATE_BUCKETS	9
+
+/*
+ * A group of channels that share a sample rate and phase offset.  The
+ * group is due on every tick where tick % sample_rate == phase.  The
+ * indices of the channels live in the sample_schedule order list
+ * starting at first.
+ */
+struct rate_bucket {
+        unsigned short sample_rate;
+        unsigned short phase;
+        unsigned short first;
+        unsigned short count;
+};
 
+/*
+ * Precomputed sampling plan for a channel table.  Built once when the
+ * table is initialized so that each tick only touches the channels that
+ * are actually due.
+ */
+struct sample_schedule {
+        size_t last_tick;
+        size_t next_tick;
+        unsigned short bucket_count;
+        struct rate_bucket *buckets;
+        unsigned short always_first;
+        unsigned short always_count;
+        unsigned short *order;
+};
+
+/*
+ * capacity is how many channels the allocation can hold, so small config
+ * changes can be applied in place.  layout is a hash of the channels and
+ * their sample rates so callers can tell if a rebuild changed anything.
+ * readers counts the tasks reading the table outside of a sample, and
+ * rebuilding is set while the owner re-initializes it.  The two are
+ * mutually exclusive.
+ */
+struct channel_table {
+        size_t channel_count;
+        size_t capacity;
+        uint32_t layout;
+        ChannelDescriptor *channels;
+        struct sample_schedule schedule;
+        volatile unsigned short readers;
+        volatile bool rebuilding;
+};
+
+/* Channel tables grow in chunks so adding a channel rarely reallocates */
+#define CHANNEL_TABLE_CHUNK	8
+
+/* Number of 32 bit words needed for a populated bitmap of count channels */
+#define SAMPLE_BITMAP_WORDS(count)	(((count) + 31) / 32)
+
+/*
+ * A single sample.  Only the values and the bitmap of which of those
+ * values were populated live here; everything else is in the table.
+ * refs counts the consumers that have yet to release the sample.  The
+ * logger only re-uses a sample once refs drops back to 0.
+ */
 struct sample {
    size_t ticks;
    size_t channel_count;
-   ChannelSample *channel_samples;
+   size_t capacity;
+   struct channel_table *table;
+   ChannelValue *values;
+   uint32_t *populated;
+   volatile unsigned short refs;
 };
 
 typedef struct _LoggerMessage {
@@ -94,22 +185,83 @@ typedef struct _LoggerMessage {
 } LoggerMessage;
 
 /**
- * Initializes the struct sample channel_sample buffer for use.  May be called
- * again to re-initialize the space.
+ * Builds the shared channel table for the enabled channels of the given
+ * configuration.  May be called again to re-initialize the table, in which
+ * case the existing allocation is re-used if it is big enough.  Any
+ * struct sample built from the table must be re-initialized afterwards
+ * if the layout of the table changed.
+ * @param t Pointer to the struct channel_table to initialize.
+ * @param lc The logger configuration to build the table from.
+ * @return The amount of space allocated.
+ */
+size_t init_channel_table(struct channel_table *t, LoggerConfig *lc);
+
+/**
+ * Frees the memory associated with a channel table.  Call this like you
+ * would use a free method.
+ * @param t Pointer to the struct channel_table to reap.
+ */
+void free_channel_table(struct channel_table *t);
+
+/**
+ * Takes a read reference on a channel table so that it isn't rebuilt
+ * while the caller uses it.  Release it with release_channel_table.
+ * @return true if the reference was taken, false if the table is being
+ * rebuilt right now.
+ */
+bool acquire_channel_table(struct channel_table *t);
+
+/**
+ * Drops a read reference taken by acquire_channel_table.
+ */
+void release_channel_table(struct channel_table *t);
+
+/**
+ * Marks a channel table as being rebuilt, which keeps new readers out
+ * until end_channel_table_rebuild is called.
+ * @return true if the table may be rebuilt, false if a reader holds it.
+ */
+bool begin_channel_table_rebuild(struct channel_table *t);
+
+/**
+ * Lets readers back into a channel table after a rebuild.
+ */
+void end_channel_table_rebuild(struct channel_table *t);
+
+/**
+ * Initializes the value storage of a struct sample for the channels in
+ * the given table.  May be called again to re-initialize the space, in
+ * which case the existing allocation is re-used if it is big enough.
  * @param s Pointer to the struct sample to initialize.
- * @param count Number of channels that we are logging.
+ * @param t The channel table that describes the sample.
  * @return The amount of space allocated.
  */
-size_t init_sample_buffer(struct sample *s, const size_t count);
+size_t init_sample_buffer(struct sample *s, struct channel_table *t);
 
 /**
- * Frees the channel_sample buffer assocaited with the struct sample.  Also
+ * Frees the value storage associated with the struct sample.  Also
  * clears out the struct sample buffer values to indicated that the buffer has
  * been released.  Call this like you would use a free method.
  * @param s Pointer to the struct sample to reap.
  */
 void free_sample_buffer(struct sample *s);
 
+/**
+ * @return true if the value of the given channel index was populated in
+ * this sample, false otherwise.
+ */
+bool is_sample_populated(const struct sample *s, const size_t channel);
+
+/**
+ * Marks the value of the given channel index as populated.
+ */
+void set_sample_populated(struct sample *s, const size_t channel);
+
+/**
+ * Marks every value of the sample as not populated.
+ */
+void clear_sample_populated(struct sample *s);
+
 /**
  * Creates a LoggerMessage for use in the messaging between threads.
  * @param t The messaget type.
@@ -119,16 +271,15 @@ LoggerMessage create_logger_message(const enum LoggerMessageType t,
                                     struct sample *s);
 
 /**
- * Tests if the given LoggerMessage points to valid data by comparing
- * timestamps.
- * @param lm The LoggerMessage to validate
- * @return true if valid, false otherwise
+ * @return true if a consumer still holds a reference to the sample,
+ * false if the sample is free to be re-used.
  */
-bool is_sample_data_valid(const LoggerMessage *lm);
+bool is_sample_in_use(const struct sample *s);
 
 /**
- * Receives and validates a LoggerMessage from the provided queue.  If the
- * LoggerMessage is invalid, then it is ignored.
+ * Receives a LoggerMessage from the provided queue.  If the message carries
+ * a sample then the caller holds a reference to it and must hand it back
+ * with release_logger_message once done.
  * @param queue The Queue containing the message
  * @param lm The LoggerMessage structure to populate.
  * @param timeout The amount of time to wait before timing out.
@@ -139,26 +290,25 @@ char receive_logger_message(xQueueHandle queue, LoggerMessage *lm,
                             portTickType timeout);
 
 /**
- * Checks to ensure that the LoggerMessage object is pointing to a usable
- * data_sample structure.  This is needed because while the LoggerMessages are
- * deeply copied to their respective queues, the data_sample structures are not
- * (they are a part of a ring buffer).  So we must validate that the timestamp
- * on the LoggerMessage matches that of the data_sample object.
- * @param lm The LoggerMessage object.
- * @return True if the data_sample is usable, false otherwise.
+ * Drops the reference to the sample held by a received LoggerMessage.
+ * Safe to call on messages that have no sample.
+ * @param lm The LoggerMessage to release.
  */
-bool is_data_sample_valid(const LoggerMessage *lm);
+void release_logger_message(const LoggerMessage *lm);
 
 /**
  * Creates a brand new LoggerMessage queue.  This is useful for sending
  * LoggerMessage objects to all the little subscribers that need to get
- * them.
+ * them.  Since every queued sample pins a slot of the logger ring, the
+ * length bounds how much of the ring a stalled subscriber can hold.
+ * @param length The number of messages the queue can hold.
  * @return A newly allocated queue.
  */
-xQueueHandle create_logger_message_queue();
+xQueueHandle create_logger_message_queue(const size_t length);
 
 /**
- * Enqueues a LoggerMessage onto a provided queue.
+ * Enqueues a LoggerMessage onto a provided queue.  On success the sample
+ * of the message (if any) gains a reference that the receiver releases.
  * @param queue The queue to append the message to.
  * @param msg The message to put into the queue.
  * @return pdTRUE if successful, or an error code otherwise.
@@ -166,6 +316,15 @@ xQueueHandle create_logger_message_queue();
 portBASE_TYPE send_logger_message(const xQueueHandle queue,
                                   const LoggerMessage * const msg);
 
+/**
+ * Drops the samples waiting on a queue, releasing their references.
+ * Messages without a sample are put back in the order they came.  Meant
+ * for consumers that have stopped reading.
+ * @param queue The queue to flush.  May be NULL.
+ * @return The number of samples dropped.
+ */
+size_t flush_logger_message_queue(const xQueueHandle queue);
+
 CPP_GUARD_END
 
 #endif /* SAMPLERECORD_H_ */
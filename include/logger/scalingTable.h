@@ -0,0 +1,61 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#ifndef SCALINGTABLE_H_
+#define SCALINGTABLE_H_
+
+#include "cpp_guard.h"
+#include "loggerConfig.h"
+
+CPP_GUARD_BEGIN
+
+/*
+ * A ScalingMap compiled for fast lookups.  Segment i covers the values
+ * that have exactly i break points at or below them, so segment 0 and the
+ * last segment are the flat ends of the map.  Each segment stores its
+ * slope and intercept so a lookup is a short binary search followed by a
+ * multiply and add.
+ */
+struct scaling_table {
+        float raw[ANALOG_SCALING_BINS];
+        float slope[ANALOG_SCALING_BINS + 1];
+        float intercept[ANALOG_SCALING_BINS + 1];
+};
+
+/**
+ * Compiles the given scaling map into a scaling table.  This is where all
+ * of the division happens.  The raw values of the map must be in
+ * ascending order.
+ */
+void init_scaling_table(struct scaling_table *st, const ScalingMap *map);
+
+/**
+ * @return The scaled value of raw.  Values outside of the map are clamped
+ * to the scaled value of the closest end of the map.
+ */
+float get_scaling_table_value(const struct scaling_table *st,
+                              const float raw);
+
+CPP_GUARD_END
+
+#endif /* SCALINGTABLE_H_ */
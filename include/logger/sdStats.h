@@ -0,0 +1,97 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#ifndef SDSTATS_H_
+#define SDSTATS_H_
+
+#include "cpp_guard.h"
+#include "loggerTiming.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+CPP_GUARD_BEGIN
+
+/*
+ * How the SD card is keeping up with the file writer.  Write latencies
+ * are per f_write call, which the sector buffer keeps to whole sectors,
+ * and sync latencies are per f_sync.
+ */
+struct sd_stats {
+        struct timing_histogram write;
+        struct timing_histogram sync;
+        uint32_t bytes;
+        uint32_t errors;
+        uint32_t remounts;
+        uint32_t queue_depth_max;
+};
+
+/**
+ * Clears all SD card counters.
+ */
+void sd_stats_reset(void);
+
+/**
+ * @return A timestamp to hand to sd_stats_write or sd_stats_sync once
+ * the operation is done.
+ */
+uint32_t sd_stats_start(void);
+
+/**
+ * Records a single write to the card.
+ * @param start The timestamp from sd_stats_start.
+ * @param bytes How many bytes were written.
+ * @param ok true if the write succeeded.
+ */
+void sd_stats_write(const uint32_t start, const size_t bytes, const bool ok);
+
+/**
+ * Records a single sync of the log file.
+ * @param start The timestamp from sd_stats_start.
+ * @param ok true if the sync succeeded.
+ */
+void sd_stats_sync(const uint32_t start, const bool ok);
+
+/**
+ * Records the file writer giving up on the card and remounting it.
+ */
+void sd_stats_remount(void);
+
+/**
+ * Records the depth of the file writer queue after a message was put
+ * on it.
+ */
+void sd_stats_queue_depth(const size_t depth);
+
+const struct sd_stats* get_sd_stats(void);
+
+/**
+ * @return The rate in bytes per second the card took data at while it
+ * was being written to.
+ */
+uint32_t get_sd_write_rate(const struct sd_stats *ss);
+
+CPP_GUARD_END
+
+#endif /* SDSTATS_H_ */
@@ -0,0 +1,110 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#ifndef SECTORBUFFER_H_
+#define SECTORBUFFER_H_
+
+#include "cpp_guard.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+CPP_GUARD_BEGIN
+
+#define SECTOR_SIZE	512
+
+/**
+ * Writes len bytes of data to the file.
+ * @return 0 on success, non-zero otherwise.
+ */
+typedef int sector_write_func(const void *data, const size_t len);
+
+/*
+ * A set of blocks, each a multiple of SECTOR_SIZE, that are filled one
+ * after the other and written out whole.  Filling and writing are
+ * separate steps so that callers can format more data while full blocks
+ * wait to be written.  Blocks are kept aligned to the file offset so
+ * that every write of a full block ends on a sector boundary.
+ *
+ * first is the oldest full block and full is how many are waiting.  The
+ * block being filled follows them.  skip is how much of the oldest
+ * unwritten block was already written out by a flush.
+ */
+struct sector_buffer {
+        char *data;
+        size_t size;
+        size_t count;
+        size_t first;
+        size_t full;
+        size_t used;
+        size_t skip;
+};
+
+/**
+ * Allocates count blocks of size bytes.  size should be a multiple of
+ * SECTOR_SIZE.
+ * @return The number of bytes allocated, 0 on failure.
+ */
+size_t init_sector_buffer(struct sector_buffer *sb, const size_t size,
+                          const size_t count);
+
+/**
+ * Discards everything buffered and lines the blocks up with the given
+ * file offset, which is where the next byte will be written.
+ */
+void reset_sector_buffer(struct sector_buffer *sb, const size_t offset);
+
+/**
+ * Copies as much of data as there is free block space for.
+ * @return The number of bytes copied.
+ */
+size_t put_sector_buffer(struct sector_buffer *sb, const void *data,
+                         size_t len);
+
+/**
+ * @return The number of full blocks waiting to be written.
+ */
+size_t get_sector_buffer_full(const struct sector_buffer *sb);
+
+/**
+ * @return The number of bytes buffered that have not been written out.
+ */
+size_t get_sector_buffer_pending(const struct sector_buffer *sb);
+
+/**
+ * Writes out all of the full blocks.
+ * @return 0 on success, else the error of the write that failed.  The
+ * failed block is kept.
+ */
+int drain_sector_buffer(struct sector_buffer *sb, sector_write_func *write);
+
+/**
+ * Writes out everything buffered, including the partial block.  The
+ * partial block stays put so the blocks remain sector aligned.
+ * @return 0 on success, else the error of the write that failed.
+ */
+int flush_sector_buffer(struct sector_buffer *sb, sector_write_func *write);
+
+CPP_GUARD_END
+
+#endif /* SECTORBUFFER_H_ */
@@ -0,0 +1,99 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#ifndef TELEMETRYDELTA_H_
+#define TELEMETRYDELTA_H_
+
+#include "cpp_guard.h"
+#include "sampleRecord.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+CPP_GUARD_BEGIN
+
+/*
+ * Delta telemetry.  Instead of every populated channel, a sample goes
+ * out with only the channels whose value moved since it was last sent.
+ * Values are compared at the channel's own precision, so the deadband
+ * is one unit of the last digit the channel shows: noise below what a
+ * reader could see never goes out.
+ *
+ * Nothing changes on the wire.  The populated bitmap of both the JSON
+ * and the binary stream already says which channels a sample carries;
+ * a reader keeps the last value of the ones that are missing.  Every
+ * keyframe_interval samples, and whenever meta goes out, a keyframe
+ * sends everything so a reader that joins late catches up.
+ */
+struct telemetry_delta {
+        size_t keyframe_interval;
+        size_t since_keyframe;
+        const struct channel_table *table;
+        uint32_t layout;
+        size_t channel_count;
+        size_t capacity;
+        /* Last value sent per channel, packed by binary_log_packed_value */
+        int64_t *last;
+        /* Channels that have a last value */
+        uint32_t *known;
+        /* The populated bitmap handed out with the filtered sample */
+        uint32_t *send;
+};
+
+/**
+ * Sets up the delta state for a connection.
+ * @param keyframe_interval Samples between keyframes.  0 turns delta
+ * telemetry off and every sample goes out in full.
+ */
+void telemetry_delta_init(struct telemetry_delta *d,
+                          const size_t keyframe_interval);
+
+/**
+ * Frees the last sent values.  The state can be used again after.
+ */
+void telemetry_delta_free(struct telemetry_delta *d);
+
+/**
+ * Forgets what was sent, so that the next sample is a keyframe.  For
+ * when the other end of the connection changes.
+ */
+void telemetry_delta_reset(struct telemetry_delta *d);
+
+/**
+ * Picks the channels of a sample worth sending.
+ * @param s The sample as it came from the logger.
+ * @param view Storage for the filtered sample.
+ * @param keyframe true to send every populated channel regardless.
+ * @return The sample to send.  Either s itself or view, which shares
+ * its values with s but carries a populated bitmap of just the changed
+ * channels.  Valid until the next call.
+ */
+struct sample* telemetry_delta_filter(struct telemetry_delta *d,
+                                      struct sample *s,
+                                      struct sample *view,
+                                      bool keyframe);
+
+CPP_GUARD_END
+
+#endif /* TELEMETRYDELTA_H_ */
@@ -0,0 +1,136 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#ifndef TELEMETRYFRAME_H_
+#define TELEMETRYFRAME_H_
+
+#include "cpp_guard.h"
+#include "serial.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+CPP_GUARD_BEGIN
+
+/*
+ * The binary telemetry stream.  A connection starts out streaming JSON
+ * sample records and switches once the other end asks for binary with
+ * the setStreamFmt API.  API replies stay JSON, so a reader tells them
+ * apart by the first byte: JSON starts with '{', frames with the sync.
+ * All values are little endian.
+ *
+ * A frame is:
+ *
+ *   uint8_t  sync[2]          TELEMETRY_FRAME_SYNC
+ *   uint8_t  type             enum telemetry_frame_type
+ *   uint16_t len              Of the payload
+ *   uint8_t  payload[len]
+ *   uint32_t crc              CRC-32 of type, len and payload
+ *
+ * A TELEMETRY_FRAME_META payload describes the channels:
+ *
+ *   uint32_t hash             FNV-1a of the rest of the payload
+ *   uint16_t channel_count
+ *
+ * followed by channel_count channel descriptions, laid out as in the
+ * binary log header (see binaryLog.h).
+ *
+ * A TELEMETRY_FRAME_SAMPLE payload is:
+ *
+ *   uint32_t tick             Counts samples sent on this connection
+ *   uint32_t hash             Of the meta frame describing the channels
+ *   uint32_t populated[]      SAMPLE_BITMAP_WORDS(channel_count) words
+ *   values                    Only the populated ones, in channel order,
+ *                             each binary_log_type_size bytes
+ *
+ * A meta frame goes out ahead of the first sample, whenever the channels
+ * change and whenever the JSON stream would have sent meta.  A reader
+ * that sees a hash it has no meta for drops samples until the next one.
+ */
+#define TELEMETRY_FRAME_SYNC	"\xa5\x5a"
+#define TELEMETRY_FRAME_SYNC_LEN	2
+/* Sync, type and len */
+#define TELEMETRY_FRAME_HEADER_LEN	5
+#define TELEMETRY_FRAME_CRC_LEN	4
+
+enum telemetry_format {
+        TELEMETRY_FORMAT_JSON = 0,
+        TELEMETRY_FORMAT_BINARY,
+        TELEMETRY_FORMATS,
+};
+
+enum telemetry_frame_type {
+        /* Not a frame.  Skip the bytes */
+        TELEMETRY_FRAME_NONE = 0,
+        TELEMETRY_FRAME_META,
+        TELEMETRY_FRAME_SAMPLE,
+};
+
+struct telemetry_frame {
+        enum telemetry_frame_type type;
+        uint16_t len;
+        const uint8_t *payload;
+};
+
+struct channel_table;
+struct sample;
+
+/**
+ * Sets how samples are streamed on a connection.  Connections stream
+ * JSON until told otherwise.
+ * @return true if the format was set, false if it is unknown or there
+ * are no streams left to track the connection with.
+ */
+bool telemetry_set_format(const Serial *serial,
+                          const enum telemetry_format format);
+
+enum telemetry_format telemetry_get_format(const Serial *serial);
+
+/**
+ * @return The hash a meta frame for the given channels would carry.
+ */
+uint32_t telemetry_meta_hash(const struct channel_table *t);
+
+/**
+ * Sends a sample as binary frames, preceded by a meta frame if one is
+ * due.
+ * @param tick The number of samples sent on this connection so far.
+ * @param send_meta true to send the meta frame regardless.
+ */
+void telemetry_send_sample(Serial *serial, const struct sample *s,
+                           const unsigned int tick, const bool send_meta);
+
+/**
+ * Looks for a frame at the start of buf.
+ * @return The number of bytes of buf the frame took up, or 0 if buf
+ * only holds the start of a frame so far.  If f->type comes back as
+ * TELEMETRY_FRAME_NONE the bytes were not a valid frame and should be
+ * skipped.
+ */
+size_t telemetry_frame_parse(const uint8_t *buf, const size_t len,
+                             struct telemetry_frame *f);
+
+CPP_GUARD_END
+
+#endif /* TELEMETRYFRAME_H_ */
@@ -0,0 +1,119 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+
+#ifndef TELEMETRYRATE_H_
+#define TELEMETRYRATE_H_
+
+#include "capabilities.h"
+#include "cpp_guard.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+CPP_GUARD_BEGIN
+
+/* How often, in ticks, each sink's rate is reconsidered */
+#define TELEMETRY_RATE_WINDOW		TICK_RATE_HZ
+
+/* Quiet windows in a row before a sink is tried one rate faster */
+#define TELEMETRY_RATE_UP_WINDOWS	5
+
+/*
+ * Adaptive sample rate of a single telemetry sink.  Rates are encoded
+ * like the channel sample rates, in ticks per sample, so a larger rate
+ * is a slower one.
+ *
+ * The logger measures the sink's queue as it hands it samples, and the
+ * sink counts the samples it finishes.  At the end of every window a
+ * sink whose queue refused a sample or filled past half steps down to
+ * the fastest rate it actually drained, and at least one rate slower.
+ * A sink whose queue stayed empty for TELEMETRY_RATE_UP_WINDOWS steps
+ * back up one rate at a time.
+ */
+struct telemetry_rate {
+        int max_rate;
+        int min_rate;
+        int rate;
+        size_t window_start;
+        uint32_t failures;
+        size_t depth_max;
+        unsigned int quiet_windows;
+        uint32_t drained_last;
+        /* Only ever written by the sink's own task */
+        volatile uint32_t drained;
+};
+
+/**
+ * Sets the bounds of a sink and starts it at the fastest of them.
+ * @param max_rate The fastest rate allowed.  SAMPLE_DISABLED sends
+ * nothing.
+ * @param min_rate The slowest rate the sink may be throttled to.
+ */
+void telemetry_rate_init(struct telemetry_rate *r, const int max_rate,
+                         const int min_rate);
+
+/**
+ * @param sampled_rate The fastest rate of the channels sampled on ticks.
+ * @return true if the sample taken on ticks should go to the sink.
+ * Always false for a sink that is disabled.
+ */
+bool telemetry_rate_is_due(const struct telemetry_rate *r,
+                           const int sampled_rate, const size_t ticks);
+
+/**
+ * Records an attempt to queue a sample to the sink.
+ * @param success true if the sample made it onto the queue.
+ * @param depth The depth of the queue after the attempt.
+ */
+void telemetry_rate_enqueue(struct telemetry_rate *r, const bool success,
+                            const size_t depth);
+
+/**
+ * Records a sample the sink finished with.  Called by the sink's task.
+ */
+void telemetry_rate_drained(struct telemetry_rate *r);
+
+/**
+ * Steps the rate if a window has passed since the last step.
+ * @param queue_length The number of messages the sink's queue holds.
+ * @return true if the rate changed.
+ */
+bool telemetry_rate_update(struct telemetry_rate *r, const size_t ticks,
+                           const size_t queue_length);
+
+/**
+ * @return The rate of the given connectivity channel, or NULL if there
+ * is no such channel.
+ */
+struct telemetry_rate* get_telemetry_rate(const size_t channel);
+
+/**
+ * Sets the bounds of every connectivity channel.
+ */
+void telemetry_rate_init_all(const int max_rate, const int min_rate);
+
+CPP_GUARD_END
+
+#endif /* TELEMETRYRATE_H_ */
@@ -50,6 +50,8 @@ typedef struct _Serial {
 
     void (*put_c)(char c);
     void (*put_s)(const char *);
+    /* Hands over a whole block at once.  Much cheaper than put_c */
+    void (*write)(const char *data, size_t len);
 
     void (*flush)(void);
 
@@ -110,7 +112,7 @@ void put_nameIndexString(Serial * serial, const char *s, int i, const char *v);
 
 void put_nameEscapedString(Serial * serial, const char *s, const char *v, int length);
 
-void put_bytes(Serial *serial, char *data, unsigned int length);
+void put_bytes(Serial *serial, const char *data, size_t length);
 
 void put_crlf(const Serial * serial);
 
@@ -54,6 +54,8 @@ void usart0_putchar(char c);
 
 void usart0_puts (const char* s );
 
+void usart0_write(const char *data, size_t len);
+
 int usart0_readLine(char *s, int len);
 
 int usart0_readLineWait(char *s, int len, size_t delay);
@@ -69,6 +71,8 @@ void usart1_putchar(char c);
 
 void usart1_puts (const char* s );
 
+void usart1_write(const char *data, size_t len);
+
 int usart1_readLine(char *s, int len);
 
 int usart1_readLineWait(char *s, int len, size_t delay);
@@ -84,6 +88,8 @@ void usart2_putchar(char c);
 
 void usart2_puts (const char* s );
 
+void usart2_write(const char *data, size_t len);
+
 int usart2_readLine(char *s, int len);
 
 int usart2_readLineWait(char *s, int len, size_t delay);
@@ -99,6 +105,8 @@ void usart3_putchar(char c);
 
 void usart3_puts (const char* s );
 
+void usart3_write(const char *data, size_t len);
+
 int usart3_readLine(char *s, int len);
 
 int usart3_readLineWait(char *s, int len, size_t delay);
@@ -25,6 +25,8 @@
 #include "cpp_guard.h"
 #include "FreeRTOS.h"
 
+#include <stddef.h>
+
 CPP_GUARD_BEGIN
 
 int USB_CDC_device_init(const int priority);
@@ -33,6 +35,8 @@ void USB_CDC_send_debug(portCHAR *string);
 
 void USB_CDC_SendByte( portCHAR cByte );
 
+void USB_CDC_SendBytes(const portCHAR *data, size_t len);
+
 portBASE_TYPE USB_CDC_ReceiveByte(portCHAR *data);
 
 portBASE_TYPE USB_CDC_ReceiveByteDelay(portCHAR *data, portTickType delay );
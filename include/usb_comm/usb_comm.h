@@ -51,6 +51,8 @@ void usb_putchar(char c);
 
 void usb_puts(const char* s );
 
+void usb_write(const char *data, size_t len);
+
 CPP_GUARD_END
 
 #endif /*USB_COMM_H_*/
@@ -0,0 +1,50 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _CHECKSUM_H_
+#define _CHECKSUM_H_
+
+#include "cpp_guard.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+CPP_GUARD_BEGIN
+
+#define CHECKSUM_FNV1A_INIT	2166136261u
+
+/**
+ * Folds len bytes of data into a 32 bit FNV-1a hash.  Start with
+ * CHECKSUM_FNV1A_INIT and chain calls to hash several regions.  Not
+ * suitable for detecting malicious changes, only accidental ones.
+ */
+uint32_t checksum_fnv1a(uint32_t hash, const void *data, size_t len);
+
+/**
+ * Folds len bytes of data into a standard (IEEE 802.3) CRC-32.  Start
+ * with 0 and chain calls to cover several regions.
+ */
+uint32_t checksum_crc32(uint32_t crc, const void *data, size_t len);
+
+CPP_GUARD_END
+
+#endif /* _CHECKSUM_H_ */
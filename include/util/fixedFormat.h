@@ -0,0 +1,72 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#ifndef _FIXEDFORMAT_H_
+#define _FIXEDFORMAT_H_
+
+#include "cpp_guard.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+CPP_GUARD_BEGIN
+
+/*
+ * Formats channel values with a known precision.  The value is split
+ * once into integer whole and 10^-precision parts, then the digits are
+ * written two at a time from a table, in place.  Output is the same as
+ * modp_ftoa() and modp_dtoa(), trailing zero trimming and rounding ties
+ * included, so they can be swapped freely.
+ */
+
+#define FIXED_MAX_PRECISION	9
+
+/* Sign, 20 digits, the point, the fraction and the terminator */
+#define FIXED_FORMAT_BUF_LEN	(1 + 20 + 1 + FIXED_MAX_PRECISION + 1)
+
+/**
+ * Scales value to an integer count of 10^-precision units, rounding
+ * like modp_ftoa() and modp_dtoa() do.  Values out of range saturate.
+ * @param single Do the fraction math at float precision like modp_ftoa().
+ */
+int64_t fixed_scale(double value, int precision, const bool single);
+
+/**
+ * Drop in for modp_ftoa() that returns where the string ends.
+ * @param buf At least FIXED_FORMAT_BUF_LEN chars.
+ * @return The length of the string written to buf.
+ */
+size_t fixed_ftoa(const float value, char *buf, const int precision);
+
+/**
+ * Drop in for modp_dtoa() that returns where the string ends.  Like
+ * modp_dtoa(), magnitudes past INT64_MAX print as 3735928559.
+ * @param buf At least FIXED_FORMAT_BUF_LEN chars.
+ * @return The length of the string written to buf.
+ */
+size_t fixed_dtoa(const double value, char *buf, const int precision);
+
+CPP_GUARD_END
+
+#endif /* _FIXEDFORMAT_H_ */
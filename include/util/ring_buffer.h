@@ -41,6 +41,13 @@ struct ring_buff {
  * @return The number of bytes copied.
  */
 size_t get_data(struct ring_buff *rb, void *data, size_t size);
+
+/**
+ * Copies size bytes from the ring buffer into data without removing
+ * them from the buffer.
+ * @return The number of bytes copied.
+ */
+size_t peek_data(struct ring_buff *rb, void *data, size_t size);
 size_t get_space(struct ring_buff *rb);
 size_t get_used(struct ring_buff *rb);
 bool have_space(struct ring_buff *rb, size_t size);
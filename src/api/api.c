@@ -22,6 +22,7 @@
 
 #include "api.h"
 #include "constants.h"
+#include "jsonWriter.h"
 #include "printk.h"
 #include "mod_string.h"
 
@@ -37,149 +38,16 @@ void initApi()
     jsmn_init(&g_jsonParser);
 }
 
-static void putQuotedStr(const Serial *serial, const char *str)
-{
-    serial->put_c('"');
-    serial->put_s(str);
-    serial->put_c('"');
-}
-
-static void putKeyAndColon(const Serial *serial, const char *key)
-{
-    putQuotedStr(serial, key);
-    serial->put_c(':');
-}
-
-static void putNull(Serial *serial)
-{
-    serial->put_s("null");
-}
-
-static void putCommaIfNecessary(const Serial *serial, int necessary)
-{
-    if (necessary)
-        serial->put_c(',');
-}
-
-void json_valueStart(Serial *serial, const char *name)
-{
-    putKeyAndColon(serial, name);
-}
-
-void json_null(Serial *serial, const char *name, int more)
-{
-    putKeyAndColon(serial, name);
-    putNull(serial);
-    putCommaIfNecessary(serial, more);
-}
-
-void json_int(Serial *serial, const char *name, int value, int more)
-{
-    putKeyAndColon(serial, name);
-    put_int(serial, value);
-    putCommaIfNecessary(serial, more);
-}
-
-void json_uint(Serial *serial, const char *name, unsigned int value, int more)
-{
-    putKeyAndColon(serial, name);
-    put_uint(serial, value);
-    putCommaIfNecessary(serial, more);
-}
-
-void json_escapedString(Serial *serial, const char *name, const char *value, int more)
-{
-    putKeyAndColon(serial, name);
-    serial->put_c('"');
-    put_escapedString(serial, value, strlen(value));
-    serial->put_c('"');
-    putCommaIfNecessary(serial, more);
-}
-
-void json_string(Serial *serial, const char *name, const char *value, int more)
-{
-    putKeyAndColon(serial, name);
-
-    if (value) {
-        putQuotedStr(serial, value);
-    } else {
-        putNull(serial);
-    }
-
-    putCommaIfNecessary(serial, more);
-}
-
-void json_float(Serial *serial, const char *name, float value, int precision, int more)
-{
-    putKeyAndColon(serial, name);
-    put_float(serial, value, precision);
-    putCommaIfNecessary(serial, more);
-}
-
-void json_objStartString(Serial *serial, const char *label)
-{
-    putKeyAndColon(serial, label);
-    serial->put_c('{');
-}
-
-// Call itoa here and use above?
-void json_objStartInt(Serial *serial, int label)
-{
-    serial->put_c('"');
-    put_int(serial, label);
-    serial->put_s("\":{");
-}
-
-void json_objStart(Serial *serial)
-{
-    serial->put_c('{');
-}
-
-void json_objEnd(Serial *serial, int more)
-{
-    serial->put_c('}');
-    putCommaIfNecessary(serial, more);
-}
-
-void json_arrayStart(Serial *serial, const char * name)
-{
-    if (name != NULL)
-        putKeyAndColon(serial, name);
-
-    serial->put_c('[');
-}
-
-void json_arrayElementString(Serial *serial, const char *value, int more)
-{
-    putQuotedStr(serial, value);
-    putCommaIfNecessary(serial, more);
-}
-
-void json_arrayElementInt(Serial *serial, int value, int more)
-{
-    put_int(serial, value);
-    putCommaIfNecessary(serial, more);
-}
-
-void json_arrayElementFloat(Serial *serial, float value, int precision, int more)
-{
-    put_float(serial, value, precision);
-    putCommaIfNecessary(serial, more);
-}
-
-void json_arrayEnd(Serial *serial, int more)
-{
-    serial->put_c(']');
-    putCommaIfNecessary(serial, more);
-}
-
 void json_sendResult(Serial *serial, const char *messageName, int resultCode)
 {
-    json_objStart(serial);
-    json_objStartString(serial, messageName);
-    json_int(serial, "rc", resultCode, 0);
-    json_objEnd(serial, 0);
-    json_objEnd(serial, 0);
+    struct json_writer w;
+    jw_open(&w, serial);
+    jw_obj_start(&w, NULL);
+    jw_obj_start(&w, messageName);
+    jw_int(&w, "rc", resultCode);
+    jw_obj_end(&w);
+    jw_obj_end(&w);
+    jw_close(&w);
 }
 
 static int dispatch_api(Serial *serial, const char * apiMsgName, const jsmntok_t *apiPayload)
@@ -0,0 +1,292 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "FreeRTOS.h"
+#include "fixedFormat.h"
+#include "jsonWriter.h"
+#include "mod_string.h"
+#include "modp_numtoa.h"
+#include "task.h"
+
+#include <stdbool.h>
+
+static char g_pool[JSON_WRITER_POOL_SIZE][JSON_WRITER_BUFFER_SIZE];
+static bool g_pool_used[JSON_WRITER_POOL_SIZE];
+
+void jw_init(struct json_writer *w, Serial *serial, char *buf, size_t size)
+{
+        w->serial = serial;
+        w->buf = buf;
+        w->size = buf ? size : 0;
+        w->len = 0;
+        w->pool_slot = -1;
+        w->depth = 0;
+        w->members = 0;
+}
+
+void jw_open(struct json_writer *w, Serial *serial)
+{
+        int slot = -1;
+
+        /* API requests come in on several tasks at once */
+        taskENTER_CRITICAL();
+        for (int i = 0; i < JSON_WRITER_POOL_SIZE; ++i) {
+                if (!g_pool_used[i]) {
+                        g_pool_used[i] = true;
+                        slot = i;
+                        break;
+                }
+        }
+        taskEXIT_CRITICAL();
+
+        if (slot < 0) {
+                jw_init(w, serial, NULL, 0);
+                return;
+        }
+
+        jw_init(w, serial, g_pool[slot], JSON_WRITER_BUFFER_SIZE);
+        w->pool_slot = slot;
+}
+
+void jw_close(struct json_writer *w)
+{
+        jw_flush(w);
+
+        if (w->pool_slot >= 0) {
+                taskENTER_CRITICAL();
+                g_pool_used[w->pool_slot] = false;
+                taskEXIT_CRITICAL();
+        }
+
+        jw_init(w, w->serial, NULL, 0);
+}
+
+void jw_flush(struct json_writer *w)
+{
+        if (!w->len)
+                return;
+
+        w->serial->write(w->buf, w->len);
+        w->len = 0;
+}
+
+void jw_raw(struct json_writer *w, const char *data, size_t len)
+{
+        if (!len)
+                return;
+
+        if (len > w->size - w->len) {
+                jw_flush(w);
+
+                /* Too big to ever fit, so skip the copy */
+                if (len > w->size) {
+                        w->serial->write(data, len);
+                        return;
+                }
+        }
+
+        memcpy(w->buf + w->len, data, len);
+        w->len += len;
+}
+
+static void put_c(struct json_writer *w, const char c)
+{
+        if (w->len < w->size)
+                w->buf[w->len++] = c;
+        else
+                jw_raw(w, &c, 1);
+}
+
+static void put_s(struct json_writer *w, const char *s)
+{
+        jw_raw(w, s, strlen(s));
+}
+
+static void put_quoted(struct json_writer *w, const char *s)
+{
+        put_c(w, '"');
+        put_s(w, s);
+        put_c(w, '"');
+}
+
+static uint32_t depth_bit(const struct json_writer *w)
+{
+        return w->depth < JSON_WRITER_MAX_DEPTH ? 1u << w->depth : 0;
+}
+
+/*
+ * Everything that goes into an object or array comes through here.
+ * The first member at each level goes without a comma.
+ */
+void jw_key(struct json_writer *w, const char *name)
+{
+        const uint32_t bit = depth_bit(w);
+
+        if (w->members & bit)
+                put_c(w, ',');
+        w->members |= bit;
+
+        if (name) {
+                put_quoted(w, name);
+                put_c(w, ':');
+        }
+}
+
+static void open_level(struct json_writer *w, const char c)
+{
+        put_c(w, c);
+        ++w->depth;
+        w->members &= ~depth_bit(w);
+}
+
+static void close_level(struct json_writer *w, const char c)
+{
+        if (w->depth)
+                --w->depth;
+        put_c(w, c);
+}
+
+void jw_obj_start(struct json_writer *w, const char *name)
+{
+        jw_key(w, name);
+        open_level(w, '{');
+}
+
+void jw_obj_start_int(struct json_writer *w, int label)
+{
+        char buf[12];
+
+        modp_itoa10(label, buf);
+        jw_obj_start(w, buf);
+}
+
+void jw_obj_end(struct json_writer *w)
+{
+        close_level(w, '}');
+}
+
+void jw_array_start(struct json_writer *w, const char *name)
+{
+        jw_key(w, name);
+        open_level(w, '[');
+}
+
+void jw_array_end(struct json_writer *w)
+{
+        close_level(w, ']');
+}
+
+void jw_null(struct json_writer *w, const char *name)
+{
+        jw_key(w, name);
+        put_s(w, "null");
+}
+
+void jw_int(struct json_writer *w, const char *name, int value)
+{
+        char buf[12];
+
+        jw_key(w, name);
+        modp_itoa10(value, buf);
+        put_s(w, buf);
+}
+
+void jw_uint(struct json_writer *w, const char *name, unsigned int value)
+{
+        char buf[12];
+
+        jw_key(w, name);
+        modp_uitoa10(value, buf);
+        put_s(w, buf);
+}
+
+void jw_ll(struct json_writer *w, const char *name, long long value)
+{
+        char buf[21];
+
+        jw_key(w, name);
+        modp_ltoa10(value, buf);
+        put_s(w, buf);
+}
+
+void jw_float(struct json_writer *w, const char *name, float value,
+              int precision)
+{
+        char buf[FIXED_FORMAT_BUF_LEN];
+
+        jw_key(w, name);
+        jw_raw(w, buf, fixed_ftoa(value, buf, precision));
+}
+
+void jw_double(struct json_writer *w, const char *name, double value,
+               int precision)
+{
+        char buf[FIXED_FORMAT_BUF_LEN];
+
+        jw_key(w, name);
+        jw_raw(w, buf, fixed_dtoa(value, buf, precision));
+}
+
+void jw_string(struct json_writer *w, const char *name, const char *value)
+{
+        jw_key(w, name);
+
+        if (value)
+                put_quoted(w, value);
+        else
+                put_s(w, "null");
+}
+
+void jw_escaped_string(struct json_writer *w, const char *name,
+                       const char *value)
+{
+        const char *run = value;
+
+        jw_key(w, name);
+        put_c(w, '"');
+
+        /* Same escapes as put_escapedString */
+        for (; *value; ++value) {
+                const char *escape;
+
+                switch (*value) {
+                case '\n':
+                        escape = "\\n";
+                        break;
+                case '\r':
+                        escape = "\\r";
+                        break;
+                case '"':
+                        escape = "\\\"";
+                        break;
+                default:
+                        continue;
+                }
+
+                jw_raw(w, run, value - run);
+                put_s(w, escape);
+                run = value + 1;
+        }
+
+        jw_raw(w, run, value - run);
+        put_c(w, '"');
+}
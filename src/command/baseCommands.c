@@ -29,7 +29,10 @@
 #include "luaTask.h"
 #include "mem_mang.h"
 #include "memory.h"
+#include "pipelineStats.h"
+#include "sdStats.h"
 #include "task.h"
+#include "telemetryRate.h"
 
 extern unsigned int _CONFIG_HEAP_SIZE;
 
@@ -83,9 +86,85 @@ void ShowStats(Serial *serial, unsigned int argc, char **argv)
     put_int(serial, sizeof(LoggerConfig));
     put_crlf(serial);
 
-    putDataRowHeader(serial, "Size of ChannelSample");
-    put_int(serial, sizeof(ChannelSample));
+    putDataRowHeader(serial, "Size of ChannelDescriptor");
+    put_int(serial, sizeof(ChannelDescriptor));
     put_crlf(serial);
+
+    putDataRowHeader(serial, "Size of ChannelValue");
+    put_int(serial, sizeof(ChannelValue));
+    put_crlf(serial);
+}
+
+static void putStatRow(Serial *serial, const char *str,
+                       const unsigned int value)
+{
+    putDataRowHeader(serial, str);
+    put_uint(serial, value);
+    put_crlf(serial);
+}
+
+void ShowPipelineStats(Serial *serial, unsigned int argc, char **argv)
+{
+    for (size_t i = 0; i < PIPELINE_CONSUMERS; ++i) {
+        const struct pipeline_stats *ps = get_pipeline_stats(i);
+
+        putHeader(serial, get_pipeline_consumer_name(i));
+        putStatRow(serial, "Samples Queued", ps->queued);
+        putStatRow(serial, "Queue Failures", ps->queue_failures);
+        putStatRow(serial, "Buffer Overruns", ps->overruns);
+        putStatRow(serial, "Max Queue Depth", ps->depth_max);
+        putStatRow(serial, "Avg Queue Depth", get_pipeline_depth_avg(ps));
+        putStatRow(serial, "Max Latency (ms)", ps->latency_max);
+        putStatRow(serial, "Avg Latency (ms)", get_pipeline_latency_avg(ps));
+
+        if (i >= PIPELINE_CONSUMER_TELEMETRY) {
+            const struct telemetry_rate *tr =
+                get_telemetry_rate(i - PIPELINE_CONSUMER_TELEMETRY);
+            putStatRow(serial, "Sample Rate (Hz)", decodeSampleRate(tr->rate));
+        }
+    }
+}
+
+static void putHistogram(Serial *serial, const char *name,
+                         const struct timing_histogram *h)
+{
+    putHeader(serial, name);
+    putStatRow(serial, "Count", h->count);
+    putStatRow(serial, "Max (us)", h->max_us);
+    putStatRow(serial, "Avg (us)", h->count ? h->total_us / h->count : 0);
+
+    for (unsigned int b = 0; b < TIMING_HISTOGRAM_BUCKETS; ++b) {
+        const uint32_t limit = timing_histogram_bucket_limit(b);
+
+        if (!h->buckets[b])
+            continue;
+
+        if (limit) {
+            serial->put_s("< ");
+            put_uint(serial, limit);
+        } else {
+            serial->put_s(">= ");
+            put_uint(serial, timing_histogram_bucket_limit(b - 1));
+        }
+        serial->put_s(" us : ");
+        put_uint(serial, h->buckets[b]);
+        put_crlf(serial);
+    }
+}
+
+void ShowSdStats(Serial *serial, unsigned int argc, char **argv)
+{
+    const struct sd_stats *ss = get_sd_stats();
+
+    putHistogram(serial, "SD Writes", &ss->write);
+    putHistogram(serial, "SD Syncs", &ss->sync);
+
+    putHeader(serial, "SD Card");
+    putStatRow(serial, "Bytes Written", ss->bytes);
+    putStatRow(serial, "Write Rate (B/s)", get_sd_write_rate(ss));
+    putStatRow(serial, "Errors", ss->errors);
+    putStatRow(serial, "Remounts", ss->remounts);
+    putStatRow(serial, "Max Queue Depth", ss->queue_depth_max);
 }
 
 void ShowTaskInfo(Serial *serial, unsigned int argc, char **argv)
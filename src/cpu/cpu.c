@@ -37,3 +37,13 @@ const char * cpu_get_serialnumber(void)
 {
     return cpu_device_get_serialnumber();
 }
+
+uint32_t cpu_get_cycle_count(void)
+{
+    return cpu_device_get_cycle_count();
+}
+
+uint32_t cpu_get_cycles_per_us(void)
+{
+    return cpu_device_get_cycles_per_us();
+}
@@ -29,6 +29,7 @@
 #include "dateTime.h"
 #include "taskUtil.h"
 #include "api.h"
+#include "jsonWriter.h"
 #include "capabilities.h"
 #include "constants.h"
 #include "cpu.h"
@@ -60,16 +61,19 @@ static int writeAuthJSON(Serial *serial, const char *deviceId)
         serial->put_s(" ");
         delayMs(250);
     }
-    json_objStart(serial);
-    json_objStartString(serial, "auth");
-    json_string(serial, "deviceId", deviceId, 1);
-    json_int(serial, "apiVer", API_REV, 1);
-    json_string(serial, "device", DEVICE_NAME, 1);
-    json_string(serial, "ver", VERSION_STR, 1);
-    json_string(serial, "sn", cpu_get_serialnumber(), 0);
-    json_objEnd(serial, 0);
-    json_objEnd(serial, 0);
-    serial->put_c('\n');
+    struct json_writer w;
+    jw_open(&w, serial);
+    jw_obj_start(&w, NULL);
+    jw_obj_start(&w, "auth");
+    jw_string(&w, "deviceId", deviceId);
+    jw_int(&w, "apiVer", API_REV);
+    jw_string(&w, "device", DEVICE_NAME);
+    jw_string(&w, "ver", VERSION_STR);
+    jw_string(&w, "sn", cpu_get_serialnumber());
+    jw_obj_end(&w);
+    jw_obj_end(&w);
+    jw_raw(&w, "\n", 1);
+    jw_close(&w);
 
     pr_debug_str_msg("sending auth- deviceId: ", deviceId);
 
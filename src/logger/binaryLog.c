@@ -0,0 +1,324 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include "binaryLog.h"
+#include "fixedFormat.h"
+#include "loggerConfig.h"
+#include "mem_mang.h"
+#include "mod_string.h"
+#include "sampleRecord.h"
+#include "taskUtil.h"
+
+enum binary_log_type binary_log_get_type(const ChannelDescriptor *cd)
+{
+        switch (cd->sampleData) {
+        case SampleData_LongLong_Noarg:
+        case SampleData_LongLong:
+                return BINARY_LOG_TYPE_LONGLONG;
+        case SampleData_Float_Noarg:
+        case SampleData_Float:
+        case SampleData_Float_Kernel:
+                return BINARY_LOG_TYPE_FLOAT;
+        case SampleData_Double_Noarg:
+        case SampleData_Double:
+                return BINARY_LOG_TYPE_DOUBLE;
+        default:
+                return BINARY_LOG_TYPE_INT;
+        }
+}
+
+size_t binary_log_type_size(const enum binary_log_type type)
+{
+        switch (type) {
+        case BINARY_LOG_TYPE_LONGLONG:
+                return sizeof(int64_t);
+        case BINARY_LOG_TYPE_DOUBLE:
+                return sizeof(double);
+        case BINARY_LOG_TYPE_FLOAT:
+                return sizeof(float);
+        default:
+                return sizeof(int32_t);
+        }
+}
+
+size_t binary_log_put_varint(uint8_t *buf, uint64_t value)
+{
+        size_t len = 0;
+
+        for (; value >= 0x80; value >>= 7)
+                buf[len++] = (uint8_t) value | 0x80;
+
+        buf[len++] = (uint8_t) value;
+        return len;
+}
+
+uint64_t binary_log_zigzag(const int64_t value)
+{
+        return value < 0 ? ~((uint64_t) value << 1) : (uint64_t) value << 1;
+}
+
+static int write_varint(struct binary_log_writer *w, const uint64_t value)
+{
+        uint8_t buf[BINARY_LOG_VARINT_MAX];
+        return w->write(buf, binary_log_put_varint(buf, value));
+}
+
+int64_t binary_log_packed_value(const ChannelDescriptor *cd,
+                                const ChannelValue *value)
+{
+        switch (binary_log_get_type(cd)) {
+        case BINARY_LOG_TYPE_LONGLONG:
+                return value->valueLongLong;
+        case BINARY_LOG_TYPE_FLOAT:
+                /* Rounded like the CSV log so both read back the same */
+                return fixed_scale(value->valueFloat, cd->cfg->precision,
+                                   true);
+        case BINARY_LOG_TYPE_DOUBLE:
+                return fixed_scale(value->valueDouble, cd->cfg->precision,
+                                   false);
+        default:
+                return value->valueInt;
+        }
+}
+
+static int write_string(struct binary_log_writer *w, const char *str,
+                        const size_t max_len)
+{
+        size_t len = 0;
+        while (len < max_len && str[len])
+                ++len;
+
+        const uint8_t len8 = len;
+        return w->write(&len8, sizeof(len8)) || w->write(str, len);
+}
+
+static bool reserve_last_values(struct binary_log_writer *w,
+                                const size_t count)
+{
+        if (count <= w->last_capacity)
+                return true;
+
+        portFree(w->last);
+        w->last = (int64_t *) portMalloc(count * sizeof(int64_t));
+        w->last_capacity = w->last ? count : 0;
+        return NULL != w->last;
+}
+
+static int write_header(struct binary_log_writer *w,
+                        const struct channel_table *t)
+{
+        if (w->compressed && !reserve_last_values(w, t->channel_count))
+                return -1;
+
+        const uint8_t version[2] = {
+                BINARY_LOG_VERSION,
+                (w->compressed ? BINARY_LOG_FLAG_DELTA : 0) |
+                (w->segmented ? BINARY_LOG_FLAG_SEGMENT : 0),
+        };
+        const uint16_t count = t->channel_count;
+        const uint16_t ms_per_tick = ticksToMs(1);
+        int rc = w->write(BINARY_LOG_MAGIC, BINARY_LOG_MAGIC_LEN) ||
+                w->write(version, sizeof(version)) ||
+                w->write(&count, sizeof(count)) ||
+                w->write(&ms_per_tick, sizeof(ms_per_tick));
+
+        if (0 == rc && w->segmented)
+                rc = w->write(&w->session, sizeof(w->session)) ||
+                        w->write(&w->part, sizeof(w->part));
+
+        const ChannelDescriptor *cd = t->channels;
+        for (size_t i = 0; 0 == rc && i < t->channel_count; ++i, ++cd) {
+                const ChannelConfig *cfg = cd->cfg;
+                const uint8_t type[2] = {
+                        binary_log_get_type(cd), cfg->precision
+                };
+                const uint16_t rate = decodeSampleRate(cfg->sampleRate);
+
+                rc = w->write(type, sizeof(type)) ||
+                        w->write(&rate, sizeof(rate)) ||
+                        w->write(&cfg->min, sizeof(cfg->min)) ||
+                        w->write(&cfg->max, sizeof(cfg->max)) ||
+                        write_string(w, cfg->label, DEFAULT_LABEL_LENGTH) ||
+                        write_string(w, cfg->units, DEFAULT_UNITS_LENGTH);
+        }
+
+        w->has_header = 0 == rc;
+        w->layout = t->layout;
+        w->ticks = 0;
+        w->rows = 0;
+        if (w->compressed)
+                memset(w->last, 0, t->channel_count * sizeof(int64_t));
+
+        return rc;
+}
+
+static int write_delta(struct binary_log_writer *w, const size_t ticks)
+{
+        const size_t delta = ticks - w->ticks;
+        w->ticks = ticks;
+
+        if (delta < BINARY_LOG_DELTA_HEADER) {
+                const uint16_t delta16 = delta;
+                return w->write(&delta16, sizeof(delta16));
+        }
+
+        const uint16_t escape = BINARY_LOG_DELTA_LONG;
+        const uint32_t delta32 = delta;
+        return w->write(&escape, sizeof(escape)) ||
+                w->write(&delta32, sizeof(delta32));
+}
+
+static int write_keyframe(struct binary_log_writer *w,
+                          const struct sample *s)
+{
+        int rc = w->write(BINARY_LOG_KEYFRAME_SYNC,
+                          BINARY_LOG_KEYFRAME_SYNC_LEN);
+
+        for (size_t i = 0; 0 == rc && i < s->channel_count; ++i)
+                rc = write_varint(w, binary_log_zigzag(w->last[i]));
+
+        return rc;
+}
+
+/*
+ * Writes the populated bitmap, then one bit per populated channel
+ * saying whether it changed, then the changes.  Unchanged values cost
+ * a single bit.
+ */
+static int write_packed_row(struct binary_log_writer *w,
+                            const struct sample *s)
+{
+        const ChannelDescriptor *cd = s->table->channels;
+        int rc = w->write(s->populated, (s->channel_count + 7) / 8);
+        uint8_t bits = 0;
+        size_t nbits = 0;
+
+        for (size_t i = 0; 0 == rc && i < s->channel_count; ++i, ++cd) {
+                if (!is_sample_populated(s, i))
+                        continue;
+
+                if (binary_log_packed_value(cd, s->values + i) != w->last[i])
+                        bits |= 1 << nbits % 8;
+
+                if (0 == ++nbits % 8) {
+                        rc = w->write(&bits, sizeof(bits));
+                        bits = 0;
+                }
+        }
+
+        if (0 == rc && nbits % 8)
+                rc = w->write(&bits, sizeof(bits));
+
+        cd = s->table->channels;
+        for (size_t i = 0; 0 == rc && i < s->channel_count; ++i, ++cd) {
+                if (!is_sample_populated(s, i))
+                        continue;
+
+                const int64_t value = binary_log_packed_value(cd, s->values + i);
+                if (value == w->last[i])
+                        continue;
+
+                rc = write_varint(w, binary_log_zigzag(value - w->last[i]));
+                w->last[i] = value;
+        }
+
+        return rc;
+}
+
+static int write_packed_sample(struct binary_log_writer *w,
+                               const struct sample *s)
+{
+        const bool keyframe = 0 == w->rows % BINARY_LOG_KEYFRAME_ROWS;
+        const uint64_t delta = s->ticks - w->ticks;
+        const uint64_t code = delta << BINARY_LOG_RECORD_BITS |
+                (keyframe ? BINARY_LOG_RECORD_KEYFRAME : BINARY_LOG_RECORD_ROW);
+
+        w->ticks = s->ticks;
+        ++w->rows;
+
+        return write_varint(w, code) ||
+                (keyframe && write_keyframe(w, s)) ||
+                write_packed_row(w, s);
+}
+
+void binary_log_start(struct binary_log_writer *w,
+                      binary_log_write_func *write, const bool compressed)
+{
+        /* Hang on to the value buffer, it is reused from log to log */
+        int64_t *last = w->last;
+        const size_t last_capacity = w->last_capacity;
+
+        memset(w, 0, sizeof(struct binary_log_writer));
+        w->write = write;
+        w->compressed = compressed;
+        w->last = last;
+        w->last_capacity = last_capacity;
+}
+
+void binary_log_segment(struct binary_log_writer *w, const uint32_t session,
+                        const uint16_t part)
+{
+        w->segmented = true;
+        w->session = session;
+        w->part = part;
+}
+
+void binary_log_keyframe(struct binary_log_writer *w)
+{
+        w->rows = 0;
+}
+
+int binary_log_write_sample(struct binary_log_writer *w,
+                            const struct sample *s)
+{
+        const struct channel_table *t = s->table;
+        int rc = 0;
+
+        if (!w->has_header) {
+                rc = write_header(w, t);
+        } else if (w->layout != t->layout) {
+                const uint16_t marker = BINARY_LOG_DELTA_HEADER;
+                rc = w->compressed ?
+                        write_varint(w, BINARY_LOG_RECORD_HEADER) :
+                        w->write(&marker, sizeof(marker));
+                rc = rc || write_header(w, t);
+        }
+
+        if (0 != rc)
+                return rc;
+
+        if (w->compressed)
+                return write_packed_sample(w, s);
+
+        rc = write_delta(w, s->ticks) ||
+                w->write(s->populated,
+                         sizeof(uint32_t[SAMPLE_BITMAP_WORDS(s->channel_count)]));
+
+        const ChannelDescriptor *cd = t->channels;
+        for (size_t i = 0; 0 == rc && i < s->channel_count; ++i, ++cd)
+                if (is_sample_populated(s, i))
+                        rc = w->write(s->values + i, binary_log_type_size(
+                                              binary_log_get_type(cd)));
+
+        return rc;
+}
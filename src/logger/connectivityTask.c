@@ -34,6 +34,7 @@
 #include "mod_string.h"
 #include "modp_numtoa.h"
 #include "null_device.h"
+#include "pipelineStats.h"
 #include "printk.h"
 #include "queue.h"
 #include "sampleRecord.h"
@@ -42,6 +43,9 @@
 #include "stdint.h"
 #include "task.h"
 #include "taskUtil.h"
+#include "telemetryDelta.h"
+#include "telemetryFrame.h"
+#include "telemetryRate.h"
 #include "usart.h"
 
 #if (CONNECTIVITY_CHANNELS == 1)
@@ -65,6 +69,15 @@
 
 #define METADATA_SAMPLE_INTERVAL				100
 
+/* Samples between full frames on links that only send changes */
+#define DELTA_KEYFRAME_INTERVAL					50
+
+/*
+ * Telemetry may only pin half of the logger ring so that a stalled link
+ * can't starve the file writer of sample slots.
+ */
+#define TELEMETRY_QUEUE_LENGTH	(LOGGER_MESSAGE_BUFFER_SIZE / 2)
+
 static xQueueHandle g_sampleQueue[CONNECTIVITY_CHANNELS] = CONNECTIVITY_TASK_INIT;
 
 
@@ -106,18 +119,93 @@ static int processRxBuffer(Serial *serial, char *buffer, size_t *rxCount)
 void queueTelemetryRecord(const LoggerMessage *msg)
 {
     for (size_t i = 0; i < CONNECTIVITY_CHANNELS; i++)
-            send_logger_message(g_sampleQueue[i], msg);
+            if (g_sampleQueue[i])
+                    send_logger_message(g_sampleQueue[i], msg);
+}
+
+void queue_telemetry_sample(const LoggerMessage *msg, const int sampled_rate,
+                            const size_t ticks)
+{
+    for (size_t i = 0; i < CONNECTIVITY_CHANNELS; i++) {
+            struct telemetry_rate *rate = get_telemetry_rate(i);
+
+            if (NULL == g_sampleQueue[i])
+                    continue;
+
+            if (telemetry_rate_update(rate, ticks, TELEMETRY_QUEUE_LENGTH))
+                    pr_info_int_msg("conn: telemetry rate ",
+                                    decodeSampleRate(rate->rate));
+
+            if (!telemetry_rate_is_due(rate, sampled_rate, ticks))
+                    continue;
+
+            const bool queued =
+                    pdTRUE == send_logger_message(g_sampleQueue[i], msg);
+            const size_t depth = uxQueueMessagesWaiting(g_sampleQueue[i]);
+
+            pipeline_stats_enqueue(PIPELINE_CONSUMER_TELEMETRY + i, queued,
+                                   depth);
+            telemetry_rate_enqueue(rate, queued, depth);
+    }
+}
+
+void telemetry_sample_dropped(const int sampled_rate, const size_t ticks)
+{
+    for (size_t i = 0; i < CONNECTIVITY_CHANNELS; i++)
+            if (g_sampleQueue[i] &&
+                telemetry_rate_is_due(get_telemetry_rate(i), sampled_rate,
+                                      ticks))
+                    pipeline_stats_overrun(PIPELINE_CONSUMER_TELEMETRY + i);
+}
+
+/*
+ * Maps a sample queue back to its connectivity channel.
+ */
+static size_t get_channel(const xQueueHandle sampleQueue)
+{
+    for (size_t i = 0; i < CONNECTIVITY_CHANNELS; i++)
+            if (g_sampleQueue[i] == sampleQueue)
+                    return i;
+
+    return CONNECTIVITY_CHANNELS;
+}
+
+/*
+ * Only channels with a task to read them get a queue.  Every sample on a
+ * queue pins a slot of the logger ring, so a queue nobody reads would
+ * hold those slots forever.
+ */
+static xQueueHandle create_sample_queue(const size_t channel)
+{
+    g_sampleQueue[channel] = create_logger_message_queue(TELEMETRY_QUEUE_LENGTH);
+    if (NULL == g_sampleQueue[channel])
+            pr_error("conn: err sample queue\r\n");
+
+    return g_sampleQueue[channel];
+}
+
+void telemetry_flush_queues(void)
+{
+    for (size_t i = 0; i < CONNECTIVITY_CHANNELS; i++) {
+            const size_t dropped = flush_logger_message_queue(g_sampleQueue[i]);
+            for (size_t d = 0; d < dropped; d++)
+                    pipeline_stats_overrun(PIPELINE_CONSUMER_TELEMETRY + i);
+    }
 }
 
 /*combined telemetry - for when there's only one telemetry / wireless port available on system
 //e.g. "Y-adapter" scenario */
-static void createCombinedTelemetryTask(int16_t priority, xQueueHandle sampleQueue)
+static void createCombinedTelemetryTask(int16_t priority)
 {
     ConnectivityConfig *connConfig = &getWorkingLoggerConfig()->ConnectivityConfigs;
     size_t btEnabled = connConfig->bluetoothConfig.btEnabled;
     size_t cellEnabled = connConfig->cellularConfig.cellEnabled;
 
     if (btEnabled || cellEnabled) {
+        xQueueHandle sampleQueue = create_sample_queue(0);
+        if (NULL == sampleQueue)
+            return;
+
         ConnParams * params = (ConnParams *)portMalloc(sizeof(ConnParams));
 
         params->periodicMeta = btEnabled && cellEnabled;
@@ -129,6 +217,7 @@ static void createCombinedTelemetryTask(int16_t priority, xQueueHandle sampleQue
         params->sampleQueue = sampleQueue;
         params->connection_timeout = 0;
         params->always_streaming = false;
+        telemetry_delta_init(&params->delta, 0);
 
         if (btEnabled) {
             params->check_connection_status = &bt_check_connection_status;
@@ -161,6 +250,7 @@ static void createWirelessConnectionTask(int16_t priority, xQueueHandle sampleQu
     params->serial = SERIAL_WIRELESS;
     params->sampleQueue = sampleQueue;
     params->always_streaming = true;
+    telemetry_delta_init(&params->delta, 0);
     xTaskCreate(connectivityTask, (signed portCHAR *) "connWireless", TELEMETRY_STACK_SIZE, params, priority, NULL );
 }
 
@@ -177,22 +267,16 @@ static void createTelemetryConnectionTask(int16_t priority, xQueueHandle sampleQ
     params->serial = SERIAL_TELEMETRY;
     params->sampleQueue = sampleQueue;
     params->always_streaming = false;
+    /* Cellular data costs money, so only send what changed */
+    telemetry_delta_init(&params->delta, DELTA_KEYFRAME_INTERVAL);
     xTaskCreate(connectivityTask, (signed portCHAR *) "connTelemetry", TELEMETRY_STACK_SIZE, params, priority, NULL );
 }
 
 void startConnectivityTask(int16_t priority)
 {
-        for (size_t i = 0; i < CONNECTIVITY_CHANNELS; i++) {
-                g_sampleQueue[i] = create_logger_message_queue();
-                if (NULL == g_sampleQueue[i]) {
-                        pr_error("conn: err sample queue\r\n");
-                        return;
-                }
-        }
-
         switch (CONNECTIVITY_CHANNELS) {
         case 1:
-                createCombinedTelemetryTask(priority, g_sampleQueue[0]);
+                createCombinedTelemetryTask(priority);
                 break;
         case 2: {
                 ConnectivityConfig *connConfig =
@@ -205,11 +289,12 @@ void startConnectivityTask(int16_t priority)
                 const uint8_t cellEnabled =
                         connConfig->cellularConfig.cellEnabled;
 
-                if (cellEnabled)
+                if (cellEnabled && create_sample_queue(1))
                         createTelemetryConnectionTask(priority,
                                                       g_sampleQueue[1], 1);
 
-                if (connConfig->bluetoothConfig.btEnabled)
+                if (connConfig->bluetoothConfig.btEnabled &&
+                    create_sample_queue(0))
                         createWirelessConnectionTask(priority,
                                                      g_sampleQueue[0],
                                                      !cellEnabled);
@@ -231,6 +316,25 @@ static void clear_connectivity_indicator()
     LED_disable(0);
 }
 
+/*
+ * Empties the sample queue while we have no connection to send on so the
+ * queued samples don't pin slots of the logger ring.  Start/Stop messages
+ * still update the logging state.
+ */
+static void drain_sample_queue(xQueueHandle sampleQueue, bool *logging_enabled)
+{
+    LoggerMessage msg;
+
+    while (pdFALSE != receive_logger_message(sampleQueue, &msg, 0)) {
+        if (LoggerMessageType_Start == msg.type)
+            *logging_enabled = true;
+        if (LoggerMessageType_Stop == msg.type)
+            *logging_enabled = false;
+
+        release_logger_message(&msg);
+    }
+}
+
 void connectivityTask(void *params)
 {
 
@@ -243,6 +347,9 @@ void connectivityTask(void *params)
     Serial *serial = get_serial(connParams->serial);
 
     xQueueHandle sampleQueue = connParams->sampleQueue;
+    const size_t channel = get_channel(sampleQueue);
+    const size_t consumer = PIPELINE_CONSUMER_TELEMETRY + channel;
+    struct telemetry_rate *rate = get_telemetry_rate(channel);
     uint32_t connection_timeout = connParams->connection_timeout;
 
     DeviceConfig deviceConfig;
@@ -261,9 +368,13 @@ void connectivityTask(void *params)
 
         while (should_stream && connParams->init_connection(&deviceConfig) != DEVICE_INIT_SUCCESS) {
             pr_info("conn: not connected. retrying\r\n");
+            drain_sample_queue(sampleQueue, &logging_enabled);
             vTaskDelay(INIT_DELAY);
         }
 
+        /* Whoever is on the other end now has to ask for binary again */
+        telemetry_set_format(serial, TELEMETRY_FORMAT_JSON);
+        telemetry_delta_reset(&connParams->delta);
         serial->flush();
         rxCount = 0;
         size_t badMsgCount = 0;
@@ -314,18 +425,37 @@ void connectivityTask(void *params)
                         const int send_meta = tick == 0 ||
                                 (connParams->periodicMeta &&
                                  (tick % METADATA_SAMPLE_INTERVAL == 0));
-                        api_send_sample_record(serial, msg.sample, tick, send_meta);
+
+                        /* A reader that just got meta needs everything */
+                        struct sample view;
+                        struct sample *sample =
+                                telemetry_delta_filter(&connParams->delta,
+                                                       msg.sample, &view,
+                                                       send_meta);
+
+                        if (TELEMETRY_FORMAT_BINARY ==
+                            telemetry_get_format(serial)) {
+                                telemetry_send_sample(serial, sample,
+                                                      tick, send_meta);
+                        } else {
+                                api_send_sample_record(serial, sample,
+                                                       tick, send_meta);
+                                put_crlf(serial);
+                        }
+                        pipeline_stats_latency(consumer, msg.ticks);
+                        telemetry_rate_drained(rate);
 
                         if (connParams->isPrimary)
                                 toggle_connectivity_indicator();
 
-                        put_crlf(serial);
                         tick++;
                         break;
                 }
                 default:
                     break;
                 }
+
+                release_logger_message(&msg);
             }
 
             /*//////////////////////////////////////////////////////////
@@ -23,15 +23,23 @@
 
 
 #include "LED.h"
+#include "capabilities.h"
+#include "checksum.h"
 #include "fileWriter.h"
+#include "fixedFormat.h"
+#include "lap_stats.h"
+#include "logJournal.h"
 #include "loggerHardware.h"
 #include "mem_mang.h"
 #include "mod_string.h"
 #include "modp_numtoa.h"
+#include "pipelineStats.h"
+#include "preroll.h"
 #include "printk.h"
-#include "ring_buffer.h"
 #include "sampleRecord.h"
+#include "sdStats.h"
 #include "sdcard.h"
+#include "sectorBuffer.h"
 #include "semphr.h"
 #include "task.h"
 #include "taskUtil.h"
@@ -40,63 +48,250 @@
 #include <stdbool.h>
 
 #define ERROR_SLEEP_DELAY_MS	500
-#define FILE_BUFFER_SIZE	256
 #define FILE_WRITER_STACK_SIZE	256
+#define LOG_CSV_VALUE_DIGITS	6
+#define LOG_PREALLOC_MAX	0xffffffff
+#define LOG_ROW_BUFF_SIZE	256
 #define MAX_LOG_FILE_INDEX	99999
+/* A comma, the widest value and the newline */
+#define ROW_FIELD_MAX	(FIXED_FORMAT_BUF_LEN + 2)
 #define SAMPLE_RECORD_QUEUE_SIZE	20
 #define WRITE_FAIL	EOF
 
 static FIL *g_logfile;
+static FIL *g_index_file;
+static unsigned char g_logfile_mode = SD_LOGGING_MODE_CSV;
+static unsigned int g_logfile_prealloc;
+static bool g_logfile_journal;
+static unsigned int g_rotate_minutes;
+static unsigned int g_rotate_kb;
+static unsigned int g_loss_budget = FLUSH_INTERVAL_MS;
+static int g_next_log_index = -1;
+static unsigned int g_start_latency;
 static xQueueHandle g_LoggerMessage_queue;
-static struct ring_buff file_buff;
+static struct sector_buffer file_buff;
+static struct log_journal g_journal;
+static bool g_journaled;
+
+/*
+ * A part of a rotated log that still has to be closed.  Closing means
+ * a directory update and writing out its index, so it waits until the
+ * queue runs dry rather than holding up samples.
+ */
+static struct {
+        FIL *file;
+        struct log_index index;
+        char name[FILENAME_LEN];
+        bool truncate;
+        bool pending;
+} g_rotated;
 
 static void error_led(const bool on)
 {
         on ? LED_enable(3) : LED_disable(3);
 }
 
-static FRESULT flush_file_buffer(void)
+static int write_file_data(const void *data, const size_t len)
+{
+        if (NULL == g_logfile->fs)
+                return FR_OK;
+
+        unsigned int bw;
+        const uint32_t start = sd_stats_start();
+        FRESULT res = f_write(g_logfile, data, len, &bw);
+        if (FR_OK == res && bw != len)
+                res = FR_DENIED;
+
+        sd_stats_write(start, bw, FR_OK == res);
+        error_led(FR_OK != res);
+        return res;
+}
+
+/*
+ * Writes out the blocks that have filled up.  The partial block stays
+ * behind so that we only ever hand whole sectors to the file system.
+ */
+static int drain_file_buffer(void)
 {
-        FRESULT res = FR_OK;
-        char tmp[32];
+        pr_trace(_RCP_BASE_FILE_ "Draining file buffer\r\n");
+        return drain_sector_buffer(&file_buff, write_file_data);
+}
 
+static int flush_file_buffer(void)
+{
         pr_trace(_RCP_BASE_FILE_ "Flushing file buffer\r\n");
-        size_t chars = get_used(&file_buff);
-        while(0 < chars) {
-                if (chars > sizeof(tmp))
-                        chars = sizeof(tmp);
-
-                pr_trace_int_msg(_RCP_BASE_FILE_ "Chars is ", chars);
-                get_data(&file_buff, &tmp, chars);
-                if (g_logfile->fs) {
-                        unsigned int bw;
-                        res = f_write(g_logfile, &tmp, chars, &bw);
-                        error_led(FR_OK != res);
-                }
 
-                chars = get_used(&file_buff);
+        /* A journal holds on to its partial frame until told otherwise */
+        const int rc = g_journaled ? log_journal_flush(&g_journal) : 0;
+        return rc ? rc : flush_sector_buffer(&file_buff, write_file_data);
+}
+
+static int append_sector_data(const void *data, size_t len)
+{
+        const char *ptr = data;
+
+        while (len) {
+                const size_t put = put_sector_buffer(&file_buff, ptr, len);
+                ptr += put;
+                len -= put;
+
+                /* All blocks full.  Have to wait on the SD card here */
+                if (len) {
+                        const int res = drain_file_buffer();
+                        if (FR_OK != res)
+                                return res;
+                }
         }
 
-        pr_trace(_RCP_BASE_FILE_ "Flushing file buffer DONE\r\n");
-        return res;
+        return FR_OK;
 }
 
-static FRESULT append_file_buffer(const char *str)
+static int append_file_data(const void *data, const size_t len)
 {
-        FRESULT res = FR_OK;
+        return g_journaled ? log_journal_append(&g_journal, data, len) :
+                append_sector_data(data, len);
+}
 
-        while(str && *str) {
-                str = put_string(&file_buff, str);
-                if (str)
-                        res = flush_file_buffer();
-        }
+static int append_file_buffer(const char *str)
+{
+        return append_file_data(str, strlen(str));
+}
+
+portBASE_TYPE queue_logfile_record(const LoggerMessage * const msg)
+{
+        const portBASE_TYPE res = send_logger_message(g_LoggerMessage_queue,
+                                                      msg);
+        const size_t depth = uxQueueMessagesWaiting(g_LoggerMessage_queue);
+
+        sd_stats_queue_depth(depth);
+        if (LoggerMessageType_Sample == msg->type)
+                pipeline_stats_enqueue(PIPELINE_CONSUMER_FILE, pdTRUE == res,
+                                       depth);
 
         return res;
 }
 
-portBASE_TYPE queue_logfile_record(const LoggerMessage * const msg)
+void logfile_sample_dropped(void)
+{
+        pipeline_stats_overrun(PIPELINE_CONSUMER_FILE);
+}
+
+void set_logfile_mode(const unsigned char mode)
+{
+        g_logfile_mode = mode;
+}
+
+unsigned char get_logfile_mode(void)
+{
+        return g_logfile_mode;
+}
+
+void set_logfile_prealloc(const unsigned int minutes)
+{
+        g_logfile_prealloc = minutes < LOG_PREALLOC_MAX_MINUTES ?
+                minutes : LOG_PREALLOC_MAX_MINUTES;
+}
+
+unsigned int get_logfile_prealloc(void)
+{
+        return g_logfile_prealloc;
+}
+
+void set_logfile_rotation(const unsigned int minutes, const unsigned int kb)
 {
-        return send_logger_message(g_LoggerMessage_queue, msg);
+        g_rotate_minutes = minutes;
+        g_rotate_kb = kb;
+}
+
+unsigned int get_logfile_rotate_minutes(void)
+{
+        return g_rotate_minutes;
+}
+
+unsigned int get_logfile_rotate_kb(void)
+{
+        return g_rotate_kb;
+}
+
+void set_logfile_journal(const bool journal)
+{
+        g_logfile_journal = journal;
+}
+
+bool get_logfile_journal(void)
+{
+        return g_logfile_journal;
+}
+
+void set_logfile_loss_budget(const unsigned int ms)
+{
+        g_loss_budget = ms;
+}
+
+unsigned int get_logfile_loss_budget(void)
+{
+        return g_loss_budget;
+}
+
+unsigned int get_logfile_start_latency(void)
+{
+        return g_start_latency;
+}
+
+static bool is_rotating(const struct logging_status *ls)
+{
+        return ls->rotate_minutes || ls->rotate_kb;
+}
+
+static bool is_binary_mode(const unsigned char mode)
+{
+        return SD_LOGGING_MODE_BINARY == mode ||
+                SD_LOGGING_MODE_COMPRESSED == mode;
+}
+
+/*
+ * Rough number of bytes per second a log of these samples grows by.
+ * It only needs to be close enough to size a pre-allocation.
+ */
+TESTABLE_STATIC size_t get_log_data_rate(const struct sample *s,
+                                         const unsigned char mode)
+{
+        const ChannelDescriptor *cd = s->table->channels;
+        const bool binary = is_binary_mode(mode);
+        size_t bytes = 0;
+        size_t row_rate = 0;
+
+        for (size_t i = 0; i < s->channel_count; ++i, ++cd) {
+                const int rate = decodeSampleRate(cd->cfg->sampleRate);
+                if (rate <= 0)
+                        continue;
+
+                if ((size_t) rate > row_rate)
+                        row_rate = rate;
+
+                size_t size = cd->cfg->precision + LOG_CSV_VALUE_DIGITS;
+                if (binary) {
+                        switch(cd->sampleData) {
+                        case SampleData_LongLong:
+                        case SampleData_LongLong_Noarg:
+                        case SampleData_Double:
+                        case SampleData_Double_Noarg:
+                                size = 8;
+                                break;
+                        default:
+                                size = 4;
+                        }
+                }
+
+                bytes += rate * size;
+        }
+
+        /* Every row carries its delta and bitmap, or all of its commas */
+        const size_t row_size = binary ?
+                sizeof(uint16_t) + (s->channel_count + 7) / 8 :
+                s->channel_count;
+
+        return bytes + row_rate * row_size;
 }
 
 static void appendQuotedString(const char *s)
@@ -113,97 +308,108 @@ static void appendInt(int num)
         append_file_buffer(buf);
 }
 
-static void appendLongLong(long long num)
-{
-        char buf[21];
-        modp_ltoa10(num, buf);
-        append_file_buffer(buf);
-}
-
-static void appendDouble(double num, int precision)
-{
-        char buf[30];
-        modp_dtoa(num, buf, precision);
-        append_file_buffer(buf);
-}
-
 static void appendFloat(float num, int precision)
 {
-        char buf[11];
-        modp_ftoa(num, buf, precision);
-        append_file_buffer(buf);
+        char buf[FIXED_FORMAT_BUF_LEN];
+        append_file_data(buf, fixed_ftoa(num, buf, precision));
 }
 
 static int write_samples_header(const LoggerMessage *msg)
 {
-        int i;
-        const ChannelSample *sample = msg->sample->channel_samples;
-        size_t count = msg->sample->channel_count;
+        const ChannelDescriptor *cd = msg->sample->table->channels;
+        const size_t count = msg->sample->channel_count;
 
-        for (i = 0; 0 < count; count--, sample++, i++) {
+        for (size_t i = 0; i < count; ++i, ++cd) {
                 append_file_buffer(0 == i ? "" : ",");
 
-                uint8_t precision = sample->cfg->precision;
-                appendQuotedString(sample->cfg->label);
+                uint8_t precision = cd->cfg->precision;
+                appendQuotedString(cd->cfg->label);
                 append_file_buffer("|");
-                appendQuotedString(sample->cfg->units);
+                appendQuotedString(cd->cfg->units);
                 append_file_buffer("|");
-                appendFloat(sample->cfg->min, precision);
+                appendFloat(cd->cfg->min, precision);
                 append_file_buffer("|");
-                appendFloat(sample->cfg->max, precision);
+                appendFloat(cd->cfg->max, precision);
                 append_file_buffer("|");
-                appendInt(decodeSampleRate(sample->cfg->sampleRate));
+                appendInt(decodeSampleRate(cd->cfg->sampleRate));
         }
 
-        append_file_buffer("\n");
-        return flush_file_buffer();
+        return append_file_buffer("\n");
 }
 
 
+/*
+ * Formats one field of a CSV row in place.
+ * @return The length of the field.
+ */
+static size_t put_sample_field(char *buf, const ChannelDescriptor *cd,
+                               const ChannelValue *value)
+{
+        const int precision = cd->cfg->precision;
+
+        switch(cd->sampleData) {
+        case SampleData_Float:
+        case SampleData_Float_Noarg:
+        case SampleData_Float_Kernel:
+                return fixed_ftoa(value->valueFloat, buf, precision);
+        case SampleData_Int:
+        case SampleData_Int_Noarg:
+                modp_itoa10(value->valueInt, buf);
+                return strlen(buf);
+        case SampleData_LongLong:
+        case SampleData_LongLong_Noarg:
+                modp_ltoa10(value->valueLongLong, buf);
+                return strlen(buf);
+        case SampleData_Double:
+        case SampleData_Double_Noarg:
+                return fixed_dtoa(value->valueDouble, buf, precision);
+        default:
+                pr_warning(_RCP_BASE_FILE_ "Unknown channel "
+                           "sample type\n");
+                return 0;
+        }
+}
+
+/*
+ * Rows are put together in row_buff with the values formatted straight
+ * into it, then handed to the file in one go instead of a field at a
+ * time.  Long rows go out in pieces.
+ */
 static int write_samples_data(const LoggerMessage *msg)
 {
-        const ChannelSample *sample = msg->sample->channel_samples;
-        size_t count = msg->sample->channel_count;
+        const struct sample *sample = msg->sample;
 
-        if (NULL == sample) {
+        if (NULL == sample->values) {
                 pr_warning(_RCP_BASE_FILE_ "null sample record\r\n");
                 return WRITE_FAIL;
         }
 
-        int i;
-        for (i = 0; 0 < count; count--, sample++, i++) {
-                append_file_buffer(0 == i ? "" : ",");
-
-                if (!sample->populated)
-                        continue;
+        static char row_buff[LOG_ROW_BUFF_SIZE];
+        const char *row_end = row_buff + sizeof(row_buff) - ROW_FIELD_MAX;
+        const ChannelDescriptor *cd = sample->table->channels;
+        const ChannelValue *value = sample->values;
+        const size_t count = sample->channel_count;
+        char *ptr = row_buff;
+        int rc = FR_OK;
+
+        for (size_t i = 0; i < count; ++i, ++cd, ++value) {
+                if (ptr > row_end) {
+                        const int res = append_file_data(row_buff,
+                                                         ptr - row_buff);
+                        rc = rc ? rc : res;
+                        ptr = row_buff;
+                }
 
-                const int precision = sample->cfg->precision;
+                if (i)
+                        *ptr++ = ',';
 
-                switch(sample->sampleData) {
-                case SampleData_Float:
-                case SampleData_Float_Noarg:
-                        appendFloat(sample->valueFloat, precision);
-                        break;
-                case SampleData_Int:
-                case SampleData_Int_Noarg:
-                        appendInt(sample->valueInt);
-                        break;
-                case SampleData_LongLong:
-                case SampleData_LongLong_Noarg:
-                        appendLongLong(sample->valueLongLong);
-                        break;
-                case SampleData_Double:
-                case SampleData_Double_Noarg:
-                        appendDouble(sample->valueDouble, precision);
-                        break;
-                default:
-                        pr_warning(_RCP_BASE_FILE_ "Unknown channel "
-                                   "sample type\n");
-                }
+                if (is_sample_populated(sample, i))
+                        ptr += put_sample_field(ptr, cd, value);
         }
 
-        append_file_buffer("\n");
-        return flush_file_buffer();
+        *ptr++ = '\n';
+        const int res = append_file_data(row_buff, ptr - row_buff);
+        return rc ? rc : res;
 }
 
 static enum writing_status open_existing_log_file(struct logging_status *ls)
@@ -217,39 +423,338 @@ static enum writing_status open_existing_log_file(struct logging_status *ls)
 
         // Seek to the end so we append instead of overwriting
         rc = f_lseek(g_logfile, f_size(g_logfile));
+        if (FR_OK != rc)
+                return WRITING_INACTIVE;
+
+        reset_sector_buffer(&file_buff, f_size(g_logfile));
+        if (g_journaled)
+                log_journal_resume(&g_journal, f_size(g_logfile) /
+                                   LOG_JOURNAL_FRAME_SIZE);
 
-        return rc == FR_OK ? WRITING_ACTIVE : WRITING_INACTIVE;
+        return WRITING_ACTIVE;
+}
+
+/*
+ * Parses the index out of a log file name like rc_12.log.  FatFs hands
+ * back 8.3 names in upper case, so the prefix is matched either way.
+ * @return The index, or -1 if this isn't one of our log files.
+ */
+TESTABLE_STATIC int get_log_file_index(const char *name)
+{
+        if ('r' != (name[0] | 0x20) || 'c' != (name[1] | 0x20) ||
+            '_' != name[2])
+                return -1;
+
+        const char *c = name + 3;
+        if (*c < '0' || *c > '9')
+                return -1;
+
+        int index = 0;
+        for (; *c >= '0' && *c <= '9'; ++c) {
+                index = index * 10 + *c - '0';
+                if (index > MAX_LOG_FILE_INDEX)
+                        return -1;
+        }
+
+        return '.' == *c ? index : -1;
+}
+
+static bool read_journal_frame(const size_t index,
+                               struct log_journal_frame *frame)
+{
+        unsigned int br;
+        return FR_OK == f_lseek(g_logfile, index * LOG_JOURNAL_FRAME_SIZE) &&
+                FR_OK == f_read(g_logfile, frame, LOG_JOURNAL_FRAME_SIZE,
+                                &br) &&
+                LOG_JOURNAL_FRAME_SIZE == br;
+}
+
+/*
+ * Cuts a journaled log back to its last good frame.  If the power went
+ * before the log was stopped the file can end in a torn frame, or in
+ * pre-allocated space that never got written.  Closing the file puts
+ * the right size in the directory.
+ */
+static void recover_log_journal(const char *name)
+{
+        if (FR_OK != f_open(g_logfile, name, FA_READ | FA_WRITE))
+                return;
+
+        /* No log is open yet, so the journal frame is free to use */
+        const DWORD size = f_size(g_logfile);
+        const DWORD good = LOG_JOURNAL_FRAME_SIZE *
+                log_journal_valid_frames(read_journal_frame,
+                                         size / LOG_JOURNAL_FRAME_SIZE,
+                                         &g_journal.frame);
+
+        if (good != size && FR_OK == f_lseek(g_logfile, good) &&
+            FR_OK == f_truncate(g_logfile))
+                pr_info_str_msg(_RCP_BASE_FILE_ "Recovered ", name);
+
+        f_close(g_logfile);
+}
+
+static bool is_journal_file(const char *name)
+{
+        /* The directory hands back short names in upper case */
+        const char *ext = strchr(name, '.');
+        return ext && 0 == strcasecmp(ext, LOG_JOURNAL_EXT);
+}
+
+/*
+ * Nothing guards against opening a file twice, so recovery must never
+ * touch a file that we still have open.
+ */
+static bool is_open_log_file(const char *name)
+{
+        return g_rotated.pending && 0 == strcasecmp(name, g_rotated.name);
+}
+
+/*
+ * Finds the index after the highest numbered log file with a single
+ * pass over the directory.  Much cheaper than probing every name.  The
+ * first scan after boot or after a card error is when logs cut short by
+ * a power loss or a pulled card show up, so it gives every journaled
+ * log a recovery pass while we are here.  A good log only costs a
+ * couple of frame reads.
+ * @param recover true to recover journaled logs along the way.  Must be
+ * false when a log may still be open.
+ */
+static int find_next_log_index(const bool recover)
+{
+        DIR dir;
+        FILINFO info;
+        int next = 0;
+
+        if (FR_OK != f_opendir(&dir, "/"))
+                return 0;
+
+        while (FR_OK == f_readdir(&dir, &info) && info.fname[0]) {
+                const int index = get_log_file_index(info.fname);
+                if (index < 0)
+                        continue;
+
+                if (index >= next)
+                        next = index + 1;
+
+                if (recover && is_journal_file(info.fname) &&
+                    !is_open_log_file(info.fname))
+                        recover_log_journal(info.fname);
+        }
+
+        f_closedir(&dir);
+        return next;
+}
+
+static void set_log_file_name(struct logging_status *ls, const int index)
+{
+        char buf[12];
+        modp_itoa10(index, buf);
+
+        strcpy(ls->name, "rc_");
+        strcat(ls->name, buf);
+        if (ls->journal)
+                strcat(ls->name, LOG_JOURNAL_EXT);
+        else
+                strcat(ls->name, is_binary_mode(ls->mode) ?
+                       ".rcb" : ".log");
+}
+
+/* Something that differs from any old log on the card */
+static uint32_t make_session_id(const struct logging_status *ls)
+{
+        const portTickType ticks = xTaskGetTickCount();
+        const uint32_t hash = checksum_fnv1a(CHECKSUM_FNV1A_INIT, ls->name,
+                                             strlen(ls->name));
+        return checksum_fnv1a(hash, &ticks, sizeof(ticks));
 }
 
 static enum writing_status open_new_log_file(struct logging_status *ls)
 {
         pr_debug(_RCP_BASE_FILE_ "Opening new log file\r\n");
 
-        int i;
+        /* Only scan the card the first time, after that we count up */
+        bool scanned = g_next_log_index < 0;
+        int i = scanned ? find_next_log_index(true) : g_next_log_index;
 
-        for (i = 0; i < MAX_LOG_FILE_INDEX; i++) {
-                char buf[12];
-                modp_itoa10(i, buf);
-
-                strcpy(ls->name, "rc_");
-                strcat(ls->name, buf);
-                strcat(ls->name, ".log");
+        while (i < MAX_LOG_FILE_INDEX) {
+                set_log_file_name(ls, i);
 
                 const FRESULT res = f_open(g_logfile, ls->name,
                                            FA_WRITE | FA_CREATE_NEW);
-                if ( FR_OK == res )
+                if ( FR_OK == res ) {
+                        g_next_log_index = i + 1;
+                        reset_sector_buffer(&file_buff, 0);
+                        if (g_journaled)
+                                log_journal_start(&g_journal,
+                                                  append_sector_data,
+                                                  make_session_id(ls));
+
+                        if (0 == ls->part)
+                                ls->session = make_session_id(ls);
+
+                        if (is_rotating(ls)) {
+                                ls->index.session = ls->session;
+                                ls->index.part = ls->part;
+                        }
+
+                        ls->segment_tick = xTaskGetTickCount();
                         return WRITING_ACTIVE;
+                }
 
                 f_close(g_logfile);
+                if (FR_EXIST != res)
+                        break;
+
+                /*
+                 * Our count is stale, likely a different card.  Look
+                 * again, but leave recovery be since a rotated part may
+                 * still be open.
+                 */
+                const int next = scanned ? 0 : find_next_log_index(false);
+                scanned = true;
+                i = next > i ? next : i + 1;
         }
 
         /* We fail if here. Be sure to clean up name buffer.*/
+        g_next_log_index = -1;
         ls->name[0] = '\0';
         return WRITING_INACTIVE;
 }
 
+/*
+ * Keeps the file grown one chunk ahead of the data so that FatFs walks
+ * the FAT a little at a time while we are idle instead of part way
+ * through a log write.  A single big grow would hold up the queue for
+ * as long as it takes, and on a nearly full card that means a scan of
+ * the whole FAT.  The write pointer is put back at the end of the data
+ * and the unused part is trimmed off when the file is closed.  The grown
+ * size is committed at the next sync, so if the power goes the file
+ * ends in whatever the clusters held before.  Only journaled logs
+ * pre-allocate, since their recovery cuts the file back to the last
+ * good frame.
+ */
+static FRESULT grow_log_file(struct logging_status *ls)
+{
+        const DWORD end = f_tell(g_logfile);
+        const DWORD size = f_size(g_logfile);
+
+        if (size >= ls->prealloc_limit || size - end >= LOG_PREALLOC_CHUNK)
+                return FR_OK;
+
+        const DWORD room = ls->prealloc_limit - size;
+        const DWORD grow = room < LOG_PREALLOC_CHUNK ? room :
+                LOG_PREALLOC_CHUNK;
+
+        /* FatFs stops short on its own if the card fills up */
+        const FRESULT res = f_lseek(g_logfile, size + grow);
+        if (FR_OK != res || f_size(g_logfile) != size + grow) {
+                pr_warning_int_msg(_RCP_BASE_FILE_ "Pre-allocation stopped "
+                                   "at bytes: ", f_size(g_logfile));
+                ls->prealloc_limit = 0;
+        }
+
+        return f_lseek(g_logfile, end);
+}
+
+/*
+ * Works out how far the file may be grown ahead of the data and
+ * reserves the first chunk.
+ */
+static FRESULT preallocate_log_file(struct logging_status *ls,
+                                    const struct sample *s)
+{
+        ls->prealloc_limit = 0;
+        if (0 == ls->prealloc)
+                return FR_OK;
+
+        /* No point reserving more than a part will use */
+        unsigned int minutes = ls->prealloc;
+        if (ls->rotate_minutes && ls->rotate_minutes < minutes)
+                minutes = ls->rotate_minutes;
+
+        const DWORD end = f_tell(g_logfile);
+        unsigned long long size = get_log_data_rate(s, ls->mode);
+        size *= 60 * minutes;
+        if (ls->rotate_kb && size > 1024ull * ls->rotate_kb)
+                size = 1024ull * ls->rotate_kb;
+        if (size > LOG_PREALLOC_MAX - end)
+                size = LOG_PREALLOC_MAX - end;
+
+        ls->prealloc_limit = end + (DWORD) size;
+        pr_info_int_msg(_RCP_BASE_FILE_ "Pre-allocating bytes: ",
+                        (DWORD) size);
+
+        return grow_log_file(ls);
+}
+
+static int write_index_data(const void *data, const size_t len)
+{
+        unsigned int bw;
+        const FRESULT res = f_write(g_index_file, data, len, &bw);
+        return FR_OK == res && bw == len ? 0 : -1;
+}
+
+/*
+ * Writes the index out next to the log, so rc_3.log gets rc_3.idx.  This
+ * needs a file object of its own since the log is still open.
+ */
+static int write_index_file(const char *log_name, const struct log_index *li)
+{
+        if (0 == li->count)
+                return 0;
+
+        char name[FILENAME_LEN];
+        strcpy(name, log_name);
+        char *ext = strchr(name, '.');
+        if (NULL == ext)
+                return -1;
+
+        strcpy(ext, LOG_INDEX_EXT);
+
+        g_index_file = (FIL *) portMalloc(sizeof(FIL));
+        if (NULL == g_index_file)
+                return -1;
+
+        memset(g_index_file, 0, sizeof(FIL));
+        int rc = f_open(g_index_file, name, FA_WRITE | FA_CREATE_ALWAYS);
+        if (FR_OK == rc) {
+                rc = write_log_index(li, write_index_data);
+                rc = f_close(g_index_file) || rc;
+        }
+
+        portFree(g_index_file);
+        g_index_file = NULL;
+
+        if (rc)
+                pr_warning_str_msg(_RCP_BASE_FILE_ "Failed to write index ",
+                                   name);
+
+        return rc;
+}
+
+static void close_rotated_log_file(void)
+{
+        if (!g_rotated.pending)
+                return;
+
+        pr_debug_str_msg(_RCP_BASE_FILE_ "Closing ", g_rotated.name);
+        if (g_rotated.truncate)
+                f_truncate(g_rotated.file);
+
+        write_index_file(g_rotated.name, &g_rotated.index);
+        f_close(g_rotated.file);
+        g_rotated.pending = false;
+}
+
 static void close_log_file(struct logging_status *ls)
 {
+        close_rotated_log_file();
+
+        /* Trim off whatever the pre-allocation didn't get used for */
+        if (ls->prealloc && WRITING_ACTIVE == ls->writing_status)
+                f_truncate(g_logfile);
+
         ls->writing_status = WRITING_INACTIVE;
         f_close(g_logfile);
         UnmountFS();
@@ -265,18 +770,13 @@ static void logging_led_off(void)
         LED_disable(2);
 }
 
-static void open_log_file(struct logging_status *ls)
+/*
+ * Opens the log file on a card that is already mounted.  Must be called
+ * with the previous file out of the way, if there was one.
+ */
+static void open_mounted_log_file(struct logging_status *ls,
+                                  const struct sample *s)
 {
-        pr_info(_RCP_BASE_FILE_ "Opening log file\r\n");
-        ls->writing_status = WRITING_INACTIVE;
-
-        const int rc = InitFS();
-        if (0 != rc) {
-                pr_error_int_msg(_RCP_BASE_FILE_ "FS init error: ", rc);
-                return;
-        }
-
-        pr_debug(_RCP_BASE_FILE_ "FS init success.  Opening file...\r\n");
         // Open a file if one is set, else create a new one.
         ls->writing_status = ls->name[0] ? open_existing_log_file(ls) :
                 open_new_log_file(ls);
@@ -286,10 +786,36 @@ static void open_log_file(struct logging_status *ls)
                 return;
         }
 
+        if (FR_OK != preallocate_log_file(ls, s)) {
+                pr_warning(_RCP_BASE_FILE_ "Lost our place in the file\r\n");
+                ls->writing_status = WRITING_INACTIVE;
+                f_close(g_logfile);
+                return;
+        }
+
         pr_info_str_msg(_RCP_BASE_FILE_ "Opened " , ls->name);
         ls->flush_tick = xTaskGetTickCount();
 }
 
+static void open_log_file(struct logging_status *ls,
+                          const struct sample *s)
+{
+        pr_info(_RCP_BASE_FILE_ "Opening log file\r\n");
+        ls->writing_status = WRITING_INACTIVE;
+
+        const int rc = InitFS();
+        if (0 != rc) {
+                pr_error_int_msg(_RCP_BASE_FILE_ "FS init error: ", rc);
+                /* Card may get swapped, so count the log files again */
+                g_next_log_index = -1;
+                return;
+        }
+
+        pr_debug(_RCP_BASE_FILE_ "FS init success.  Opening file...\r\n");
+        g_journaled = ls->journal;
+        open_mounted_log_file(ls, s);
+}
+
 TESTABLE_STATIC int logging_start(struct logging_status *ls)
 {
         pr_info(_RCP_BASE_FILE_ "Start\r\n");
@@ -297,6 +823,22 @@ TESTABLE_STATIC int logging_start(struct logging_status *ls)
 
         /* Set this here because this is the start of the log stream */
         ls->rows_written = 0;
+        ls->mode = g_logfile_mode;
+        ls->journal = g_logfile_journal;
+        /* Without a journal, a cut would leave the log ending in junk */
+        ls->prealloc = ls->journal ? g_logfile_prealloc : 0;
+        ls->rotate_minutes = g_rotate_minutes;
+        ls->rotate_kb = g_rotate_kb;
+        ls->session = 0;
+        ls->part = 0;
+        ls->start_tick = xTaskGetTickCount();
+        ls->start_pending = true;
+
+        /* The index is a nice to have.  Log without it if need be */
+        if (ls->index.entries)
+                reset_log_index(&ls->index);
+        else if (!init_log_index(&ls->index, LOG_INDEX_ENTRIES))
+                pr_warning(_RCP_BASE_FILE_ "No memory for log index\r\n");
 
         logging_led_toggle();
         return 0;
@@ -307,6 +849,11 @@ TESTABLE_STATIC int logging_stop(struct logging_status *ls)
         pr_debug(_RCP_BASE_FILE_ "End\r\n");
         ls->logging = false;
 
+        if (WRITING_ACTIVE == ls->writing_status) {
+                flush_file_buffer();
+                write_index_file(ls->name, &ls->index);
+        }
+
         close_log_file(ls);
 
         /* Prevent log file from being re-opened */
@@ -316,10 +863,55 @@ TESTABLE_STATIC int logging_stop(struct logging_status *ls)
         return 0;
 }
 
+static int write_binary_samples(struct logging_status *ls,
+                                const LoggerMessage *msg)
+{
+        /* The writer takes care of the header for us */
+        if (0 == ls->rows_written) {
+                binary_log_start(&ls->binary, append_file_data,
+                                 SD_LOGGING_MODE_COMPRESSED == ls->mode);
+                if (is_rotating(ls))
+                        binary_log_segment(&ls->binary, ls->session,
+                                           ls->part);
+        }
+
+        const int rc = binary_log_write_sample(&ls->binary, msg->sample);
+        if (0 == rc)
+                ls->rows_written++;
+
+        return rc;
+}
+
+/*
+ * @return Where the next row will start in the file.  Journaled logs
+ * count the payload, not the framing.
+ */
+static uint32_t get_log_position(void)
+{
+        return g_journaled ? g_journal.bytes :
+                f_tell(g_logfile) + get_sector_buffer_pending(&file_buff);
+}
+
+/*
+ * Notes where this sample starts in the file.  Packed binary logs get a
+ * keyframe there so that a reader can start decoding from the entry.
+ */
+static void index_sample(struct logging_status *ls, const struct sample *s)
+{
+        if (log_index_row(&ls->index, get_log_position(), s->ticks,
+                          getLapCount()))
+                binary_log_keyframe(&ls->binary);
+}
+
 static int write_samples(struct logging_status *ls, const LoggerMessage *msg)
 {
         int rc = 0;
 
+        index_sample(ls, msg->sample);
+
+        if (is_binary_mode(ls->mode))
+                return write_binary_samples(ls, msg);
+
         /* If we haven't written to this file yet, start with the headers */
         if (0 == ls->rows_written) {
                 rc = write_samples_header(msg);
@@ -341,6 +933,83 @@ static int write_samples(struct logging_status *ls, const LoggerMessage *msg)
         return rc;
 }
 
+TESTABLE_STATIC bool is_rotation_due(const struct logging_status *ls)
+{
+        /* Every part gets at least one row */
+        if (WRITING_ACTIVE != ls->writing_status || 0 == ls->rows_written)
+                return false;
+
+        if (ls->rotate_kb && get_log_position() / 1024 >= ls->rotate_kb)
+                return true;
+
+        return ls->rotate_minutes &&
+                isTimeoutMs(ls->segment_tick, ls->rotate_minutes * 60000);
+}
+
+static bool init_rotated_log_file(void)
+{
+        if (NULL == g_rotated.file) {
+                g_rotated.file = (FIL *) portMalloc(sizeof(FIL));
+                if (NULL == g_rotated.file)
+                        return false;
+
+                memset(g_rotated.file, 0, sizeof(FIL));
+        }
+
+        /* Parts can go without an index if need be */
+        if (NULL == g_rotated.index.entries &&
+            !init_log_index(&g_rotated.index, LOG_INDEX_ENTRIES))
+                pr_warning(_RCP_BASE_FILE_ "No memory for part index\r\n");
+
+        return true;
+}
+
+/*
+ * Moves on to the next part of the log.  The new part is opened right
+ * away and gets its header with the sample at hand, so no sample waits
+ * on the rotation.  The old part only has its data flushed here; it is
+ * closed by close_rotated_log_file() once things are quiet.
+ */
+TESTABLE_STATIC void rotate_log_file(struct logging_status *ls,
+                                     const struct sample *s)
+{
+        /* There is only room for one part waiting to be closed */
+        close_rotated_log_file();
+
+        if (!init_rotated_log_file()) {
+                pr_warning(_RCP_BASE_FILE_ "No memory to rotate, "
+                           "carrying on in one file\r\n");
+                ls->rotate_minutes = 0;
+                ls->rotate_kb = 0;
+                return;
+        }
+
+        pr_info_str_msg(_RCP_BASE_FILE_ "Rotating ", ls->name);
+        flush_file_buffer();
+
+        FIL *file = g_rotated.file;
+        g_rotated.file = g_logfile;
+        g_logfile = file;
+
+        const struct log_index index = g_rotated.index;
+        g_rotated.index = ls->index;
+        ls->index = index;
+        reset_log_index(&ls->index);
+
+        strcpy(g_rotated.name, ls->name);
+        g_rotated.truncate = 0 != ls->prealloc;
+        g_rotated.pending = true;
+
+        ls->part++;
+        ls->rows_written = 0;
+        ls->name[0] = '\0';
+        open_mounted_log_file(ls, s);
+
+        /* The retry will remount the card, so the old part can't wait */
+        if (WRITING_ACTIVE != ls->writing_status)
+                close_rotated_log_file();
+}
+
 TESTABLE_STATIC int logging_sample(struct logging_status *ls,
                                    LoggerMessage *msg)
 {
@@ -348,6 +1017,9 @@ TESTABLE_STATIC int logging_sample(struct logging_status *ls,
         if (!ls->logging)
                 return 0;
 
+        if (is_rotation_due(ls))
+                rotate_log_file(ls, msg->sample);
+
         int attempts = 2;
         int rc = WRITE_FAIL;
         while (attempts--) {
@@ -357,7 +1029,7 @@ TESTABLE_STATIC int logging_sample(struct logging_status *ls,
                  * this method will init the FS.
                  */
                 if (WRITING_ACTIVE != ls->writing_status)
-                        open_log_file(ls);
+                        open_log_file(ls, msg->sample);
 
                 /* Don't try to write if file isn't open */
                 if (WRITING_ACTIVE == ls->writing_status) {
@@ -369,6 +1041,7 @@ TESTABLE_STATIC int logging_sample(struct logging_status *ls,
                 /* If here, then unmount and try attempts more time */
                 pr_error(_RCP_BASE_FILE_ "Remounting FS due to write "
                          "error.\r\n");
+                sd_stats_remount();
                 close_log_file(ls);
 
                 /*
@@ -380,20 +1053,96 @@ TESTABLE_STATIC int logging_sample(struct logging_status *ls,
                 taskYIELD();
         }
 
+        if (0 == rc && ls->start_pending) {
+                ls->start_pending = false;
+                g_start_latency = ticksToMs(xTaskGetTickCount() -
+                                            ls->start_tick);
+                pr_info_int_msg(_RCP_BASE_FILE_ "First row ms: ",
+                                g_start_latency);
+        }
+
         logging_led_toggle();
         return rc;
 }
 
+/*
+ * Writes out the samples the pre-roll buffer held on to ahead of the
+ * log start so that the log begins with the lead up to the trigger.
+ * The table is held for the whole flush so a config change can't
+ * rebuild it underneath us.  If one is already under way, the stored
+ * samples no longer match the config and are dropped.
+ */
+static int logging_preroll(struct logging_status *ls)
+{
+        struct channel_table *t = preroll_get_table();
+        if (NULL == t)
+                return 0;
+
+        if (!acquire_channel_table(t)) {
+                pr_warning(_RCP_BASE_FILE_ "Config changed, pre-roll "
+                           "dropped\r\n");
+                preroll_clear();
+                return 0;
+        }
+
+        struct sample s;
+        memset(&s, 0, sizeof(struct sample));
+        if (!init_sample_buffer(&s, t)) {
+                pr_warning(_RCP_BASE_FILE_ "No memory for pre-roll\r\n");
+                preroll_clear();
+                release_channel_table(t);
+                return -1;
+        }
+
+        LoggerMessage msg = create_logger_message(LoggerMessageType_Sample,
+                                                  &s);
+        int rc = 0;
+        while (0 == rc && preroll_get(&s)) {
+                msg.ticks = s.ticks;
+                rc = logging_sample(ls, &msg);
+        }
+
+        preroll_clear();
+        free_sample_buffer(&s);
+        release_channel_table(t);
+        return rc;
+}
+
+/*
+ * Samples are at risk from when they are taken until the sync after they
+ * are written, so the time they take to reach us comes out of the loss
+ * budget.  Syncs cost throughput, so we use as much of what is left as
+ * we can.  If samples are so backed up that they eat more than half the
+ * budget it can't be met anyway, and syncing harder would only put us
+ * further behind.
+ */
+static unsigned int get_sync_interval(void)
+{
+        const struct pipeline_stats *ps =
+                get_pipeline_stats(PIPELINE_CONSUMER_FILE);
+        unsigned int latency = get_pipeline_latency_avg(ps);
+
+        if (latency > g_loss_budget / 2)
+                latency = g_loss_budget / 2;
+
+        return g_loss_budget - latency;
+}
+
 TESTABLE_STATIC int flush_logfile(struct logging_status *ls)
 {
         if (ls->writing_status != WRITING_ACTIVE)
                 return -1;
 
-        if (!isTimeoutMs(ls->flush_tick, FLUSH_INTERVAL_MS))
+        if (!isTimeoutMs(ls->flush_tick, get_sync_interval()))
                 return -2;
 
         pr_debug(_RCP_BASE_FILE_ "flush\r\n");
-        const int res = f_sync(g_logfile);
+        int res = flush_file_buffer();
+        if (0 == res) {
+                const uint32_t start = sd_stats_start();
+                res = f_sync(g_logfile);
+                sd_stats_sync(start, FR_OK == res);
+        }
         if (0 != res)
                 pr_debug_int_msg(_RCP_BASE_FILE_ "flush err ", res);
 
@@ -420,10 +1169,22 @@ static void fileWriterTask(void *params)
 
                 switch (msg.type) {
                 case LoggerMessageType_Sample:
+                        /* Hold on to samples for the next log start */
+                        if (!ls.logging) {
+                                preroll_add(msg.sample);
+                                rc = 0;
+                                break;
+                        }
+
                         rc = logging_sample(&ls, &msg);
+                        if (0 == rc && ls.logging)
+                                pipeline_stats_latency(PIPELINE_CONSUMER_FILE,
+                                                       msg.ticks);
                         break;
                 case LoggerMessageType_Start:
                         rc = logging_start(&ls);
+                        if (0 == rc)
+                                rc = logging_preroll(&ls);
                         break;
                 case LoggerMessageType_Stop:
                         rc = logging_stop(&ls);
@@ -441,30 +1202,64 @@ static void fileWriterTask(void *params)
                         pr_debug_int_msg(" failed with code ", rc);
                 }
 
+                release_logger_message(&msg);
+
+                /*
+                 * Only write out full blocks once we have caught up on
+                 * the queue.  This way formatting new rows is not held
+                 * up behind the SD card unless we run out of blocks.
+                 */
+                if (WRITING_ACTIVE == ls.writing_status &&
+                    0 == uxQueueMessagesWaiting(g_LoggerMessage_queue)) {
+                        int res = drain_file_buffer();
+                        if (0 == res) {
+                                close_rotated_log_file();
+                                res = grow_log_file(&ls);
+                        }
+
+                        if (0 != res) {
+                                pr_error(_RCP_BASE_FILE_ "Drain failed\r\n");
+                                sd_stats_remount();
+                                close_log_file(&ls);
+                        }
+                }
+
                 flush_logfile(&ls);
         }
 }
 
+TESTABLE_STATIC bool init_file_writer(void)
+{
+        if (NULL == g_logfile) {
+                g_logfile = (FIL *) portMalloc(sizeof(FIL));
+                if (NULL == g_logfile) {
+                        pr_error(_RCP_BASE_FILE_ "logfile sruct alloc err\r\n");
+                        return false;
+                }
+                memset(g_logfile, 0, sizeof(FIL));
+        }
+
+        if (NULL == file_buff.data &&
+            !init_sector_buffer(&file_buff, LOG_FILE_BLOCK_SIZE,
+                                LOG_FILE_BLOCKS)) {
+                pr_error(_RCP_BASE_FILE_ "Failed to alloc file buffer.\r\n");
+                return false;
+        }
+
+        return true;
+}
+
 void startFileWriterTask(int priority)
 {
-        g_LoggerMessage_queue = create_logger_message_queue();
+        g_LoggerMessage_queue = create_logger_message_queue(
+                LOGGER_MESSAGE_BUFFER_SIZE);
         if (NULL == g_LoggerMessage_queue) {
                 pr_error(_RCP_BASE_FILE_ "LoggerMessage Queue is null!\r\n");
                 return;
         }
 
-        g_logfile = (FIL *) portMalloc(sizeof(FIL));
-        if (NULL == g_logfile) {
-                pr_error(_RCP_BASE_FILE_ "logfile sruct alloc err\r\n");
+        if (!init_file_writer())
                 return;
-        }
-        memset(g_logfile, 0, sizeof(FIL));
-
-        const size_t size = create_ring_buffer(&file_buff, FILE_BUFFER_SIZE);
-        if (FILE_BUFFER_SIZE != size + 1) {
-                pr_error(_RCP_BASE_FILE_ "Failed to alloc ring buffer.\r\n");
-                return;
-        }
 
         xTaskCreate( fileWriterTask,( signed portCHAR * ) "fileWriter",
                      FILE_WRITER_STACK_SIZE, NULL, priority, NULL );
@@ -0,0 +1,126 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include "logIndex.h"
+#include "mem_mang.h"
+#include "mod_string.h"
+
+bool init_log_index(struct log_index *li, const size_t capacity)
+{
+        memset(li, 0, sizeof(struct log_index));
+
+        li->entries = (struct log_index_entry *)
+                portMalloc(capacity * sizeof(struct log_index_entry));
+        if (NULL == li->entries)
+                return false;
+
+        li->capacity = capacity;
+        reset_log_index(li);
+        return true;
+}
+
+void reset_log_index(struct log_index *li)
+{
+        li->count = 0;
+        li->interval = LOG_INDEX_INTERVAL;
+        li->rows = 0;
+        li->lap = -1;
+        li->session = 0;
+        li->part = 0;
+}
+
+/*
+ * Drops every other periodic entry to make room, which leaves them on
+ * the doubled interval.  Lap entries stay put.  Once all that is left is
+ * laps there is nothing more we can do.
+ */
+static void thin_log_index(struct log_index *li)
+{
+        size_t kept = 0;
+        bool keep = false;
+
+        for (size_t i = 0; i < li->count; ++i) {
+                struct log_index_entry e = li->entries[i];
+
+                if (e.flags & LOG_INDEX_FLAG_PERIODIC) {
+                        keep = !keep;
+                        if (!keep)
+                                e.flags &= ~LOG_INDEX_FLAG_PERIODIC;
+                }
+
+                if (e.flags)
+                        li->entries[kept++] = e;
+        }
+
+        li->count = kept;
+        li->interval *= 2;
+}
+
+bool log_index_row(struct log_index *li, const uint32_t offset,
+                   const uint32_t ticks, const int lap)
+{
+        /* No memory for entries, so no index */
+        if (0 == li->capacity)
+                return false;
+
+        const unsigned int row = li->rows++;
+        const bool new_lap = row && lap != li->lap;
+        bool periodic = 0 == row % li->interval;
+
+        li->lap = lap;
+        if (!new_lap && !periodic)
+                return false;
+
+        if (li->count == li->capacity) {
+                thin_log_index(li);
+                /* This row may not be on the new interval */
+                periodic = 0 == row % li->interval;
+        }
+
+        if (li->count == li->capacity || (!new_lap && !periodic))
+                return false;
+
+        struct log_index_entry *e = li->entries + li->count++;
+        e->offset = offset;
+        e->ticks = ticks;
+        e->lap = lap;
+        e->flags = (new_lap ? LOG_INDEX_FLAG_LAP : 0) |
+                (periodic ? LOG_INDEX_FLAG_PERIODIC : 0);
+        return true;
+}
+
+int write_log_index(const struct log_index *li,
+                    log_index_write_func *write)
+{
+        const uint8_t version[2] = { LOG_INDEX_VERSION, 0 };
+        const uint32_t interval = li->interval;
+        const uint32_t count = li->count;
+
+        return write(LOG_INDEX_MAGIC, LOG_INDEX_MAGIC_LEN) ||
+                write(version, sizeof(version)) ||
+                write(&interval, sizeof(interval)) ||
+                write(&count, sizeof(count)) ||
+                write(&li->session, sizeof(li->session)) ||
+                write(&li->part, sizeof(li->part)) ||
+                write(li->entries, count * sizeof(struct log_index_entry));
+}
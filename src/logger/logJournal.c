@@ -0,0 +1,144 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include "checksum.h"
+#include "logJournal.h"
+#include "mod_string.h"
+
+#include <stddef.h>
+
+static uint32_t get_frame_crc(const struct log_journal_frame *frame)
+{
+        return checksum_crc32(0, frame,
+                              offsetof(struct log_journal_frame, crc));
+}
+
+static void new_frame(struct log_journal *j, const uint32_t seq)
+{
+        struct log_journal_frame *f = &j->frame;
+
+        memcpy(f->magic, LOG_JOURNAL_MAGIC, LOG_JOURNAL_MAGIC_LEN);
+        f->len = 0;
+        f->seq = seq;
+}
+
+static int write_frame(struct log_journal *j)
+{
+        struct log_journal_frame *f = &j->frame;
+
+        /* Don't leave stale data behind in the padding */
+        memset(f->payload + f->len, 0, LOG_JOURNAL_PAYLOAD - f->len);
+        f->crc = get_frame_crc(f);
+
+        const int rc = j->write(f, sizeof(struct log_journal_frame));
+        if (0 == rc)
+                new_frame(j, f->seq + 1);
+
+        return rc;
+}
+
+void log_journal_start(struct log_journal *j, log_journal_write_func *write,
+                       const uint32_t session)
+{
+        memset(j, 0, sizeof(struct log_journal));
+        j->write = write;
+        j->frame.session = session;
+        new_frame(j, 0);
+}
+
+void log_journal_resume(struct log_journal *j, const uint32_t seq)
+{
+        j->frame.seq = seq;
+}
+
+int log_journal_append(struct log_journal *j, const void *data, size_t len)
+{
+        struct log_journal_frame *f = &j->frame;
+        const uint8_t *ptr = data;
+
+        while (len) {
+                size_t chunk = LOG_JOURNAL_PAYLOAD - f->len;
+                if (chunk > len)
+                        chunk = len;
+
+                memcpy(f->payload + f->len, ptr, chunk);
+                f->len += chunk;
+                j->bytes += chunk;
+                ptr += chunk;
+                len -= chunk;
+
+                if (LOG_JOURNAL_PAYLOAD == f->len) {
+                        const int rc = write_frame(j);
+                        if (rc)
+                                return rc;
+                }
+        }
+
+        return 0;
+}
+
+int log_journal_flush(struct log_journal *j)
+{
+        return j->frame.len ? write_frame(j) : 0;
+}
+
+bool log_journal_frame_valid(const struct log_journal_frame *frame,
+                             const uint32_t session, const uint32_t seq)
+{
+        return 0 == strncmp(frame->magic, LOG_JOURNAL_MAGIC,
+                            LOG_JOURNAL_MAGIC_LEN) &&
+                frame->len <= LOG_JOURNAL_PAYLOAD &&
+                frame->session == session &&
+                frame->seq == seq &&
+                frame->crc == get_frame_crc(frame);
+}
+
+size_t log_journal_valid_frames(log_journal_read_func *read,
+                                const size_t frames,
+                                struct log_journal_frame *frame)
+{
+        /* The first frame tells us which session to look for */
+        if (0 == frames || !read(0, frame) ||
+            !log_journal_frame_valid(frame, frame->session, 0))
+                return 0;
+
+        const uint32_t session = frame->session;
+        size_t good = 0;
+        size_t bad = frames - 1;
+
+        if (read(bad, frame) && log_journal_frame_valid(frame, session, bad))
+                return frames;
+
+        /* Frame good is valid, frame bad is not.  Close in on the edge */
+        while (bad - good > 1) {
+                const size_t mid = good + (bad - good) / 2;
+
+                if (read(mid, frame) &&
+                    log_journal_frame_valid(frame, session, mid))
+                        good = mid;
+                else
+                        bad = mid;
+        }
+
+        return good + 1;
+}
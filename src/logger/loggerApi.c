@@ -30,9 +30,11 @@
 #include "constants.h"
 #include "cpu.h"
 #include "dateTime.h"
+#include "fileWriter.h"
 #include "geopoint.h"
 #include "gps.h"
 #include "imu.h"
+#include "jsonWriter.h"
 #include "lap_stats.h"
 #include "launch_control.h"
 #include "logger.h"
@@ -43,17 +45,22 @@
 #include "loggerNotifications.h"
 #include "loggerSampleData.h"
 #include "loggerTaskEx.h"
+#include "loggerTiming.h"
 #include "luaScript.h"
 #include "luaTask.h"
 #include "mem_mang.h"
 #include "mod_string.h"
 #include "modp_atonum.h"
+#include "pipelineStats.h"
 #include "printk.h"
 #include "sampleRecord.h"
+#include "sdStats.h"
 #include "serial.h"
 #include "sim900.h"
 #include "task.h"
 #include "taskUtil.h"
+#include "telemetryFrame.h"
+#include "telemetryRate.h"
 #include "timer.h"
 #include "tracks.h"
 
@@ -201,105 +208,204 @@ int api_factoryReset(Serial *serial, const jsmntok_t *json)
 
 int api_getVersion(Serial *serial, const jsmntok_t *json)
 {
-    json_objStart(serial);
-    json_objStartString(serial,"ver");
-    json_string(serial, "name", DEVICE_NAME, 1);
-    json_string(serial, "fname", FRIENDLY_DEVICE_NAME, 1);
-    json_int(serial, "major", MAJOR_REV, 1);
-    json_int(serial, "minor", MINOR_REV, 1);
-    json_int(serial, "bugfix", BUGFIX_REV, 1);
-    json_string(serial, "serial", cpu_get_serialnumber(), 0);
-    json_objEnd(serial, 0);
-    json_objEnd(serial, 0);
+    struct json_writer w;
+    jw_open(&w, serial);
+    jw_obj_start(&w, NULL);
+    jw_obj_start(&w, "ver");
+    jw_string(&w, "name", DEVICE_NAME);
+    jw_string(&w, "fname", FRIENDLY_DEVICE_NAME);
+    jw_int(&w, "major", MAJOR_REV);
+    jw_int(&w, "minor", MINOR_REV);
+    jw_int(&w, "bugfix", BUGFIX_REV);
+    jw_string(&w, "serial", cpu_get_serialnumber());
+    jw_obj_end(&w);
+    jw_obj_end(&w);
+    jw_close(&w);
     return API_SUCCESS_NO_RETURN;
 }
 
 int api_getCapabilities(Serial *serial, const jsmntok_t *json)
 {
-    json_objStart(serial);
-    json_objStartString(serial,"capabilities");
-
-    json_objStartString(serial,"channels");
-    json_int(serial, "analog", ANALOG_CHANNELS, 1);
-    json_int(serial, "imu", IMU_CHANNELS, 1);
-    json_int(serial, "gpio", GPIO_CHANNELS, 1);
-    json_int(serial, "timer", TIMER_CHANNELS, 1);
-    json_int(serial, "pwm", PWM_CHANNELS, 1);
-    json_int(serial, "can", CAN_CHANNELS, 0);
-    json_objEnd(serial, 1);
-
-    json_objStartString(serial,"sampleRates");
-    json_int(serial, "sensor", MAX_SENSOR_SAMPLE_RATE, 1);
-    json_int(serial, "gps", MAX_GPS_SAMPLE_RATE, 0);
-    json_objEnd(serial, 1);
-
-    json_objStartString(serial,"db");
-    json_int(serial, "tracks", MAX_TRACKS, 1);
-    json_int(serial, "sectors", MAX_SECTORS, 1);
-    json_int(serial, "script", SCRIPT_MEMORY_LENGTH, 0);
-    json_objEnd(serial, 0);
-
-    json_objEnd(serial, 0);
-    json_objEnd(serial, 0);
+    struct json_writer w;
+    jw_open(&w, serial);
+    jw_obj_start(&w, NULL);
+    jw_obj_start(&w, "capabilities");
+
+    jw_obj_start(&w, "channels");
+    jw_int(&w, "analog", ANALOG_CHANNELS);
+    jw_int(&w, "imu", IMU_CHANNELS);
+    jw_int(&w, "gpio", GPIO_CHANNELS);
+    jw_int(&w, "timer", TIMER_CHANNELS);
+    jw_int(&w, "pwm", PWM_CHANNELS);
+    jw_int(&w, "can", CAN_CHANNELS);
+    jw_obj_end(&w);
+
+    jw_obj_start(&w, "sampleRates");
+    jw_int(&w, "sensor", MAX_SENSOR_SAMPLE_RATE);
+    jw_int(&w, "gps", MAX_GPS_SAMPLE_RATE);
+    jw_obj_end(&w);
+
+    jw_obj_start(&w, "db");
+    jw_int(&w, "tracks", MAX_TRACKS);
+    jw_int(&w, "sectors", MAX_SECTORS);
+    jw_int(&w, "script", SCRIPT_MEMORY_LENGTH);
+    jw_obj_end(&w);
+
+    jw_obj_end(&w);
+    jw_obj_end(&w);
+    jw_close(&w);
     return API_SUCCESS_NO_RETURN;
 }
 
 int api_getStatus(Serial *serial, const jsmntok_t *json)
 {
-    json_objStart(serial);
-    json_objStartString(serial, "status");
-
-    json_objStartString(serial, "system");
-    json_string(serial, "model", FRIENDLY_DEVICE_NAME, 1);
-    json_int(serial, "ver_major", MAJOR_REV, 1);
-    json_int(serial, "ver_minor", MINOR_REV, 1);
-    json_int(serial, "ver_bugfix", BUGFIX_REV, 1);
-    json_string(serial, "serial", cpu_get_serialnumber(), 1);
-    json_uint(serial, "uptime", getUptimeAsInt(), 0);
-    json_objEnd(serial, 1);
-
-    json_objStartString(serial, "GPS");
-    json_int(serial, "init", (int)GPS_getStatus(), 1);
-    json_int(serial, "qual", GPS_getQuality(), 1);
-    json_float(serial, "lat", GPS_getLatitude(), DEFAULT_GPS_POSITION_PRECISION, 1);
-    json_float(serial, "lon", GPS_getLongitude(), DEFAULT_GPS_POSITION_PRECISION, 1);
-    json_int(serial, "sats", GPS_getSatellitesUsedForPosition(), 1);
-    json_int(serial, "DOP", GPS_getDOP(), 0);
-    json_objEnd(serial, 1);
-
-    json_objStartString(serial, "cell");
-    json_int(serial, "init", cellmodem_get_status(), 1);
-    json_string(serial, "IMEI", cell_get_IMEI(), 1);
-    json_int(serial, "sig_str", cell_get_signal_strength(), 1);
-    json_string(serial, "number", cell_get_subscriber_number(), 0);
-    json_objEnd(serial, 1);
-
-    json_objStartString(serial, "bt");
-    json_int(serial, "init", (int)bt_get_status(), 0);
-    json_objEnd(serial, 1);
-
-    json_objStartString(serial, "logging");
-    json_int(serial, "status", (int)logging_get_status(), 1);
-    json_int(serial, "dur", logging_active_time(), 0);
-    json_objEnd(serial, 1);
-
-    json_objStartString(serial, "track");
-    json_int(serial, "status", lapstats_get_track_status(), 1);
-    json_int(serial, "trackId", lapstats_get_selected_track_id(), 1);
-    json_int(serial, "inLap", (int)lapstats_lap_in_progress(), 1);
-    json_int(serial, "armed", lc_is_armed(), 0);
-    json_objEnd(serial, 1);
-
-    json_objStartString(serial, "telemetry");
-    json_int(serial, "status", (int)sim900_get_connection_status(), 1);
-    json_int(serial, "dur", sim900_active_time(), 0);
-    json_objEnd(serial, 0);
-
-    json_objEnd(serial, 0);
-    json_objEnd(serial, 0);
+    struct json_writer w;
+    jw_open(&w, serial);
+    jw_obj_start(&w, NULL);
+    jw_obj_start(&w, "status");
+
+    jw_obj_start(&w, "system");
+    jw_string(&w, "model", FRIENDLY_DEVICE_NAME);
+    jw_int(&w, "ver_major", MAJOR_REV);
+    jw_int(&w, "ver_minor", MINOR_REV);
+    jw_int(&w, "ver_bugfix", BUGFIX_REV);
+    jw_string(&w, "serial", cpu_get_serialnumber());
+    jw_uint(&w, "uptime", getUptimeAsInt());
+    jw_obj_end(&w);
+
+    jw_obj_start(&w, "GPS");
+    jw_int(&w, "init", (int)GPS_getStatus());
+    jw_int(&w, "qual", GPS_getQuality());
+    jw_float(&w, "lat", GPS_getLatitude(), DEFAULT_GPS_POSITION_PRECISION);
+    jw_float(&w, "lon", GPS_getLongitude(), DEFAULT_GPS_POSITION_PRECISION);
+    jw_int(&w, "sats", GPS_getSatellitesUsedForPosition());
+    jw_int(&w, "DOP", GPS_getDOP());
+    jw_obj_end(&w);
+
+    jw_obj_start(&w, "cell");
+    jw_int(&w, "init", cellmodem_get_status());
+    jw_string(&w, "IMEI", cell_get_IMEI());
+    jw_int(&w, "sig_str", cell_get_signal_strength());
+    jw_string(&w, "number", cell_get_subscriber_number());
+    jw_obj_end(&w);
+
+    jw_obj_start(&w, "bt");
+    jw_int(&w, "init", (int)bt_get_status());
+    jw_obj_end(&w);
+
+    jw_obj_start(&w, "logging");
+    jw_int(&w, "status", (int)logging_get_status());
+    jw_int(&w, "dur", logging_active_time());
+    jw_uint(&w, "start_lat", get_logfile_start_latency());
+    jw_obj_end(&w);
+
+    jw_obj_start(&w, "track");
+    jw_int(&w, "status", lapstats_get_track_status());
+    jw_int(&w, "trackId", lapstats_get_selected_track_id());
+    jw_int(&w, "inLap", (int)lapstats_lap_in_progress());
+    jw_int(&w, "armed", lc_is_armed());
+    jw_obj_end(&w);
+
+    jw_obj_start(&w, "telemetry");
+    jw_int(&w, "status", (int)sim900_get_connection_status());
+    jw_int(&w, "dur", sim900_active_time());
+    jw_obj_end(&w);
+
+    jw_obj_start(&w, "pipeline");
+    for (size_t i = 0; i < PIPELINE_CONSUMERS; ++i) {
+        const struct pipeline_stats *ps = get_pipeline_stats(i);
+
+        jw_obj_start(&w, get_pipeline_consumer_name(i));
+        jw_uint(&w, "queued", ps->queued);
+        jw_uint(&w, "q_fail", ps->queue_failures);
+        jw_uint(&w, "overrun", ps->overruns);
+        jw_uint(&w, "q_max", ps->depth_max);
+        jw_uint(&w, "q_avg", get_pipeline_depth_avg(ps));
+        jw_uint(&w, "lat_max", ps->latency_max);
+        jw_uint(&w, "lat_avg", get_pipeline_latency_avg(ps));
+
+        /* What each telemetry link is getting right now, in Hz */
+        if (i >= PIPELINE_CONSUMER_TELEMETRY) {
+            const struct telemetry_rate *tr =
+                get_telemetry_rate(i - PIPELINE_CONSUMER_TELEMETRY);
+            jw_int(&w, "rate", decodeSampleRate(tr->rate));
+        }
+        jw_obj_end(&w);
+    }
+    jw_obj_end(&w);
+
+    jw_obj_end(&w);
+    jw_obj_end(&w);
+    jw_close(&w);
+    return API_SUCCESS_NO_RETURN;
+}
+
+static void json_timing_histogram(struct json_writer *w, const char *name,
+                                  const struct timing_histogram *h)
+{
+    jw_obj_start(w, name);
+    jw_uint(w, "count", h->count);
+    jw_uint(w, "max", h->max_us);
+    jw_uint(w, "avg", h->count ? h->total_us / h->count : 0);
+
+    jw_array_start(w, "hist");
+    for (int b = 0; b < TIMING_HISTOGRAM_BUCKETS; ++b)
+        jw_int(w, NULL, h->buckets[b]);
+    jw_array_end(w);
+
+    jw_obj_end(w);
+}
+
+int api_getTiming(Serial *serial, const jsmntok_t *json)
+{
+    struct json_writer w;
+    jw_open(&w, serial);
+    jw_obj_start(&w, NULL);
+    jw_obj_start(&w, "timing");
+
+    for (int i = 0; i < TIMING_HISTOGRAMS; ++i)
+        json_timing_histogram(&w, get_logger_timing_histogram_name(i),
+                              get_logger_timing_histogram(i));
+
+    jw_obj_end(&w);
+    jw_obj_end(&w);
+    jw_close(&w);
     return API_SUCCESS_NO_RETURN;
 }
 
+int api_resetTiming(Serial *serial, const jsmntok_t *json)
+{
+    logger_timing_reset();
+    return API_SUCCESS;
+}
+
+int api_getSdStats(Serial *serial, const jsmntok_t *json)
+{
+    const struct sd_stats *ss = get_sd_stats();
+
+    struct json_writer w;
+    jw_open(&w, serial);
+    jw_obj_start(&w, NULL);
+    jw_obj_start(&w, "sdStats");
+    json_timing_histogram(&w, "write", &ss->write);
+    json_timing_histogram(&w, "sync", &ss->sync);
+    jw_uint(&w, "bytes", ss->bytes);
+    jw_uint(&w, "bps", get_sd_write_rate(ss));
+    jw_uint(&w, "errors", ss->errors);
+    jw_uint(&w, "remounts", ss->remounts);
+    jw_uint(&w, "q_max", ss->queue_depth_max);
+    jw_obj_end(&w);
+    jw_obj_end(&w);
+    jw_close(&w);
+    return API_SUCCESS_NO_RETURN;
+}
+
+int api_resetSdStats(Serial *serial, const jsmntok_t *json)
+{
+    sd_stats_reset();
+    return API_SUCCESS;
+}
+
 int api_sampleData(Serial *serial, const jsmntok_t *json)
 {
     int sendMeta = 0;
@@ -321,39 +427,56 @@ int api_sampleData(Serial *serial, const jsmntok_t *json)
     if (0 == channelCount)
         return API_ERROR_SEVERE;
 
+    struct channel_table t;
+    memset(&t, 0, sizeof(struct channel_table));
+    if (!init_channel_table(&t, config))
+       return API_ERROR_SEVERE;
+
     struct sample s;
     memset(&s, 0, sizeof(struct sample));
-    const size_t size = init_sample_buffer(&s, channelCount);
-    if (!size)
+    const size_t size = init_sample_buffer(&s, &t);
+    if (!size) {
+       free_channel_table(&t);
        return API_ERROR_SEVERE;
+    }
 
     populate_sample_buffer(&s, 0);
     api_send_sample_record(serial, &s, 0, sendMeta);
 
     free_sample_buffer(&s);
+    free_channel_table(&t);
     return API_SUCCESS_NO_RETURN;
 }
 
 int api_heart_beat(Serial *serial, const jsmntok_t *json)
 {
-    json_objStart(serial);
-    json_int(serial, "hb", getUptimeAsInt(), 0);
-    json_objEnd(serial, 0);
+    struct json_writer w;
+    jw_open(&w, serial);
+    jw_obj_start(&w, NULL);
+    jw_int(&w, "hb", getUptimeAsInt());
+    jw_obj_end(&w);
+    jw_close(&w);
     return API_SUCCESS_NO_RETURN;
 }
 
 void api_sendLogStart(Serial *serial)
 {
-    json_objStart(serial);
-    json_int(serial, "logStart", 1, 0);
-    json_objEnd(serial, 0);
+    struct json_writer w;
+    jw_open(&w, serial);
+    jw_obj_start(&w, NULL);
+    jw_int(&w, "logStart", 1);
+    jw_obj_end(&w);
+    jw_close(&w);
 }
 
 void api_sendLogEnd(Serial *serial)
 {
-    json_objStart(serial);
-    json_int(serial, "logEnd", 1, 0);
-    json_objEnd(serial, 0);
+    struct json_writer w;
+    jw_open(&w, serial);
+    jw_obj_start(&w, NULL);
+    jw_int(&w, "logEnd", 1);
+    jw_obj_end(&w);
+    jw_close(&w);
 }
 
 int api_log(Serial *serial, const jsmntok_t *json)
@@ -377,54 +500,54 @@ int api_log(Serial *serial, const jsmntok_t *json)
     return API_SUCCESS;
 }
 
-static void json_channelConfig(Serial *serial, ChannelConfig *cfg, int more)
+static void json_channelConfig(struct json_writer *w, ChannelConfig *cfg)
 {
-    json_string(serial, "nm", cfg->label, 1);
-    json_string(serial, "ut", cfg->units, 1);
-    json_float(serial, "min", cfg->min, cfg->precision, 1);
-    json_float(serial, "max", cfg->max, cfg->precision, 1);
-    json_int(serial, "prec", (int) cfg->precision, 1);
-    json_int(serial, "sr", decodeSampleRate(cfg->sampleRate), more);
+    jw_string(w, "nm", cfg->label);
+    jw_string(w, "ut", cfg->units);
+    jw_float(w, "min", cfg->min, cfg->precision);
+    jw_float(w, "max", cfg->max, cfg->precision);
+    jw_int(w, "prec", (int) cfg->precision);
+    jw_int(w, "sr", decodeSampleRate(cfg->sampleRate));
 }
 
-static void write_sample_meta(Serial *serial, const struct sample *sample,
-                              int sampleRateLimit, int more)
+static void write_sample_meta(struct json_writer *w,
+                              const struct channel_table *t,
+                              int sampleRateLimit)
 {
-        json_arrayStart(serial, "meta");
-        ChannelSample *channel_sample = sample->channel_samples;
+        jw_array_start(w, "meta");
+        const ChannelDescriptor *cd = t->channels;
 
-        for (size_t i = 0; i < sample->channel_count; ++i, ++channel_sample) {
-                if (0 < i)
-                        serial->put_c(',');
-
-                serial->put_c('{');
-                json_channelConfig(serial, channel_sample->cfg, 0);
-                serial->put_c('}');
+        for (size_t i = 0; i < t->channel_count; ++i, ++cd) {
+                jw_obj_start(w, NULL);
+                json_channelConfig(w, cd->cfg);
+                jw_obj_end(w);
         }
 
-        json_arrayEnd(serial, more);
+        jw_array_end(w);
 }
 
 int api_getMeta(Serial *serial, const jsmntok_t *json)
 {
-    json_objStart(serial);
-
     LoggerConfig * config = getWorkingLoggerConfig();
     const size_t channelCount = get_enabled_channel_count(config);
 
     if (0 == channelCount)
         return API_ERROR_SEVERE;
 
-    struct sample s;
-    memset(&s, 0, sizeof(struct sample));
-    const size_t size = init_sample_buffer(&s, channelCount);
+    struct channel_table t;
+    memset(&t, 0, sizeof(struct channel_table));
+    const size_t size = init_channel_table(&t, config);
     if (!size)
        return API_ERROR_SEVERE;
 
-    write_sample_meta(serial, &s, getConnectivitySampleRateLimit(), 0);
+    struct json_writer w;
+    jw_open(&w, serial);
+    jw_obj_start(&w, NULL);
+    write_sample_meta(&w, &t, getConnectivitySampleRateLimit());
+    jw_obj_end(&w);
+    jw_close(&w);
 
-    free_sample_buffer(&s);
-    json_objEnd(serial, 0);
+    free_channel_table(&t);
     return API_SUCCESS_NO_RETURN;
 }
 
@@ -434,74 +557,64 @@ int api_getMeta(Serial *serial, const jsmntok_t *json)
 void api_send_sample_record(Serial *serial, struct sample *sample,
                             unsigned int tick, int sendMeta)
 {
-        json_objStart(serial);
-        json_objStartString(serial, "s");
-        json_uint(serial,"t", tick, 1);
+        struct json_writer w;
+        jw_open(&w, serial);
 
-        if (sendMeta)
-                write_sample_meta(serial, sample,
-                                  getConnectivitySampleRateLimit(), 1);
-
-        size_t channelBitmaskIndex = 0;
-        unsigned int channelBitmask[MAX_BITMAPS];
-        memset(channelBitmask, 0, sizeof(channelBitmask));
-
-        json_arrayStart(serial, "d");
-        ChannelSample *cs = sample->channel_samples;
-
-        size_t channelBitPosition = 0;
-        for (size_t i = 0; i < sample->channel_count;
-             i++, channelBitPosition++, cs++) {
-
-                if (channelBitPosition > 31) {
-                        channelBitmaskIndex++;
-                        channelBitPosition=0;
-                        if (channelBitmaskIndex > MAX_BITMAPS)
-                                break;
-                }
+        jw_obj_start(&w, NULL);
+        jw_obj_start(&w, "s");
+        jw_uint(&w, "t", tick);
 
-                if (cs->populated) {
-                        channelBitmask[channelBitmaskIndex] =
-                                channelBitmask[channelBitmaskIndex] |
-                                (1 << channelBitPosition);
-
-                        const int precision = cs->cfg->precision;
-                        switch(cs->sampleData) {
-                        case SampleData_Float:
-                        case SampleData_Float_Noarg:
-                                put_float(serial, cs->valueFloat, precision);
-                                break;
-                        case SampleData_Int:
-                        case SampleData_Int_Noarg:
-                                put_int(serial, cs->valueInt);
-                                break;
-                        case SampleData_LongLong:
-                        case SampleData_LongLong_Noarg:
-                                put_ll(serial, cs->valueLongLong);
-                                break;
-                        case SampleData_Double:
-                        case SampleData_Double_Noarg:
-                                put_double(serial, cs->valueDouble, precision);
-                                break;
-                        default:
-                                pr_warning("sendSampleRec: unknown sample "
-                                           "data type\r\n");
-                                break;
-                        }
-                        serial->put_c(',');
+        if (sendMeta)
+                write_sample_meta(&w, sample->table,
+                                  getConnectivitySampleRateLimit());
+
+        jw_array_start(&w, "d");
+
+        size_t channel_count = sample->channel_count;
+        if (channel_count > MAX_BITMAPS * 32)
+                channel_count = MAX_BITMAPS * 32;
+
+        const ChannelDescriptor *cd = sample->table->channels;
+        const ChannelValue *value = sample->values;
+        for (size_t i = 0; i < channel_count; i++, cd++, value++) {
+                if (!is_sample_populated(sample, i))
+                        continue;
+
+                const int precision = cd->cfg->precision;
+                switch(cd->sampleData) {
+                case SampleData_Float:
+                case SampleData_Float_Noarg:
+                case SampleData_Float_Kernel:
+                        jw_float(&w, NULL, value->valueFloat, precision);
+                        break;
+                case SampleData_Int:
+                case SampleData_Int_Noarg:
+                        jw_int(&w, NULL, value->valueInt);
+                        break;
+                case SampleData_LongLong:
+                case SampleData_LongLong_Noarg:
+                        jw_ll(&w, NULL, value->valueLongLong);
+                        break;
+                case SampleData_Double:
+                case SampleData_Double_Noarg:
+                        jw_double(&w, NULL, value->valueDouble, precision);
+                        break;
+                default:
+                        pr_warning("sendSampleRec: unknown sample "
+                                   "data type\r\n");
+                        break;
                 }
         }
 
-        size_t channelBitmaskCount = channelBitmaskIndex + 1;
-        for (size_t i = 0; i < channelBitmaskCount; i++) {
-                put_uint(serial, channelBitmask[i]);
-                if (i < channelBitmaskCount - 1)
-                        serial->put_c(',');
-        }
+        /* The populated bitmap goes out as is, 32 channels per word */
+        const size_t channelBitmaskCount = SAMPLE_BITMAP_WORDS(channel_count);
+        for (size_t i = 0; i < channelBitmaskCount; i++)
+                jw_uint(&w, NULL, sample->populated[i]);
 
-        json_arrayEnd(serial, 0);
-        json_objEnd(serial, 0);
-        json_objEnd(serial, 0);
+        jw_array_end(&w);
+        jw_obj_end(&w);
+        jw_obj_end(&w);
+        jw_close(&w);
 }
 
 static const jsmntok_t * setChannelConfig(Serial *serial, const jsmntok_t *cfg,
@@ -666,43 +779,40 @@ int api_setAnalogConfig(Serial *serial, const jsmntok_t * json)
 static void sendAnalogConfig(Serial *serial, size_t startIndex, size_t endIndex)
 {
 
-    json_objStart(serial);
-    json_objStartString(serial, "analogCfg");
+    struct json_writer w;
+    jw_open(&w, serial);
+    jw_obj_start(&w, NULL);
+    jw_obj_start(&w, "analogCfg");
     for (size_t i = startIndex; i <= endIndex; i++) {
 
         ADCConfig *adcCfg = &(getWorkingLoggerConfig()->ADCConfigs[i]);
-        json_objStartInt(serial, i);
-        json_channelConfig(serial, &(adcCfg->cfg), 1);
-        json_int(serial, "scalMod", adcCfg->scalingMode, 1);
-        json_float(serial, "scaling", adcCfg->linearScaling, LINEAR_SCALING_PRECISION, 1);
-        json_float(serial, "offset", adcCfg->linearOffset, LINEAR_SCALING_PRECISION, 1);
-        json_float(serial, "alpha", adcCfg->filterAlpha, FILTER_ALPHA_PRECISION, 1);
-        json_float(serial, "cal", adcCfg->calibration, LINEAR_SCALING_PRECISION, 1);
-
-        json_objStartString(serial, "map");
-        json_arrayStart(serial, "raw");
-
-        for (size_t b = 0; b < ANALOG_SCALING_BINS; b++) {
-            put_float(serial,  adcCfg->scalingMap.rawValues[b], SCALING_MAP_BIN_PRECISION);
-            if (b < ANALOG_SCALING_BINS - 1)
-                serial->put_c(',');
-        }
+        jw_obj_start_int(&w, i);
+        json_channelConfig(&w, &(adcCfg->cfg));
+        jw_int(&w, "scalMod", adcCfg->scalingMode);
+        jw_float(&w, "scaling", adcCfg->linearScaling, LINEAR_SCALING_PRECISION);
+        jw_float(&w, "offset", adcCfg->linearOffset, LINEAR_SCALING_PRECISION);
+        jw_float(&w, "alpha", adcCfg->filterAlpha, FILTER_ALPHA_PRECISION);
+        jw_float(&w, "cal", adcCfg->calibration, LINEAR_SCALING_PRECISION);
 
-        json_arrayEnd(serial, 1);
-        json_arrayStart(serial, "scal");
+        jw_obj_start(&w, "map");
+        jw_array_start(&w, "raw");
 
-        for (size_t b = 0; b < ANALOG_SCALING_BINS; b++) {
-            put_float(serial, adcCfg->scalingMap.scaledValues[b], DEFAULT_ANALOG_SCALING_PRECISION);
-            if (b < ANALOG_SCALING_BINS - 1)
-                serial->put_c(',');
-        }
+        for (size_t b = 0; b < ANALOG_SCALING_BINS; b++)
+            jw_float(&w, NULL, adcCfg->scalingMap.rawValues[b], SCALING_MAP_BIN_PRECISION);
 
-        json_arrayEnd(serial, 0);
-        json_objEnd(serial, 0); //map
-        json_objEnd(serial, i != endIndex); //index
+        jw_array_end(&w);
+        jw_array_start(&w, "scal");
+
+        for (size_t b = 0; b < ANALOG_SCALING_BINS; b++)
+            jw_float(&w, NULL, adcCfg->scalingMap.scaledValues[b], DEFAULT_ANALOG_SCALING_PRECISION);
+
+        jw_array_end(&w);
+        jw_obj_end(&w); //map
+        jw_obj_end(&w); //index
     }
-    json_objEnd(serial, 0);
-    json_objEnd(serial, 0);
+    jw_obj_end(&w);
+    jw_obj_end(&w);
+    jw_close(&w);
 }
 
 int api_getAnalogConfig(Serial *serial, const jsmntok_t * json)
@@ -758,20 +868,23 @@ int api_setImuConfig(Serial *serial, const jsmntok_t *json)
 
 static void sendImuConfig(Serial *serial, size_t startIndex, size_t endIndex)
 {
-    json_objStart(serial);
-    json_objStartString(serial, "imuCfg");
+    struct json_writer w;
+    jw_open(&w, serial);
+    jw_obj_start(&w, NULL);
+    jw_obj_start(&w, "imuCfg");
     for (size_t i = startIndex; i <= endIndex; i++) {
         ImuConfig *cfg = &(getWorkingLoggerConfig()->ImuConfigs[i]);
-        json_objStartInt(serial, i);
-        json_channelConfig(serial, &(cfg->cfg), 1);
-        json_uint(serial, "mode", cfg->mode, 1);
-        json_uint(serial, "chan", cfg->physicalChannel, 1);
-        json_int(serial, "zeroVal", cfg->zeroValue, 1);
-        json_float(serial, "alpha", cfg->filterAlpha, FILTER_ALPHA_PRECISION, 0 );
-        json_objEnd(serial, i != endIndex); //index
+        jw_obj_start_int(&w, i);
+        json_channelConfig(&w, &(cfg->cfg));
+        jw_uint(&w, "mode", cfg->mode);
+        jw_uint(&w, "chan", cfg->physicalChannel);
+        jw_int(&w, "zeroVal", cfg->zeroValue);
+        jw_float(&w, "alpha", cfg->filterAlpha, FILTER_ALPHA_PRECISION);
+        jw_obj_end(&w); //index
     }
-    json_objEnd(serial, 0);
-    json_objEnd(serial, 0);
+    jw_obj_end(&w);
+    jw_obj_end(&w);
+    jw_close(&w);
 }
 
 int api_getImuConfig(Serial *serial, const jsmntok_t *json)
@@ -824,36 +937,46 @@ static void setConfigGeneric(Serial *serial, const jsmntok_t * json, void *cfg,
 int api_getCellConfig(Serial *serial, const jsmntok_t *json)
 {
     CellularConfig *cfg = &(getWorkingLoggerConfig()->ConnectivityConfigs.cellularConfig);
-    json_objStart(serial);
-    json_objStartString(serial, "cellCfg");
-    json_string(serial, "apnHost", cfg->apnHost, 1);
-    json_string(serial, "apnUser", cfg->apnUser, 1);
-    json_string(serial, "apnPass", cfg->apnPass, 0);
-    json_objEnd(serial, 0);
-    json_objEnd(serial, 0);
+    struct json_writer w;
+    jw_open(&w, serial);
+    jw_obj_start(&w, NULL);
+    jw_obj_start(&w, "cellCfg");
+    jw_string(&w, "apnHost", cfg->apnHost);
+    jw_string(&w, "apnUser", cfg->apnUser);
+    jw_string(&w, "apnPass", cfg->apnPass);
+    jw_obj_end(&w);
+    jw_obj_end(&w);
+    jw_close(&w);
     return API_SUCCESS_NO_RETURN;
 }
 
 int api_getBluetoothConfig(Serial *serial, const jsmntok_t *json)
 {
     BluetoothConfig *cfg = &(getWorkingLoggerConfig()->ConnectivityConfigs.bluetoothConfig);
-    json_objStart(serial);
-    json_objStartString(serial, "btCfg");
-    json_string(serial, "name", cfg->deviceName, 1);
-    json_string(serial, "pass", cfg->passcode, 0);
-    json_objEnd(serial, 0);
-    json_objEnd(serial, 0);
+    struct json_writer w;
+    jw_open(&w, serial);
+    jw_obj_start(&w, NULL);
+    jw_obj_start(&w, "btCfg");
+    jw_string(&w, "name", cfg->deviceName);
+    jw_string(&w, "pass", cfg->passcode);
+    jw_obj_end(&w);
+    jw_obj_end(&w);
+    jw_close(&w);
     return API_SUCCESS_NO_RETURN;
 }
 
 int api_getLogfile(Serial *serial, const jsmntok_t *json)
 {
-    json_objStart(serial);
-    json_valueStart(serial, "logfile");
-    serial->put_c('"');
+    struct json_writer w;
+    jw_open(&w, serial);
+    jw_obj_start(&w, NULL);
+    jw_key(&w, "logfile");
+    jw_raw(&w, "\"", 1);
+    jw_flush(&w);
     read_log_to_serial(serial, 1);
-    serial->put_c('"');
-    json_objEnd(serial,0);
+    jw_raw(&w, "\"", 1);
+    jw_obj_end(&w);
+    jw_close(&w);
     return API_SUCCESS_NO_RETURN;
 }
 
@@ -868,6 +991,20 @@ int api_setLogfileLevel(Serial *serial, const jsmntok_t *json)
     }
 }
 
+/*
+ * Switches how samples stream on the connection the request came in
+ * on.  Takes effect from the next sample.
+ */
+int api_setStreamFormat(Serial *serial, const jsmntok_t *json)
+{
+    int format;
+    if (!setIntValueIfExists(json, "fmt", &format) || format < 0)
+        return API_ERROR_PARAMETER;
+
+    return telemetry_set_format(serial, (enum telemetry_format) format) ?
+        API_SUCCESS : API_ERROR_PARAMETER;
+}
+
 static void setCellConfig(const jsmntok_t *root)
 {
     const jsmntok_t *cellCfgNode = findNode(root, "cellCfg");
@@ -917,50 +1054,56 @@ int api_setConnectivityConfig(Serial *serial, const jsmntok_t *json)
 int api_getConnectivityConfig(Serial *serial, const jsmntok_t *json)
 {
     ConnectivityConfig *cfg = &(getWorkingLoggerConfig()->ConnectivityConfigs);
-    json_objStart(serial);
-    json_objStartString(serial, "connCfg");
-
-    json_objStartString(serial, "btCfg");
-    json_int(serial, "btEn", cfg->bluetoothConfig.btEnabled, 1);
-    json_string(serial, "name", cfg->bluetoothConfig.deviceName, 1);
-    json_string(serial, "pass", cfg->bluetoothConfig.passcode, 0);
-    json_objEnd(serial, 1);
-
-    json_objStartString(serial, "cellCfg");
-    json_int(serial, "cellEn", cfg->cellularConfig.cellEnabled, 1);
-    json_string(serial, "apnHost", cfg->cellularConfig.apnHost, 1);
-    json_string(serial, "apnUser", cfg->cellularConfig.apnUser, 1);
-    json_string(serial, "apnPass", cfg->cellularConfig.apnPass, 0);
-    json_objEnd(serial, 1);
-
-    json_objStartString(serial, "telCfg");
-    json_int(serial, "bgStream", cfg->telemetryConfig.backgroundStreaming, 1);
-    json_string(serial, "deviceId", cfg->telemetryConfig.telemetryDeviceId, 1);
-    json_string(serial, "host", cfg->telemetryConfig.telemetryServerHost, 0);
-    json_objEnd(serial, 0);
-
-    json_objEnd(serial, 0);
-    json_objEnd(serial, 0);
+    struct json_writer w;
+    jw_open(&w, serial);
+    jw_obj_start(&w, NULL);
+    jw_obj_start(&w, "connCfg");
+
+    jw_obj_start(&w, "btCfg");
+    jw_int(&w, "btEn", cfg->bluetoothConfig.btEnabled);
+    jw_string(&w, "name", cfg->bluetoothConfig.deviceName);
+    jw_string(&w, "pass", cfg->bluetoothConfig.passcode);
+    jw_obj_end(&w);
+
+    jw_obj_start(&w, "cellCfg");
+    jw_int(&w, "cellEn", cfg->cellularConfig.cellEnabled);
+    jw_string(&w, "apnHost", cfg->cellularConfig.apnHost);
+    jw_string(&w, "apnUser", cfg->cellularConfig.apnUser);
+    jw_string(&w, "apnPass", cfg->cellularConfig.apnPass);
+    jw_obj_end(&w);
+
+    jw_obj_start(&w, "telCfg");
+    jw_int(&w, "bgStream", cfg->telemetryConfig.backgroundStreaming);
+    jw_string(&w, "deviceId", cfg->telemetryConfig.telemetryDeviceId);
+    jw_string(&w, "host", cfg->telemetryConfig.telemetryServerHost);
+    jw_obj_end(&w);
+
+    jw_obj_end(&w);
+    jw_obj_end(&w);
+    jw_close(&w);
     return API_SUCCESS_NO_RETURN;
 }
 
 static void sendPwmConfig(Serial *serial, size_t startIndex, size_t endIndex)
 {
 
-    json_objStart(serial);
-    json_objStartString(serial, "pwmCfg");
+    struct json_writer w;
+    jw_open(&w, serial);
+    jw_obj_start(&w, NULL);
+    jw_obj_start(&w, "pwmCfg");
     for (size_t i = startIndex; i <= endIndex; i++) {
         PWMConfig *cfg = &(getWorkingLoggerConfig()->PWMConfigs[i]);
-        json_objStartInt(serial, i);
-        json_channelConfig(serial, &(cfg->cfg), 1);
-        json_uint(serial, "outMode", cfg->outputMode, 1);
-        json_uint(serial, "logMode", cfg->loggingMode, 1);
-        json_uint(serial, "stDutyCyc", cfg->startupDutyCycle, 1);
-        json_uint(serial, "stPeriod", cfg->startupPeriod, 0);
-        json_objEnd(serial, i != endIndex); //index
+        jw_obj_start_int(&w, i);
+        json_channelConfig(&w, &(cfg->cfg));
+        jw_uint(&w, "outMode", cfg->outputMode);
+        jw_uint(&w, "logMode", cfg->loggingMode);
+        jw_uint(&w, "stDutyCyc", cfg->startupDutyCycle);
+        jw_uint(&w, "stPeriod", cfg->startupPeriod);
+        jw_obj_end(&w); //index
     }
-    json_objEnd(serial, 0);
-    json_objEnd(serial, 0);
+    jw_obj_end(&w);
+    jw_obj_end(&w);
+    jw_close(&w);
 }
 
 
@@ -1035,17 +1178,20 @@ static const jsmntok_t * setGpioExtendedField(const jsmntok_t *valueTok, const c
 
 static void sendGpioConfig(Serial *serial, size_t startIndex, size_t endIndex)
 {
-    json_objStart(serial);
-    json_objStartString(serial, "gpioCfg");
+    struct json_writer w;
+    jw_open(&w, serial);
+    jw_obj_start(&w, NULL);
+    jw_obj_start(&w, "gpioCfg");
     for (size_t i = startIndex; i <= endIndex; i++) {
         GPIOConfig *cfg = &(getWorkingLoggerConfig()->GPIOConfigs[i]);
-        json_objStartInt(serial, i);
-        json_channelConfig(serial, &(cfg->cfg), 1);
-        json_uint(serial, "mode", cfg->mode, 0);
-        json_objEnd(serial, i != endIndex);
+        jw_obj_start_int(&w, i);
+        json_channelConfig(&w, &(cfg->cfg));
+        jw_uint(&w, "mode", cfg->mode);
+        jw_obj_end(&w);
     }
-    json_objEnd(serial, 0);
-    json_objEnd(serial, 0);
+    jw_obj_end(&w);
+    jw_obj_end(&w);
+    jw_close(&w);
 }
 
 
@@ -1106,21 +1252,24 @@ static const jsmntok_t * setTimerExtendedField(const jsmntok_t *valueTok, const
 
 static void sendTimerConfig(Serial *serial, size_t startIndex, size_t endIndex)
 {
-    json_objStart(serial);
-    json_objStartString(serial, "timerCfg");
+    struct json_writer w;
+    jw_open(&w, serial);
+    jw_obj_start(&w, NULL);
+    jw_obj_start(&w, "timerCfg");
     for (size_t i = startIndex; i <= endIndex; i++) {
         TimerConfig *cfg = &(getWorkingLoggerConfig()->TimerConfigs[i]);
-        json_objStartInt(serial, i);
-        json_channelConfig(serial, &(cfg->cfg), 1);
-        json_uint(serial, "st", cfg->slowTimerEnabled, 1);
-        json_uint(serial, "mode", cfg->mode, 1);
-        json_float(serial, "alpha", cfg->filterAlpha, FILTER_ALPHA_PRECISION, 1);
-        json_uint(serial, "ppr", cfg->pulsePerRevolution, 1);
-        json_uint(serial, "speed", cfg->timerSpeed, 0);
-        json_objEnd(serial, i != endIndex);
+        jw_obj_start_int(&w, i);
+        json_channelConfig(&w, &(cfg->cfg));
+        jw_uint(&w, "st", cfg->slowTimerEnabled);
+        jw_uint(&w, "mode", cfg->mode);
+        jw_float(&w, "alpha", cfg->filterAlpha, FILTER_ALPHA_PRECISION);
+        jw_uint(&w, "ppr", cfg->pulsePerRevolution);
+        jw_uint(&w, "speed", cfg->timerSpeed);
+        jw_obj_end(&w);
     }
-    json_objEnd(serial, 0);
-    json_objEnd(serial, 0);
+    jw_obj_end(&w);
+    jw_obj_end(&w);
+    jw_close(&w);
 }
 
 int api_getTimerConfig(Serial *serial, const jsmntok_t *json)
@@ -1170,24 +1319,27 @@ int api_getGpsConfig(Serial *serial, const jsmntok_t *json)
 
     GPSConfig *gpsCfg = &(getWorkingLoggerConfig()->GPSConfigs);
 
-    json_objStart(serial);
-    json_objStartString(serial, "gpsCfg");
+    struct json_writer w;
+    jw_open(&w, serial);
+    jw_obj_start(&w, NULL);
+    jw_obj_start(&w, "gpsCfg");
 
     unsigned short highestRate = getGpsConfigHighSampleRate(gpsCfg);
-    json_int(serial, "sr", decodeSampleRate(highestRate), 1);
+    jw_int(&w, "sr", decodeSampleRate(highestRate));
 
     const int posEnabled = gpsCfg->latitude.sampleRate != SAMPLE_DISABLED &&
                            gpsCfg->longitude.sampleRate != SAMPLE_DISABLED;
-    json_int(serial, "pos",  posEnabled, 1);
-    json_int(serial, "speed", gpsCfg->speed.sampleRate != SAMPLE_DISABLED, 1);
-    json_int(serial, "dist", gpsCfg->distance.sampleRate != SAMPLE_DISABLED, 1);
-    json_int(serial, "alt", gpsCfg->altitude.sampleRate != SAMPLE_DISABLED, 1);
-    json_int(serial, "sats", gpsCfg->satellites.sampleRate != SAMPLE_DISABLED, 1);
-    json_int(serial, "qual", gpsCfg->quality.sampleRate != SAMPLE_DISABLED, 1);
-    json_int(serial, "dop", gpsCfg->DOP.sampleRate != SAMPLE_DISABLED, 0);
-
-    json_objEnd(serial, 0);
-    json_objEnd(serial, 0);
+    jw_int(&w, "pos", posEnabled);
+    jw_int(&w, "speed", gpsCfg->speed.sampleRate != SAMPLE_DISABLED);
+    jw_int(&w, "dist", gpsCfg->distance.sampleRate != SAMPLE_DISABLED);
+    jw_int(&w, "alt", gpsCfg->altitude.sampleRate != SAMPLE_DISABLED);
+    jw_int(&w, "sats", gpsCfg->satellites.sampleRate != SAMPLE_DISABLED);
+    jw_int(&w, "qual", gpsCfg->quality.sampleRate != SAMPLE_DISABLED);
+    jw_int(&w, "dop", gpsCfg->DOP.sampleRate != SAMPLE_DISABLED);
+
+    jw_obj_end(&w);
+    jw_obj_end(&w);
+    jw_close(&w);
     return API_SUCCESS_NO_RETURN;
 }
 
@@ -1226,16 +1378,19 @@ int api_getCanConfig(Serial *serial, const jsmntok_t *json)
 {
 
     CANConfig *canCfg = &getWorkingLoggerConfig()->CanConfig;
-    json_objStart(serial);
-    json_objStartString(serial, "canCfg");
-    json_int(serial, "en", canCfg->enabled, 1);
-    json_arrayStart(serial, "baud");
+    struct json_writer w;
+    jw_open(&w, serial);
+    jw_obj_start(&w, NULL);
+    jw_obj_start(&w, "canCfg");
+    jw_int(&w, "en", canCfg->enabled);
+    jw_array_start(&w, "baud");
     for (size_t i = 0; i < CONFIG_CAN_CHANNELS; i++) {
-        json_arrayElementInt(serial, canCfg->baud[i], i < CONFIG_CAN_CHANNELS - 1);
+        jw_int(&w, NULL, canCfg->baud[i]);
     }
-    json_arrayEnd(serial, 0);
-    json_objEnd(serial, 0);
-    json_objEnd(serial, 0);
+    jw_array_end(&w);
+    jw_obj_end(&w);
+    jw_obj_end(&w);
+    jw_close(&w);
 
     return API_SUCCESS_NO_RETURN;
 }
@@ -1261,26 +1416,29 @@ int api_setCanConfig(Serial *serial, const jsmntok_t *json)
 
 int api_getObd2Config(Serial *serial, const jsmntok_t *json)
 {
-    json_objStart(serial);
-    json_objStartString(serial, "obd2Cfg");
+    struct json_writer w;
+    jw_open(&w, serial);
+    jw_obj_start(&w, NULL);
+    jw_obj_start(&w, "obd2Cfg");
 
     OBD2Config *obd2Cfg = &(getWorkingLoggerConfig()->OBD2Configs);
 
     int enabledPids = obd2Cfg->enabledPids;
-    json_int(serial,"en", obd2Cfg->enabled, 1);
-    json_arrayStart(serial, "pids");
+    jw_int(&w, "en", obd2Cfg->enabled);
+    jw_array_start(&w, "pids");
 
     for (int i = 0; i < enabledPids; i++) {
         PidConfig *pidCfg = &obd2Cfg->pids[i];
-        json_objStart(serial);
-        json_channelConfig(serial, &(pidCfg->cfg), 1);
-        json_int(serial,"pid",pidCfg->pid, 0);
-        json_objEnd(serial, i < enabledPids - 1);
+        jw_obj_start(&w, NULL);
+        json_channelConfig(&w, &(pidCfg->cfg));
+        jw_int(&w, "pid", pidCfg->pid);
+        jw_obj_end(&w);
     }
 
-    json_arrayEnd(serial, 0);
-    json_objEnd(serial,0);
-    json_objEnd(serial, 0);
+    jw_array_end(&w);
+    jw_obj_end(&w);
+    jw_obj_end(&w);
+    jw_close(&w);
     return API_SUCCESS_NO_RETURN;
 }
 
@@ -1375,71 +1533,74 @@ int api_getLapConfig(Serial *serial, const jsmntok_t *json)
 {
     LapConfig *lapCfg = &(getWorkingLoggerConfig()->LapConfigs);
 
-    json_objStart(serial);
-    json_objStartString(serial, "lapCfg");
+    struct json_writer w;
+    jw_open(&w, serial);
+    jw_obj_start(&w, NULL);
+    jw_obj_start(&w, "lapCfg");
 
-    json_objStartString(serial, "lapCount");
-    json_channelConfig(serial, &lapCfg->lapCountCfg, 0);
-    json_objEnd(serial, 1);
+    jw_obj_start(&w, "lapCount");
+    json_channelConfig(&w, &lapCfg->lapCountCfg);
+    jw_obj_end(&w);
 
-    json_objStartString(serial, "lapTime");
-    json_channelConfig(serial, &lapCfg->lapTimeCfg, 0);
-    json_objEnd(serial, 1);
+    jw_obj_start(&w, "lapTime");
+    json_channelConfig(&w, &lapCfg->lapTimeCfg);
+    jw_obj_end(&w);
 
-    json_objStartString(serial, "predTime");
-    json_channelConfig(serial, &lapCfg->predTimeCfg, 0);
-    json_objEnd(serial, 1);
+    jw_obj_start(&w, "predTime");
+    json_channelConfig(&w, &lapCfg->predTimeCfg);
+    jw_obj_end(&w);
 
-    json_objStartString(serial, "sector");
-    json_channelConfig(serial, &lapCfg->sectorCfg, 0);
-    json_objEnd(serial, 1);
+    jw_obj_start(&w, "sector");
+    json_channelConfig(&w, &lapCfg->sectorCfg);
+    jw_obj_end(&w);
 
-    json_objStartString(serial, "sectorTime");
-    json_channelConfig(serial, &lapCfg->sectorTimeCfg, 0);
-    json_objEnd(serial, 1);
+    jw_obj_start(&w, "sectorTime");
+    json_channelConfig(&w, &lapCfg->sectorTimeCfg);
+    jw_obj_end(&w);
 
-    json_objStartString(serial, "elapsed");
-    json_channelConfig(serial, &lapCfg->elapsed_time_cfg, 0);
-    json_objEnd(serial, 1);
+    jw_obj_start(&w, "elapsed");
+    json_channelConfig(&w, &lapCfg->elapsed_time_cfg);
+    jw_obj_end(&w);
 
-    json_objStartString(serial, "currentLap");
-    json_channelConfig(serial, &lapCfg->current_lap_cfg, 0);
-    json_objEnd(serial, 0);
+    jw_obj_start(&w, "currentLap");
+    json_channelConfig(&w, &lapCfg->current_lap_cfg);
+    jw_obj_end(&w);
 
-    json_objEnd(serial, 0);
-    json_objEnd(serial, 0);
+    jw_obj_end(&w);
+    jw_obj_end(&w);
+    jw_close(&w);
     return API_SUCCESS_NO_RETURN;
 }
 
-static void json_geoPointArray(Serial *serial, const char *name, const GeoPoint *point, int more)
+static void json_geoPointArray(struct json_writer *w, const char *name, const GeoPoint *point)
 {
-    json_arrayStart(serial, name);
-    json_arrayElementFloat(serial, point->latitude, DEFAULT_GPS_POSITION_PRECISION, 1);
-    json_arrayElementFloat(serial, point->longitude, DEFAULT_GPS_POSITION_PRECISION, 0);
-    json_arrayEnd(serial, more);
+    jw_array_start(w, name);
+    jw_float(w, NULL, point->latitude, DEFAULT_GPS_POSITION_PRECISION);
+    jw_float(w, NULL, point->longitude, DEFAULT_GPS_POSITION_PRECISION);
+    jw_array_end(w);
 }
 
-static void json_track(Serial *serial, const Track *track)
+static void json_track(struct json_writer *w, const Track *track)
 {
-    json_int(serial, "id", track->trackId, 1);
-    json_int(serial, "type", track->track_type, 1);
+    jw_int(w, "id", track->trackId);
+    jw_int(w, "type", track->track_type);
     if (track->track_type == TRACK_TYPE_CIRCUIT) {
-        json_geoPointArray(serial, "sf", &track->circuit.startFinish, 1);
-        json_arrayStart(serial, "sec");
+        json_geoPointArray(w, "sf", &track->circuit.startFinish);
+        jw_array_start(w, "sec");
         for (size_t i = 0; i < CIRCUIT_SECTOR_COUNT; i++) {
-            json_geoPointArray(serial, NULL, &track->circuit.sectors[i], i < CIRCUIT_SECTOR_COUNT - 1);
+            json_geoPointArray(w, NULL, &track->circuit.sectors[i]);
         }
-        json_arrayEnd(serial, 0);
+        jw_array_end(w);
     } else {
         GeoPoint start = getStartPoint(track);
         GeoPoint finish = getFinishPoint(track);
-        json_geoPointArray(serial, "st", &start, 1);
-        json_geoPointArray(serial, "fin", &finish, 1);
-        json_arrayStart(serial, "sec");
+        json_geoPointArray(w, "st", &start);
+        json_geoPointArray(w, "fin", &finish);
+        jw_array_start(w, "sec");
         for (size_t i = 0; i < STAGE_SECTOR_COUNT; i++) {
-            json_geoPointArray(serial, NULL, &track->stage.sectors[i], i < STAGE_SECTOR_COUNT - 1);
+            json_geoPointArray(w, NULL, &track->stage.sectors[i]);
         }
-        json_arrayEnd(serial, 0);
+        jw_array_end(w);
     }
 }
 
@@ -1447,15 +1608,18 @@ int api_getTrackConfig(Serial *serial, const jsmntok_t *json)
 {
     TrackConfig *trackCfg = &(getWorkingLoggerConfig()->TrackConfigs);
 
-    json_objStart(serial);
-    json_objStartString(serial, "trackCfg");
-    json_float(serial, "rad", trackCfg->radius, DEFAULT_GPS_RADIUS_PRECISION, 1);
-    json_int(serial, "autoDetect", trackCfg->auto_detect, 1);
-    json_objStartString(serial, "track");
-    json_track(serial, &trackCfg->track);
-    json_objEnd(serial, 0);
-    json_objEnd(serial, 0);
-    json_objEnd(serial, 0);
+    struct json_writer w;
+    jw_open(&w, serial);
+    jw_obj_start(&w, NULL);
+    jw_obj_start(&w, "trackCfg");
+    jw_float(&w, "rad", trackCfg->radius, DEFAULT_GPS_RADIUS_PRECISION);
+    jw_int(&w, "autoDetect", trackCfg->auto_detect);
+    jw_obj_start(&w, "track");
+    json_track(&w, &trackCfg->track);
+    jw_obj_end(&w);
+    jw_obj_end(&w);
+    jw_obj_end(&w);
+    jw_close(&w);
 
     return API_SUCCESS_NO_RETURN;
 }
@@ -1587,20 +1751,23 @@ int api_getTrackDb(Serial *serial, const jsmntok_t *json)
     const Tracks * tracks = get_tracks();
 
     size_t track_count = tracks->count;
-    json_objStart(serial);
-    json_objStartString(serial, "trackDb");
-    json_int(serial,"size", track_count, 1);
-    json_int(serial, "max", MAX_TRACK_COUNT, 1);
-    json_arrayStart(serial, "tracks");
+    struct json_writer w;
+    jw_open(&w, serial);
+    jw_obj_start(&w, NULL);
+    jw_obj_start(&w, "trackDb");
+    jw_int(&w, "size", track_count);
+    jw_int(&w, "max", MAX_TRACK_COUNT);
+    jw_array_start(&w, "tracks");
     for (size_t track_index = 0; track_index < track_count; track_index++) {
         const Track *track = tracks->tracks + track_index;
-        json_objStart(serial);
-        json_track(serial, track);
-        json_objEnd(serial, track_index < track_count - 1);
+        jw_obj_start(&w, NULL);
+        json_track(&w, track);
+        jw_obj_end(&w);
     }
-    json_arrayEnd(serial, 0);
-    json_objEnd(serial, 0);
-    json_objEnd(serial, 0);
+    jw_array_end(&w);
+    jw_obj_end(&w);
+    jw_obj_end(&w);
+    jw_close(&w);
     return API_SUCCESS_NO_RETURN;
 }
 
@@ -1608,12 +1775,15 @@ int api_getScript(Serial *serial, const jsmntok_t *json)
 {
     const char *script = getScript();
 
-    json_objStart(serial);
-    json_objStartString(serial, "scriptCfg");
-    json_null(serial, "page", 1);
-    json_escapedString(serial, "data", script,0);
-    json_objEnd(serial, 0);
-    json_objEnd(serial, 0);
+    struct json_writer w;
+    jw_open(&w, serial);
+    jw_obj_start(&w, NULL);
+    jw_obj_start(&w, "scriptCfg");
+    jw_null(&w, "page");
+    jw_escaped_string(&w, "data", script);
+    jw_obj_end(&w);
+    jw_obj_end(&w);
+    jw_close(&w);
 
     return API_SUCCESS_NO_RETURN;
 }
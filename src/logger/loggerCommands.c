@@ -21,6 +21,7 @@
 
 
 #include <stddef.h>
+#include "fileWriter.h"
 #include "gpsTask.h"
 #include "mod_string.h"
 #include "loggerCommands.h"
@@ -38,6 +39,7 @@
 #include "usart.h"
 #include "mem_mang.h"
 #include "loggerTaskEx.h"
+#include "preroll.h"
 #include "taskUtil.h"
 #include "GPIO.h"
 #include "cpu.h"
@@ -180,3 +182,130 @@ void LogGpsData(Serial *serial, unsigned int argc, char **argv)
 
     serial->flush();
 }
+
+void StaggerSampling(Serial *serial, unsigned int argc, char **argv)
+{
+    if (argc != 2) {
+        serial->put_s("Must pass one argument only.  Enter 0 to disable, or non-zero to enable\r\n");
+        put_commandError(serial, ERROR_CODE_INVALID_PARAM);
+    } else {
+        const bool enable = (argv[1][0] != '0');
+        set_staggered_sampling(enable);
+        configChanged();
+        serial->put_s(enable ? "Enabling" : "Disabling");
+        serial->put_s(" phase staggered channel sampling.\r\n");
+        put_commandOK(serial);
+    }
+
+    serial->flush();
+}
+
+void SetPreroll(Serial *serial, unsigned int argc, char **argv)
+{
+    if (argc != 2) {
+        serial->put_s("Must pass one argument only.  Enter the pre-roll time in ms, or 0 to disable\r\n");
+        put_commandError(serial, ERROR_CODE_INVALID_PARAM);
+    } else {
+        preroll_set_duration(modp_atoui(argv[1]));
+        serial->put_s("Pre-roll set to ");
+        put_uint(serial, preroll_get_duration());
+        serial->put_s(" ms.\r\n");
+        put_commandOK(serial);
+    }
+
+    serial->flush();
+}
+
+void SetLogFormat(Serial *serial, unsigned int argc, char **argv)
+{
+    const unsigned char mode = argc == 2 ?
+        filterSdLoggingMode(modp_atoui(argv[1])) : SD_LOGGING_MODE_DISABLED;
+
+    if (SD_LOGGING_MODE_DISABLED == mode) {
+        serial->put_s("Must pass one argument only.  Enter 1 for CSV, 2 for binary or 3 for compressed binary\r\n");
+        put_commandError(serial, ERROR_CODE_INVALID_PARAM);
+    } else {
+        set_logfile_mode(mode);
+        switch (mode) {
+        case SD_LOGGING_MODE_BINARY:
+            serial->put_s("Binary");
+            break;
+        case SD_LOGGING_MODE_COMPRESSED:
+            serial->put_s("Compressed binary");
+            break;
+        default:
+            serial->put_s("CSV");
+            break;
+        }
+        serial->put_s(" log files will be written from the next log start.\r\n");
+        put_commandOK(serial);
+    }
+
+    serial->flush();
+}
+
+void SetLogPrealloc(Serial *serial, unsigned int argc, char **argv)
+{
+    if (argc != 2) {
+        serial->put_s("Must pass one argument only.  Enter the minutes to reserve space for, or 0 to disable\r\n");
+        put_commandError(serial, ERROR_CODE_INVALID_PARAM);
+    } else {
+        set_logfile_prealloc(modp_atoui(argv[1]));
+        serial->put_s("Journaled log files will reserve space for ");
+        put_uint(serial, get_logfile_prealloc());
+        serial->put_s(" minutes from the next log start.\r\n");
+        put_commandOK(serial);
+    }
+
+    serial->flush();
+}
+
+void SetLogJournal(Serial *serial, unsigned int argc, char **argv)
+{
+    if (argc != 2) {
+        serial->put_s("Must pass one argument only.  Enter 0 to disable, or non-zero to enable\r\n");
+        put_commandError(serial, ERROR_CODE_INVALID_PARAM);
+    } else {
+        const bool enable = (argv[1][0] != '0');
+        set_logfile_journal(enable);
+        serial->put_s(enable ? "Enabling" : "Disabling");
+        serial->put_s(" power cut safe log files from the next log start.\r\n");
+        put_commandOK(serial);
+    }
+
+    serial->flush();
+}
+
+void SetLogLossBudget(Serial *serial, unsigned int argc, char **argv)
+{
+    if (argc != 2) {
+        serial->put_s("Must pass one argument only.  Enter the ms of samples that may be lost on a power cut\r\n");
+        put_commandError(serial, ERROR_CODE_INVALID_PARAM);
+    } else {
+        set_logfile_loss_budget(modp_atoui(argv[1]));
+        serial->put_s("Log files will lose at most ");
+        put_uint(serial, get_logfile_loss_budget());
+        serial->put_s(" ms of samples on a power cut.\r\n");
+        put_commandOK(serial);
+    }
+
+    serial->flush();
+}
+
+void SetLogRotate(Serial *serial, unsigned int argc, char **argv)
+{
+    if (argc != 3) {
+        serial->put_s("Must pass two arguments.  Enter the minutes and the KB per log file, 0 for no limit\r\n");
+        put_commandError(serial, ERROR_CODE_INVALID_PARAM);
+    } else {
+        set_logfile_rotation(modp_atoui(argv[1]), modp_atoui(argv[2]));
+        serial->put_s("Log files will roll over every ");
+        put_uint(serial, get_logfile_rotate_minutes());
+        serial->put_s(" minutes or ");
+        put_uint(serial, get_logfile_rotate_kb());
+        serial->put_s(" KB from the next log start.\r\n");
+        put_commandOK(serial);
+    }
+
+    serial->flush();
+}
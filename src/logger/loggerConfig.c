@@ -70,6 +70,16 @@ static void resetTimeConfig(struct TimeConfig *tc)
     tc[1] = (struct TimeConfig) DEFAULT_UTC_MILLIS_TIME_CONFIG;
 }
 
+// Spreads the bins evenly over 0 - 5V, whatever ANALOG_SCALING_BINS is
+static void resetScalingMap(ScalingMap *map)
+{
+    for (size_t i = 0; i < ANALOG_SCALING_BINS; ++i) {
+        const float v = 5.0f * i / (ANALOG_SCALING_BINS - 1);
+        map->rawValues[i] = v;
+        map->scaledValues[i] = v;
+    }
+}
+
 static void resetAdcConfig(ADCConfig cfg[])
 {
     // All but the last one are zeroed out.
@@ -82,6 +92,9 @@ static void resetAdcConfig(ADCConfig cfg[])
 
     // Now update the battery config
     cfg[7] = (ADCConfig) BATTERY_ADC_CONFIG;
+
+    for (size_t i = 0; i < CONFIG_ADC_CHANNELS; ++i)
+        resetScalingMap(&cfg[i].scalingMap);
 }
 
 static void resetPwmConfig(PWMConfig cfg[])
@@ -352,6 +365,10 @@ unsigned char filterSdLoggingMode(unsigned char mode)
     switch (mode) {
     case SD_LOGGING_MODE_CSV:
         return SD_LOGGING_MODE_CSV;
+    case SD_LOGGING_MODE_BINARY:
+        return SD_LOGGING_MODE_BINARY;
+    case SD_LOGGING_MODE_COMPRESSED:
+        return SD_LOGGING_MODE_COMPRESSED;
     default:
     case SD_LOGGING_MODE_DISABLED:
         return SD_LOGGING_MODE_DISABLED;
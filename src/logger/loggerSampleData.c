@@ -40,13 +40,16 @@
 #include "predictive_timer_2.h"
 #include "printk.h"
 #include "sampleRecord.h"
+#include "scalingTable.h"
 #include "taskUtil.h"
+#include "test.h"
 #include "timer.h"
 #include "virtual_channel.h"
 
 #include <stdbool.h>
+#include <stdint.h>
 
-static ChannelSample* processChannelSampleWithFloatGetter(ChannelSample *s,
+static ChannelDescriptor* processChannelSampleWithFloatGetter(ChannelDescriptor *s,
         ChannelConfig *cfg,
         const size_t index,
         float (*getter)(int))
@@ -62,7 +65,7 @@ static ChannelSample* processChannelSampleWithFloatGetter(ChannelSample *s,
     return ++s;
 }
 
-static ChannelSample* processChannelSampleWithIntGetter(ChannelSample *s,
+static ChannelDescriptor* processChannelSampleWithIntGetter(ChannelDescriptor *s,
         ChannelConfig *cfg,
         const size_t index,
         int (*getter)(int))
@@ -78,7 +81,7 @@ static ChannelSample* processChannelSampleWithIntGetter(ChannelSample *s,
     return ++s;
 }
 
-static ChannelSample* processChannelSampleWithFloatGetterNoarg(ChannelSample *s,
+static ChannelDescriptor* processChannelSampleWithFloatGetterNoarg(ChannelDescriptor *s,
         ChannelConfig *cfg,
         float (*getter)())
 {
@@ -92,7 +95,7 @@ static ChannelSample* processChannelSampleWithFloatGetterNoarg(ChannelSample *s,
     return ++s;
 }
 
-static ChannelSample* processChannelSampleWithIntGetterNoarg(ChannelSample *s,
+static ChannelDescriptor* processChannelSampleWithIntGetterNoarg(ChannelDescriptor *s,
         ChannelConfig *cfg,
         int (*getter)())
 {
@@ -106,7 +109,7 @@ static ChannelSample* processChannelSampleWithIntGetterNoarg(ChannelSample *s,
     return ++s;
 }
 
-static ChannelSample* processChannelSampleWithLongLongGetterNoarg(ChannelSample *s,
+static ChannelDescriptor* processChannelSampleWithLongLongGetterNoarg(ChannelDescriptor *s,
         ChannelConfig *cfg,
         long long (*getter)())
 {
@@ -152,75 +155,148 @@ float get_mapped_value(float value, ScalingMap *scalingMap)
     return scaled;
 }
 
-float get_analog_sample(int channelId)
+/*
+ * Sample kernels.  Each of these is chosen, and has its parameters baked
+ * in, when the channel table is built so that the hot path never has to
+ * look at the config or switch on its modes.
+ */
+TESTABLE_STATIC float invalid_kernel(const ChannelDescriptor *cd)
 {
-    LoggerConfig * loggerConfig = getWorkingLoggerConfig();
-    ADCConfig *ac = &(loggerConfig->ADCConfigs[channelId]);
-    float value = ADC_read(channelId);
-    float analogValue = 0;
-    switch(ac->scalingMode) {
-    case SCALING_MODE_RAW:
-        analogValue = value;
-        break;
-    case SCALING_MODE_LINEAR:
-        analogValue = (ac->linearScaling * (float)value) + ac->linearOffset;
-        break;
-    case SCALING_MODE_MAP:
-        analogValue = get_mapped_value((float)value,&(ac->scalingMap));
-        break;
-    default:
-        analogValue = -1;
-        break;
-    }
-    return analogValue;
+        return -1;
 }
 
-float get_timer_sample(int channelId)
+TESTABLE_STATIC float analog_raw_kernel(const ChannelDescriptor *cd)
 {
-    LoggerConfig *loggerConfig = getWorkingLoggerConfig();
-    TimerConfig *c = &(loggerConfig->TimerConfigs[channelId]);
-    float timerValue = 0;
-    uint8_t pulsePerRevolution = c->pulsePerRevolution;
-    switch (c->mode) {
-    case MODE_LOGGING_TIMER_RPM:
-        timerValue = timer_get_rpm(channelId) / pulsePerRevolution;
-        break;
-    case MODE_LOGGING_TIMER_FREQUENCY:
-        timerValue = timer_get_hz(channelId) / pulsePerRevolution;
-        break;
-    case MODE_LOGGING_TIMER_PERIOD_MS:
-        timerValue = timer_get_ms(channelId) * pulsePerRevolution;
-        break;
-    case MODE_LOGGING_TIMER_PERIOD_USEC:
-        timerValue = timer_get_usec(channelId) * pulsePerRevolution;
-        break;
-    default:
-        timerValue = -1;
-        break;
-    }
-    return timerValue;
+        return ADC_read(cd->channelIndex);
 }
 
-float get_pwm_sample(int channelId)
+TESTABLE_STATIC float analog_linear_kernel(const ChannelDescriptor *cd)
 {
-    LoggerConfig *loggerConfig = getWorkingLoggerConfig();
-    PWMConfig *c = &(loggerConfig->PWMConfigs[channelId]);
-    float pwmValue = 0;
-    switch (c->loggingMode) {
-    case MODE_LOGGING_PWM_PERIOD:
-        pwmValue = PWM_channel_get_period(channelId);
-        break;
-    case MODE_LOGGING_PWM_DUTY:
-        pwmValue = PWM_get_duty_cycle(channelId);
-        break;
-    case MODE_LOGGING_PWM_VOLTS:
-        pwmValue = PWM_get_duty_cycle(channelId) * PWM_VOLTAGE_SCALING;
-        break;
-    default:
-        pwmValue = -1;
-        break;
-    }
-    return pwmValue;
+        return cd->kernel.linear.scale * ADC_read(cd->channelIndex) +
+                cd->kernel.linear.offset;
+}
+
+TESTABLE_STATIC float analog_map_kernel(const ChannelDescriptor *cd)
+{
+        return get_scaling_table_value(cd->kernel.map,
+                                       ADC_read(cd->channelIndex));
+}
+
+TESTABLE_STATIC float timer_rpm_kernel(const ChannelDescriptor *cd)
+{
+        return timer_get_rpm(cd->channelIndex) / cd->kernel.pulses;
+}
+
+TESTABLE_STATIC float timer_hz_kernel(const ChannelDescriptor *cd)
+{
+        return timer_get_hz(cd->channelIndex) / cd->kernel.pulses;
+}
+
+TESTABLE_STATIC float timer_ms_kernel(const ChannelDescriptor *cd)
+{
+        return timer_get_ms(cd->channelIndex) * cd->kernel.pulses;
+}
+
+TESTABLE_STATIC float timer_usec_kernel(const ChannelDescriptor *cd)
+{
+        return timer_get_usec(cd->channelIndex) * cd->kernel.pulses;
+}
+
+TESTABLE_STATIC float pwm_period_kernel(const ChannelDescriptor *cd)
+{
+        return PWM_channel_get_period(cd->channelIndex);
+}
+
+TESTABLE_STATIC float pwm_duty_kernel(const ChannelDescriptor *cd)
+{
+        return PWM_get_duty_cycle(cd->channelIndex);
+}
+
+TESTABLE_STATIC float pwm_volts_kernel(const ChannelDescriptor *cd)
+{
+        return PWM_get_duty_cycle(cd->channelIndex) * PWM_VOLTAGE_SCALING;
+}
+
+/* Lookup tables of the mapped analog channels, filled in with the table */
+static struct scaling_table g_analog_maps[CONFIG_ADC_CHANNELS];
+
+static void init_kernel_descriptor(ChannelDescriptor *cd, ChannelConfig *cfg,
+                                   const size_t index)
+{
+        cd->cfg = cfg;
+        cd->channelIndex = index;
+        cd->sampleData = SampleData_Float_Kernel;
+}
+
+static void compile_analog_kernel(ChannelDescriptor *cd, ADCConfig *ac,
+                                  const size_t index)
+{
+        init_kernel_descriptor(cd, &ac->cfg, index);
+
+        switch (ac->scalingMode) {
+        case SCALING_MODE_RAW:
+                cd->get_float_sample_kernel = analog_raw_kernel;
+                break;
+        case SCALING_MODE_LINEAR:
+                cd->get_float_sample_kernel = analog_linear_kernel;
+                cd->kernel.linear.scale = ac->linearScaling;
+                cd->kernel.linear.offset = ac->linearOffset;
+                break;
+        case SCALING_MODE_MAP:
+                init_scaling_table(g_analog_maps + index, &ac->scalingMap);
+                cd->get_float_sample_kernel = analog_map_kernel;
+                cd->kernel.map = g_analog_maps + index;
+                break;
+        default:
+                cd->get_float_sample_kernel = invalid_kernel;
+                break;
+        }
+}
+
+static void compile_timer_kernel(ChannelDescriptor *cd, TimerConfig *tc,
+                                 const size_t index)
+{
+        init_kernel_descriptor(cd, &tc->cfg, index);
+        cd->kernel.pulses = tc->pulsePerRevolution;
+
+        switch (tc->mode) {
+        case MODE_LOGGING_TIMER_RPM:
+                cd->get_float_sample_kernel = timer_rpm_kernel;
+                break;
+        case MODE_LOGGING_TIMER_FREQUENCY:
+                cd->get_float_sample_kernel = timer_hz_kernel;
+                break;
+        case MODE_LOGGING_TIMER_PERIOD_MS:
+                cd->get_float_sample_kernel = timer_ms_kernel;
+                break;
+        case MODE_LOGGING_TIMER_PERIOD_USEC:
+                cd->get_float_sample_kernel = timer_usec_kernel;
+                break;
+        default:
+                cd->get_float_sample_kernel = invalid_kernel;
+                break;
+        }
+}
+
+static void compile_pwm_kernel(ChannelDescriptor *cd, PWMConfig *pc,
+                               const size_t index)
+{
+        init_kernel_descriptor(cd, &pc->cfg, index);
+
+        switch (pc->loggingMode) {
+        case MODE_LOGGING_PWM_PERIOD:
+                cd->get_float_sample_kernel = pwm_period_kernel;
+                break;
+        case MODE_LOGGING_PWM_DUTY:
+                cd->get_float_sample_kernel = pwm_duty_kernel;
+                break;
+        case MODE_LOGGING_PWM_VOLTS:
+                cd->get_float_sample_kernel = pwm_volts_kernel;
+                break;
+        default:
+                cd->get_float_sample_kernel = invalid_kernel;
+                break;
+        }
 }
 
 float get_imu_sample(int channelId)
@@ -231,10 +307,197 @@ float get_imu_sample(int channelId)
     return value;
 }
 
-void init_channel_sample_buffer(LoggerConfig *loggerConfig, struct sample *buff)
+static bool g_staggered_sampling;
+
+void set_staggered_sampling(const bool enable)
+{
+        g_staggered_sampling = enable;
+}
+
+bool is_staggered_sampling(void)
+{
+        return g_staggered_sampling;
+}
+
+/*
+ * Tally of the channels at a given sample rate that may be phase shifted.
+ * Used by the load balancing pass to spread those channels across the
+ * ticks of their sample period.
+ */
+struct rate_group {
+        unsigned short sample_rate;
+        unsigned short count;
+        unsigned short assigned;
+        unsigned short base;
+};
+
+static bool is_staggerable(const ChannelConfig *cfg)
+{
+        /*
+         * Always sampled channels carry the timestamp of every sample and
+         * channels sampled every tick have nowhere to move to.
+         */
+        return g_staggered_sampling && !(cfg->flags & ALWAYS_SAMPLED) &&
+                cfg->sampleRate > SAMPLE_1000Hz;
+}
+
+static struct rate_group* get_rate_group(struct rate_group *groups,
+                                         size_t *group_count,
+                                         const unsigned short sample_rate)
+{
+        for (size_t i = 0; i < *group_count; ++i)
+                if (groups[i].sample_rate == sample_rate)
+                        return groups + i;
+
+        if (SAMPLE_RATE_BUCKETS == *group_count)
+                return NULL;
+
+        struct rate_group *group = groups + (*group_count)++;
+        group->sample_rate = sample_rate;
+        group->count = 0;
+        group->assigned = 0;
+        group->base = 0;
+        return group;
+}
+
+/**
+ * Hands out the next phase offset for a channel.  Channels that share a
+ * rate are spaced evenly across the ticks of their sample period, and each
+ * rate starts where the previous one left off so that the groups don't all
+ * pile up on tick 0.
+ */
+static unsigned short get_channel_phase(struct rate_group *groups,
+                                        size_t *group_count,
+                                        const ChannelConfig *cfg)
 {
-        buff->ticks = 0;
-        ChannelSample *sample = buff->channel_samples;
+        if (!is_staggerable(cfg))
+                return 0;
+
+        struct rate_group *group =
+                get_rate_group(groups, group_count, cfg->sampleRate);
+        if (NULL == group || 0 == group->count)
+                return 0;
+
+        const unsigned int rate = group->sample_rate;
+        const unsigned int slot = group->assigned++ * rate / group->count;
+        return (group->base + slot) % rate;
+}
+
+static struct rate_bucket* get_rate_bucket(struct sample_schedule *sched,
+                                           const unsigned short sample_rate,
+                                           const unsigned short phase)
+{
+        struct rate_bucket *bucket = sched->buckets;
+        size_t i;
+
+        /*
+         * Buckets are kept sorted from the fastest rate to the slowest,
+         * and by phase within a rate.
+         */
+        for (i = 0; i < sched->bucket_count; ++i, ++bucket) {
+                if (bucket->sample_rate == sample_rate) {
+                        if (bucket->phase == phase)
+                                return bucket;
+
+                        if (phase < bucket->phase)
+                                break;
+                }
+
+                if (isHigherSampleRate(sample_rate, bucket->sample_rate))
+                        break;
+        }
+
+        /* Shift the later buckets down to make room for this one */
+        for (size_t j = sched->bucket_count; j > i; --j)
+                sched->buckets[j] = sched->buckets[j - 1];
+
+        ++sched->bucket_count;
+
+        bucket->sample_rate = sample_rate;
+        bucket->phase = phase;
+        bucket->count = 0;
+        return bucket;
+}
+
+/**
+ * Groups the channels of the table by their sample rate and phase so that
+ * populate_sample_buffer need only visit the channels that are due on a
+ * given tick.
+ */
+static void init_sample_schedule(struct channel_table *t)
+{
+        struct sample_schedule *sched = &t->schedule;
+        const ChannelDescriptor *cs = t->channels;
+        const size_t count = t->channel_count;
+        struct rate_group groups[SAMPLE_RATE_BUCKETS];
+        size_t group_count = 0;
+
+        sched->last_tick = 0;
+        sched->next_tick = 0;
+        sched->bucket_count = 0;
+        sched->always_count = 0;
+
+        /* Load balancing pass.  Count up what can be staggered per rate */
+        for (size_t i = 0; i < count; ++i, ++cs) {
+                if (!is_staggerable(cs->cfg))
+                        continue;
+
+                struct rate_group *group = get_rate_group(
+                        groups, &group_count, cs->cfg->sampleRate);
+                if (group)
+                        ++group->count;
+        }
+
+        unsigned int cursor = 0;
+        for (size_t i = 0; i < group_count; ++i) {
+                groups[i].base = cursor % groups[i].sample_rate;
+                cursor += groups[i].count;
+        }
+
+        cs = t->channels;
+        for (size_t i = 0; i < count; ++i, ++cs) {
+                const unsigned short phase =
+                        get_channel_phase(groups, &group_count, cs->cfg);
+                struct rate_bucket *bucket =
+                        get_rate_bucket(sched, cs->cfg->sampleRate, phase);
+
+                ++bucket->count;
+                if (cs->cfg->flags & ALWAYS_SAMPLED)
+                        ++sched->always_count;
+        }
+
+        /* Lay out the order list, one contiguous run per bucket */
+        unsigned short offset = 0;
+        for (size_t i = 0; i < sched->bucket_count; ++i) {
+                sched->buckets[i].first = offset;
+                offset += sched->buckets[i].count;
+                sched->buckets[i].count = 0;
+        }
+
+        sched->always_first = offset;
+        sched->always_count = 0;
+
+        for (size_t i = 0; i < group_count; ++i)
+                groups[i].assigned = 0;
+
+        cs = t->channels;
+        for (size_t i = 0; i < count; ++i, ++cs) {
+                const unsigned short phase =
+                        get_channel_phase(groups, &group_count, cs->cfg);
+                struct rate_bucket *bucket =
+                        get_rate_bucket(sched, cs->cfg->sampleRate, phase);
+
+                sched->order[bucket->first + bucket->count++] = i;
+                if (cs->cfg->flags & ALWAYS_SAMPLED)
+                        sched->order[sched->always_first +
+                                     sched->always_count++] = i;
+        }
+}
+
+void init_channel_descriptors(LoggerConfig *loggerConfig,
+                              struct channel_table *t)
+{
+        ChannelDescriptor *sample = t->channels;
         ChannelConfig *chanCfg;
 
     /*
@@ -257,7 +520,8 @@ void init_channel_sample_buffer(LoggerConfig *loggerConfig, struct sample *buff)
     for (int i=0; i < CONFIG_ADC_CHANNELS; i++) {
         ADCConfig *config = &(loggerConfig->ADCConfigs[i]);
         chanCfg = &(config->cfg);
-        sample = processChannelSampleWithFloatGetter(sample, chanCfg, i, get_analog_sample);
+        if (chanCfg->sampleRate != SAMPLE_DISABLED)
+            compile_analog_kernel(sample++, config, i);
     }
 
     for (int i = 0; i < CONFIG_IMU_CHANNELS; i++) {
@@ -269,7 +533,8 @@ void init_channel_sample_buffer(LoggerConfig *loggerConfig, struct sample *buff)
     for (int i=0; i < CONFIG_TIMER_CHANNELS; i++) {
         TimerConfig *config = &(loggerConfig->TimerConfigs[i]);
         chanCfg = &(config->cfg);
-        sample = processChannelSampleWithFloatGetter(sample, chanCfg, i, get_timer_sample);
+        if (chanCfg->sampleRate != SAMPLE_DISABLED)
+            compile_timer_kernel(sample++, config, i);
     }
 
     for (int i=0; i < CONFIG_GPIO_CHANNELS; i++) {
@@ -281,7 +546,8 @@ void init_channel_sample_buffer(LoggerConfig *loggerConfig, struct sample *buff)
     for (int i=0; i < CONFIG_PWM_CHANNELS; i++) {
         PWMConfig *config = &(loggerConfig->PWMConfigs[i]);
         chanCfg = &(config->cfg);
-        sample = processChannelSampleWithFloatGetter(sample, chanCfg, i, get_pwm_sample);
+        if (chanCfg->sampleRate != SAMPLE_DISABLED)
+            compile_pwm_kernel(sample++, config, i);
     }
 
     OBD2Config *obd2Config = &(loggerConfig->OBD2Configs);
@@ -336,77 +602,130 @@ void init_channel_sample_buffer(LoggerConfig *loggerConfig, struct sample *buff)
     chanCfg = &(trackConfig->current_lap_cfg);
     sample = processChannelSampleWithIntGetterNoarg(sample, chanCfg,
              lapstats_current_lap);
+
+    init_sample_schedule(t);
 }
 
-static void populate_channel_sample(ChannelSample *sample)
+static void populate_channel_sample(const ChannelDescriptor *cd,
+                                    ChannelValue *value)
 {
-    size_t channelIndex = sample->channelIndex;
+    size_t channelIndex = cd->channelIndex;
 
-    switch(sample->sampleData) {
+    switch(cd->sampleData) {
     case SampleData_Int_Noarg:
-        sample->valueInt = sample->get_int_sample_noarg();
+        value->valueInt = cd->get_int_sample_noarg();
         break;
     case SampleData_Int:
-        sample->valueInt = sample->get_int_sample(channelIndex);
+        value->valueInt = cd->get_int_sample(channelIndex);
         break;
     case SampleData_LongLong_Noarg:
-        sample->valueLongLong = sample->get_longlong_sample_noarg();
+        value->valueLongLong = cd->get_longlong_sample_noarg();
         break;
     case SampleData_LongLong:
-        sample->valueLongLong = sample->get_longlong_sample(channelIndex);
+        value->valueLongLong = cd->get_longlong_sample(channelIndex);
         break;
     case SampleData_Float_Noarg:
-        sample->valueFloat = sample->get_float_sample_noarg();
+        value->valueFloat = cd->get_float_sample_noarg();
         break;
     case SampleData_Float:
-        sample->valueFloat = sample->get_float_sample(channelIndex);
+        value->valueFloat = cd->get_float_sample(channelIndex);
         break;
     case SampleData_Double_Noarg:
-        sample->valueDouble = sample->get_double_sample_noarg();
+        value->valueDouble = cd->get_double_sample_noarg();
         break;
     case SampleData_Double:
-        sample->valueDouble = sample->get_double_sample(channelIndex);
+        value->valueDouble = cd->get_double_sample(channelIndex);
+        break;
+    case SampleData_Float_Kernel:
+        value->valueFloat = cd->get_float_sample_kernel(cd);
         break;
     default:
         pr_warning("populate channel sample: unknown sample type");
-        sample->valueLongLong = -1;
+        value->valueLongLong = -1;
         break;
     }
 }
 
-int populate_sample_buffer(struct sample *s, size_t logTick)
+static void populate_channels(struct sample *s, const size_t first,
+                              const size_t count)
 {
-    unsigned short highestRate = SAMPLE_DISABLED;
-    ChannelSample *samples = s->channel_samples;
-    const size_t count = s->channel_count;
+        const unsigned short *idx = s->table->schedule.order + first;
+        const unsigned short * const end = idx + count;
 
-    for (size_t i = 0; i < count; i++, samples++) {
-        const unsigned short sampleRate = samples->cfg->sampleRate;
+        for (; idx < end; ++idx) {
+                /* Always sampled channels may have been filled already */
+                if (is_sample_populated(s, *idx))
+                        continue;
 
-        if (logTick % sampleRate != 0) {
-            samples->populated = false;
-            continue;
+                populate_channel_sample(s->table->channels + *idx,
+                                        s->values + *idx);
+                set_sample_populated(s, *idx);
         }
+}
 
-        highestRate = getHigherSampleRate(sampleRate, highestRate);
-        samples->populated = true;
-        populate_channel_sample(samples);
-    }
+int populate_sample_buffer(struct sample *s, size_t logTick)
+{
+        struct sample_schedule *sched = &s->table->schedule;
+
+        /*
+         * Nothing can be due between the last tick we evaluated and the
+         * next due tick, so bail out early.  Ticks that go backwards (like
+         * when the buffer is reused from tick 0) force a full evaluation.
+         */
+        if (logTick > sched->last_tick && logTick < sched->next_tick)
+                return SAMPLE_DISABLED;
+
+        unsigned short highestRate = SAMPLE_DISABLED;
+        size_t next_tick = SIZE_MAX;
+        const struct rate_bucket *bucket = sched->buckets;
+        const struct rate_bucket * const end = bucket + sched->bucket_count;
+
+        for (; bucket < end; ++bucket) {
+                const size_t rate = bucket->sample_rate;
+                const size_t remainder = logTick % rate;
+                const size_t delta = (bucket->phase + rate - remainder) % rate;
+
+                if (0 != delta) {
+                        if (logTick + delta < next_tick)
+                                next_tick = logTick + delta;
+                        continue;
+                }
+
+                if (logTick + rate < next_tick)
+                        next_tick = logTick + rate;
+
+                /* Buckets are sorted, so the first one due is the fastest */
+                if (SAMPLE_DISABLED == highestRate) {
+                        highestRate = bucket->sample_rate;
+                        clear_sample_populated(s);
+                }
+
+                populate_channels(s, bucket->first, bucket->count);
+        }
 
-    // Check if we got a sample.  If not, then bypass the rest as we are done.
-    if (highestRate == SAMPLE_DISABLED)
-        return SAMPLE_DISABLED;
+        sched->last_tick = logTick;
+        sched->next_tick = next_tick;
 
-    // If there was a sample taken, now we fill in the always sampled fields.
-    samples = s->channel_samples;
-    for (size_t i = 0; i < count; i++, samples++) {
-        const int isAlwaysSampled = samples->cfg->flags & ALWAYS_SAMPLED;
-        if (!isAlwaysSampled)
-            continue;
+        /* Check if we got a sample.  If not, then bypass the rest as we are done. */
+        if (highestRate == SAMPLE_DISABLED)
+                return SAMPLE_DISABLED;
 
-        samples->populated = true;
-        populate_channel_sample(samples);
-    }
+        /* If there was a sample taken, now we fill in the always sampled fields. */
+        populate_channels(s, sched->always_first, sched->always_count);
+
+        return highestRate;
+}
 
-    return highestRate;
+int get_sample_rate_due(const struct channel_table *t, size_t logTick)
+{
+        const struct sample_schedule *sched = &t->schedule;
+        const struct rate_bucket *bucket = sched->buckets;
+        const struct rate_bucket * const end = bucket + sched->bucket_count;
+
+        /* Buckets are sorted, so the first one due is the fastest */
+        for (; bucket < end; ++bucket)
+                if (logTick % bucket->sample_rate == bucket->phase)
+                        return bucket->sample_rate;
+
+        return SAMPLE_DISABLED;
 }
@@ -23,6 +23,7 @@
 #include "FreeRTOS.h"
 #include "LED.h"
 #include "capabilities.h"
+#include "checksum.h"
 #include "connectivityTask.h"
 #include "fileWriter.h"
 #include "gps.h"
@@ -34,12 +35,16 @@
 #include "loggerHardware.h"
 #include "loggerSampleData.h"
 #include "loggerTaskEx.h"
+#include "loggerTiming.h"
 #include "mod_string.h"
+#include "pipelineStats.h"
+#include "preroll.h"
 #include "printk.h"
 #include "sampleRecord.h"
 #include "semphr.h"
 #include "task.h"
 #include "taskUtil.h"
+#include "telemetryRate.h"
 #include "watchdog.h"
 
 #define LOGGER_TASK_PRIORITY	( tskIDLE_PRIORITY + 4 )
@@ -54,8 +59,10 @@ int g_telemetryBackgroundStreaming;
 
 xSemaphoreHandle onTick;
 
-/* This should be 0'd out accroding to C standards */
+/* These should be 0'd out accroding to C standards */
+static struct channel_table g_channel_table;
 static struct sample g_sample_buffer[LOGGER_MESSAGE_BUFFER_SIZE];
+static uint32_t g_lap_config_hash;
 
 static LoggerMessage getLogStartMessage()
 {
@@ -72,6 +79,7 @@ static LoggerMessage getLogStopMessage()
  */
 void vApplicationTickHook(void)
 {
+    logger_timing_tick();
     xSemaphoreGiveFromISR(onTick, pdFALSE);
 }
 
@@ -110,15 +118,33 @@ void startLoggerTaskEx(int priority)
                  LOGGER_STACK_SIZE, NULL, priority, NULL );
 }
 
-static int init_sample_ring_buffer(LoggerConfig *loggerConfig)
+/**
+ * Brings the channel table and sample buffers in line with the config.
+ * Allocations are re-used when they are big enough, and the buffers are
+ * left alone entirely if the channel layout didn't change.
+ * @param buffer_size The number of buffers currently in use.
+ * @return The number of buffers available.
+ */
+static int init_sample_ring_buffer(LoggerConfig *loggerConfig,
+                                   const int buffer_size)
 {
-        const size_t channel_count = get_enabled_channel_count(loggerConfig);
         struct sample *s = g_sample_buffer;
         const struct sample * const end = s + LOGGER_MESSAGE_BUFFER_SIZE;
+        const uint32_t layout = g_channel_table.layout;
         int i;
 
+        if (0 == init_channel_table(&g_channel_table, loggerConfig)) {
+                pr_error("Failed to allocate memory for channel table\r\n");
+                return 0;
+        }
+
+        if (buffer_size && layout == g_channel_table.layout) {
+                pr_debug("Channel layout unchanged\r\n");
+                return buffer_size;
+        }
+
         for (i = 0; s < end; ++s, ++i) {
-                const size_t bytes = init_sample_buffer(s, channel_count);
+                const size_t bytes = init_sample_buffer(s, &g_channel_table);
                 if (0 == bytes) {
                         /* If here, then can't alloc memory for buffers */
                         pr_error("Failed to allocate memory for sample buffers\r\n");
@@ -130,6 +156,74 @@ static int init_sample_ring_buffer(LoggerConfig *loggerConfig)
         return i;
 }
 
+/**
+ * @return true if the lap or track config changed since the last call.
+ */
+static bool lap_config_changed(const LoggerConfig *loggerConfig)
+{
+        uint32_t hash = checksum_fnv1a(CHECKSUM_FNV1A_INIT,
+                                       &loggerConfig->LapConfigs,
+                                       sizeof(LapConfig));
+        hash = checksum_fnv1a(hash, &loggerConfig->TrackConfigs,
+                              sizeof(TrackConfig));
+
+        const bool changed = hash != g_lap_config_hash;
+        g_lap_config_hash = hash;
+        return changed;
+}
+
+/**
+ * @return true if a consumer still holds any of the sample buffers.
+ */
+static bool is_sample_ring_buffer_busy(void)
+{
+        for (size_t i = 0; i < LOGGER_MESSAGE_BUFFER_SIZE; ++i)
+                if (is_sample_in_use(&g_sample_buffer[i]))
+                        return true;
+
+        return false;
+}
+
+/**
+ * Waits for the consumers to release the sample buffers before they are
+ * re-allocated.  Samples still queued to telemetry would be re-keyed on
+ * the new layout anyway, so they are dropped as soon as the wait starts
+ * and a stalled link can't leave a gap in the log.  Only the file writer
+ * and samples a link is part way through sending are waited on.
+ * @param waiting Whether a wait is already under way.
+ * @return true once the buffers are free.
+ */
+static bool wait_sample_ring_buffer(bool *waiting)
+{
+        if (!*waiting) {
+                telemetry_flush_queues();
+                *waiting = true;
+        }
+
+        if (is_sample_ring_buffer_busy())
+                return false;
+
+        *waiting = false;
+        return true;
+}
+
+/**
+ * Finds the next sample buffer that no consumer holds, starting at the
+ * given index.
+ * @return The index of the free buffer, or buffer_size if all are in use.
+ */
+static size_t get_free_sample_index(const size_t index,
+                                    const size_t buffer_size)
+{
+        for (size_t i = 0; i < buffer_size; ++i) {
+                const size_t idx = (index + i) % buffer_size;
+                if (!is_sample_in_use(&g_sample_buffer[idx]))
+                        return idx;
+        }
+
+        return buffer_size;
+}
+
 static int calcTelemetrySampleRate(LoggerConfig *config, int desiredSampleRate)
 {
     int maxRate = getConnectivitySampleRateLimit();
@@ -153,6 +247,33 @@ void updateSampleRates(LoggerConfig *loggerConfig, int *loggingSampleRate,
     pr_info("\r\n");
 }
 
+static bool should_log_sample(const bool is_logging, const int sampledRate,
+                              const int loggingSampleRate)
+{
+        return is_logging && sampledRate >= loggingSampleRate;
+}
+
+/**
+ * Called when a sample is due but every buffer is still held by a
+ * consumer.  The sample is lost, so count it against each consumer that
+ * would have received it and flag the backpressure.
+ */
+static void handle_sample_overrun(const struct channel_table *t,
+                                  const size_t ticks, const bool is_logging,
+                                  const int loggingSampleRate)
+{
+        const int sampledRate = get_sample_rate_due(t, ticks);
+        if (SAMPLE_DISABLED == sampledRate)
+                return;
+
+        if (should_log_sample(is_logging, sampledRate, loggingSampleRate)) {
+                logfile_sample_dropped();
+                logging_set_status(LOGGING_STATUS_ERROR_WRITING);
+        }
+
+        telemetry_sample_dropped(sampledRate, ticks);
+}
+
 void loggerTaskEx(void *params)
 {
         LoggerConfig *loggerConfig = getWorkingLoggerConfig();
@@ -162,6 +283,7 @@ void loggerTaskEx(void *params)
         int loggingSampleRate = SAMPLE_DISABLED;
         int sampleRateTimebase = SAMPLE_DISABLED;
         int telemetrySampleRate = SAMPLE_DISABLED;
+        bool reconfigWait = false;
 
         g_loggingShouldRun = 0;
         vSemaphoreCreateBinary(onTick);
@@ -173,8 +295,22 @@ void loggerTaskEx(void *params)
                 xSemaphoreTake(onTick, portMAX_DELAY);
                 ++currentTicks;
 
+                /*
+                 * Consumers may still be reading the old buffers or the
+                 * table itself, so wait until they have all been released
+                 * before we re-allocate them.
+                 */
+                if (g_configChanged &&
+                    (!wait_sample_ring_buffer(&reconfigWait) ||
+                     !begin_channel_table_rebuild(&g_channel_table))) {
+                        watchdog_reset();
+                        continue;
+                }
+
                 if (g_configChanged) {
-                        buffer_size = init_sample_ring_buffer(loggerConfig);
+                        buffer_size = init_sample_ring_buffer(loggerConfig,
+                                                              buffer_size);
+                        end_channel_table_rebuild(&g_channel_table);
                         if (!buffer_size) {
                                 pr_error("Failed to allocate any buffers!\r\n");
                                 LED_enable(3);
@@ -192,9 +328,20 @@ void loggerTaskEx(void *params)
                         updateSampleRates(loggerConfig, &loggingSampleRate,
                                           &telemetrySampleRate,
                                           &sampleRateTimebase);
-                        resetLapCount();
-                        lapstats_reset_distance();
-                        currentTicks = 0;
+                        telemetry_rate_init_all(telemetrySampleRate,
+                                                MIN_TELEMETRY_SAMPLE_RATE);
+                        pipeline_stats_reset();
+
+                        /*
+                         * Only throw away lap state when something that
+                         * affects it changed.  Ticks keep counting so the
+                         * log has no gap.
+                         */
+                        if (lap_config_changed(loggerConfig)) {
+                                resetLapCount();
+                                lapstats_reset_distance();
+                        }
+
                         g_configChanged = 0;
                 }
 
@@ -220,12 +367,22 @@ void loggerTaskEx(void *params)
                         logging_set_status(LOGGING_STATUS_IDLE);
                 }
 
-                /* Prepare a Sample */
+                /* Prepare a Sample in a buffer no consumer is holding */
+                bufferIndex = get_free_sample_index(bufferIndex, buffer_size);
+                if (bufferIndex == buffer_size) {
+                        bufferIndex = 0;
+                        handle_sample_overrun(&g_channel_table, currentTicks,
+                                              is_logging, loggingSampleRate);
+                        continue;
+                }
+
                 struct sample *sample = &g_sample_buffer[bufferIndex];
 
                 /* Check if we need to actually populate the buffer. */
+                logger_timing_sample_start();
                 const int sampledRate = populate_sample_buffer(sample,
                                                                currentTicks);
+                logger_timing_sample_end(SAMPLE_DISABLED != sampledRate);
                 if (sampledRate == SAMPLE_DISABLED)
                         continue;
 
@@ -235,21 +392,25 @@ void loggerTaskEx(void *params)
 
                 /*
                  * We only log to file if the user has manually pushed the
-                 * logging button.
+                 * logging button.  Until then the file writer keeps the
+                 * samples in its pre-roll buffer, if one is enabled.
                  */
-                if (is_logging && sampledRate >= loggingSampleRate) {
+                if (should_log_sample(is_logging || is_preroll_enabled(),
+                                      sampledRate, loggingSampleRate)) {
                         /* XXX Move this to file writer? */
                         const portBASE_TYPE res = queue_logfile_record(&msg);
                         const logging_status_t ls = pdTRUE == res ?
                                 LOGGING_STATUS_WRITING :
                                 LOGGING_STATUS_ERROR_WRITING;
-                        logging_set_status(ls);
+                        if (is_logging)
+                                logging_set_status(ls);
                 }
 
-                /* send the sample on to the telemetry task(s) */
-                if (sampledRate >= telemetrySampleRate ||
-                    currentTicks % telemetrySampleRate == 0)
-                        queueTelemetryRecord(&msg);
+                /*
+                 * send the sample on to the telemetry task(s), each at
+                 * the rate its link keeps up with
+                 */
+                queue_telemetry_sample(&msg, sampledRate, currentTicks);
 
                 ++bufferIndex;
                 bufferIndex %= buffer_size;
@@ -0,0 +1,105 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "cpu.h"
+#include "loggerTiming.h"
+#include "mod_string.h"
+
+#include <stddef.h>
+
+static volatile uint32_t g_tick_cycles;
+static uint32_t g_sample_start_cycles;
+static struct timing_histogram g_histograms[TIMING_HISTOGRAMS];
+
+static const char* const g_histogram_names[TIMING_HISTOGRAMS] = {
+        "tickToSample",
+        "sampleDuration",
+};
+
+uint32_t timing_cycles_to_us(const uint32_t cycles)
+{
+        const uint32_t per_us = cpu_get_cycles_per_us();
+        return per_us ? cycles / per_us : cycles;
+}
+
+void timing_histogram_add(struct timing_histogram *h, const uint32_t us)
+{
+        unsigned int bucket = 0;
+        uint32_t v = us;
+
+        while (v && bucket < TIMING_HISTOGRAM_BUCKETS - 1) {
+                v >>= 1;
+                ++bucket;
+        }
+
+        ++h->buckets[bucket];
+        ++h->count;
+        h->total_us += us;
+        if (us > h->max_us)
+                h->max_us = us;
+}
+
+uint32_t timing_histogram_bucket_limit(const unsigned int bucket)
+{
+        return bucket < TIMING_HISTOGRAM_BUCKETS - 1 ? 1u << bucket : 0;
+}
+
+void logger_timing_tick(void)
+{
+        g_tick_cycles = cpu_get_cycle_count();
+}
+
+void logger_timing_sample_start(void)
+{
+        g_sample_start_cycles = cpu_get_cycle_count();
+
+        /* Unsigned math handles the counter wrapping */
+        const uint32_t late = g_sample_start_cycles - g_tick_cycles;
+        timing_histogram_add(g_histograms + TIMING_TICK_TO_SAMPLE,
+                             timing_cycles_to_us(late));
+}
+
+void logger_timing_sample_end(const bool sampled)
+{
+        if (!sampled)
+                return;
+
+        const uint32_t cycles = cpu_get_cycle_count() - g_sample_start_cycles;
+        timing_histogram_add(g_histograms + TIMING_SAMPLE_DURATION,
+                             timing_cycles_to_us(cycles));
+}
+
+void logger_timing_reset(void)
+{
+        memset(g_histograms, 0, sizeof(g_histograms));
+}
+
+const struct timing_histogram* get_logger_timing_histogram(
+        const enum timing_histogram_id id)
+{
+        return id < TIMING_HISTOGRAMS ? g_histograms + id : NULL;
+}
+
+const char* get_logger_timing_histogram_name(const enum timing_histogram_id id)
+{
+        return id < TIMING_HISTOGRAMS ? g_histogram_names[id] : "";
+}
@@ -0,0 +1,106 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "mod_string.h"
+#include "pipelineStats.h"
+#include "taskUtil.h"
+
+#include <stdbool.h>
+
+static struct pipeline_stats g_stats[PIPELINE_CONSUMERS];
+
+static const char* const g_consumer_names[PIPELINE_CONSUMERS] = {
+        "file",
+        "telem0",
+#if CONNECTIVITY_CHANNELS > 1
+        "telem1",
+#endif
+};
+
+static struct pipeline_stats* get_stats(const size_t consumer)
+{
+        return consumer < PIPELINE_CONSUMERS ? g_stats + consumer : NULL;
+}
+
+void pipeline_stats_reset(void)
+{
+        memset(g_stats, 0, sizeof(g_stats));
+}
+
+void pipeline_stats_enqueue(const size_t consumer, const bool success,
+                            const size_t depth)
+{
+        struct pipeline_stats *ps = get_stats(consumer);
+        if (!ps)
+                return;
+
+        if (!success) {
+                ++ps->queue_failures;
+                return;
+        }
+
+        ++ps->queued;
+        ps->depth_total += depth;
+        if (depth > ps->depth_max)
+                ps->depth_max = depth;
+}
+
+void pipeline_stats_overrun(const size_t consumer)
+{
+        struct pipeline_stats *ps = get_stats(consumer);
+        if (ps)
+                ++ps->overruns;
+}
+
+void pipeline_stats_latency(const size_t consumer, const size_t sample_ticks)
+{
+        struct pipeline_stats *ps = get_stats(consumer);
+        if (!ps)
+                return;
+
+        const uint32_t latency = ticksToMs(getCurrentTicks() - sample_ticks);
+
+        ++ps->latency_count;
+        ps->latency_total += latency;
+        if (latency > ps->latency_max)
+                ps->latency_max = latency;
+}
+
+const struct pipeline_stats* get_pipeline_stats(const size_t consumer)
+{
+        return get_stats(consumer);
+}
+
+const char* get_pipeline_consumer_name(const size_t consumer)
+{
+        return consumer < PIPELINE_CONSUMERS ? g_consumer_names[consumer] : "";
+}
+
+uint32_t get_pipeline_depth_avg(const struct pipeline_stats *ps)
+{
+        return ps->queued ? ps->depth_total / ps->queued : 0;
+}
+
+uint32_t get_pipeline_latency_avg(const struct pipeline_stats *ps)
+{
+        return ps->latency_count ? ps->latency_total / ps->latency_count : 0;
+}
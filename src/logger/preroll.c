@@ -0,0 +1,197 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include "capabilities.h"
+#include "preroll.h"
+#include "ring_buffer.h"
+#include "taskUtil.h"
+
+#include <stdint.h>
+
+/*
+ * Every stored sample starts with this header.  len covers the header,
+ * the populated bitmap and the packed values that follow it.
+ */
+struct preroll_record {
+        uint16_t len;
+        uint32_t ticks;
+};
+
+static struct {
+        struct ring_buff rb;
+        struct channel_table *table;
+        uint32_t layout;
+        size_t duration_ms;
+} g_preroll;
+
+static size_t get_value_size(const ChannelDescriptor *cd)
+{
+        switch (cd->sampleData) {
+        case SampleData_LongLong_Noarg:
+        case SampleData_LongLong:
+                return sizeof(long long);
+        case SampleData_Double_Noarg:
+        case SampleData_Double:
+                return sizeof(double);
+        case SampleData_Float_Noarg:
+        case SampleData_Float:
+        case SampleData_Float_Kernel:
+                return sizeof(float);
+        default:
+                return sizeof(int);
+        }
+}
+
+static size_t get_record_size(const struct sample *s)
+{
+        const ChannelDescriptor *cd = s->table->channels;
+        size_t size = sizeof(struct preroll_record) +
+                sizeof(uint32_t[SAMPLE_BITMAP_WORDS(s->channel_count)]);
+
+        for (size_t i = 0; i < s->channel_count; ++i, ++cd)
+                if (is_sample_populated(s, i))
+                        size += get_value_size(cd);
+
+        return size;
+}
+
+static bool peek_record(struct preroll_record *rec)
+{
+        return sizeof(*rec) == peek_data(&g_preroll.rb, rec, sizeof(*rec));
+}
+
+static void drop_record(void)
+{
+        struct preroll_record rec;
+        if (peek_record(&rec))
+                dump_data(&g_preroll.rb, rec.len);
+}
+
+static bool update_buffer(void)
+{
+        const bool want = 0 != g_preroll.duration_ms;
+        const bool have = NULL != g_preroll.rb.buf;
+
+        if (want && !have)
+                create_ring_buffer(&g_preroll.rb, PREROLL_BUFFER_SIZE);
+        else if (!want && have)
+                free_ring_buffer(&g_preroll.rb);
+
+        return NULL != g_preroll.rb.buf;
+}
+
+void preroll_set_duration(const size_t ms)
+{
+        g_preroll.duration_ms = ms < PREROLL_MAX_MS ? ms : PREROLL_MAX_MS;
+}
+
+size_t preroll_get_duration(void)
+{
+        return g_preroll.duration_ms;
+}
+
+bool is_preroll_enabled(void)
+{
+        return 0 != g_preroll.duration_ms;
+}
+
+bool preroll_add(const struct sample *s)
+{
+        if (!update_buffer())
+                return false;
+
+        /* Samples of different layouts can't be mixed */
+        if (s->table != g_preroll.table ||
+            s->table->layout != g_preroll.layout) {
+                preroll_clear();
+                g_preroll.table = s->table;
+                g_preroll.layout = s->table->layout;
+        }
+
+        const size_t len = get_record_size(s);
+        if (len >= g_preroll.rb.size)
+                return false;
+
+        /* Age out the history we no longer want, then make room */
+        const size_t max_age = msToTicks(g_preroll.duration_ms);
+        struct preroll_record rec;
+        while (peek_record(&rec) && s->ticks - rec.ticks > max_age)
+                dump_data(&g_preroll.rb, rec.len);
+
+        while (!have_space(&g_preroll.rb, len))
+                drop_record();
+
+        rec.len = len;
+        rec.ticks = s->ticks;
+        put_data(&g_preroll.rb, &rec, sizeof(rec));
+        put_data(&g_preroll.rb, s->populated,
+                 sizeof(uint32_t[SAMPLE_BITMAP_WORDS(s->channel_count)]));
+
+        const ChannelDescriptor *cd = s->table->channels;
+        for (size_t i = 0; i < s->channel_count; ++i, ++cd)
+                if (is_sample_populated(s, i))
+                        put_data(&g_preroll.rb, s->values + i,
+                                 get_value_size(cd));
+
+        return true;
+}
+
+struct channel_table* preroll_get_table(void)
+{
+        if (NULL == g_preroll.rb.buf || !has_data(&g_preroll.rb))
+                return NULL;
+
+        return g_preroll.table;
+}
+
+bool preroll_get(struct sample *s)
+{
+        if (NULL == preroll_get_table())
+                return false;
+
+        if (s->table != g_preroll.table ||
+            s->table->layout != g_preroll.layout) {
+                preroll_clear();
+                return false;
+        }
+
+        struct preroll_record rec;
+        get_data(&g_preroll.rb, &rec, sizeof(rec));
+        get_data(&g_preroll.rb, s->populated,
+                 sizeof(uint32_t[SAMPLE_BITMAP_WORDS(s->channel_count)]));
+        s->ticks = rec.ticks;
+
+        const ChannelDescriptor *cd = s->table->channels;
+        for (size_t i = 0; i < s->channel_count; ++i, ++cd)
+                if (is_sample_populated(s, i))
+                        get_data(&g_preroll.rb, s->values + i,
+                                 get_value_size(cd));
+
+        return true;
+}
+
+void preroll_clear(void)
+{
+        if (g_preroll.rb.buf)
+                clear_data(&g_preroll.rb);
+}
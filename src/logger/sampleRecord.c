@@ -22,66 +22,260 @@
 
 #include "FreeRTOS.h"
 #include "capabilities.h"
+#include "checksum.h"
 #include "loggerConfig.h"
 #include "loggerSampleData.h"
 #include "mem_mang.h"
+#include "mod_string.h"
 #include "sampleRecord.h"
+#include "task.h"
 #include "taskUtil.h"
 
 #include <stdbool.h>
 
-size_t init_sample_buffer(struct sample *s, const size_t count)
+static size_t get_channel_table_size(const size_t capacity)
 {
-        if (s->channel_samples)
-                free_sample_buffer(s);
+        /*
+         * Every channel can end up in its own schedule bucket, and the
+         * schedule order list holds every channel once for its bucket and
+         * once more if it is always sampled.  Keep it all in the same
+         * allocation as the descriptors to avoid extra heap churn.
+         */
+        return sizeof(ChannelDescriptor[capacity]) +
+                sizeof(struct rate_bucket[capacity]) +
+                sizeof(unsigned short[capacity * 2]);
+}
 
-        const size_t size = sizeof(ChannelSample[count]);
-        s->channel_samples = (ChannelSample *) portMalloc(size);
+static uint32_t get_channel_table_layout(const struct channel_table *t)
+{
+        uint32_t hash = CHECKSUM_FNV1A_INIT;
+        const ChannelDescriptor *cd = t->channels;
 
-        if (NULL == s->channel_samples)
-                return 0;
+        for (size_t i = 0; i < t->channel_count; ++i, ++cd) {
+                hash = checksum_fnv1a(hash, &cd->cfg, sizeof(cd->cfg));
+                hash = checksum_fnv1a(hash, &cd->channelIndex,
+                                      sizeof(cd->channelIndex));
+                hash = checksum_fnv1a(hash, &cd->sampleData,
+                                      sizeof(cd->sampleData));
+                hash = checksum_fnv1a(hash, &cd->cfg->sampleRate,
+                                      sizeof(cd->cfg->sampleRate));
+                hash = checksum_fnv1a(hash, &cd->cfg->flags,
+                                      sizeof(cd->cfg->flags));
+        }
+
+        /* Staggering moves channels around without changing any of them */
+        const bool staggered = is_staggered_sampling();
+        return checksum_fnv1a(hash, &staggered, sizeof(staggered));
+}
+
+size_t init_channel_table(struct channel_table *t, LoggerConfig *lc)
+{
+        const size_t count = get_enabled_channel_count(lc);
+
+        if (count > t->capacity || NULL == t->channels) {
+                if (t->channels)
+                        free_channel_table(t);
+
+                const size_t capacity = (count + CHANNEL_TABLE_CHUNK - 1) /
+                        CHANNEL_TABLE_CHUNK * CHANNEL_TABLE_CHUNK;
+                t->channels = (ChannelDescriptor *)
+                        portMalloc(get_channel_table_size(capacity));
+                if (NULL == t->channels)
+                        return 0;
+
+                t->capacity = capacity;
+        }
+
+        t->schedule.buckets = (struct rate_bucket *) (t->channels + t->capacity);
+        t->schedule.order = (unsigned short *)
+                (t->schedule.buckets + t->capacity);
+        t->channel_count = count;
+        init_channel_descriptors(lc, t);
+        t->layout = get_channel_table_layout(t);
+
+        return get_channel_table_size(t->capacity);
+}
+
+void free_channel_table(struct channel_table *t)
+{
+        portFree(t->channels);
+        t->channels = NULL;
+        t->channel_count = 0;
+        t->capacity = 0;
+        t->layout = 0;
+        t->schedule.buckets = NULL;
+        t->schedule.order = NULL;
+}
+
+bool acquire_channel_table(struct channel_table *t)
+{
+        taskENTER_CRITICAL();
+        const bool ok = !t->rebuilding;
+        if (ok)
+                ++t->readers;
+        taskEXIT_CRITICAL();
+
+        return ok;
+}
+
+void release_channel_table(struct channel_table *t)
+{
+        taskENTER_CRITICAL();
+        if (t->readers)
+                --t->readers;
+        taskEXIT_CRITICAL();
+}
+
+bool begin_channel_table_rebuild(struct channel_table *t)
+{
+        taskENTER_CRITICAL();
+        const bool ok = 0 == t->readers;
+        if (ok)
+                t->rebuilding = true;
+        taskEXIT_CRITICAL();
+
+        return ok;
+}
+
+void end_channel_table_rebuild(struct channel_table *t)
+{
+        t->rebuilding = false;
+}
+
+static size_t get_sample_buffer_size(const size_t capacity)
+{
+        return sizeof(ChannelValue[capacity]) +
+                sizeof(uint32_t[SAMPLE_BITMAP_WORDS(capacity)]);
+}
+
+size_t init_sample_buffer(struct sample *s, struct channel_table *t)
+{
+        /* Size to the table capacity so the sample grows with it */
+        const size_t count = t->channel_count;
+        const size_t capacity = count > t->capacity ? count : t->capacity;
+
+        if (capacity > s->capacity || NULL == s->values) {
+                if (s->values)
+                        free_sample_buffer(s);
+
+                s->values = (ChannelValue *)
+                        portMalloc(get_sample_buffer_size(capacity));
+                if (NULL == s->values)
+                        return 0;
 
+                s->capacity = capacity;
+        }
+
+        s->populated = (uint32_t *) (s->values + s->capacity);
         s->ticks = 0;
         s->channel_count = count;
-        init_channel_sample_buffer(getWorkingLoggerConfig(), s);
+        s->table = t;
+        clear_sample_populated(s);
 
-        return size;
+        return get_sample_buffer_size(s->capacity);
 }
 
 void free_sample_buffer(struct sample *s)
 {
-        portFree(s->channel_samples);
-        s->channel_samples = NULL;
+        portFree(s->values);
+        s->values = NULL;
+        s->populated = NULL;
+        s->capacity = 0;
+}
+
+bool is_sample_populated(const struct sample *s, const size_t channel)
+{
+        return s->populated[channel / 32] & (1u << (channel % 32));
+}
+
+void set_sample_populated(struct sample *s, const size_t channel)
+{
+        s->populated[channel / 32] |= 1u << (channel % 32);
+}
+
+void clear_sample_populated(struct sample *s)
+{
+        memset(s->populated, 0,
+               sizeof(uint32_t[SAMPLE_BITMAP_WORDS(s->channel_count)]));
+}
+
+bool is_sample_in_use(const struct sample *s)
+{
+        return 0 != s->refs;
+}
+
+static void acquire_sample(struct sample *s)
+{
+        taskENTER_CRITICAL();
+        ++s->refs;
+        taskEXIT_CRITICAL();
 }
 
-bool is_sample_data_valid(const LoggerMessage *lm)
+static void release_sample(struct sample *s)
 {
-        /* Only validate messages with non-null samples */
-        return NULL == lm->sample ? true : lm->ticks == lm->sample->ticks;
+        taskENTER_CRITICAL();
+        if (s->refs)
+                --s->refs;
+        taskEXIT_CRITICAL();
 }
 
 portBASE_TYPE send_logger_message(const xQueueHandle queue,
                                   const LoggerMessage * const msg)
 {
-        return NULL == queue ? errQUEUE_EMPTY : xQueueSend(queue, msg, 0);
-}
+        if (NULL == queue)
+                return errQUEUE_EMPTY;
 
+        /*
+         * Take the reference before the message is visible to the
+         * receiver so it can't release the sample out from under us.
+         */
+        if (msg->sample)
+                acquire_sample(msg->sample);
+
+        const portBASE_TYPE res = xQueueSend(queue, msg, 0);
+        if (pdTRUE != res && msg->sample)
+                release_sample(msg->sample);
+
+        return res;
+}
 
 char receive_logger_message(xQueueHandle queue, LoggerMessage *lm,
                             portTickType timeout)
 {
-        char res;
+        return xQueueReceive(queue, lm, timeout);
+}
 
-        do {
-                res = xQueueReceive(queue, lm, timeout);
-        } while (pdTRUE == res && !is_sample_data_valid(lm));
+void release_logger_message(const LoggerMessage *lm)
+{
+        if (lm->sample)
+                release_sample(lm->sample);
+}
 
-        return res;
+size_t flush_logger_message_queue(const xQueueHandle queue)
+{
+        if (NULL == queue)
+                return 0;
+
+        /* Bounded since the messages we keep go back on the same queue */
+        size_t count = uxQueueMessagesWaiting(queue);
+        size_t dropped = 0;
+        LoggerMessage msg;
+
+        while (count-- && pdFALSE != receive_logger_message(queue, &msg, 0)) {
+                if (msg.sample) {
+                        release_logger_message(&msg);
+                        ++dropped;
+                } else {
+                        send_logger_message(queue, &msg);
+                }
+        }
+
+        return dropped;
 }
 
-xQueueHandle create_logger_message_queue()
+xQueueHandle create_logger_message_queue(const size_t length)
 {
-        return xQueueCreate(LOGGER_MESSAGE_BUFFER_SIZE, sizeof(LoggerMessage));
+        return xQueueCreate(length, sizeof(LoggerMessage));
 }
 
 LoggerMessage create_logger_message(const enum LoggerMessageType t,
@@ -94,7 +288,6 @@ LoggerMessage create_logger_message(const enum LoggerMessageType t,
         msg.ticks = ticks;
         msg.sample = s;
 
-        /* Set matching timestamps.  Needed for validation */
         if (s)
                 s->ticks = ticks;
 
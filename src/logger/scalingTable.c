@@ -0,0 +1,67 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include "scalingTable.h"
+
+#include <stddef.h>
+
+void init_scaling_table(struct scaling_table *st, const ScalingMap *map)
+{
+        const float *x = map->rawValues;
+        const float *y = map->scaledValues;
+        const size_t last = ANALOG_SCALING_BINS - 1;
+
+        st->slope[0] = 0;
+        st->intercept[0] = y[0];
+
+        for (size_t i = 1; i <= last; ++i) {
+                st->raw[i - 1] = x[i - 1];
+
+                /* Duplicate break points leave a segment we never visit */
+                const float run = x[i] - x[i - 1];
+                st->slope[i] = run > 0 ? (y[i] - y[i - 1]) / run : 0;
+                st->intercept[i] = y[i - 1] - st->slope[i] * x[i - 1];
+        }
+
+        st->raw[last] = x[last];
+        st->slope[last + 1] = 0;
+        st->intercept[last + 1] = y[last];
+}
+
+float get_scaling_table_value(const struct scaling_table *st,
+                              const float raw)
+{
+        size_t lo = 0;
+        size_t hi = ANALOG_SCALING_BINS;
+
+        /* Count the break points at or below raw */
+        while (lo < hi) {
+                const size_t mid = (lo + hi) / 2;
+                if (raw < st->raw[mid])
+                        hi = mid;
+                else
+                        lo = mid + 1;
+        }
+
+        return st->slope[lo] * raw + st->intercept[lo];
+}
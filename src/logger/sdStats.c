@@ -0,0 +1,86 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include "cpu.h"
+#include "mod_string.h"
+#include "sdStats.h"
+
+#include <stdbool.h>
+
+static struct sd_stats g_stats;
+
+void sd_stats_reset(void)
+{
+        memset(&g_stats, 0, sizeof(g_stats));
+}
+
+uint32_t sd_stats_start(void)
+{
+        return cpu_get_cycle_count();
+}
+
+static uint32_t elapsed_us(const uint32_t start)
+{
+        /* Unsigned math handles the counter wrapping */
+        return timing_cycles_to_us(cpu_get_cycle_count() - start);
+}
+
+void sd_stats_write(const uint32_t start, const size_t bytes, const bool ok)
+{
+        timing_histogram_add(&g_stats.write, elapsed_us(start));
+
+        if (ok)
+                g_stats.bytes += bytes;
+        else
+                ++g_stats.errors;
+}
+
+void sd_stats_sync(const uint32_t start, const bool ok)
+{
+        timing_histogram_add(&g_stats.sync, elapsed_us(start));
+
+        if (!ok)
+                ++g_stats.errors;
+}
+
+void sd_stats_remount(void)
+{
+        ++g_stats.remounts;
+}
+
+void sd_stats_queue_depth(const size_t depth)
+{
+        if (depth > g_stats.queue_depth_max)
+                g_stats.queue_depth_max = depth;
+}
+
+const struct sd_stats* get_sd_stats(void)
+{
+        return &g_stats;
+}
+
+uint32_t get_sd_write_rate(const struct sd_stats *ss)
+{
+        const uint32_t us = ss->write.total_us;
+        return us ? (uint64_t) ss->bytes * 1000000 / us : 0;
+}
@@ -0,0 +1,121 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include "mem_mang.h"
+#include "mod_string.h"
+#include "sectorBuffer.h"
+
+static char* get_block(const struct sector_buffer *sb, const size_t idx)
+{
+        return sb->data + (idx % sb->count) * sb->size;
+}
+
+size_t init_sector_buffer(struct sector_buffer *sb, const size_t size,
+                          const size_t count)
+{
+        memset(sb, 0, sizeof(struct sector_buffer));
+
+        sb->data = (char *) portMalloc(size * count);
+        if (NULL == sb->data)
+                return 0;
+
+        sb->size = size;
+        sb->count = count;
+        return size * count;
+}
+
+void reset_sector_buffer(struct sector_buffer *sb, const size_t offset)
+{
+        sb->first = 0;
+        sb->full = 0;
+        sb->used = offset % sb->size;
+        sb->skip = sb->used;
+}
+
+size_t put_sector_buffer(struct sector_buffer *sb, const void *data,
+                         size_t len)
+{
+        const char *ptr = data;
+        size_t put = 0;
+
+        while (len && sb->full < sb->count) {
+                size_t chunk = sb->size - sb->used;
+                if (chunk > len)
+                        chunk = len;
+
+                char *block = get_block(sb, sb->first + sb->full);
+                memcpy(block + sb->used, ptr, chunk);
+
+                sb->used += chunk;
+                ptr += chunk;
+                put += chunk;
+                len -= chunk;
+
+                if (sb->used == sb->size) {
+                        ++sb->full;
+                        sb->used = 0;
+                }
+        }
+
+        return put;
+}
+
+size_t get_sector_buffer_full(const struct sector_buffer *sb)
+{
+        return sb->full;
+}
+
+size_t get_sector_buffer_pending(const struct sector_buffer *sb)
+{
+        return sb->full * sb->size + sb->used - sb->skip;
+}
+
+int drain_sector_buffer(struct sector_buffer *sb, sector_write_func *write)
+{
+        while (sb->full) {
+                const char *block = get_block(sb, sb->first);
+                const int rc = write(block + sb->skip, sb->size - sb->skip);
+                if (rc)
+                        return rc;
+
+                sb->first = (sb->first + 1) % sb->count;
+                --sb->full;
+                sb->skip = 0;
+        }
+
+        return 0;
+}
+
+int flush_sector_buffer(struct sector_buffer *sb, sector_write_func *write)
+{
+        int rc = drain_sector_buffer(sb, write);
+        if (rc || sb->used == sb->skip)
+                return rc;
+
+        const char *block = get_block(sb, sb->first);
+        rc = write(block + sb->skip, sb->used - sb->skip);
+        if (0 == rc)
+                sb->skip = sb->used;
+
+        return rc;
+}
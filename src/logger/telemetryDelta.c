@@ -0,0 +1,150 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include "binaryLog.h"
+#include "mem_mang.h"
+#include "mod_string.h"
+#include "telemetryDelta.h"
+
+void telemetry_delta_init(struct telemetry_delta *d,
+                          const size_t keyframe_interval)
+{
+        memset(d, 0, sizeof(*d));
+        d->keyframe_interval = keyframe_interval;
+}
+
+static void free_values(struct telemetry_delta *d)
+{
+        portFree(d->last);
+        portFree(d->known);
+        portFree(d->send);
+        d->last = NULL;
+        d->known = NULL;
+        d->send = NULL;
+        d->capacity = 0;
+}
+
+void telemetry_delta_free(struct telemetry_delta *d)
+{
+        free_values(d);
+        telemetry_delta_init(d, d->keyframe_interval);
+}
+
+void telemetry_delta_reset(struct telemetry_delta *d)
+{
+        d->table = NULL;
+}
+
+static bool reserve_values(struct telemetry_delta *d, const size_t count)
+{
+        if (count <= d->capacity)
+                return true;
+
+        free_values(d);
+
+        const size_t words = SAMPLE_BITMAP_WORDS(count);
+        d->last = (int64_t *) portMalloc(count * sizeof(int64_t));
+        d->known = (uint32_t *) portMalloc(words * sizeof(uint32_t));
+        d->send = (uint32_t *) portMalloc(words * sizeof(uint32_t));
+
+        if (!d->last || !d->known || !d->send) {
+                free_values(d);
+                return false;
+        }
+
+        d->capacity = count;
+        return true;
+}
+
+/*
+ * Makes sure the state matches the channels of the sample.  A new
+ * table means the old last values mean nothing.
+ * @return true if the state had to be started over.
+ */
+static bool sync_table(struct telemetry_delta *d, const struct sample *s)
+{
+        const struct channel_table *t = s->table;
+
+        if (d->table == t && d->layout == t->layout &&
+            d->channel_count == s->channel_count)
+                return false;
+
+        d->table = NULL;
+        if (!reserve_values(d, s->channel_count))
+                return true;
+
+        d->table = t;
+        d->layout = t->layout;
+        d->channel_count = s->channel_count;
+        return true;
+}
+
+struct sample* telemetry_delta_filter(struct telemetry_delta *d,
+                                      struct sample *s,
+                                      struct sample *view,
+                                      bool keyframe)
+{
+        if (!d->keyframe_interval)
+                return s;
+
+        keyframe |= sync_table(d, s);
+
+        /* No memory for the state, so fall back to sending it all */
+        if (!d->table)
+                return s;
+
+        const size_t words = SAMPLE_BITMAP_WORDS(s->channel_count);
+        if (keyframe || d->since_keyframe >= d->keyframe_interval) {
+                memset(d->known, 0, words * sizeof(uint32_t));
+                d->since_keyframe = 0;
+                keyframe = true;
+        }
+        ++d->since_keyframe;
+
+        memset(d->send, 0, words * sizeof(uint32_t));
+
+        const ChannelDescriptor *cd = s->table->channels;
+        for (size_t i = 0; i < s->channel_count; ++i, ++cd) {
+                if (!is_sample_populated(s, i))
+                        continue;
+
+                const size_t word = i / 32;
+                const uint32_t bit = 1u << (i % 32);
+                const int64_t value = binary_log_packed_value(cd,
+                                                              s->values + i);
+
+                if ((d->known[word] & bit) && value == d->last[i])
+                        continue;
+
+                d->last[i] = value;
+                d->known[word] |= bit;
+                d->send[word] |= bit;
+        }
+
+        if (keyframe)
+                return s;
+
+        *view = *s;
+        view->populated = d->send;
+        return view;
+}
@@ -0,0 +1,274 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include "binaryLog.h"
+#include "checksum.h"
+#include "loggerConfig.h"
+#include "mod_string.h"
+#include "sampleRecord.h"
+#include "telemetryFrame.h"
+
+/* One per serial port is all there can ever be */
+#define TELEMETRY_STREAMS	SERIAL_COUNT
+
+struct telemetry_stream {
+        const Serial *serial;
+        enum telemetry_format format;
+        bool meta_sent;
+        uint32_t layout;
+        uint32_t hash;
+};
+
+static struct telemetry_stream g_streams[TELEMETRY_STREAMS];
+
+/*
+ * Frames are written twice, first with no serial to find out how long
+ * they are and then for real.  The first pass also hashes what it sees
+ * so that meta frames can lead with their hash.
+ */
+struct frame_out {
+        Serial *serial;
+        size_t len;
+        uint32_t crc;
+        uint32_t hash;
+};
+
+static struct telemetry_stream* find_stream(const Serial *serial)
+{
+        for (size_t i = 0; i < TELEMETRY_STREAMS; ++i)
+                if (serial == g_streams[i].serial)
+                        return g_streams + i;
+
+        return NULL;
+}
+
+bool telemetry_set_format(const Serial *serial,
+                          const enum telemetry_format format)
+{
+        if (format >= TELEMETRY_FORMATS)
+                return false;
+
+        struct telemetry_stream *ts = find_stream(serial);
+        if (NULL == ts)
+                ts = find_stream(NULL);
+        if (NULL == ts)
+                return false;
+
+        memset(ts, 0, sizeof(*ts));
+        ts->serial = serial;
+        ts->format = format;
+        return true;
+}
+
+enum telemetry_format telemetry_get_format(const Serial *serial)
+{
+        const struct telemetry_stream *ts = find_stream(serial);
+        return ts ? ts->format : TELEMETRY_FORMAT_JSON;
+}
+
+static void frame_put(struct frame_out *out, const void *data,
+                      const size_t len)
+{
+        out->len += len;
+
+        if (NULL == out->serial) {
+                out->hash = checksum_fnv1a(out->hash, data, len);
+                return;
+        }
+
+        out->crc = checksum_crc32(out->crc, data, len);
+        put_bytes(out->serial, (const char *) data, len);
+}
+
+static void frame_put_string(struct frame_out *out, const char *str,
+                             const size_t max_len)
+{
+        size_t len = 0;
+        while (len < max_len && str[len])
+                ++len;
+
+        const uint8_t len8 = len;
+        frame_put(out, &len8, sizeof(len8));
+        frame_put(out, str, len);
+}
+
+static void frame_start(struct frame_out *out,
+                        const enum telemetry_frame_type type, const size_t len)
+{
+        const uint8_t type8 = type;
+        const uint16_t len16 = len;
+
+        put_bytes(out->serial, TELEMETRY_FRAME_SYNC, TELEMETRY_FRAME_SYNC_LEN);
+        out->crc = 0;
+        frame_put(out, &type8, sizeof(type8));
+        frame_put(out, &len16, sizeof(len16));
+}
+
+static void frame_end(struct frame_out *out)
+{
+        const uint32_t crc = out->crc;
+        put_bytes(out->serial, (const char *) &crc, sizeof(crc));
+}
+
+static void put_channels(struct frame_out *out, const struct channel_table *t)
+{
+        const uint16_t count = t->channel_count;
+        frame_put(out, &count, sizeof(count));
+
+        const ChannelDescriptor *cd = t->channels;
+        for (size_t i = 0; i < t->channel_count; ++i, ++cd) {
+                const ChannelConfig *cfg = cd->cfg;
+                const uint8_t type[2] = {
+                        binary_log_get_type(cd), cfg->precision
+                };
+                const uint16_t rate = decodeSampleRate(cfg->sampleRate);
+
+                frame_put(out, type, sizeof(type));
+                frame_put(out, &rate, sizeof(rate));
+                frame_put(out, &cfg->min, sizeof(cfg->min));
+                frame_put(out, &cfg->max, sizeof(cfg->max));
+                frame_put_string(out, cfg->label, DEFAULT_LABEL_LENGTH);
+                frame_put_string(out, cfg->units, DEFAULT_UNITS_LENGTH);
+        }
+}
+
+static size_t measure_channels(const struct channel_table *t, uint32_t *hash)
+{
+        struct frame_out out = { .hash = CHECKSUM_FNV1A_INIT };
+
+        put_channels(&out, t);
+        *hash = out.hash;
+        return out.len;
+}
+
+uint32_t telemetry_meta_hash(const struct channel_table *t)
+{
+        uint32_t hash;
+
+        measure_channels(t, &hash);
+        return hash;
+}
+
+static void send_meta_frame(Serial *serial, struct telemetry_stream *ts,
+                            const struct channel_table *t)
+{
+        const size_t len = measure_channels(t, &ts->hash);
+        struct frame_out out = { .serial = serial };
+
+        frame_start(&out, TELEMETRY_FRAME_META, sizeof(ts->hash) + len);
+        frame_put(&out, &ts->hash, sizeof(ts->hash));
+        put_channels(&out, t);
+        frame_end(&out);
+
+        ts->meta_sent = true;
+        ts->layout = t->layout;
+}
+
+static void put_sample(struct frame_out *out, const struct sample *s,
+                       const uint32_t tick, const uint32_t hash)
+{
+        frame_put(out, &tick, sizeof(tick));
+        frame_put(out, &hash, sizeof(hash));
+        frame_put(out, s->populated,
+                  sizeof(uint32_t[SAMPLE_BITMAP_WORDS(s->channel_count)]));
+
+        const ChannelDescriptor *cd = s->table->channels;
+        for (size_t i = 0; i < s->channel_count; ++i, ++cd)
+                if (is_sample_populated(s, i))
+                        frame_put(out, s->values + i, binary_log_type_size(
+                                          binary_log_get_type(cd)));
+}
+
+void telemetry_send_sample(Serial *serial, const struct sample *s,
+                           const unsigned int tick, const bool send_meta)
+{
+        struct telemetry_stream *ts = find_stream(serial);
+        if (NULL == ts)
+                return;
+
+        const struct channel_table *t = s->table;
+        if (send_meta || !ts->meta_sent || ts->layout != t->layout)
+                send_meta_frame(serial, ts, t);
+
+        struct frame_out out = { 0 };
+        put_sample(&out, s, tick, ts->hash);
+
+        const size_t len = out.len;
+        out = (struct frame_out) { .serial = serial };
+        frame_start(&out, TELEMETRY_FRAME_SAMPLE, len);
+        put_sample(&out, s, tick, ts->hash);
+        frame_end(&out);
+}
+
+static size_t find_sync(const uint8_t *buf, const size_t len)
+{
+        size_t i = 1;
+        while (i < len && TELEMETRY_FRAME_SYNC[0] != (char) buf[i])
+                ++i;
+
+        return i;
+}
+
+size_t telemetry_frame_parse(const uint8_t *buf, const size_t len,
+                             struct telemetry_frame *f)
+{
+        f->type = TELEMETRY_FRAME_NONE;
+        f->len = 0;
+        f->payload = NULL;
+
+        if (0 == len)
+                return 0;
+
+        /* A partial sync at the end of buf may still turn into a frame */
+        const size_t sync_len = len < TELEMETRY_FRAME_SYNC_LEN ?
+                len : TELEMETRY_FRAME_SYNC_LEN;
+        if (strncmp((const char *) buf, TELEMETRY_FRAME_SYNC, sync_len))
+                return find_sync(buf, len);
+        if (len < TELEMETRY_FRAME_HEADER_LEN)
+                return 0;
+
+        const uint8_t type = buf[TELEMETRY_FRAME_SYNC_LEN];
+        uint16_t payload_len;
+        memcpy(&payload_len, buf + TELEMETRY_FRAME_SYNC_LEN + 1,
+               sizeof(payload_len));
+
+        const size_t frame_len = TELEMETRY_FRAME_HEADER_LEN + payload_len +
+                TELEMETRY_FRAME_CRC_LEN;
+        if (len < frame_len)
+                return 0;
+
+        /* The CRC covers everything but the sync */
+        const uint8_t *body = buf + TELEMETRY_FRAME_SYNC_LEN;
+        const size_t body_len = frame_len - TELEMETRY_FRAME_SYNC_LEN -
+                TELEMETRY_FRAME_CRC_LEN;
+        uint32_t crc;
+        memcpy(&crc, body + body_len, sizeof(crc));
+        if (crc != checksum_crc32(0, body, body_len) ||
+            (TELEMETRY_FRAME_META != type && TELEMETRY_FRAME_SAMPLE != type))
+                return find_sync(buf, len);
+
+        f->type = (enum telemetry_frame_type) type;
+        f->len = payload_len;
+        f->payload = buf + TELEMETRY_FRAME_HEADER_LEN;
+        return frame_len;
+}
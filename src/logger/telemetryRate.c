@@ -0,0 +1,186 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+
+#include "loggerConfig.h"
+#include "telemetryRate.h"
+
+static struct telemetry_rate g_rates[CONNECTIVITY_CHANNELS];
+
+/* The rates a sink steps through, fastest first */
+static const int g_steps[] = {
+        SAMPLE_1000Hz,
+        SAMPLE_500Hz,
+        SAMPLE_200Hz,
+        SAMPLE_100Hz,
+        SAMPLE_50Hz,
+        SAMPLE_25Hz,
+        SAMPLE_10Hz,
+        SAMPLE_5Hz,
+        SAMPLE_1Hz,
+};
+
+#define STEP_COUNT	(sizeof(g_steps) / sizeof(g_steps[0]))
+
+static void start_window(struct telemetry_rate *r, const size_t ticks)
+{
+        r->window_start = ticks;
+        r->failures = 0;
+        r->depth_max = 0;
+        r->drained_last = r->drained;
+}
+
+void telemetry_rate_init(struct telemetry_rate *r, const int max_rate,
+                         const int min_rate)
+{
+        r->max_rate = max_rate;
+        r->min_rate = max_rate && min_rate > max_rate ? min_rate : max_rate;
+        r->rate = max_rate;
+        r->quiet_windows = 0;
+        start_window(r, 0);
+}
+
+bool telemetry_rate_is_due(const struct telemetry_rate *r,
+                           const int sampled_rate, const size_t ticks)
+{
+        if (SAMPLE_DISABLED == r->rate)
+                return false;
+
+        return sampled_rate >= r->rate || ticks % r->rate == 0;
+}
+
+void telemetry_rate_enqueue(struct telemetry_rate *r, const bool success,
+                            const size_t depth)
+{
+        if (!success) {
+                ++r->failures;
+                return;
+        }
+
+        if (depth > r->depth_max)
+                r->depth_max = depth;
+}
+
+void telemetry_rate_drained(struct telemetry_rate *r)
+{
+        ++r->drained;
+}
+
+static int slower_rate(const int rate)
+{
+        for (size_t i = 0; i < STEP_COUNT; ++i)
+                if (g_steps[i] > rate)
+                        return g_steps[i];
+
+        return rate;
+}
+
+static int faster_rate(const int rate)
+{
+        for (size_t i = STEP_COUNT; i > 0; --i)
+                if (g_steps[i - 1] < rate)
+                        return g_steps[i - 1];
+
+        return rate;
+}
+
+/*
+ * The fastest rate the sink kept up with.  Never less than one step
+ * down, since the current rate is the one it just choked on.
+ */
+static int throttle(const struct telemetry_rate *r, const uint32_t drained_hz)
+{
+        int rate = r->min_rate;
+
+        for (size_t i = 0; i < STEP_COUNT; ++i) {
+                if ((uint32_t) (TICK_RATE_HZ / g_steps[i]) <= drained_hz) {
+                        rate = g_steps[i];
+                        break;
+                }
+        }
+
+        const int slower = slower_rate(r->rate);
+        if (rate < slower)
+                rate = slower;
+
+        return rate > r->min_rate ? r->min_rate : rate;
+}
+
+static void adjust(struct telemetry_rate *r, const size_t elapsed,
+                   const size_t queue_length)
+{
+        const bool congested = r->failures || r->depth_max > queue_length / 2;
+        const bool quiet = !r->failures && r->depth_max <= 1;
+
+        if (congested) {
+                const uint32_t drained_hz = (r->drained - r->drained_last) *
+                        TICK_RATE_HZ / elapsed;
+
+                r->rate = throttle(r, drained_hz);
+                r->quiet_windows = 0;
+                return;
+        }
+
+        if (!quiet) {
+                r->quiet_windows = 0;
+                return;
+        }
+
+        if (++r->quiet_windows < TELEMETRY_RATE_UP_WINDOWS)
+                return;
+
+        const int faster = faster_rate(r->rate);
+        r->rate = faster < r->max_rate ? r->max_rate : faster;
+        r->quiet_windows = 0;
+}
+
+bool telemetry_rate_update(struct telemetry_rate *r, const size_t ticks,
+                           const size_t queue_length)
+{
+        const size_t elapsed = ticks - r->window_start;
+        if (elapsed < TELEMETRY_RATE_WINDOW)
+                return false;
+
+        const int rate = r->rate;
+
+        /*
+         * A window that ran long means nobody was sampling, so what it
+         * measured says nothing about the link.
+         */
+        if (SAMPLE_DISABLED != rate && elapsed < 2 * TELEMETRY_RATE_WINDOW)
+                adjust(r, elapsed, queue_length);
+
+        start_window(r, ticks);
+        return rate != r->rate;
+}
+
+struct telemetry_rate* get_telemetry_rate(const size_t channel)
+{
+        return channel < CONNECTIVITY_CHANNELS ? g_rates + channel : NULL;
+}
+
+void telemetry_rate_init_all(const int max_rate, const int min_rate)
+{
+        for (size_t i = 0; i < CONNECTIVITY_CHANNELS; ++i)
+                telemetry_rate_init(g_rates + i, max_rate, min_rate);
+}
@@ -23,6 +23,7 @@
 #include "serial.h"
 #include "usart.h"
 #include "usb_comm.h"
+#include "fixedFormat.h"
 #include "modp_numtoa.h"
 #include "printk.h"
 static Serial serial_ports[SERIAL_COUNT];
@@ -92,16 +93,14 @@ void put_ll(Serial *serial, long long l)
 
 void put_float(Serial *serial, float f,int precision)
 {
-    char buf[20];
-    modp_ftoa(f,buf,precision);
-    serial->put_s(buf);
+    char buf[FIXED_FORMAT_BUF_LEN];
+    serial->write(buf, fixed_ftoa(f, buf, precision));
 }
 
 void put_double(Serial *serial, double f, int precision)
 {
-    char buf[30];
-    modp_dtoa(f,buf,precision);
-    serial->put_s(buf);
+    char buf[FIXED_FORMAT_BUF_LEN];
+    serial->write(buf, fixed_dtoa(f, buf, precision));
 }
 
 void put_hex(Serial *serial, int n)
@@ -261,23 +260,32 @@ void put_nameIndexString(Serial *serial, const char *s, int i, const char *v)
 void put_escapedString(Serial * serial, const char *v, int length)
 {
     const char *value = v;
+    const char *run = v;
+
+    /* Runs of plain characters go out in one write */
     while (value - v < length) {
+        const char *escape;
         switch(*value) {
         case '\n':
-            serial->put_s("\\n");
+            escape = "\\n";
             break;
         case '\r':
-            serial->put_s("\\r");
+            escape = "\\r";
             break;
         case '"':
-            serial->put_s("\\\"");
+            escape = "\\\"";
             break;
         default:
-            serial->put_c(*value);
-            break;
+            value++;
+            continue;
         }
-        value++;
+
+        serial->write(run, value - run);
+        serial->put_s(escape);
+        run = ++value;
     }
+
+    serial->write(run, value - run);
 }
 
 void put_nameEscapedString(Serial *serial, const char *s, const char *v, int length)
@@ -309,13 +317,9 @@ void put_nameEscapedString(Serial *serial, const char *s, const char *v, int len
 }
 
 
-void put_bytes(Serial *serial, char *data, unsigned int length)
+void put_bytes(Serial *serial, const char *data, size_t length)
 {
-    while (length > 0) {
-        serial->put_c(*data);
-        data++;
-        length--;
-    }
+    serial->write(data, length);
 }
 
 void put_crlf(const Serial *serial)
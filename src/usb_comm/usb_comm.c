@@ -52,6 +52,7 @@ void usb_init_serial(Serial *serial)
     serial->get_line_wait = &usb_readLineWait;
     serial->put_c = &usb_putchar;
     serial->put_s = &usb_puts;
+    serial->write = &usb_write;
 }
 
 void startUSBCommTask(int priority)
@@ -116,9 +117,12 @@ int usb_readLineWait(char *s, int len, size_t delay)
 
 void usb_puts(const char *s)
 {
-    while ( *s ) {
-        USB_CDC_SendByte(*s++ );
-    }
+    usb_write(s, strlen(s));
+}
+
+void usb_write(const char *data, size_t len)
+{
+    USB_CDC_SendBytes(data, len);
 }
 
 void usb_putchar(char c)
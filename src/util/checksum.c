@@ -0,0 +1,60 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include "checksum.h"
+
+#define FNV1A_PRIME	16777619u
+
+uint32_t checksum_fnv1a(uint32_t hash, const void *data, size_t len)
+{
+        const unsigned char *p = (const unsigned char *) data;
+
+        while (len--) {
+                hash ^= *p++;
+                hash *= FNV1A_PRIME;
+        }
+
+        return hash;
+}
+
+/* Reflected polynomial 0xedb88320, a nibble at a time to keep it small */
+static const uint32_t crc32_nibbles[16] = {
+        0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac,
+        0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c,
+        0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c,
+        0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c,
+};
+
+uint32_t checksum_crc32(uint32_t crc, const void *data, size_t len)
+{
+        const unsigned char *p = (const unsigned char *) data;
+
+        crc = ~crc;
+        while (len--) {
+                crc ^= *p++;
+                crc = (crc >> 4) ^ crc32_nibbles[crc & 0xf];
+                crc = (crc >> 4) ^ crc32_nibbles[crc & 0xf];
+        }
+
+        return ~crc;
+}
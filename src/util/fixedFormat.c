@@ -0,0 +1,274 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+
+#include "fixedFormat.h"
+#include "mod_string.h"
+
+/* modp_ftoa() prints this for values too big for it */
+#define FLOAT_OVERFLOW		"3735928559"
+#define FLOAT_OVERFLOW_LEN	(sizeof(FLOAT_OVERFLOW) - 1)
+
+static const uint64_t powers_of_10[] = {
+        1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull,
+        10000000ull, 100000000ull, 1000000000ull, 10000000000ull,
+        100000000000ull, 1000000000000ull, 10000000000000ull,
+        100000000000000ull, 1000000000000000ull, 10000000000000000ull,
+        100000000000000000ull, 1000000000000000000ull,
+        10000000000000000000ull,
+};
+
+static const float powers_of_10_f[] = {
+        1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000,
+        1000000000,
+};
+
+static const char digit_pairs[] =
+        "00010203040506070809"
+        "10111213141516171819"
+        "20212223242526272829"
+        "30313233343536373839"
+        "40414243444546474849"
+        "50515253545556575859"
+        "60616263646566676869"
+        "70717273747576777879"
+        "80818283848586878889"
+        "90919293949596979899";
+
+static int clamp_precision(const int precision)
+{
+        if (precision < 0)
+                return 0;
+
+        return precision > FIXED_MAX_PRECISION ?
+                FIXED_MAX_PRECISION : precision;
+}
+
+/* A value split at the point, frac in 10^-precision units */
+struct fixed_parts {
+        uint64_t whole;
+        uint32_t frac;
+};
+
+static bool round_up(const bool tie, const int precision,
+                     const uint64_t whole, const uint32_t frac)
+{
+        /* modp rounds ties to even, except that a 0 digit rounds up */
+        const uint64_t odd = precision ? frac : whole;
+        return tie && ((precision && 0 == frac) || odd & 1);
+}
+
+static void carry(struct fixed_parts *parts, const int precision)
+{
+        if (parts->frac >= powers_of_10[precision]) {
+                parts->frac -= powers_of_10[precision];
+                ++parts->whole;
+        }
+}
+
+/*
+ * Float math only, the same steps as modp_ftoa().  Doubles are done in
+ * software on the MCU so they are kept out of this path.
+ */
+static void split_float(struct fixed_parts *parts, const float value,
+                        const int precision)
+{
+        /* No fraction bits left up here */
+        if (value >= 2147483648.0f) {
+                parts->whole = value >= 9223372036854775807.0f ?
+                        INT64_MAX : (uint64_t) value;
+                parts->frac = 0;
+                return;
+        }
+
+        const uint32_t whole = (uint32_t) value;
+        const float tmp = (value - whole) * powers_of_10_f[precision];
+        uint32_t frac = (uint32_t) tmp;
+        const float diff = tmp - frac;
+
+        if (diff > 0.5f || round_up(diff == 0.5f, precision, whole, frac))
+                ++frac;
+
+        parts->whole = whole;
+        parts->frac = frac;
+        carry(parts, precision);
+}
+
+static void split_double(struct fixed_parts *parts, const double value,
+                         const int precision)
+{
+        if (value >= 9223372036854775807.0) {
+                parts->whole = INT64_MAX;
+                parts->frac = 0;
+                return;
+        }
+
+        const uint64_t whole = (uint64_t) value;
+        const double tmp = (value - whole) * powers_of_10[precision];
+        uint32_t frac = (uint32_t) tmp;
+        const double diff = tmp - frac;
+
+        if (diff > 0.5 || round_up(diff == 0.5, precision, whole, frac))
+                ++frac;
+
+        parts->whole = whole;
+        parts->frac = frac;
+        carry(parts, precision);
+}
+
+int64_t fixed_scale(double value, int precision, const bool single)
+{
+        /* NaN */
+        if (value != value)
+                return 0;
+
+        precision = clamp_precision(precision);
+
+        const bool neg = value < 0;
+        if (neg)
+                value = -value;
+
+        struct fixed_parts parts;
+        if (single)
+                split_float(&parts, value, precision);
+        else
+                split_double(&parts, value, precision);
+
+        const int64_t scale = powers_of_10[precision];
+        const int64_t scaled = parts.whole > (INT64_MAX - parts.frac) / scale ?
+                INT64_MAX : (int64_t) parts.whole * scale + parts.frac;
+
+        return neg ? -scaled : scaled;
+}
+
+static size_t count_digits(const uint64_t value)
+{
+        size_t n = 1;
+
+        if (value <= UINT32_MAX) {
+                const uint32_t v = value;
+                while (n < 10 && v >= powers_of_10[n])
+                        ++n;
+
+                return n;
+        }
+
+        while (n < sizeof(powers_of_10) / sizeof(powers_of_10[0]) &&
+               value >= powers_of_10[n])
+                ++n;
+
+        return n;
+}
+
+/* Writes v as exactly n digits, zero padded, ending just before end */
+static void put_digits32(char *end, uint32_t v, size_t n)
+{
+        for (; n >= 2; n -= 2) {
+                const uint32_t q = v / 100;
+                const char *pair = digit_pairs + 2 * (v - q * 100);
+                *--end = pair[1];
+                *--end = pair[0];
+                v = q;
+        }
+
+        if (n)
+                *--end = '0' + v;
+}
+
+/*
+ * 64 bit divides are library calls on the MCU so they are only used
+ * until the value fits in 32 bits.
+ */
+static void put_digits(char *end, uint64_t value, size_t n)
+{
+        for (; value > UINT32_MAX; n -= 2) {
+                const uint64_t q = value / 100;
+                const char *pair = digit_pairs + 2 * (value - q * 100);
+                *--end = pair[1];
+                *--end = pair[0];
+                value = q;
+        }
+
+        put_digits32(end, value, n);
+}
+
+static size_t format_parts(char *buf, const bool neg,
+                           const struct fixed_parts *parts, int precision)
+{
+        char *ptr = buf;
+        if (neg)
+                *ptr++ = '-';
+
+        const size_t whole_digits = count_digits(parts->whole);
+        ptr += whole_digits;
+        put_digits(ptr, parts->whole, whole_digits);
+
+        if (precision) {
+                *ptr++ = '.';
+                ptr += precision;
+                put_digits32(ptr, parts->frac, precision);
+
+                /* Like modp, drop trailing zeros but keep one digit */
+                for (; precision > 1 && '0' == ptr[-1]; --precision)
+                        --ptr;
+        }
+
+        *ptr = '\0';
+        return ptr - buf;
+}
+
+size_t fixed_ftoa(const float value, char *buf, const int precision)
+{
+        const bool neg = value < 0;
+        const float mag = neg ? -value : value;
+
+        if (mag > (float) INT32_MAX) {
+                strcpy(buf, FLOAT_OVERFLOW);
+                return FLOAT_OVERFLOW_LEN;
+        }
+
+        const int prec = clamp_precision(precision);
+        struct fixed_parts parts = {0, 0};
+        if (value == value)
+                split_float(&parts, mag, prec);
+
+        return format_parts(buf, neg, &parts, prec);
+}
+
+size_t fixed_dtoa(const double value, char *buf, const int precision)
+{
+        const bool neg = value < 0;
+        const double mag = neg ? -value : value;
+
+        if (mag > (double) INT64_MAX) {
+                strcpy(buf, FLOAT_OVERFLOW);
+                return FLOAT_OVERFLOW_LEN;
+        }
+
+        const int prec = clamp_precision(precision);
+        struct fixed_parts parts = {0, 0};
+        if (value == value)
+                split_double(&parts, mag, prec);
+
+        return format_parts(buf, neg, &parts, prec);
+}
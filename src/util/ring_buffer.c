@@ -90,7 +90,7 @@ size_t get_used(struct ring_buff *rb)
         return rb->size - get_space(rb) - 1;
 }
 
-size_t get_data(struct ring_buff *rb, void *data, size_t size)
+size_t peek_data(struct ring_buff *rb, void *data, size_t size)
 {
         size_t dist = get_used(rb);
         if (size > dist)
@@ -99,17 +99,20 @@ size_t get_data(struct ring_buff *rb, void *data, size_t size)
         dist = get_end_dist(rb, rb->tail);
         if (size < dist) {
                 memcpy(data, rb->tail, size);
-                rb->tail += size;
         } else {
-                size_t wrap_size = size - dist;
                 memcpy(data, rb->tail, dist);
-                memcpy((char *)data + dist, rb->buf, wrap_size);
-                rb->tail = rb->buf + wrap_size;
+                memcpy((char *)data + dist, rb->buf, size - dist);
         }
 
         return size;
 }
 
+size_t get_data(struct ring_buff *rb, void *data, size_t size)
+{
+        size = peek_data(rb, data, size);
+        return dump_data(rb, size);
+}
+
 size_t dump_data(struct ring_buff *rb, size_t size)
 {
         const size_t used = get_used(rb);
@@ -12,7 +12,7 @@
 #define MAX_TRACKS				240
 #define MAX_SECTORS				20
 #define MAX_VIRTUAL_CHANNELS	30
-#define LOGGER_MESSAGE_BUFFER_SIZE	10
+#define LOGGER_MESSAGE_BUFFER_SIZE	25
 
 /*
  * Adds additional memory saving behavior for low memory systems.
@@ -71,6 +71,13 @@
 
 //logging
 #define LOG_BUFFER_SIZE			8192
+#define PREROLL_BUFFER_SIZE		(1024 * 8)
+#define LOG_FILE_BLOCK_SIZE		(512 * 4)
+#define LOG_FILE_BLOCKS			2
+#define LOG_INDEX_ENTRIES		128
+#define PREROLL_MAX_MS			5000
+#define LOG_PREALLOC_CHUNK		(1024 * 256)
+#define LOG_PREALLOC_MAX_MINUTES	60
 
 //system info
 #define DEVICE_NAME    "RCP_MK2"
@@ -49,6 +49,7 @@ APP_SRC = 	$(APP_PATH)/main.c \
 			$(RCP_SRC)/command/command.c \
 			$(RCP_SRC)/command/baseCommands.c \
 			$(RCP_SRC)/api/api.c \
+			$(RCP_SRC)/api/jsonWriter.c \
 			$(RCP_SRC)/OBD2/OBD2_task.c \
 			$(RCP_SRC)/OBD2/OBD2.c \
 			$(RCP_SRC)/jsmn/jsmn.c \
@@ -86,10 +87,22 @@ APP_SRC = 	$(APP_PATH)/main.c \
 			$(RCP_SRC)/logger/loggerHardware.c \
 			$(RCP_SRC)/logger/loggerSampleData.c \
 			$(RCP_SRC)/logger/loggerTaskEx.c \
+			$(RCP_SRC)/logger/loggerTiming.c \
 			$(RCP_SRC)/logger/logger.c \
+			$(RCP_SRC)/logger/binaryLog.c \
 			$(RCP_SRC)/logger/connectivityTask.c \
+			$(RCP_SRC)/logger/logIndex.c \
+			$(RCP_SRC)/logger/logJournal.c \
 			$(RCP_SRC)/logger/luaLoggerBinding.c \
+			$(RCP_SRC)/logger/pipelineStats.c \
+			$(RCP_SRC)/logger/preroll.c \
 			$(RCP_SRC)/logger/sampleRecord.c \
+			$(RCP_SRC)/logger/scalingTable.c \
+			$(RCP_SRC)/logger/sdStats.c \
+			$(RCP_SRC)/logger/sectorBuffer.c \
+			$(RCP_SRC)/logger/telemetryDelta.c \
+			$(RCP_SRC)/logger/telemetryFrame.c \
+			$(RCP_SRC)/logger/telemetryRate.c \
 			$(RCP_SRC)/devices/bluetooth.c \
 			$(RCP_SRC)/devices/cellModem.c \
 			$(RCP_SRC)/devices/null_device.c \
@@ -107,6 +120,8 @@ APP_SRC = 	$(APP_PATH)/main.c \
 			$(RCP_SRC)/util/modp_atonum.c \
 			$(RCP_SRC)/util/modp_numtoa.c \
 			$(RCP_SRC)/util/byteswap.c \
+			$(RCP_SRC)/util/checksum.c \
+			$(RCP_SRC)/util/fixedFormat.c \
 			$(RCP_SRC)/util/taskUtil.c \
 			$(RCP_SRC)/sdcard/sdcard.c \
 			$(HAL_SRC)/sim900_stm32/sim900_device_stm32.c \
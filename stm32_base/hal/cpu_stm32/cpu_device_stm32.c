@@ -11,9 +11,21 @@
 #define SERIAL_ID_BITS		96
 #define SERIAL_ID_BUFFER_LEN	(((SERIAL_ID_BITS / 8) * 2) + 1)
 
+/* Our CMSIS predates the DWT definitions, so address it directly */
+#define DWT_CTRL		(*(volatile uint32_t *) 0xE0001000)
+#define DWT_CYCCNT		(*(volatile uint32_t *) 0xE0001004)
+#define DWT_CTRL_CYCCNTENA	(1UL << 0)
+
 extern uint32_t _flash_start;
 static char cpu_id[SERIAL_ID_BUFFER_LEN];
 
+static void init_cycle_counter()
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT_CYCCNT = 0;
+    DWT_CTRL |= DWT_CTRL_CYCCNTENA;
+}
+
 static void init_cpu_id()
 {
     uint32_t *p = (uint32_t *) CPU_ID_REGISTER_START;
@@ -34,6 +46,7 @@ int cpu_device_init(void)
     NVIC_SetVectorTable(NVIC_VectTab_FLASH, _flash_start);
     NVIC_PriorityGroupConfig(NVIC_PriorityGroup_4);
     init_cpu_id();
+    init_cycle_counter();
     return 1;
 }
 
@@ -58,3 +71,13 @@ const char *cpu_device_get_serialnumber(void)
 {
     return cpu_id;
 }
+
+uint32_t cpu_device_get_cycle_count(void)
+{
+    return DWT_CYCCNT;
+}
+
+uint32_t cpu_device_get_cycles_per_us(void)
+{
+    return SystemCoreClock / 1000000;
+}
@@ -2,6 +2,7 @@
 #include "FreeRTOS.h"
 #include "task.h"
 #include "queue.h"
+#include "semphr.h"
 #include "stm32f4xx_usart.h"
 #include "stm32f4xx_gpio.h"
 #include "stm32f4xx_misc.h"
@@ -10,8 +11,10 @@
 #include "printk.h"
 #include "mem_mang.h"
 #include "LED.h"
+#include "mod_string.h"
 
 #define UART_QUEUE_LENGTH 	1024
+#define UART_TX_BUFFER_SIZE	1024
 #define GPS_BUFFER_SIZE		132
 
 #define UART_WIRELESS_IRQ_PRIORITY 	7
@@ -29,20 +32,79 @@ typedef enum {
     UART_TX_IRQ = 2
 } uart_irq_type_t;
 
-xQueueHandle xUsart0Tx;
 xQueueHandle xUsart0Rx;
 
-xQueueHandle xUsart1Tx;
 xQueueHandle xUsart1Rx;
 
 xQueueHandle xUsart2Tx;
 xQueueHandle xUsart2Rx;
 
-xQueueHandle xUsart3Tx;
 xQueueHandle xUsart3Rx;
 
 static uint8_t *gpsRxBuffer;
 
+/*
+ * Transmit ring buffer drained by DMA.  Tasks fill it from head and the
+ * DMA sends from tail, one contiguous run at a time.  The GPS port keeps
+ * the per-character Tx queue since its DMA stream belongs to I2C, and it
+ * hardly ever transmits anyway.
+ */
+struct uart_tx {
+    USART_TypeDef *usart;
+    DMA_Stream_TypeDef *stream;
+    uint32_t channel;
+    uint32_t all_flag_mask; /* required for clearing flags */
+    uint32_t tc_flag;
+    uint32_t te_flag;
+    uint8_t *buf;
+    volatile size_t head;
+    volatile size_t tail;
+    /* Length of the run the DMA is sending, 0 if it is idle */
+    volatile size_t busy;
+    xSemaphoreHandle lock;
+    /* Given whenever the DMA frees up some of the buffer */
+    xSemaphoreHandle space;
+};
+
+static struct uart_tx wirelessTx = {
+    .usart = USART1,
+    .stream = DMA2_Stream7,
+    .channel = DMA_Channel_4,
+    .all_flag_mask = DMA_FLAG_FEIF7 | DMA_FLAG_DMEIF7 | DMA_FLAG_TEIF7 |
+    DMA_FLAG_HTIF7 | DMA_FLAG_TCIF7,
+    .tc_flag = DMA_IT_TCIF7,
+    .te_flag = DMA_IT_TEIF7,
+};
+
+static struct uart_tx auxTx = {
+    .usart = USART3,
+    .stream = DMA1_Stream3,
+    .channel = DMA_Channel_4,
+    .all_flag_mask = DMA_FLAG_FEIF3 | DMA_FLAG_DMEIF3 | DMA_FLAG_TEIF3 |
+    DMA_FLAG_HTIF3 | DMA_FLAG_TCIF3,
+    .tc_flag = DMA_IT_TCIF3,
+    .te_flag = DMA_IT_TEIF3,
+};
+
+static struct uart_tx telemetryTx = {
+    .usart = UART4,
+    .stream = DMA1_Stream4,
+    .channel = DMA_Channel_4,
+    .all_flag_mask = DMA_FLAG_FEIF4 | DMA_FLAG_DMEIF4 | DMA_FLAG_TEIF4 |
+    DMA_FLAG_HTIF4 | DMA_FLAG_TCIF4,
+    .tc_flag = DMA_IT_TCIF4,
+    .te_flag = DMA_IT_TEIF4,
+};
+
+static int initTxBuffer(struct uart_tx *tx)
+{
+    tx->buf = (uint8_t *) portMalloc(UART_TX_BUFFER_SIZE);
+    tx->lock = xSemaphoreCreateMutex();
+    vSemaphoreCreateBinary(tx->space);
+
+    return tx->buf != NULL && tx->lock != NULL && tx->space != NULL;
+}
+
 static int initQueues()
 {
     gpsRxBuffer = (uint8_t *) portMalloc(sizeof(uint8_t) * GPS_BUFFER_SIZE);
@@ -52,9 +114,7 @@ static int initQueues()
     /* Create the queues used to hold Rx and Tx characters. */
     xUsart0Rx = xQueueCreate(UART_QUEUE_LENGTH,
                              (unsigned portBASE_TYPE)sizeof(signed portCHAR));
-    xUsart0Tx = xQueueCreate(UART_QUEUE_LENGTH + 1,
-                             (unsigned portBASE_TYPE)sizeof(signed portCHAR));
-    if (xUsart0Rx == NULL || xUsart0Tx == NULL) {
+    if (xUsart0Rx == NULL || !initTxBuffer(&wirelessTx)) {
         success = 0;
         goto cleanup_and_return;
     }
@@ -62,9 +122,7 @@ static int initQueues()
 
     xUsart1Rx = xQueueCreate(UART_QUEUE_LENGTH,
                              (unsigned portBASE_TYPE)sizeof(signed portCHAR));
-    xUsart1Tx = xQueueCreate(UART_QUEUE_LENGTH + 1,
-                             (unsigned portBASE_TYPE)sizeof(signed portCHAR));
-    if (xUsart1Rx == NULL || xUsart1Tx == NULL) {
+    if (xUsart1Rx == NULL || !initTxBuffer(&auxTx)) {
         success = 0;
         goto cleanup_and_return;
     }
@@ -80,9 +138,7 @@ static int initQueues()
 
     xUsart3Rx = xQueueCreate(UART_QUEUE_LENGTH,
                              (unsigned portBASE_TYPE)sizeof(signed portCHAR));
-    xUsart3Tx = xQueueCreate(UART_QUEUE_LENGTH + 1,
-                             (unsigned portBASE_TYPE)sizeof(signed portCHAR));
-    if (xUsart3Rx == NULL || xUsart3Tx == NULL) {
+    if (xUsart3Rx == NULL || !initTxBuffer(&telemetryTx)) {
         success = 0;
         goto cleanup_and_return;
     }
@@ -191,6 +247,7 @@ int usart_device_init_serial(Serial * serial, uart_id_t id)
         serial->get_line_wait = &usart0_readLineWait;
         serial->put_c = &usart0_putchar;
         serial->put_s = &usart0_puts;
+        serial->write = &usart0_write;
         break;
 
     case UART_AUX:
@@ -202,6 +259,7 @@ int usart_device_init_serial(Serial * serial, uart_id_t id)
         serial->get_line_wait = &usart1_readLineWait;
         serial->put_c = &usart1_putchar;
         serial->put_s = &usart1_puts;
+        serial->write = &usart1_write;
         break;
 
     case UART_GPS:
@@ -213,6 +271,7 @@ int usart_device_init_serial(Serial * serial, uart_id_t id)
         serial->get_line_wait = &usart2_readLineWait;
         serial->put_c = &usart2_putchar;
         serial->put_s = &usart2_puts;
+        serial->write = &usart2_write;
         break;
 
     case UART_TELEMETRY:
@@ -224,6 +283,7 @@ int usart_device_init_serial(Serial * serial, uart_id_t id)
         serial->get_line_wait = &usart3_readLineWait;
         serial->put_c = &usart3_putchar;
         serial->put_s = &usart3_puts;
+        serial->write = &usart3_write;
         break;
 
     default:
@@ -294,6 +354,46 @@ static void enableRxDMA(uint32_t RCC_AHB1Periph,
     DMA_Cmd(DMA_stream, ENABLE);
 }
 
+static void enableTxDMA(struct uart_tx *tx, uint32_t RCC_AHB1Periph,
+                        uint8_t NVIC_IRQ_channel, uint8_t IRQ_priority)
+{
+    NVIC_InitTypeDef NVIC_InitStructure;
+    NVIC_InitStructure.NVIC_IRQChannel = NVIC_IRQ_channel;
+    NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = IRQ_priority;
+    NVIC_InitStructure.NVIC_IRQChannelSubPriority = 0;
+    NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+    NVIC_Init(&NVIC_InitStructure);
+
+    RCC_AHB1PeriphClockCmd(RCC_AHB1Periph, ENABLE);
+    DMA_InitTypeDef DMA_InitStructure;
+    DMA_DeInit(tx->stream);
+    DMA_InitStructure.DMA_Channel = tx->channel;
+    DMA_InitStructure.DMA_DIR = DMA_DIR_MemoryToPeripheral;
+    DMA_InitStructure.DMA_Memory0BaseAddr = (uint32_t) tx->buf;
+    /* Set for real each time a run is started */
+    DMA_InitStructure.DMA_BufferSize = 1;
+    DMA_InitStructure.DMA_PeripheralBaseAddr = (uint32_t) & tx->usart->DR;
+    DMA_InitStructure.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
+    DMA_InitStructure.DMA_MemoryInc = DMA_MemoryInc_Enable;
+    DMA_InitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_Byte;
+    DMA_InitStructure.DMA_MemoryDataSize = DMA_MemoryDataSize_Byte;
+    DMA_InitStructure.DMA_Mode = DMA_Mode_Normal;
+    DMA_InitStructure.DMA_Priority = DMA_Priority_Medium;
+    DMA_InitStructure.DMA_FIFOMode = DMA_FIFOMode_Disable;
+    DMA_InitStructure.DMA_FIFOThreshold = DMA_FIFOThreshold_Full;
+    DMA_InitStructure.DMA_MemoryBurst = DMA_MemoryBurst_Single;
+    DMA_InitStructure.DMA_PeripheralBurst = DMA_PeripheralBurst_Single;
+    DMA_Init(tx->stream, &DMA_InitStructure);
+
+    DMA_ClearFlag(tx->stream, tx->all_flag_mask);
+    DMA_ITConfig(tx->stream, DMA_IT_TC | DMA_IT_TE, ENABLE);
+    USART_DMACmd(tx->usart, USART_DMAReq_Tx, ENABLE);
+
+    tx->head = 0;
+    tx->tail = 0;
+    tx->busy = 0;
+}
+
 static void enableRxTxIrq(USART_TypeDef * USARTx, uint8_t usartIrq,
                           uint8_t IRQ_priority, uart_irq_type_t irqType)
 {
@@ -309,9 +409,9 @@ static void enableRxTxIrq(USART_TypeDef * USARTx, uint8_t usartIrq,
     NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
     NVIC_Init(&NVIC_InitStructure);
 
-    if (irqType | UART_RX_IRQ)
+    if (irqType & UART_RX_IRQ)
         USART_ITConfig(USARTx, USART_IT_RXNE, ENABLE);
-    if (irqType | UART_TX_IRQ)
+    if (irqType & UART_TX_IRQ)
         USART_ITConfig(USARTx, USART_IT_TXE, ENABLE);
 }
 
@@ -327,7 +427,9 @@ void usart_device_init_0(unsigned int bits, unsigned int parity,
     GPIO_PinAFConfig(GPIOA, GPIO_PinSource10, GPIO_AF_USART1);
 
     enableRxTxIrq(USART1, USART1_IRQn, UART_WIRELESS_IRQ_PRIORITY,
-                  (UART_RX_IRQ | UART_TX_IRQ));
+                  UART_RX_IRQ);
+    enableTxDMA(&wirelessTx, RCC_AHB1Periph_DMA2, DMA2_Stream7_IRQn,
+                UART_WIRELESS_IRQ_PRIORITY);
 
     initUsart(USART1, bits, parity, stopBits, baud);
 }
@@ -343,8 +445,9 @@ void usart_device_init_1(unsigned int bits, unsigned int parity,
     GPIO_PinAFConfig(GPIOD, GPIO_PinSource8, GPIO_AF_USART3);
     GPIO_PinAFConfig(GPIOD, GPIO_PinSource9, GPIO_AF_USART3);
 
-    enableRxTxIrq(USART3, USART3_IRQn, UART_AUX_IRQ_PRIORITY,
-                  (UART_RX_IRQ | UART_TX_IRQ));
+    enableRxTxIrq(USART3, USART3_IRQn, UART_AUX_IRQ_PRIORITY, UART_RX_IRQ);
+    enableTxDMA(&auxTx, RCC_AHB1Periph_DMA1, DMA1_Stream3_IRQn,
+                UART_AUX_IRQ_PRIORITY);
 
     initUsart(USART3, bits, parity, stopBits, baud);
 }
@@ -379,7 +482,9 @@ void usart_device_init_3(unsigned int bits, unsigned int parity,
     GPIO_PinAFConfig(GPIOA, GPIO_PinSource1, GPIO_AF_UART4);
 
     enableRxTxIrq(UART4, UART4_IRQn, UART_TELEMETRY_IRQ_PRIORITY,
-                  (UART_RX_IRQ | UART_TX_IRQ));
+                  UART_RX_IRQ);
+    enableTxDMA(&telemetryTx, RCC_AHB1Periph_DMA1, DMA1_Stream4_IRQn,
+                UART_TELEMETRY_IRQ_PRIORITY);
 
     initUsart(UART4, bits, parity, stopBits, baud);
 }
@@ -388,6 +493,60 @@ void usart_device_init_3(unsigned int bits, unsigned int parity,
 // Communication functions
 ////////////////////////////////////////////////////////////////////////////
 
+/*
+ * Starts the DMA on the next run waiting in the buffer unless it is busy
+ * already.  Called with interrupts masked or from the DMA interrupt.
+ */
+static void startTxDMA(struct uart_tx *tx)
+{
+    if (tx->busy || tx->head == tx->tail)
+        return;
+
+    const size_t end = tx->head > tx->tail ? tx->head : UART_TX_BUFFER_SIZE;
+    tx->busy = end - tx->tail;
+
+    DMA_MemoryTargetConfig(tx->stream, (uint32_t) (tx->buf + tx->tail),
+                           DMA_Memory_0);
+    DMA_SetCurrDataCounter(tx->stream, tx->busy);
+
+    /* The stream won't start with flags left over from the last run */
+    DMA_ClearFlag(tx->stream, tx->all_flag_mask);
+    DMA_Cmd(tx->stream, ENABLE);
+}
+
+static void usartTxWrite(struct uart_tx *tx, const char *data, size_t len)
+{
+    xSemaphoreTake(tx->lock, portMAX_DELAY);
+
+    while (len) {
+        const size_t head = tx->head;
+        const size_t tail = tx->tail;
+
+        /* One slot stays empty to tell a full buffer from an empty one */
+        size_t room = head < tail ? tail - head - 1 :
+            UART_TX_BUFFER_SIZE - head - (tail == 0 ? 1 : 0);
+
+        if (!room) {
+            xSemaphoreTake(tx->space, portMAX_DELAY);
+            continue;
+        }
+
+        if (room > len)
+            room = len;
+
+        memcpy(tx->buf + head, data, room);
+        data += room;
+        len -= room;
+
+        taskENTER_CRITICAL();
+        tx->head = (head + room) % UART_TX_BUFFER_SIZE;
+        startTxDMA(tx);
+        taskEXIT_CRITICAL();
+    }
+
+    xSemaphoreGive(tx->lock);
+}
+
 void usart0_flush(void)
 {
     char rx;
@@ -473,10 +632,7 @@ void usart0_putchar(char c)
         pr_debug(buf);
     }
 
-    xQueueSend(xUsart0Tx, &c, portMAX_DELAY);
-
-    //Enable transmitter interrupt
-    USART_ITConfig(USART1, USART_IT_TXE, ENABLE);
+    usart0_write(&c, 1);
 }
 
 void usart1_putchar(char c)
@@ -488,10 +644,7 @@ void usart1_putchar(char c)
         pr_debug(buf);
     }
 
-    xQueueSend(xUsart1Tx, &c, portMAX_DELAY);
-
-    //Enable transmitter interrupt
-    USART_ITConfig(USART3, USART_IT_TXE, ENABLE);
+    usart1_write(&c, 1);
 }
 
 void usart2_putchar(char c)
@@ -518,22 +671,27 @@ void usart3_putchar(char c)
         pr_debug(buf);
     }
 
-    xQueueSend(xUsart3Tx, &c, portMAX_DELAY);
-
-    //Enable transmitter interrupt
-    USART_ITConfig(UART4, USART_IT_TXE, ENABLE);
+    usart3_write(&c, 1);
 }
 
 void usart0_puts(const char *s)
 {
-    while (*s)
-        usart0_putchar(*s++);
+    usart0_write(s, strlen(s));
+}
+
+void usart0_write(const char *data, size_t len)
+{
+    usartTxWrite(&wirelessTx, data, len);
 }
 
 void usart1_puts(const char *s)
 {
-    while (*s)
-        usart1_putchar(*s++);
+    usart1_write(s, strlen(s));
+}
+
+void usart1_write(const char *data, size_t len)
+{
+    usartTxWrite(&auxTx, data, len);
 }
 
 void usart2_puts(const char *s)
@@ -542,10 +700,20 @@ void usart2_puts(const char *s)
         usart2_putchar(*s++);
 }
 
+void usart2_write(const char *data, size_t len)
+{
+    while (len--)
+        usart2_putchar(*data++);
+}
+
 void usart3_puts(const char *s)
 {
-    while (*s)
-        usart3_putchar(*s++);
+    usart3_write(s, strlen(s));
+}
+
+void usart3_write(const char *data, size_t len)
+{
+    usartTxWrite(&telemetryTx, data, len);
 }
 
 int usart0_readLineWait(char *s, int len, size_t delay)
@@ -694,21 +862,9 @@ void DMA1_Stream5_IRQHandler(void)
 
 void USART1_IRQHandler(void)
 {
-    portBASE_TYPE xTaskWokenByTx = pdFALSE, xTaskWokenByPost = pdFALSE;
+    portBASE_TYPE xTaskWokenByPost = pdFALSE;
     signed portCHAR cChar;
 
-    if (USART_GetITStatus(USART1, USART_IT_TXE) != RESET) {
-        /* The interrupt was caused by the TX becoming empty.  Are there any more characters to transmit? */
-        if (xQueueReceiveFromISR(xUsart0Tx, &cChar, &xTaskWokenByTx) ==
-            pdTRUE) {
-            // A character was retrieved from the queue so can be sent to the USART
-            USART_SendData(USART1, cChar);
-        } else {
-            /* Queue empty, nothing to send so turn off the Tx interrupt. */
-            USART_ITConfig(USART1, USART_IT_TXE, DISABLE);
-        }
-    }
-
     if (USART_GetITStatus(USART1, USART_IT_RXNE) != RESET) {
         /* The interrupt was caused by a character being received.  Grab the
            character from the rx and place it in the queue or received
@@ -719,9 +875,9 @@ void USART1_IRQHandler(void)
 
     handle_usart_overrun(USART1);
 
-    /* If a task was woken by either a character being received or a character
-       being transmitted then we may need to switch to another task. */
-    portEND_SWITCHING_ISR(xTaskWokenByPost || xTaskWokenByTx);
+    /* If a task was woken by a character being received then we may need
+       to switch to another task.  Transmit is handled by the DMA. */
+    portEND_SWITCHING_ISR(xTaskWokenByPost);
 }
 
 void USART2_IRQHandler(void)
@@ -758,21 +914,9 @@ void USART2_IRQHandler(void)
 
 void USART3_IRQHandler(void)
 {
-    portBASE_TYPE xTaskWokenByTx = pdFALSE, xTaskWokenByPost = pdFALSE;
+    portBASE_TYPE xTaskWokenByPost = pdFALSE;
     signed portCHAR cChar;
 
-    if (USART_GetITStatus(USART3, USART_IT_TXE) != RESET) {
-        /* The interrupt was caused by the TX becoming empty.  Are there any more characters to transmit? */
-        if (xQueueReceiveFromISR(xUsart1Tx, &cChar, &xTaskWokenByTx) ==
-            pdTRUE) {
-            // A character was retrieved from the queue so can be sent to the USART
-            USART_SendData(USART3, cChar);
-        } else {
-            /* Queue empty, nothing to send so turn off the Tx interrupt. */
-            USART_ITConfig(USART3, USART_IT_TXE, DISABLE);
-        }
-    }
-
     if (USART_GetITStatus(USART3, USART_IT_RXNE) != RESET) {
         /* The interrupt was caused by a character being received.  Grab the
            character from the rx and place it in the queue or received
@@ -783,27 +927,16 @@ void USART3_IRQHandler(void)
 
     handle_usart_overrun(USART3);
 
-    /* If a task was woken by either a character being received or a character
-       being transmitted then we may need to switch to another task. */
-    portEND_SWITCHING_ISR(xTaskWokenByPost || xTaskWokenByTx);
+    /* If a task was woken by a character being received then we may need
+       to switch to another task.  Transmit is handled by the DMA. */
+    portEND_SWITCHING_ISR(xTaskWokenByPost);
 }
 
 void UART4_IRQHandler(void)
 {
-    portBASE_TYPE xTaskWokenByTx = pdFALSE, xTaskWokenByPost = pdFALSE;
+    portBASE_TYPE xTaskWokenByPost = pdFALSE;
     signed portCHAR cChar;
 
-    if (USART_GetITStatus(UART4, USART_IT_TXE) != RESET) {
-        /* The interrupt was caused by the TX becoming empty.  Are there any more characters to transmit? */
-        if (xQueueReceiveFromISR(xUsart3Tx, &cChar, &xTaskWokenByTx) ==
-            pdTRUE) {
-            // A character was retrieved from the queue so can be sent to the USART
-            USART_SendData(UART4, cChar);
-        } else {
-            /* Queue empty, nothing to send so turn off the Tx interrupt. */
-            USART_ITConfig(UART4, USART_IT_TXE, DISABLE);
-        }
-    }
     if (USART_GetITStatus(UART4, USART_IT_RXNE) != RESET) {
         /* The interrupt was caused by a character being received.  Grab the
            character from the rx and place it in the queue or received
@@ -814,7 +947,47 @@ void UART4_IRQHandler(void)
 
     handle_usart_overrun(UART4);
 
-    /* If a task was woken by either a character being received or a character
-       being transmitted then we may need to switch to another task. */
-    portEND_SWITCHING_ISR(xTaskWokenByPost || xTaskWokenByTx);
+    /* If a task was woken by a character being received then we may need
+       to switch to another task.  Transmit is handled by the DMA. */
+    portEND_SWITCHING_ISR(xTaskWokenByPost);
+}
+
+static portBASE_TYPE handleTxDMA(struct uart_tx *tx)
+{
+    portBASE_TYPE xTaskWoken = pdFALSE;
+
+    const ITStatus error = DMA_GetITStatus(tx->stream, tx->te_flag);
+
+    if (!error && !DMA_GetITStatus(tx->stream, tx->tc_flag))
+        return xTaskWoken;
+
+    /*
+     * The stream stops itself on a transfer error.  The run is dropped
+     * rather than sent again, since part of it may already be out, and
+     * the writers must not be left waiting on it.
+     */
+    DMA_ClearFlag(tx->stream, tx->all_flag_mask);
+
+    /* The run is out.  Move on to whatever was added meanwhile */
+    tx->tail = (tx->tail + tx->busy) % UART_TX_BUFFER_SIZE;
+    tx->busy = 0;
+    startTxDMA(tx);
+
+    xSemaphoreGiveFromISR(tx->space, &xTaskWoken);
+    return xTaskWoken;
+}
+
+void DMA2_Stream7_IRQHandler(void)
+{
+    portEND_SWITCHING_ISR(handleTxDMA(&wirelessTx));
+}
+
+void DMA1_Stream3_IRQHandler(void)
+{
+    portEND_SWITCHING_ISR(handleTxDMA(&auxTx));
+}
+
+void DMA1_Stream4_IRQHandler(void)
+{
+    portEND_SWITCHING_ISR(handleTxDMA(&telemetryTx));
 }
@@ -36,6 +36,11 @@ void USB_CDC_SendByte( portCHAR cByte )
     vcp_tx((uint8_t*)&cByte, 1);
 }
 
+void USB_CDC_SendBytes(const portCHAR *data, size_t len)
+{
+    vcp_tx((uint8_t*)data, len);
+}
+
 portBASE_TYPE USB_CDC_ReceiveByte(portCHAR *data)
 {
     return vcp_rx((uint8_t*)data, 1, 0);
@@ -36,6 +36,7 @@
 #include <usb_dcd.h>
 
 #include <stdbool.h>
+#include <string.h>
 #include <FreeRTOS.h>
 #include <task.h>
 #include <portmacro.h>
@@ -172,15 +173,18 @@ static uint16_t VCP_Ctrl (uint32_t Cmd, uint8_t* Buf, uint32_t Len)
   * @retval Result of the opeartion: USBD_OK if all operations are OK else VCP_FAIL
   */
 
-static bool check_tx_overrun(void)
+/*
+ * How much can be copied into the IN buffer in one go, without wrapping
+ * and without catching up to what the CDC core has yet to send.
+ */
+static uint32_t get_tx_room(void)
 {
-    if (APP_Rx_ptr_in == APP_Rx_ptr_out - 1)
-        return true;
+    const uint32_t out = APP_Rx_ptr_out;
 
-    if ((APP_Rx_ptr_in == APP_RX_DATA_SIZE) && (APP_Rx_ptr_out == 0))
-        return true;
+    if (APP_Rx_ptr_in < out)
+        return out - APP_Rx_ptr_in - 1;
 
-    return false;
+    return APP_RX_DATA_SIZE - APP_Rx_ptr_in - (0 == out ? 1 : 0);
 }
 
 static bool check_suspended(void)
@@ -194,25 +198,29 @@ static bool check_suspended(void)
 
 static uint16_t VCP_DataTx (uint8_t* Buf, uint32_t Len)
 {
-    bool overrun;
-
     bool susp = check_suspended();
 
     /* If USB Is disconnected, drop the data on the floor */
     if (susp)
         return USBD_FAIL;
 
-    while (Len--) {
-        overrun = check_tx_overrun();
+    while (Len) {
+        uint32_t room = get_tx_room();
 
-        while(overrun) {
+        if (!room) {
             vTaskDelay(1);
-            overrun = check_tx_overrun();
+            continue;
         }
 
-        APP_Rx_Buffer[APP_Rx_ptr_in++] = *Buf++;
+        if (room > Len)
+            room = Len;
+
+        memcpy(APP_Rx_Buffer + APP_Rx_ptr_in, Buf, room);
+        Buf += room;
+        Len -= room;
 
         /* Avoid running off the end of the buffer */
+        APP_Rx_ptr_in += room;
         if(APP_Rx_ptr_in >= APP_RX_DATA_SIZE) {
             APP_Rx_ptr_in = 0;
         }
@@ -40,6 +40,11 @@ signed portBASE_TYPE xQueueGenericReceive(
 }
 
 
+unsigned portBASE_TYPE uxQueueMessagesWaiting(const xQueueHandle xQueue)
+{
+        return 0;
+}
+
 xQueueHandle xQueueCreate(
         unsigned portBASE_TYPE uxQueueLength,
         unsigned portBASE_TYPE uxItemSize)
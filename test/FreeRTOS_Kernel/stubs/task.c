@@ -43,6 +43,12 @@ void increment_tick() {
         ticks++;
 }
 
+void vPortEnterCritical() {
+}
+
+void vPortExitCritical() {
+}
+
 void vTaskDelay(portTickType xTicksToDelay) {
         usleep((useconds_t)xTicksToDelay * 1000);
 }
@@ -0,0 +1,404 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include "binaryLog.h"
+#include "binaryLog_test.h"
+#include "loggerConfig.h"
+#include "modp_numtoa.h"
+#include "rcb2csv.h"
+#include "sampleRecord.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+using std::string;
+
+CPPUNIT_TEST_SUITE_REGISTRATION( BinaryLogTest );
+
+static struct channel_table table;
+static struct sample sample;
+static struct binary_log_writer writer;
+static struct binary_log_writer packed_writer;
+static string output;
+static string packed;
+
+static int capture(const void *data, const size_t len)
+{
+        output.append((const char *) data, len);
+        return 0;
+}
+
+static int capture_packed(const void *data, const size_t len)
+{
+        packed.append((const char *) data, len);
+        return 0;
+}
+
+static size_t count_keyframes(const string &log)
+{
+        size_t count = 0;
+        for (size_t pos = log.find(BINARY_LOG_KEYFRAME_SYNC);
+             string::npos != pos;
+             pos = log.find(BINARY_LOG_KEYFRAME_SYNC, pos + 1))
+                ++count;
+
+        return count;
+}
+
+static int fail(const void *data, const size_t len)
+{
+        return -1;
+}
+
+static int convert(const string &in, string &out)
+{
+        char *buf = NULL;
+        size_t size = 0;
+        FILE *fin = fmemopen((void *) in.data(), in.size(), "rb");
+        FILE *fout = open_memstream(&buf, &size);
+
+        const int rc = rcb2csv(fin, fout);
+        fclose(fin);
+        fclose(fout);
+
+        out = string(buf, size);
+        free(buf);
+        return rc;
+}
+
+/* The CSV that fileWriter.c would have written */
+static string csv_header(void)
+{
+        string csv;
+        char buf[32];
+
+        for (size_t i = 0; i < table.channel_count; ++i) {
+                const ChannelConfig *cfg = table.channels[i].cfg;
+                csv += i ? "," : "";
+                csv += string("\"") + cfg->label + "\"|\"" + cfg->units + "\"|";
+                modp_ftoa(cfg->min, buf, cfg->precision);
+                csv += string(buf) + "|";
+                modp_ftoa(cfg->max, buf, cfg->precision);
+                csv += string(buf) + "|";
+                modp_itoa10(decodeSampleRate(cfg->sampleRate), buf);
+                csv += buf;
+        }
+
+        return csv + "\n";
+}
+
+static string csv_row(void)
+{
+        string csv;
+        char buf[32];
+
+        for (size_t i = 0; i < sample.channel_count; ++i) {
+                const ChannelDescriptor *cd = table.channels + i;
+                const ChannelValue *v = sample.values + i;
+                csv += i ? "," : "";
+
+                if (!is_sample_populated(&sample, i))
+                        continue;
+
+                switch (cd->sampleData) {
+                case SampleData_LongLong_Noarg:
+                        modp_ltoa10(v->valueLongLong, buf);
+                        break;
+                case SampleData_Int_Noarg:
+                case SampleData_Int:
+                        modp_itoa10(v->valueInt, buf);
+                        break;
+                default:
+                        modp_ftoa(v->valueFloat, buf, cd->cfg->precision);
+                        break;
+                }
+                csv += buf;
+        }
+
+        return csv + "\n";
+}
+
+static void fill_sample(const size_t ticks)
+{
+        clear_sample_populated(&sample);
+        sample.ticks = ticks;
+
+        for (size_t i = 0; i < sample.channel_count; ++i) {
+                /* Leave some gaps */
+                if (i % 3 == 2)
+                        continue;
+
+                switch (table.channels[i].sampleData) {
+                case SampleData_LongLong_Noarg:
+                        sample.values[i].valueLongLong = 1000000000000ll + i;
+                        break;
+                case SampleData_Int_Noarg:
+                case SampleData_Int:
+                        sample.values[i].valueInt = -(int) i;
+                        break;
+                default:
+                        sample.values[i].valueFloat = 1.5f * i;
+                        break;
+                }
+                set_sample_populated(&sample, i);
+        }
+}
+
+void BinaryLogTest::setUp()
+{
+        initialize_logger_config();
+        init_channel_table(&table, getWorkingLoggerConfig());
+        init_sample_buffer(&sample, &table);
+        binary_log_start(&writer, capture, false);
+        binary_log_start(&packed_writer, capture_packed, true);
+        output.clear();
+        packed.clear();
+}
+
+void BinaryLogTest::tearDown()
+{
+        free_sample_buffer(&sample);
+        free_channel_table(&table);
+}
+
+void BinaryLogTest::testRoundTrip()
+{
+        fill_sample(1);
+        CPPUNIT_ASSERT_EQUAL(0, binary_log_write_sample(&writer, &sample));
+        string expected = csv_header() + csv_row();
+        const size_t first_len = output.size();
+
+        fill_sample(3);
+        CPPUNIT_ASSERT_EQUAL(0, binary_log_write_sample(&writer, &sample));
+        expected += csv_row();
+
+        /* Only the populated values make it into the record */
+        size_t record_len = sizeof(uint16_t) +
+                sizeof(uint32_t[SAMPLE_BITMAP_WORDS(sample.channel_count)]);
+        for (size_t i = 0; i < sample.channel_count; ++i)
+                if (is_sample_populated(&sample, i))
+                        record_len += SampleData_LongLong_Noarg ==
+                                table.channels[i].sampleData ? 8 : 4;
+        CPPUNIT_ASSERT_EQUAL(record_len, output.size() - first_len);
+
+        string csv;
+        CPPUNIT_ASSERT_EQUAL(0, convert(output, csv));
+        CPPUNIT_ASSERT_EQUAL(expected, csv);
+}
+
+void BinaryLogTest::testLongDelta()
+{
+        fill_sample(0);
+        binary_log_write_sample(&writer, &sample);
+        fill_sample(1000000);
+        binary_log_write_sample(&writer, &sample);
+
+        string csv;
+        CPPUNIT_ASSERT_EQUAL(0, convert(output, csv));
+        CPPUNIT_ASSERT_EQUAL(csv_header() + csv_row() + csv_row(), csv);
+}
+
+void BinaryLogTest::testLayoutChange()
+{
+        fill_sample(1);
+        binary_log_write_sample(&writer, &sample);
+        const string first = csv_header() + csv_row();
+
+        /* Drop a channel, the next record must come with a new header */
+        table.channels[2].cfg->sampleRate = SAMPLE_DISABLED;
+        init_channel_table(&table, getWorkingLoggerConfig());
+        init_sample_buffer(&sample, &table);
+        fill_sample(2);
+        binary_log_write_sample(&writer, &sample);
+
+        string csv;
+        CPPUNIT_ASSERT_EQUAL(0, convert(output, csv));
+        CPPUNIT_ASSERT_EQUAL(first + csv_header() + csv_row(), csv);
+}
+
+void BinaryLogTest::testSegment()
+{
+        binary_log_segment(&writer, 0x12345678, 2);
+        fill_sample(1);
+        CPPUNIT_ASSERT_EQUAL(0, binary_log_write_sample(&writer, &sample));
+
+        const size_t fixed = BINARY_LOG_MAGIC_LEN + 2 + 2 + 2;
+        uint32_t session;
+        uint16_t part;
+        memcpy(&session, output.data() + fixed, sizeof(session));
+        memcpy(&part, output.data() + fixed + 4, sizeof(part));
+        CPPUNIT_ASSERT(output[BINARY_LOG_MAGIC_LEN + 1] &
+                       BINARY_LOG_FLAG_SEGMENT);
+        CPPUNIT_ASSERT_EQUAL((uint32_t) 0x12345678, session);
+        CPPUNIT_ASSERT_EQUAL((uint16_t) 2, part);
+
+        string csv;
+        CPPUNIT_ASSERT_EQUAL(0, convert(output, csv));
+        CPPUNIT_ASSERT_EQUAL(csv_header() + csv_row(), csv);
+}
+
+void BinaryLogTest::testBadInput()
+{
+        string csv;
+        CPPUNIT_ASSERT_EQUAL(-1, convert("Not a binary log", csv));
+        CPPUNIT_ASSERT_EQUAL(string(""), csv);
+
+        fill_sample(1);
+        binary_log_write_sample(&writer, &sample);
+        output.resize(output.size() - 1);
+        CPPUNIT_ASSERT_EQUAL(-1, convert(output, csv));
+        CPPUNIT_ASSERT_EQUAL(0, (int) csv.find(csv_header()));
+}
+
+void BinaryLogTest::testWriteError()
+{
+        binary_log_start(&writer, fail, false);
+        fill_sample(1);
+        CPPUNIT_ASSERT(0 != binary_log_write_sample(&writer, &sample));
+}
+
+void BinaryLogTest::testVarint()
+{
+        uint8_t buf[BINARY_LOG_VARINT_MAX];
+
+        CPPUNIT_ASSERT_EQUAL((size_t) 1, binary_log_put_varint(buf, 0x7f));
+        CPPUNIT_ASSERT_EQUAL((uint8_t) 0x7f, buf[0]);
+
+        CPPUNIT_ASSERT_EQUAL((size_t) 2, binary_log_put_varint(buf, 300));
+        CPPUNIT_ASSERT_EQUAL((uint8_t) 0xac, buf[0]);
+        CPPUNIT_ASSERT_EQUAL((uint8_t) 0x02, buf[1]);
+
+        CPPUNIT_ASSERT_EQUAL((size_t) BINARY_LOG_VARINT_MAX,
+                             binary_log_put_varint(buf, UINT64_MAX));
+
+        CPPUNIT_ASSERT_EQUAL((uint64_t) 0, binary_log_zigzag(0));
+        CPPUNIT_ASSERT_EQUAL((uint64_t) 1, binary_log_zigzag(-1));
+        CPPUNIT_ASSERT_EQUAL((uint64_t) 2, binary_log_zigzag(1));
+        CPPUNIT_ASSERT_EQUAL(UINT64_MAX, binary_log_zigzag(INT64_MIN));
+}
+
+void BinaryLogTest::testPackedRoundTrip()
+{
+        fill_sample(1);
+        CPPUNIT_ASSERT_EQUAL(0, binary_log_write_sample(&packed_writer,
+                                                        &sample));
+        const size_t first_len = packed.size();
+        string expected = csv_header() + csv_row();
+
+        /* Nothing changed so this is the code, bitmaps and no values */
+        fill_sample(3);
+        CPPUNIT_ASSERT_EQUAL(0, binary_log_write_sample(&packed_writer,
+                                                        &sample));
+        expected += csv_row();
+
+        size_t populated = 0;
+        for (size_t i = 0; i < sample.channel_count; ++i)
+                populated += is_sample_populated(&sample, i);
+
+        const size_t record_len = 1 + (sample.channel_count + 7) / 8 +
+                (populated + 7) / 8;
+        CPPUNIT_ASSERT_EQUAL(record_len, packed.size() - first_len);
+
+        string csv;
+        CPPUNIT_ASSERT_EQUAL(0, convert(packed, csv));
+        CPPUNIT_ASSERT_EQUAL(expected, csv);
+}
+
+void BinaryLogTest::testPackedLayoutChange()
+{
+        fill_sample(1);
+        binary_log_write_sample(&packed_writer, &sample);
+        const string first = csv_header() + csv_row();
+
+        table.channels[2].cfg->sampleRate = SAMPLE_DISABLED;
+        init_channel_table(&table, getWorkingLoggerConfig());
+        init_sample_buffer(&sample, &table);
+        fill_sample(2);
+        binary_log_write_sample(&packed_writer, &sample);
+
+        string csv;
+        CPPUNIT_ASSERT_EQUAL(0, convert(packed, csv));
+        CPPUNIT_ASSERT_EQUAL(first + csv_header() + csv_row(), csv);
+        CPPUNIT_ASSERT_EQUAL((size_t) 2, count_keyframes(packed));
+}
+
+/*
+ * Plays back something that looks like a session: counters that step
+ * now and then, slow drifting sensors and a few busy channels, with the
+ * slower channels only populated on some rows.
+ */
+void BinaryLogTest::testPackedSession()
+{
+        const size_t rows = 1000;
+        string csv;
+
+        for (size_t row = 0; row < rows; ++row) {
+                clear_sample_populated(&sample);
+                sample.ticks = row * 2;
+
+                for (size_t i = 0; i < sample.channel_count; ++i) {
+                        if (i % 4 == 3 && row % 10)
+                                continue;
+
+                        ChannelValue *v = sample.values + i;
+                        switch (table.channels[i].sampleData) {
+                        case SampleData_LongLong_Noarg:
+                                v->valueLongLong = 1460000000000ll + row * 10;
+                                break;
+                        case SampleData_Int_Noarg:
+                        case SampleData_Int:
+                                v->valueInt = row / 300;
+                                break;
+                        default:
+                                v->valueFloat = i % 5 ? 20.0f + i +
+                                        (row / 50) * 0.25f :
+                                        (float) ((row * 7 + i) % 13);
+                                break;
+                        }
+                        set_sample_populated(&sample, i);
+                }
+
+                CPPUNIT_ASSERT_EQUAL(0, binary_log_write_sample(&writer,
+                                                                &sample));
+                CPPUNIT_ASSERT_EQUAL(0, binary_log_write_sample(&packed_writer,
+                                                                &sample));
+                csv += (row ? "" : csv_header()) + csv_row();
+        }
+
+        string plain_csv;
+        string packed_csv;
+        CPPUNIT_ASSERT_EQUAL(0, convert(output, plain_csv));
+        CPPUNIT_ASSERT_EQUAL(0, convert(packed, packed_csv));
+        CPPUNIT_ASSERT_EQUAL(csv, plain_csv);
+        CPPUNIT_ASSERT_EQUAL(csv, packed_csv);
+
+        const size_t keyframes = (rows + BINARY_LOG_KEYFRAME_ROWS - 1) /
+                BINARY_LOG_KEYFRAME_ROWS;
+        CPPUNIT_ASSERT_EQUAL(keyframes, count_keyframes(packed));
+
+        /* Should be several times smaller than both other formats */
+        CPPUNIT_ASSERT(packed.size() * 3 < output.size());
+        CPPUNIT_ASSERT(packed.size() * 3 < csv.size());
+}
@@ -0,0 +1,59 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#ifndef BINARYLOG_TEST_H_
+#define BINARYLOG_TEST_H_
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class BinaryLogTest : public CppUnit::TestFixture
+{
+        CPPUNIT_TEST_SUITE( BinaryLogTest );
+        CPPUNIT_TEST( testRoundTrip );
+        CPPUNIT_TEST( testLongDelta );
+        CPPUNIT_TEST( testLayoutChange );
+        CPPUNIT_TEST( testSegment );
+        CPPUNIT_TEST( testBadInput );
+        CPPUNIT_TEST( testWriteError );
+        CPPUNIT_TEST( testVarint );
+        CPPUNIT_TEST( testPackedRoundTrip );
+        CPPUNIT_TEST( testPackedLayoutChange );
+        CPPUNIT_TEST( testPackedSession );
+        CPPUNIT_TEST_SUITE_END();
+
+public:
+        void setUp();
+        void tearDown();
+        void testRoundTrip();
+        void testLongDelta();
+        void testLayoutChange();
+        void testSegment();
+        void testBadInput();
+        void testWriteError();
+        void testVarint();
+        void testPackedRoundTrip();
+        void testPackedLayoutChange();
+        void testPackedSession();
+};
+
+#endif /* BINARYLOG_TEST_H_ */
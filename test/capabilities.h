@@ -101,6 +101,13 @@ CPP_GUARD_BEGIN
 
 //logging
 #define LOG_BUFFER_SIZE			1024
+#define PREROLL_BUFFER_SIZE		512
+#define LOG_FILE_BLOCK_SIZE		512
+#define LOG_FILE_BLOCKS			2
+#define LOG_INDEX_ENTRIES		16
+#define PREROLL_MAX_MS			1000
+#define LOG_PREALLOC_CHUNK		(1024 * 4)
+#define LOG_PREALLOC_MAX_MINUTES	60
 
 //system info
 #define DEVICE_NAME    "RCP_SIM"
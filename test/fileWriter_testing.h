@@ -31,6 +31,11 @@ int flush_logfile(struct logging_status *ls);
 int logging_stop(struct logging_status *ls);
 int logging_start(struct logging_status *ls);
 int logging_sample(struct logging_status *ls, LoggerMessage *msg);
+int get_log_file_index(const char *name);
+size_t get_log_data_rate(const struct sample *s, const unsigned char mode);
+bool init_file_writer(void);
+bool is_rotation_due(const struct logging_status *ls);
+void rotate_log_file(struct logging_status *ls, const struct sample *s);
 
 CPP_GUARD_END
 
@@ -27,10 +27,18 @@
 
 CPP_GUARD_BEGIN
 
-float get_analog_sample(int channelId);
-float get_timer_sample(int channelId);
-float get_pwm_sample(int channelId);
 float get_imu_sample(int channelId);
+float invalid_kernel(const ChannelDescriptor *cd);
+float analog_raw_kernel(const ChannelDescriptor *cd);
+float analog_linear_kernel(const ChannelDescriptor *cd);
+float analog_map_kernel(const ChannelDescriptor *cd);
+float timer_rpm_kernel(const ChannelDescriptor *cd);
+float timer_hz_kernel(const ChannelDescriptor *cd);
+float timer_ms_kernel(const ChannelDescriptor *cd);
+float timer_usec_kernel(const ChannelDescriptor *cd);
+float pwm_period_kernel(const ChannelDescriptor *cd);
+float pwm_duty_kernel(const ChannelDescriptor *cd);
+float pwm_volts_kernel(const ChannelDescriptor *cd);
 
 CPP_GUARD_END
 
@@ -0,0 +1,223 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include "jsonWriter.h"
+#include "jsonWriter_test.h"
+#include "mock_serial.h"
+
+#include <string>
+
+CPPUNIT_TEST_SUITE_REGISTRATION( JsonWriterTest );
+
+using std::string;
+
+static string tx(void)
+{
+        return string(mock_getTxBuffer(), mock_getTxLength());
+}
+
+void JsonWriterTest::setUp()
+{
+        setupMockSerial();
+        mock_resetTxBuffer();
+}
+
+void JsonWriterTest::testMembers()
+{
+        char buf[64];
+        struct json_writer w;
+
+        jw_init(&w, getMockSerial(), buf, sizeof(buf));
+        jw_obj_start(&w, NULL);
+        jw_int(&w, "i", -12);
+        jw_uint(&w, "u", 4000000000u);
+        jw_ll(&w, "ll", -5000000000LL);
+        jw_float(&w, "f", 1.25f, 2);
+        jw_double(&w, "d", 2.5, 1);
+        jw_string(&w, "s", "abc");
+        jw_string(&w, "n", NULL);
+        jw_null(&w, "z");
+        jw_obj_end(&w);
+        jw_flush(&w);
+
+        CPPUNIT_ASSERT_EQUAL(string("{\"i\":-12,\"u\":4000000000,"
+                                    "\"ll\":-5000000000,\"f\":1.25,"
+                                    "\"d\":2.5,\"s\":\"abc\",\"n\":null,"
+                                    "\"z\":null}"), tx());
+}
+
+void JsonWriterTest::testNesting()
+{
+        char buf[64];
+        struct json_writer w;
+
+        jw_init(&w, getMockSerial(), buf, sizeof(buf));
+        jw_obj_start(&w, NULL);
+        jw_obj_start(&w, "a");
+        jw_obj_start_int(&w, 3);
+        jw_int(&w, "x", 1);
+        jw_obj_end(&w);
+        jw_obj_start_int(&w, 4);
+        jw_obj_end(&w);
+        jw_obj_end(&w);
+        jw_array_start(&w, "b");
+        jw_int(&w, NULL, 1);
+        jw_array_start(&w, NULL);
+        jw_array_end(&w);
+        jw_obj_start(&w, NULL);
+        jw_int(&w, "y", 2);
+        jw_obj_end(&w);
+        jw_array_end(&w);
+        jw_int(&w, "c", 3);
+        jw_obj_end(&w);
+        CPPUNIT_ASSERT_EQUAL(0u, w.depth);
+        jw_close(&w);
+
+        CPPUNIT_ASSERT_EQUAL(string("{\"a\":{\"3\":{\"x\":1},\"4\":{}},"
+                                    "\"b\":[1,[],{\"y\":2}],\"c\":3}"),
+                             tx());
+}
+
+void JsonWriterTest::testEscapedString()
+{
+        char buf[64];
+        struct json_writer w;
+
+        jw_init(&w, getMockSerial(), buf, sizeof(buf));
+        jw_escaped_string(&w, "s", "say \"hi\"\r\nbye");
+        jw_escaped_string(&w, "e", "");
+        jw_flush(&w);
+
+        CPPUNIT_ASSERT_EQUAL(string("\"s\":\"say \\\"hi\\\"\\r\\nbye\","
+                                    "\"e\":\"\""), tx());
+}
+
+/* What api_getLogfile does to stream the log straight to the serial */
+void JsonWriterTest::testRawValue()
+{
+        char buf[64];
+        struct json_writer w;
+
+        jw_init(&w, getMockSerial(), buf, sizeof(buf));
+        jw_obj_start(&w, NULL);
+        jw_int(&w, "a", 1);
+        jw_key(&w, "log");
+        jw_raw(&w, "\"", 1);
+        jw_flush(&w);
+        getMockSerial()->put_s("text");
+        jw_raw(&w, "\"", 1);
+        jw_obj_end(&w);
+        jw_flush(&w);
+
+        CPPUNIT_ASSERT_EQUAL(string("{\"a\":1,\"log\":\"text\"}"), tx());
+}
+
+void JsonWriterTest::testBuffering()
+{
+        char buf[16];
+        struct json_writer w;
+
+        jw_init(&w, getMockSerial(), buf, sizeof(buf));
+        jw_array_start(&w, NULL);
+        for (int i = 0; i < 100; ++i)
+                jw_int(&w, NULL, i);
+        jw_array_end(&w);
+
+        /* Only ever whole buffers until the flush */
+        CPPUNIT_ASSERT(mock_getTxCalls() > 0);
+        CPPUNIT_ASSERT(mock_getTxLength() > mock_getTxCalls() * 12);
+
+        jw_flush(&w);
+        string expected("[");
+        for (int i = 0; i < 100; ++i) {
+                if (i)
+                        expected += ",";
+                expected += std::to_string(i);
+        }
+        expected += "]";
+        CPPUNIT_ASSERT_EQUAL(expected, tx());
+
+        /* Nothing left to send */
+        const size_t calls = mock_getTxCalls();
+        jw_flush(&w);
+        CPPUNIT_ASSERT_EQUAL(calls, mock_getTxCalls());
+}
+
+void JsonWriterTest::testOversizeWrite()
+{
+        char buf[8];
+        struct json_writer w;
+        const string big(40, 'x');
+
+        jw_init(&w, getMockSerial(), buf, sizeof(buf));
+        jw_int(&w, "a", 1);
+        jw_string(&w, "b", big.c_str());
+        jw_flush(&w);
+
+        CPPUNIT_ASSERT_EQUAL("\"a\":1,\"b\":\"" + big + "\"", tx());
+}
+
+void JsonWriterTest::testUnbuffered()
+{
+        struct json_writer w;
+
+        jw_init(&w, getMockSerial(), NULL, 0);
+        jw_obj_start(&w, NULL);
+        jw_int(&w, "a", 1);
+
+        /* Goes out as it is written */
+        CPPUNIT_ASSERT_EQUAL(string("{\"a\":1"), tx());
+
+        jw_obj_end(&w);
+        jw_close(&w);
+        CPPUNIT_ASSERT_EQUAL(string("{\"a\":1}"), tx());
+}
+
+void JsonWriterTest::testPool()
+{
+        struct json_writer w[JSON_WRITER_POOL_SIZE + 1];
+
+        for (int i = 0; i < JSON_WRITER_POOL_SIZE; ++i) {
+                jw_open(&w[i], getMockSerial());
+                CPPUNIT_ASSERT_EQUAL(i, w[i].pool_slot);
+                CPPUNIT_ASSERT_EQUAL((size_t) JSON_WRITER_BUFFER_SIZE,
+                                     w[i].size);
+        }
+
+        /* Pool is dry, so the next one falls back to unbuffered */
+        jw_open(&w[JSON_WRITER_POOL_SIZE], getMockSerial());
+        CPPUNIT_ASSERT_EQUAL(-1, w[JSON_WRITER_POOL_SIZE].pool_slot);
+        CPPUNIT_ASSERT_EQUAL((size_t) 0, w[JSON_WRITER_POOL_SIZE].size);
+        jw_int(&w[JSON_WRITER_POOL_SIZE], "a", 1);
+        jw_close(&w[JSON_WRITER_POOL_SIZE]);
+        CPPUNIT_ASSERT_EQUAL(string("\"a\":1"), tx());
+
+        jw_close(&w[0]);
+        struct json_writer again;
+        jw_open(&again, getMockSerial());
+        CPPUNIT_ASSERT_EQUAL(0, again.pool_slot);
+        jw_close(&again);
+
+        for (int i = 1; i < JSON_WRITER_POOL_SIZE; ++i)
+                jw_close(&w[i]);
+}
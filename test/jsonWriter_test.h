@@ -0,0 +1,54 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#ifndef JSONWRITER_TEST_H_
+#define JSONWRITER_TEST_H_
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class JsonWriterTest : public CppUnit::TestFixture
+{
+        CPPUNIT_TEST_SUITE( JsonWriterTest );
+        CPPUNIT_TEST( testMembers );
+        CPPUNIT_TEST( testNesting );
+        CPPUNIT_TEST( testEscapedString );
+        CPPUNIT_TEST( testRawValue );
+        CPPUNIT_TEST( testBuffering );
+        CPPUNIT_TEST( testOversizeWrite );
+        CPPUNIT_TEST( testUnbuffered );
+        CPPUNIT_TEST( testPool );
+        CPPUNIT_TEST_SUITE_END();
+
+public:
+        void setUp();
+        void testMembers();
+        void testNesting();
+        void testEscapedString();
+        void testRawValue();
+        void testBuffering();
+        void testOversizeWrite();
+        void testUnbuffered();
+        void testPool();
+};
+
+#endif /* JSONWRITER_TEST_H_ */
@@ -0,0 +1,142 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include "logIndex.h"
+#include "logIndex_test.h"
+#include "mem_mang.h"
+#include "mod_string.h"
+
+#include <string>
+
+CPPUNIT_TEST_SUITE_REGISTRATION( LogIndexTest );
+
+#define CAPACITY	8
+
+static struct log_index li;
+static std::string written;
+
+static int capture(const void *data, const size_t len)
+{
+        written.append((const char *) data, len);
+        return 0;
+}
+
+/* Feeds the index rows of 10 bytes, one tick apart */
+static void add_rows(const size_t first, const size_t count, const int lap)
+{
+        for (size_t i = first; i < first + count; ++i)
+                log_index_row(&li, i * 10, i, lap);
+}
+
+void LogIndexTest::setUp()
+{
+        init_log_index(&li, CAPACITY);
+        written.clear();
+}
+
+void LogIndexTest::tearDown()
+{
+        portFree(li.entries);
+}
+
+void LogIndexTest::testPeriodic()
+{
+        add_rows(0, LOG_INDEX_INTERVAL * 3, 0);
+
+        CPPUNIT_ASSERT_EQUAL((size_t) 3, li.count);
+
+        for (size_t i = 0; i < li.count; ++i) {
+                CPPUNIT_ASSERT_EQUAL((uint16_t) LOG_INDEX_FLAG_PERIODIC,
+                                     li.entries[i].flags);
+
+                const uint32_t row = i * LOG_INDEX_INTERVAL;
+                CPPUNIT_ASSERT_EQUAL(row * 10, li.entries[i].offset);
+                CPPUNIT_ASSERT_EQUAL(row, li.entries[i].ticks);
+        }
+}
+
+void LogIndexTest::testLaps()
+{
+        add_rows(0, 10, 0);
+        CPPUNIT_ASSERT(log_index_row(&li, 100, 10, 1));
+        add_rows(11, 10, 1);
+
+        CPPUNIT_ASSERT_EQUAL((size_t) 2, li.count);
+        CPPUNIT_ASSERT_EQUAL((uint16_t) 1, li.entries[1].lap);
+        CPPUNIT_ASSERT_EQUAL((uint32_t) 100, li.entries[1].offset);
+        CPPUNIT_ASSERT_EQUAL((uint16_t) LOG_INDEX_FLAG_LAP,
+                             li.entries[1].flags);
+}
+
+void LogIndexTest::testThinning()
+{
+        /* Lap entries in amongst the periodic ones must survive */
+        add_rows(0, LOG_INDEX_INTERVAL * 3, 0);
+        add_rows(LOG_INDEX_INTERVAL * 3, LOG_INDEX_INTERVAL + 1, 1);
+        add_rows(LOG_INDEX_INTERVAL * 4 + 1, LOG_INDEX_INTERVAL * 8, 2);
+        CPPUNIT_ASSERT(li.count <= CAPACITY);
+        CPPUNIT_ASSERT(li.interval > LOG_INDEX_INTERVAL);
+
+        int laps = 0;
+        for (size_t i = 0; i < li.count; ++i) {
+                const struct log_index_entry *e = li.entries + i;
+
+                if (e->flags & LOG_INDEX_FLAG_LAP)
+                        ++laps;
+
+                /* Periodic entries are on the new interval */
+                if (e->flags & LOG_INDEX_FLAG_PERIODIC)
+                        CPPUNIT_ASSERT_EQUAL((uint32_t) 0,
+                                             e->ticks % li.interval);
+        }
+        CPPUNIT_ASSERT_EQUAL(2, laps);
+}
+
+void LogIndexTest::testWrite()
+{
+        add_rows(0, LOG_INDEX_INTERVAL + 1, 0);
+        li.session = 0xdeadbeef;
+        li.part = 3;
+        CPPUNIT_ASSERT_EQUAL(0, write_log_index(&li, capture));
+
+        const size_t header = LOG_INDEX_MAGIC_LEN + 2 + 4 + 4 + 4 + 2;
+        CPPUNIT_ASSERT_EQUAL(header + 2 * sizeof(struct log_index_entry),
+                             written.size());
+        CPPUNIT_ASSERT_EQUAL(std::string(LOG_INDEX_MAGIC),
+                             written.substr(0, LOG_INDEX_MAGIC_LEN));
+
+        uint32_t count;
+        memcpy(&count, written.data() + header - 10, sizeof(count));
+        CPPUNIT_ASSERT_EQUAL((uint32_t) 2, count);
+
+        uint32_t session;
+        uint16_t part;
+        memcpy(&session, written.data() + header - 6, sizeof(session));
+        memcpy(&part, written.data() + header - 2, sizeof(part));
+        CPPUNIT_ASSERT_EQUAL((uint32_t) 0xdeadbeef, session);
+        CPPUNIT_ASSERT_EQUAL((uint16_t) 3, part);
+
+        struct log_index_entry e;
+        memcpy(&e, written.data() + header + sizeof(e), sizeof(e));
+        CPPUNIT_ASSERT_EQUAL((uint32_t) LOG_INDEX_INTERVAL * 10, e.offset);
+}
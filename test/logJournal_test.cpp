@@ -0,0 +1,227 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "logJournal.h"
+#include "logJournal_test.h"
+#include "mod_string.h"
+#include "rcj2log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+
+CPPUNIT_TEST_SUITE_REGISTRATION( LogJournalTest );
+
+#define SESSION	0x1234abcd
+
+static struct log_journal journal;
+static std::string file;
+
+static int capture(const void *data, const size_t len)
+{
+        file.append((const char *) data, len);
+        return 0;
+}
+
+static bool read_frame(const size_t index, struct log_journal_frame *frame)
+{
+        const size_t offset = index * LOG_JOURNAL_FRAME_SIZE;
+        if (offset + LOG_JOURNAL_FRAME_SIZE > file.size())
+                return false;
+
+        memcpy(frame, file.data() + offset, LOG_JOURNAL_FRAME_SIZE);
+        return true;
+}
+
+static const struct log_journal_frame* get_frame(const size_t index)
+{
+        return (const struct log_journal_frame *)
+                (file.data() + index * LOG_JOURNAL_FRAME_SIZE);
+}
+
+static size_t valid_frames(void)
+{
+        struct log_journal_frame scratch;
+        return log_journal_valid_frames(read_frame, file.size() /
+                                        LOG_JOURNAL_FRAME_SIZE, &scratch);
+}
+
+/* Journals the given number of full frames worth of data */
+static void write_frames(const size_t count)
+{
+        char data[LOG_JOURNAL_PAYLOAD];
+
+        for (size_t i = 0; i < count; ++i) {
+                memset(data, 'a' + i % 26, sizeof(data));
+                CPPUNIT_ASSERT_EQUAL(0, log_journal_append(&journal, data,
+                                                           sizeof(data)));
+        }
+}
+
+void LogJournalTest::setUp()
+{
+        file.clear();
+        log_journal_start(&journal, capture, SESSION);
+}
+
+void LogJournalTest::testFrameSize()
+{
+        CPPUNIT_ASSERT_EQUAL((size_t) LOG_JOURNAL_FRAME_SIZE,
+                             sizeof(struct log_journal_frame));
+        CPPUNIT_ASSERT_EQUAL((size_t) LOG_JOURNAL_HEADER_SIZE,
+                             offsetof(struct log_journal_frame, payload));
+}
+
+void LogJournalTest::testFraming()
+{
+        const std::string data(LOG_JOURNAL_PAYLOAD + 100, 'x');
+
+        log_journal_append(&journal, data.data(), data.size());
+
+        /* Only the full frame goes out, the rest waits for more */
+        CPPUNIT_ASSERT_EQUAL((size_t) LOG_JOURNAL_FRAME_SIZE, file.size());
+        CPPUNIT_ASSERT_EQUAL((uint32_t) data.size(), journal.bytes);
+
+        const struct log_journal_frame *f = get_frame(0);
+        CPPUNIT_ASSERT_EQUAL(0, strncmp(f->magic, LOG_JOURNAL_MAGIC,
+                                        LOG_JOURNAL_MAGIC_LEN));
+        CPPUNIT_ASSERT_EQUAL((uint16_t) LOG_JOURNAL_PAYLOAD, f->len);
+        CPPUNIT_ASSERT_EQUAL((uint32_t) SESSION, f->session);
+        CPPUNIT_ASSERT_EQUAL((uint32_t) 0, f->seq);
+        CPPUNIT_ASSERT(log_journal_frame_valid(f, SESSION, 0));
+        CPPUNIT_ASSERT(!log_journal_frame_valid(f, SESSION, 1));
+        CPPUNIT_ASSERT(!log_journal_frame_valid(f, SESSION + 1, 0));
+}
+
+void LogJournalTest::testFlush()
+{
+        CPPUNIT_ASSERT_EQUAL(0, log_journal_flush(&journal));
+        CPPUNIT_ASSERT(file.empty());
+
+        log_journal_append(&journal, "hello", 5);
+        CPPUNIT_ASSERT_EQUAL(0, log_journal_flush(&journal));
+        log_journal_append(&journal, "world", 5);
+        log_journal_flush(&journal);
+
+        CPPUNIT_ASSERT_EQUAL((size_t) 2 * LOG_JOURNAL_FRAME_SIZE,
+                             file.size());
+
+        const struct log_journal_frame *f = get_frame(1);
+        CPPUNIT_ASSERT_EQUAL((uint16_t) 5, f->len);
+        CPPUNIT_ASSERT_EQUAL((uint32_t) 1, f->seq);
+        CPPUNIT_ASSERT_EQUAL(0, strncmp((const char *) f->payload, "world", 5));
+        CPPUNIT_ASSERT_EQUAL((uint8_t) 0, f->payload[5]);
+        CPPUNIT_ASSERT(log_journal_frame_valid(f, SESSION, 1));
+
+        /* Carrying on after a reopen picks up the sequence */
+        log_journal_resume(&journal, 2);
+        log_journal_append(&journal, "again", 5);
+        log_journal_flush(&journal);
+        CPPUNIT_ASSERT(log_journal_frame_valid(get_frame(2), SESSION, 2));
+        CPPUNIT_ASSERT_EQUAL((size_t) 3, valid_frames());
+}
+
+void LogJournalTest::testValidClean()
+{
+        for (size_t frames = 1; frames < 12; ++frames) {
+                setUp();
+                write_frames(frames);
+                CPPUNIT_ASSERT_EQUAL(frames, valid_frames());
+        }
+}
+
+void LogJournalTest::testValidTornTail()
+{
+        for (size_t frames = 1; frames < 12; ++frames) {
+                setUp();
+                write_frames(frames);
+
+                /* Half a frame made it, then pre-allocated zeros */
+                const std::string good = file;
+                file[file.size() - 100] ^= 0xff;
+                CPPUNIT_ASSERT_EQUAL(frames - 1, valid_frames());
+
+                file = good;
+                file.append(LOG_JOURNAL_FRAME_SIZE * 5, '\0');
+                CPPUNIT_ASSERT_EQUAL(frames, valid_frames());
+        }
+}
+
+void LogJournalTest::testValidStaleTail()
+{
+        /* An older log left intact frames in the clusters we reused */
+        write_frames(10);
+        const std::string stale = file;
+
+        setUp();
+        log_journal_start(&journal, capture, SESSION + 1);
+        write_frames(3);
+        file.append(stale, file.size(), std::string::npos);
+
+        CPPUNIT_ASSERT_EQUAL((size_t) 10 * LOG_JOURNAL_FRAME_SIZE,
+                             file.size());
+        CPPUNIT_ASSERT_EQUAL((size_t) 3, valid_frames());
+}
+
+void LogJournalTest::testValidEmpty()
+{
+        CPPUNIT_ASSERT_EQUAL((size_t) 0, valid_frames());
+
+        file.assign(LOG_JOURNAL_FRAME_SIZE * 4, '\0');
+        CPPUNIT_ASSERT_EQUAL((size_t) 0, valid_frames());
+}
+
+static int unwrap(std::string &out)
+{
+        char *buf = NULL;
+        size_t size = 0;
+        FILE *fin = fmemopen((void *) file.data(), file.size(), "rb");
+        FILE *fout = open_memstream(&buf, &size);
+
+        const int rc = rcj2log(fin, fout);
+        fclose(fin);
+        fclose(fout);
+
+        out = std::string(buf, size);
+        free(buf);
+        return rc;
+}
+
+void LogJournalTest::testUnwrap()
+{
+        const std::string data(LOG_JOURNAL_PAYLOAD * 2, 'y');
+        std::string out;
+
+        log_journal_append(&journal, "head,", 5);
+        log_journal_flush(&journal);
+        log_journal_append(&journal, data.data(), data.size());
+        log_journal_flush(&journal);
+
+        CPPUNIT_ASSERT_EQUAL(0, unwrap(out));
+        CPPUNIT_ASSERT_EQUAL(std::string("head,") + data, out);
+
+        /* A torn last frame is dropped along with what is in it */
+        file.resize(file.size() - 10);
+        CPPUNIT_ASSERT_EQUAL(-1, unwrap(out));
+        CPPUNIT_ASSERT_EQUAL(std::string("head,") +
+                             data.substr(0, LOG_JOURNAL_PAYLOAD), out);
+}
@@ -0,0 +1,55 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+
+#ifndef LOGJOURNAL_TEST_H_
+#define LOGJOURNAL_TEST_H_
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class LogJournalTest : public CppUnit::TestFixture
+{
+        CPPUNIT_TEST_SUITE( LogJournalTest );
+        CPPUNIT_TEST( testFrameSize );
+        CPPUNIT_TEST( testFraming );
+        CPPUNIT_TEST( testFlush );
+        CPPUNIT_TEST( testValidClean );
+        CPPUNIT_TEST( testValidTornTail );
+        CPPUNIT_TEST( testValidStaleTail );
+        CPPUNIT_TEST( testValidEmpty );
+        CPPUNIT_TEST( testUnwrap );
+        CPPUNIT_TEST_SUITE_END();
+
+public:
+        void setUp();
+        void testFrameSize();
+        void testFraming();
+        void testFlush();
+        void testValidClean();
+        void testValidTornTail();
+        void testValidStaleTail();
+        void testValidEmpty();
+        void testUnwrap();
+};
+
+#endif /* LOGJOURNAL_TEST_H_ */
@@ -33,6 +33,7 @@
 #include "modp_atonum.h"
 #include "memory_mock.h"
 #include "printk.h"
+#include <ctime>
 #include <string>
 #include <fstream>
 #include <streambuf>
@@ -45,6 +46,10 @@
 #include "logger.h"
 #include "lap_stats.h"
 #include "launch_control.h"
+#include "loggerTiming.h"
+#include "sdStats.h"
+#include "telemetryFrame.h"
+#include "telemetryRate.h"
 #include "task.h"
 #include "task_testing.h"
 
@@ -1320,6 +1325,8 @@ void LoggerApiTest::testGetStatus(){
         lc_reset();
         lapStats_init();
 
+    telemetry_rate_init_all(SAMPLE_10Hz, MIN_TELEMETRY_SAMPLE_RATE);
+
     char * response = processApiGeneric("getStatus1.json");
 
     Object json;
@@ -1356,4 +1363,134 @@ void LoggerApiTest::testGetStatus(){
 
     CPPUNIT_ASSERT_EQUAL((int)TELEMETRY_STATUS_IDLE, (int)(Number)json["status"]["telemetry"]["status"]);
     CPPUNIT_ASSERT_EQUAL(0, (int)(Number)json["status"]["telemetry"]["started"]);
+
+    CPPUNIT_ASSERT_EQUAL(0, (int)(Number)json["status"]["pipeline"]["file"]["q_fail"]);
+    CPPUNIT_ASSERT_EQUAL(0, (int)(Number)json["status"]["pipeline"]["telem0"]["overrun"]);
+    CPPUNIT_ASSERT_EQUAL(0, (int)(Number)json["status"]["pipeline"]["telem1"]["lat_max"]);
+    CPPUNIT_ASSERT_EQUAL(10, (int)(Number)json["status"]["pipeline"]["telem0"]["rate"]);
+}
+
+void LoggerApiTest::testGetTiming(){
+    logger_timing_reset();
+    struct timing_histogram *h = (struct timing_histogram *)
+            get_logger_timing_histogram(TIMING_SAMPLE_DURATION);
+    timing_histogram_add(h, 3);
+    timing_histogram_add(h, 5);
+
+    char * response = processApiGeneric("getTiming1.json");
+
+    Object json;
+    stringToJson(response, json);
+
+    Object &sd = json["timing"]["sampleDuration"];
+    CPPUNIT_ASSERT_EQUAL(2, (int)(Number)sd["count"]);
+    CPPUNIT_ASSERT_EQUAL(5, (int)(Number)sd["max"]);
+    CPPUNIT_ASSERT_EQUAL(4, (int)(Number)sd["avg"]);
+
+    Array &hist = sd["hist"];
+    CPPUNIT_ASSERT_EQUAL(TIMING_HISTOGRAM_BUCKETS, (int) hist.Size());
+    CPPUNIT_ASSERT_EQUAL(1, (int)(Number)hist[2]);
+    CPPUNIT_ASSERT_EQUAL(1, (int)(Number)hist[3]);
+
+    CPPUNIT_ASSERT_EQUAL(0, (int)(Number)json["timing"]["tickToSample"]["count"]);
+}
+
+void LoggerApiTest::testResetTiming(){
+    struct timing_histogram *h = (struct timing_histogram *)
+            get_logger_timing_histogram(TIMING_TICK_TO_SAMPLE);
+    timing_histogram_add(h, 1);
+
+    string json = readFile("resetTiming1.json");
+    mock_resetTxBuffer();
+    process_api(getMockSerial(), (char *)json.c_str(), json.size());
+    assertGenericResponse(mock_getTxBuffer(), "resetTiming", 1);
+
+    CPPUNIT_ASSERT_EQUAL(0u, h->count);
+}
+
+void LoggerApiTest::testGetSdStats(){
+    sd_stats_reset();
+    sd_stats_write(sd_stats_start(), 512, true);
+    sd_stats_remount();
+    sd_stats_queue_depth(4);
+
+    char * response = processApiGeneric("getSdStats1.json");
+
+    Object json;
+    stringToJson(response, json);
+
+    Object &ss = json["sdStats"];
+    CPPUNIT_ASSERT_EQUAL(1, (int)(Number)ss["write"]["count"]);
+    CPPUNIT_ASSERT_EQUAL(TIMING_HISTOGRAM_BUCKETS,
+                         (int)((Array &) ss["sync"]["hist"]).Size());
+    CPPUNIT_ASSERT_EQUAL(512, (int)(Number)ss["bytes"]);
+    CPPUNIT_ASSERT_EQUAL(0, (int)(Number)ss["errors"]);
+    CPPUNIT_ASSERT_EQUAL(1, (int)(Number)ss["remounts"]);
+    CPPUNIT_ASSERT_EQUAL(4, (int)(Number)ss["q_max"]);
+}
+
+void LoggerApiTest::testResetSdStats(){
+    sd_stats_remount();
+
+    string json = readFile("resetSdStats1.json");
+    mock_resetTxBuffer();
+    process_api(getMockSerial(), (char *)json.c_str(), json.size());
+    assertGenericResponse(mock_getTxBuffer(), "resetSdStats", 1);
+
+    CPPUNIT_ASSERT_EQUAL(0u, get_sd_stats()->remounts);
+}
+
+void LoggerApiTest::testSetStreamFormat(){
+    string json = readFile("setStreamFmt1.json");
+    mock_resetTxBuffer();
+    process_api(getMockSerial(), (char *)json.c_str(), json.size());
+    assertGenericResponse(mock_getTxBuffer(), "setStreamFmt", API_SUCCESS);
+    CPPUNIT_ASSERT_EQUAL(TELEMETRY_FORMAT_BINARY,
+                         telemetry_get_format(getMockSerial()));
+
+    json = readFile("setStreamFmt2.json");
+    mock_resetTxBuffer();
+    process_api(getMockSerial(), (char *)json.c_str(), json.size());
+    assertGenericResponse(mock_getTxBuffer(), "setStreamFmt",
+                          API_ERROR_PARAMETER);
+    CPPUNIT_ASSERT_EQUAL(TELEMETRY_FORMAT_BINARY,
+                         telemetry_get_format(getMockSerial()));
+
+    telemetry_set_format(getMockSerial(), TELEMETRY_FORMAT_JSON);
+}
+
+#define BENCH_ROUNDS 2000
+
+/*
+ * Not a pass/fail test, just numbers to watch: how many of the heavier
+ * responses the API can put out per second on the mock serial, and how
+ * many serial calls each one takes.
+ */
+void LoggerApiTest::testApiBenchmark(){
+    const char *files[] = {"getAnalogCfg3.json", "getStatus1.json",
+                           "getTrackDb1.json"};
+
+    printf("\n");
+    for (size_t f = 0; f < sizeof(files) / sizeof(files[0]); f++) {
+        const string json = readFile(files[f]);
+        size_t calls = 0;
+        size_t bytes = 0;
+
+        clock_t start = clock();
+        for (int r = 0; r < BENCH_ROUNDS; r++) {
+            /* The parser writes into the request, so use a fresh copy */
+            string request = json;
+            mock_resetTxBuffer();
+            process_api(getMockSerial(), &request[0], request.size());
+            calls = mock_getTxCalls();
+            bytes = mock_getTxLength();
+        }
+        const clock_t ticks = clock() - start;
+
+        printf("%s %.0f responses/s, %zu bytes in %zu serial calls\n",
+               files[f], BENCH_ROUNDS * (double) CLOCKS_PER_SEC / ticks,
+               bytes, calls);
+
+        CPPUNIT_ASSERT(bytes > calls * 32);
+    }
 }
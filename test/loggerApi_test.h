@@ -77,6 +77,12 @@ class LoggerApiTest : public CppUnit::TestFixture
     CPPUNIT_TEST( testRunScript);
     CPPUNIT_TEST( testGetVersion);
     CPPUNIT_TEST( testGetStatus);
+    CPPUNIT_TEST( testGetTiming);
+    CPPUNIT_TEST( testResetTiming);
+    CPPUNIT_TEST( testGetSdStats);
+    CPPUNIT_TEST( testResetSdStats);
+    CPPUNIT_TEST( testSetStreamFormat);
+    CPPUNIT_TEST( testApiBenchmark);
     CPPUNIT_TEST( testGetCapabilities);
     CPPUNIT_TEST_SUITE_END();
 
@@ -132,6 +138,12 @@ public:
     void testRunScript();
     void testGetVersion();
     void testGetStatus();
+    void testGetTiming();
+    void testResetTiming();
+    void testGetSdStats();
+    void testResetSdStats();
+    void testSetStreamFormat();
+    void testApiBenchmark();
     void testGetCapabilities();
 
 private:
@@ -20,12 +20,16 @@
 
 #include "loggerFileWriterTest.hh"
 #include "FreeRTOS.h"
+#include "capabilities.h"
 #include "fileWriter.h"
 #include "fileWriter_testing.h"
 #include "mod_string.h"
+#include "pipelineStats.h"
+#include "sdStats.h"
 #include "task.h"
 #include "task_testing.h"
 
+#include <limits.h>
 #include <stdio.h>
 #include <string>
 
@@ -39,6 +43,10 @@ void LoggerFileWriterTest::setUp()
 {
         _ls = (struct logging_status) { 0 };
         ls = &_ls;
+        init_file_writer();
+        pipeline_stats_reset();
+        sd_stats_reset();
+        set_ticks(0);
 }
 
 void LoggerFileWriterTest::tearDown() {}
@@ -65,15 +73,73 @@ void LoggerFileWriterTest::testFlushLogfile()
         rc = flush_logfile(ls);
         CPPUNIT_ASSERT_EQUAL(0, rc);
         CPPUNIT_ASSERT_EQUAL(xTaskGetTickCount(), ls->flush_tick);
+        CPPUNIT_ASSERT_EQUAL(1u, get_sd_stats()->sync.count);
+}
+
+void LoggerFileWriterTest::testLossBudget()
+{
+        ls->writing_status = WRITING_ACTIVE;
+        ls->flush_tick = 0;
+        set_logfile_loss_budget(400);
+
+        /* Samples take 100ms to get to us, so we sync 100ms sooner */
+        set_ticks(100 / portTICK_RATE_MS);
+        pipeline_stats_latency(PIPELINE_CONSUMER_FILE, 0);
+
+        set_ticks(300 / portTICK_RATE_MS - 1);
+        CPPUNIT_ASSERT_EQUAL(-2, flush_logfile(ls));
+        set_ticks(300 / portTICK_RATE_MS);
+        CPPUNIT_ASSERT_EQUAL(0, flush_logfile(ls));
+
+        /* But never more often than every half a budget */
+        pipeline_stats_reset();
+        ls->flush_tick = 0;
+        set_ticks(1000 / portTICK_RATE_MS);
+        pipeline_stats_latency(PIPELINE_CONSUMER_FILE, 0);
+
+        set_ticks(200 / portTICK_RATE_MS - 1);
+        CPPUNIT_ASSERT_EQUAL(-2, flush_logfile(ls));
+        set_ticks(200 / portTICK_RATE_MS);
+        CPPUNIT_ASSERT_EQUAL(0, flush_logfile(ls));
+
+        set_logfile_loss_budget(FLUSH_INTERVAL_MS);
 }
 
 void LoggerFileWriterTest::testLoggingStart()
 {
         ls->logging = false;
         ls->rows_written = 1;
+        set_logfile_prealloc(30);
+        set_logfile_journal(true);
         logging_start(ls);
+        set_logfile_prealloc(0);
+        set_logfile_journal(false);
         CPPUNIT_ASSERT_EQUAL(true, ls->logging);
         CPPUNIT_ASSERT_EQUAL((unsigned int) 0, ls->rows_written);
+        CPPUNIT_ASSERT_EQUAL((unsigned int) 30, ls->prealloc);
+        CPPUNIT_ASSERT_EQUAL(true, ls->journal);
+
+        /* Plain logs can't be recovered, so they don't pre-allocate */
+        set_logfile_prealloc(30);
+        logging_start(ls);
+        set_logfile_prealloc(0);
+        CPPUNIT_ASSERT_EQUAL((unsigned int) 0, ls->prealloc);
+        CPPUNIT_ASSERT_EQUAL(false, ls->journal);
+}
+
+void LoggerFileWriterTest::testPreallocLimit()
+{
+        set_logfile_prealloc(LOG_PREALLOC_MAX_MINUTES);
+        CPPUNIT_ASSERT_EQUAL((unsigned int) LOG_PREALLOC_MAX_MINUTES,
+                             get_logfile_prealloc());
+
+        /* Anything more would take too long to reserve */
+        set_logfile_prealloc(UINT_MAX);
+        CPPUNIT_ASSERT_EQUAL((unsigned int) LOG_PREALLOC_MAX_MINUTES,
+                             get_logfile_prealloc());
+
+        set_logfile_prealloc(0);
+        CPPUNIT_ASSERT_EQUAL((unsigned int) 0, get_logfile_prealloc());
 }
 
 void LoggerFileWriterTest::testLoggingStop()
@@ -92,6 +158,98 @@ void LoggerFileWriterTest::testLoggingSampleSkip()
         CPPUNIT_ASSERT_EQUAL(0, rc);
 }
 
+void LoggerFileWriterTest::testLogDataRate()
+{
+        ChannelConfig cfgs[2];
+        memset(cfgs, 0, sizeof(cfgs));
+        cfgs[0].sampleRate = SAMPLE_50Hz;
+        cfgs[0].precision = 2;
+        cfgs[1].sampleRate = SAMPLE_10Hz;
+        cfgs[1].precision = 6;
+
+        ChannelDescriptor cds[2];
+        memset(cds, 0, sizeof(cds));
+        cds[0].cfg = &cfgs[0];
+        cds[0].sampleData = SampleData_Float;
+        cds[1].cfg = &cfgs[1];
+        cds[1].sampleData = SampleData_Double;
+
+        struct channel_table table;
+        memset(&table, 0, sizeof(table));
+        table.channel_count = 2;
+        table.channels = cds;
+
+        struct sample s;
+        memset(&s, 0, sizeof(s));
+        s.channel_count = 2;
+        s.table = &table;
+
+        /* Values plus a comma per channel per row at the fastest rate */
+        CPPUNIT_ASSERT_EQUAL((size_t) 50 * 8 + 10 * 12 + 50 * 2,
+                             get_log_data_rate(&s, SD_LOGGING_MODE_CSV));
+
+        /* Values plus the delta and bitmap per row */
+        CPPUNIT_ASSERT_EQUAL((size_t) 50 * 4 + 10 * 8 + 50 * 3,
+                             get_log_data_rate(&s, SD_LOGGING_MODE_BINARY));
+}
+
+void LoggerFileWriterTest::testLogFileIndex()
+{
+        CPPUNIT_ASSERT_EQUAL(0, get_log_file_index("rc_0.log"));
+        CPPUNIT_ASSERT_EQUAL(123, get_log_file_index("RC_123.LOG"));
+        CPPUNIT_ASSERT_EQUAL(42, get_log_file_index("RC_42.RCB"));
+
+        CPPUNIT_ASSERT_EQUAL(-1, get_log_file_index("rc_.log"));
+        CPPUNIT_ASSERT_EQUAL(-1, get_log_file_index("rc_12"));
+        CPPUNIT_ASSERT_EQUAL(-1, get_log_file_index("rc_1a.log"));
+        CPPUNIT_ASSERT_EQUAL(-1, get_log_file_index("TEST1.TXT"));
+        CPPUNIT_ASSERT_EQUAL(-1, get_log_file_index("RC_999999.LOG"));
+}
+
 /*
  * TODO: Build in tests for file open and close methods.
  */
+
+void LoggerFileWriterTest::testRotationDue()
+{
+        ls->writing_status = WRITING_ACTIVE;
+        ls->rows_written = 1;
+        ls->segment_tick = 0;
+        CPPUNIT_ASSERT_EQUAL(false, is_rotation_due(ls));
+
+        ls->rotate_minutes = 1;
+        set_ticks(60000 / portTICK_RATE_MS - 1);
+        CPPUNIT_ASSERT_EQUAL(false, is_rotation_due(ls));
+        set_ticks(60000 / portTICK_RATE_MS);
+        CPPUNIT_ASSERT_EQUAL(true, is_rotation_due(ls));
+
+        /* Never before the first row of a part */
+        ls->rows_written = 0;
+        CPPUNIT_ASSERT_EQUAL(false, is_rotation_due(ls));
+}
+
+void LoggerFileWriterTest::testRotate()
+{
+        ls->logging = true;
+        ls->writing_status = WRITING_ACTIVE;
+        ls->rows_written = 10;
+        ls->rotate_minutes = 1;
+        ls->session = 0x1234;
+        strcpy(ls->name, "rc_1.log");
+
+        set_ticks(5);
+        rotate_log_file(ls, NULL);
+
+        /* The next part is open and starts over with a header */
+        CPPUNIT_ASSERT_EQUAL(WRITING_ACTIVE, ls->writing_status);
+        CPPUNIT_ASSERT_EQUAL((unsigned int) 0, ls->rows_written);
+        CPPUNIT_ASSERT(std::string("rc_1.log") != std::string(ls->name));
+        CPPUNIT_ASSERT_EQUAL((uint16_t) 1, ls->part);
+        CPPUNIT_ASSERT_EQUAL((uint32_t) 0x1234, ls->session);
+        CPPUNIT_ASSERT_EQUAL((uint16_t) 1, ls->index.part);
+        CPPUNIT_ASSERT_EQUAL((uint32_t) 0x1234, ls->index.session);
+        CPPUNIT_ASSERT_EQUAL((portTickType) 5, ls->segment_tick);
+        CPPUNIT_ASSERT_EQUAL(false, is_rotation_due(ls));
+
+        logging_stop(ls);
+}
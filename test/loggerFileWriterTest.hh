@@ -27,9 +27,15 @@ class LoggerFileWriterTest : public CppUnit::TestFixture
 {
         CPPUNIT_TEST_SUITE( LoggerFileWriterTest );
         CPPUNIT_TEST( testFlushLogfile );
+        CPPUNIT_TEST( testLossBudget );
         CPPUNIT_TEST( testLoggingStart );
+        CPPUNIT_TEST( testPreallocLimit );
         CPPUNIT_TEST( testLoggingStop );
         CPPUNIT_TEST( testLoggingSampleSkip );
+        CPPUNIT_TEST( testLogDataRate );
+        CPPUNIT_TEST( testLogFileIndex );
+        CPPUNIT_TEST( testRotationDue );
+        CPPUNIT_TEST( testRotate );
         CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -38,9 +44,15 @@ public:
         void tearDown();
 
         void testFlushLogfile();
+        void testLossBudget();
         void testLoggingStart();
+        void testPreallocLimit();
         void testLoggingStop();
         void testLoggingSampleSkip();
+        void testLogDataRate();
+        void testLogFileIndex();
+        void testRotationDue();
+        void testRotate();
 };
 
 #endif /* _LOGGERFILEWRITER_TEST_H_ */
@@ -0,0 +1,130 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "cpu_mock.h"
+#include "loggerTiming.h"
+#include "loggerTiming_test.h"
+
+#include <string>
+
+using std::string;
+
+CPPUNIT_TEST_SUITE_REGISTRATION( LoggerTimingTest );
+
+/* The cpu mock counts one cycle per us */
+
+void LoggerTimingTest::setUp()
+{
+        cpu_mock_set_cycle_count(0);
+        logger_timing_reset();
+}
+
+void LoggerTimingTest::testHistogramBuckets()
+{
+        struct timing_histogram h = {};
+
+        timing_histogram_add(&h, 0);
+        timing_histogram_add(&h, 1);
+        timing_histogram_add(&h, 2);
+        timing_histogram_add(&h, 3);
+        timing_histogram_add(&h, 1000);
+        timing_histogram_add(&h, UINT32_MAX);
+
+        CPPUNIT_ASSERT_EQUAL(1u, h.buckets[0]);
+        CPPUNIT_ASSERT_EQUAL(1u, h.buckets[1]);
+        CPPUNIT_ASSERT_EQUAL(2u, h.buckets[2]);
+        /* 512 <= 1000 < 1024 */
+        CPPUNIT_ASSERT_EQUAL(1u, h.buckets[10]);
+        CPPUNIT_ASSERT_EQUAL(1u, h.buckets[TIMING_HISTOGRAM_BUCKETS - 1]);
+        CPPUNIT_ASSERT_EQUAL(6u, h.count);
+        CPPUNIT_ASSERT_EQUAL(UINT32_MAX, h.max_us);
+
+        CPPUNIT_ASSERT_EQUAL(1u, timing_histogram_bucket_limit(0));
+        CPPUNIT_ASSERT_EQUAL(1024u, timing_histogram_bucket_limit(10));
+        CPPUNIT_ASSERT_EQUAL(0u, timing_histogram_bucket_limit(
+                                     TIMING_HISTOGRAM_BUCKETS - 1));
+}
+
+void LoggerTimingTest::testTickToSample()
+{
+        cpu_mock_set_cycle_count(100);
+        logger_timing_tick();
+        cpu_mock_set_cycle_count(150);
+        logger_timing_sample_start();
+
+        const struct timing_histogram *h =
+                get_logger_timing_histogram(TIMING_TICK_TO_SAMPLE);
+        CPPUNIT_ASSERT_EQUAL(1u, h->count);
+        CPPUNIT_ASSERT_EQUAL(50u, h->max_us);
+        CPPUNIT_ASSERT_EQUAL(1u, h->buckets[6]);
+}
+
+void LoggerTimingTest::testSampleDuration()
+{
+        cpu_mock_set_cycle_count(1000);
+        logger_timing_tick();
+        logger_timing_sample_start();
+        cpu_mock_set_cycle_count(1020);
+        logger_timing_sample_end(true);
+
+        /* Ticks with nothing due are not recorded */
+        logger_timing_sample_start();
+        cpu_mock_set_cycle_count(1021);
+        logger_timing_sample_end(false);
+
+        const struct timing_histogram *h =
+                get_logger_timing_histogram(TIMING_SAMPLE_DURATION);
+        CPPUNIT_ASSERT_EQUAL(1u, h->count);
+        CPPUNIT_ASSERT_EQUAL(20u, h->max_us);
+        CPPUNIT_ASSERT_EQUAL(20u, h->total_us);
+
+        CPPUNIT_ASSERT_EQUAL(2u, get_logger_timing_histogram(
+                                     TIMING_TICK_TO_SAMPLE)->count);
+}
+
+void LoggerTimingTest::testCycleCounterWrap()
+{
+        cpu_mock_set_cycle_count(UINT32_MAX - 9);
+        logger_timing_tick();
+        cpu_mock_set_cycle_count(10);
+        logger_timing_sample_start();
+
+        CPPUNIT_ASSERT_EQUAL(20u, get_logger_timing_histogram(
+                                      TIMING_TICK_TO_SAMPLE)->max_us);
+}
+
+void LoggerTimingTest::testReset()
+{
+        logger_timing_tick();
+        logger_timing_sample_start();
+        logger_timing_sample_end(true);
+        logger_timing_reset();
+
+        for (int i = 0; i < TIMING_HISTOGRAMS; ++i)
+                CPPUNIT_ASSERT_EQUAL(0u, get_logger_timing_histogram(
+                                             (enum timing_histogram_id) i)->count);
+
+        CPPUNIT_ASSERT(NULL == get_logger_timing_histogram(TIMING_HISTOGRAMS));
+        CPPUNIT_ASSERT_EQUAL(string("tickToSample"),
+                             string(get_logger_timing_histogram_name(
+                                            TIMING_TICK_TO_SAMPLE)));
+}
@@ -0,0 +1,47 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef LOGGERTIMING_TEST_H_
+#define LOGGERTIMING_TEST_H_
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class LoggerTimingTest : public CppUnit::TestFixture
+{
+        CPPUNIT_TEST_SUITE( LoggerTimingTest );
+        CPPUNIT_TEST( testHistogramBuckets );
+        CPPUNIT_TEST( testTickToSample );
+        CPPUNIT_TEST( testSampleDuration );
+        CPPUNIT_TEST( testCycleCounterWrap );
+        CPPUNIT_TEST( testReset );
+        CPPUNIT_TEST_SUITE_END();
+
+public:
+        void setUp();
+        void testHistogramBuckets();
+        void testTickToSample();
+        void testSampleDuration();
+        void testCycleCounterWrap();
+        void testReset();
+};
+
+#endif /* LOGGERTIMING_TEST_H_ */
@@ -21,6 +21,9 @@
 
 
 #include "cpu_device.h"
+#include "cpu_mock.h"
+
+static uint32_t cycle_count;
 
 int cpu_device_init(void)
 {
@@ -36,3 +39,19 @@ const char * cpu_device_get_serialnumber(void)
 {
     return "AAABBBCCCDDDEEEFFF000111";
 }
+
+uint32_t cpu_device_get_cycle_count(void)
+{
+    return cycle_count;
+}
+
+/* One cycle per us keeps the test math simple */
+uint32_t cpu_device_get_cycles_per_us(void)
+{
+    return 1;
+}
+
+void cpu_mock_set_cycle_count(uint32_t cycles)
+{
+    cycle_count = cycles;
+}
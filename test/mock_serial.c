@@ -26,6 +26,11 @@
 static Serial mockSerial;
 static char rxBuffer[20000];
 static char txBuffer[20000];
+static size_t txLength;
+static size_t txCalls;
+static char writeBuffer[20000];
+static size_t writeLength;
+static size_t writeCalls;
 size_t bufIndex;
 
 void setupMockSerial()
@@ -37,6 +42,7 @@ void setupMockSerial()
     mockSerial.get_line_wait = &mock_get_line_wait;
     mockSerial.put_c = &mock_put_c;
     mockSerial.put_s = &mock_put_s;
+    mockSerial.write = &mock_write;
 }
 
 char * mock_getTxBuffer()
@@ -44,6 +50,31 @@ char * mock_getTxBuffer()
     return txBuffer;
 }
 
+size_t mock_getTxLength()
+{
+    return txLength;
+}
+
+size_t mock_getTxCalls()
+{
+    return txCalls;
+}
+
+char * mock_getWriteBuffer()
+{
+    return writeBuffer;
+}
+
+size_t mock_getWriteLength()
+{
+    return writeLength;
+}
+
+size_t mock_getWriteCalls()
+{
+    return writeCalls;
+}
+
 void mock_setRxBuffer(const char *src)
 {
     strcpy(rxBuffer, src);
@@ -58,6 +89,11 @@ void mock_appendRxBuffer(const char *src)
 void mock_resetTxBuffer()
 {
     txBuffer[0] = '\0';
+    txLength = 0;
+    txCalls = 0;
+    writeBuffer[0] = '\0';
+    writeLength = 0;
+    writeCalls = 0;
 }
 
 Serial * getMockSerial()
@@ -85,17 +121,39 @@ char mock_get_c()
     return c;
 }
 
+/* Binary safe, so that telemetry frames can be captured too */
+static void append(char c)
+{
+    if (txLength + 1 >= sizeof(txBuffer))
+        return;
+
+    txBuffer[txLength++] = c;
+    txBuffer[txLength] = '\0';
+}
+
 void mock_put_c(char c)
 {
-    char append[2];
-    append[0] = c;
-    append[1] = '\0';
-    strcat(txBuffer, append);
+    txCalls++;
+    append(c);
 }
 
 void mock_put_s(const char* s )
 {
-    while ( *s ) mock_put_c(*s++ );
+    txCalls++;
+    while ( *s ) append(*s++ );
+}
+
+void mock_write(const char *data, size_t len)
+{
+    txCalls++;
+    writeCalls++;
+    while (len--) {
+        if (writeLength + 1 < sizeof(writeBuffer)) {
+            writeBuffer[writeLength++] = *data;
+            writeBuffer[writeLength] = '\0';
+        }
+        append(*data++);
+    }
 }
 
 int mock_get_line_wait(char *s, int len, size_t delay)
@@ -37,6 +37,8 @@ void mock_put_c(char c);
 
 void mock_put_s(const char* s );
 
+void mock_write(const char *data, size_t len);
+
 int mock_get_line_wait(char *s, int len, size_t delay);
 
 int mock_get_line(char *s, int len);
@@ -49,6 +51,18 @@ void mock_setRxBuffer(const char *src);
 
 char * mock_getTxBuffer();
 
+size_t mock_getTxLength();
+
+/* How many put_c, put_s and write calls since the last reset */
+size_t mock_getTxCalls();
+
+/* Only what went through write, concatenated, and how many write calls */
+char * mock_getWriteBuffer();
+
+size_t mock_getWriteLength();
+
+size_t mock_getWriteCalls();
+
 void mock_appendRxBuffer(const char *src);
 
 void mock_resetTxBuffer();
@@ -39,6 +39,7 @@ void usb_init_serial(Serial *serial)
     serial->get_line_wait = &usb_readLineWait;
     serial->put_c = &usb_putchar;
     serial->put_s = &usb_puts;
+    serial->write = &usb_write;
 }
 
 void usb_init(unsigned int bits, unsigned int parity, unsigned int stopBits, unsigned int baud) {}
@@ -76,6 +77,11 @@ void usb_putchar(char c)
 
 }
 
+void usb_write(const char *data, size_t len)
+{
+
+}
+
 void onUSBCommTask(void *pvParameters)
 {
 }
@@ -0,0 +1,109 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "pipelineStats.h"
+#include "pipelineStats_test.h"
+#include "taskUtil.h"
+#include "task_testing.h"
+
+#include <string>
+
+using std::string;
+
+CPPUNIT_TEST_SUITE_REGISTRATION( PipelineStatsTest );
+
+void PipelineStatsTest::setUp()
+{
+        reset_ticks();
+        pipeline_stats_reset();
+}
+
+void PipelineStatsTest::testEnqueue()
+{
+        pipeline_stats_enqueue(PIPELINE_CONSUMER_FILE, true, 1);
+        pipeline_stats_enqueue(PIPELINE_CONSUMER_FILE, true, 4);
+        pipeline_stats_enqueue(PIPELINE_CONSUMER_FILE, true, 2);
+        pipeline_stats_enqueue(PIPELINE_CONSUMER_FILE, false, 5);
+
+        const struct pipeline_stats *ps =
+                get_pipeline_stats(PIPELINE_CONSUMER_FILE);
+        CPPUNIT_ASSERT_EQUAL(3u, ps->queued);
+        CPPUNIT_ASSERT_EQUAL(1u, ps->queue_failures);
+        CPPUNIT_ASSERT_EQUAL(4u, ps->depth_max);
+        CPPUNIT_ASSERT_EQUAL(2u, get_pipeline_depth_avg(ps));
+
+        /* Other consumers are untouched */
+        ps = get_pipeline_stats(PIPELINE_CONSUMER_TELEMETRY);
+        CPPUNIT_ASSERT_EQUAL(0u, ps->queued);
+        CPPUNIT_ASSERT_EQUAL(0u, get_pipeline_depth_avg(ps));
+}
+
+void PipelineStatsTest::testOverrun()
+{
+        pipeline_stats_overrun(PIPELINE_CONSUMER_TELEMETRY);
+        pipeline_stats_overrun(PIPELINE_CONSUMER_TELEMETRY);
+
+        CPPUNIT_ASSERT_EQUAL(2u, get_pipeline_stats(
+                                     PIPELINE_CONSUMER_TELEMETRY)->overruns);
+        CPPUNIT_ASSERT_EQUAL(0u, get_pipeline_stats(
+                                     PIPELINE_CONSUMER_FILE)->overruns);
+}
+
+void PipelineStatsTest::testLatency()
+{
+        set_ticks(10);
+        pipeline_stats_latency(PIPELINE_CONSUMER_FILE, 8);
+        set_ticks(20);
+        pipeline_stats_latency(PIPELINE_CONSUMER_FILE, 10);
+
+        const struct pipeline_stats *ps =
+                get_pipeline_stats(PIPELINE_CONSUMER_FILE);
+        CPPUNIT_ASSERT_EQUAL(2u, ps->latency_count);
+        CPPUNIT_ASSERT_EQUAL((uint32_t) ticksToMs(10), ps->latency_max);
+        CPPUNIT_ASSERT_EQUAL((uint32_t) ticksToMs(6),
+                             get_pipeline_latency_avg(ps));
+}
+
+void PipelineStatsTest::testInvalidConsumer()
+{
+        pipeline_stats_enqueue(PIPELINE_CONSUMERS, true, 1);
+        pipeline_stats_overrun(PIPELINE_CONSUMERS);
+        pipeline_stats_latency(PIPELINE_CONSUMERS, 0);
+
+        CPPUNIT_ASSERT(NULL == get_pipeline_stats(PIPELINE_CONSUMERS));
+        CPPUNIT_ASSERT_EQUAL(string(""), string(get_pipeline_consumer_name(
+                                                        PIPELINE_CONSUMERS)));
+        CPPUNIT_ASSERT_EQUAL(string("file"), string(get_pipeline_consumer_name(
+                                                            PIPELINE_CONSUMER_FILE)));
+}
+
+void PipelineStatsTest::testReset()
+{
+        pipeline_stats_enqueue(PIPELINE_CONSUMER_FILE, false, 0);
+        pipeline_stats_overrun(PIPELINE_CONSUMER_FILE);
+        pipeline_stats_reset();
+
+        const struct pipeline_stats *ps =
+                get_pipeline_stats(PIPELINE_CONSUMER_FILE);
+        CPPUNIT_ASSERT_EQUAL(0u, ps->queue_failures);
+        CPPUNIT_ASSERT_EQUAL(0u, ps->overruns);
+}
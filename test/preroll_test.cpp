@@ -0,0 +1,159 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include "capabilities.h"
+#include "loggerConfig.h"
+#include "preroll.h"
+#include "preroll_test.h"
+#include "sampleRecord.h"
+#include "taskUtil.h"
+
+CPPUNIT_TEST_SUITE_REGISTRATION( PrerollTest );
+
+static struct channel_table table;
+static struct sample in;
+static struct sample out;
+
+static void fill_sample(struct sample *s, const size_t ticks)
+{
+        clear_sample_populated(s);
+        s->ticks = ticks;
+
+        /* Only populate a few so that several samples fit in the buffer */
+        for (size_t i = 0; i < 4; ++i) {
+                s->values[i].valueLongLong = 0;
+                s->values[i].valueInt = (int) (ticks + i);
+                set_sample_populated(s, i);
+        }
+}
+
+void PrerollTest::setUp()
+{
+        initialize_logger_config();
+        init_channel_table(&table, getWorkingLoggerConfig());
+        init_sample_buffer(&in, &table);
+        init_sample_buffer(&out, &table);
+        preroll_set_duration(PREROLL_MAX_MS);
+        preroll_clear();
+}
+
+void PrerollTest::tearDown()
+{
+        /* A disabled pre-roll releases its buffer on the next add */
+        preroll_set_duration(0);
+        preroll_add(&in);
+
+        free_sample_buffer(&out);
+        free_sample_buffer(&in);
+        free_channel_table(&table);
+}
+
+void PrerollTest::testDuration()
+{
+        preroll_set_duration(PREROLL_MAX_MS + 1);
+        CPPUNIT_ASSERT_EQUAL((size_t) PREROLL_MAX_MS, preroll_get_duration());
+        CPPUNIT_ASSERT(is_preroll_enabled());
+
+        preroll_set_duration(0);
+        CPPUNIT_ASSERT(!is_preroll_enabled());
+
+        fill_sample(&in, 1);
+        CPPUNIT_ASSERT(!preroll_add(&in));
+        CPPUNIT_ASSERT(NULL == preroll_get_table());
+}
+
+void PrerollTest::testRoundTrip()
+{
+        fill_sample(&in, 42);
+        CPPUNIT_ASSERT(preroll_add(&in));
+        CPPUNIT_ASSERT(&table == preroll_get_table());
+
+        CPPUNIT_ASSERT(preroll_get(&out));
+        CPPUNIT_ASSERT_EQUAL((size_t) 42, out.ticks);
+        for (size_t i = 0; i < table.channel_count; ++i) {
+                CPPUNIT_ASSERT_EQUAL(is_sample_populated(&in, i),
+                                     is_sample_populated(&out, i));
+                if (is_sample_populated(&in, i))
+                        CPPUNIT_ASSERT_EQUAL(in.values[i].valueInt,
+                                             out.values[i].valueInt);
+        }
+
+        CPPUNIT_ASSERT(!preroll_get(&out));
+        CPPUNIT_ASSERT(NULL == preroll_get_table());
+}
+
+void PrerollTest::testAgeOut()
+{
+        const size_t max_age = msToTicks(100);
+        preroll_set_duration(100);
+
+        for (size_t ticks = 0; ticks <= 2 * max_age; ticks += max_age / 2) {
+                fill_sample(&in, ticks);
+                CPPUNIT_ASSERT(preroll_add(&in));
+        }
+
+        /* Only the samples within max_age of the newest remain */
+        CPPUNIT_ASSERT(preroll_get(&out));
+        CPPUNIT_ASSERT_EQUAL(max_age, out.ticks);
+        CPPUNIT_ASSERT(preroll_get(&out));
+        CPPUNIT_ASSERT(preroll_get(&out));
+        CPPUNIT_ASSERT_EQUAL(2 * max_age, out.ticks);
+        CPPUNIT_ASSERT(!preroll_get(&out));
+}
+
+void PrerollTest::testSpaceEviction()
+{
+        const size_t count = 100;
+        for (size_t ticks = 0; ticks < count; ++ticks) {
+                fill_sample(&in, ticks);
+                CPPUNIT_ASSERT(preroll_add(&in));
+        }
+
+        /* The oldest went to make room, the newest are all there in order */
+        size_t stored = 0;
+        size_t last = 0;
+        while (preroll_get(&out)) {
+                if (stored++)
+                        CPPUNIT_ASSERT_EQUAL(last + 1, out.ticks);
+                last = out.ticks;
+                CPPUNIT_ASSERT_EQUAL((int) last, out.values[0].valueInt);
+        }
+
+        CPPUNIT_ASSERT(stored > 0 && stored < count);
+        CPPUNIT_ASSERT_EQUAL(count - 1, last);
+}
+
+void PrerollTest::testLayoutChange()
+{
+        fill_sample(&in, 1);
+        CPPUNIT_ASSERT(preroll_add(&in));
+
+        /* Samples stored under the old layout can't be decoded */
+        table.layout++;
+        CPPUNIT_ASSERT(!preroll_get(&out));
+        CPPUNIT_ASSERT(NULL == preroll_get_table());
+
+        /* New samples are stored against the new layout */
+        CPPUNIT_ASSERT(preroll_add(&in));
+        CPPUNIT_ASSERT(preroll_get(&out));
+}
@@ -146,6 +146,23 @@ void RingBufferTest::dumpTest()
         CPPUNIT_ASSERT_EQUAL(toDump, get_space(&rb));
 }
 
+void RingBufferTest::peekTest()
+{
+        char data_out[4] = {0};
+
+        /* Put the data across the end of the buffer */
+        rb.head = rb.tail = buff + buff_size - 2;
+        CPPUNIT_ASSERT_EQUAL((size_t) 3, put_data(&rb, "FOO", 3));
+
+        /* Peeking leaves the data in place */
+        CPPUNIT_ASSERT_EQUAL((size_t) 3, peek_data(&rb, data_out, 3));
+        CPPUNIT_ASSERT(0 == strcmp("FOO", data_out));
+        CPPUNIT_ASSERT_EQUAL((size_t) 3, get_used(&rb));
+
+        /* Can't peek more than what is there */
+        CPPUNIT_ASSERT_EQUAL((size_t) 3, peek_data(&rb, data_out, 4));
+}
+
 void RingBufferTest::clearTest()
 {
         /* Fill up the buffer */
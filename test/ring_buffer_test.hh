@@ -33,6 +33,7 @@ class RingBufferTest : public CppUnit::TestFixture
         CPPUNIT_TEST( putFailTest );
         CPPUNIT_TEST( getFailTest );
         CPPUNIT_TEST( dumpTest );
+        CPPUNIT_TEST( peekTest );
         CPPUNIT_TEST( clearTest );
         CPPUNIT_TEST( createDestroyTest );
         CPPUNIT_TEST_SUITE_END();
@@ -46,6 +47,7 @@ public:
         void putFailTest();
         void getFailTest();
         void dumpTest();
+        void peekTest();
         void clearTest();
         void createDestroyTest();
 };
@@ -37,7 +37,9 @@
 #include "task.h"
 #include "task_testing.h"
 
+#include <math.h>
 #include <string>
+#include <string.h>
 
 using std::string;
 
@@ -45,6 +47,7 @@ using std::string;
 CPPUNIT_TEST_SUITE_REGISTRATION( SampleRecordTest );
 
 LoggerConfig *lc;
+struct channel_table t;
 struct sample s;
 
 void SampleRecordTest::setUp()
@@ -56,15 +59,17 @@ void SampleRecordTest::setUp()
 
         lc = getWorkingLoggerConfig();
         lapStats_init();
-        size_t channelCount = get_enabled_channel_count(lc);
-        init_sample_buffer(&s, channelCount);
+        init_channel_table(&t, lc);
+        init_sample_buffer(&s, &t);
 
 }
 
 
 void SampleRecordTest::tearDown()
 {
+        set_staggered_sampling(false);
         free_sample_buffer(&s);
+        free_channel_table(&t);
 }
 
 
@@ -74,13 +79,16 @@ void SampleRecordTest::testPopulateSampleRecord(){
 	ADC_mock_set_value(7, 123);
 	ADC_sample_all();
 
+        /* Scaling is baked into the table when it is built */
+        init_channel_table(&t, lc);
+
         // Set it so we have 1 tick.
         increment_tick();
         CPPUNIT_ASSERT_EQUAL(1, (int) (xTaskGetTickCount()));
 
 	const unsigned short highSampleRate =
                 (unsigned short) populate_sample_buffer(&s, 0);
-        const ChannelSample *samples = s.channel_samples;
+        const ChannelValue *samples = s.values;
 
         // Interval Channel
         CPPUNIT_ASSERT_EQUAL((int) (xTaskGetTickCount() * MS_PER_TICK),
@@ -170,7 +178,11 @@ void SampleRecordTest::testInitSampleRecord()
         size_t channelCount = get_enabled_channel_count(lc);
         CPPUNIT_ASSERT_EQUAL(expectedEnabledChannels, channelCount);
 
-        ChannelSample *ts = s.channel_samples;
+        CPPUNIT_ASSERT_EQUAL(expectedEnabledChannels, t.channel_count);
+        CPPUNIT_ASSERT_EQUAL(expectedEnabledChannels, s.channel_count);
+        CPPUNIT_ASSERT_EQUAL(&t, s.table);
+
+        ChannelDescriptor *ts = t.channels;
         const struct TimeConfig *tc = lc->TimeConfigs;
 
         // Check what should be Uptime (Interval)
@@ -195,9 +207,8 @@ void SampleRecordTest::testInitSampleRecord()
 
                 CPPUNIT_ASSERT_EQUAL((size_t) i, ts->channelIndex);
                 CPPUNIT_ASSERT_EQUAL((void *) &ac->cfg, (void *) ts->cfg);
-                CPPUNIT_ASSERT_EQUAL((void *) get_analog_sample,
-                                     (void *) ts->get_float_sample);
-                CPPUNIT_ASSERT_EQUAL(SampleData_Float, ts->sampleData);
+                CPPUNIT_ASSERT(NULL != ts->get_float_sample_kernel);
+                CPPUNIT_ASSERT_EQUAL(SampleData_Float_Kernel, ts->sampleData);
                 ts++;
         }
 
@@ -221,9 +232,8 @@ void SampleRecordTest::testInitSampleRecord()
 
                 CPPUNIT_ASSERT_EQUAL((size_t)i, ts->channelIndex);
                 CPPUNIT_ASSERT_EQUAL((void *) &tc->cfg, (void *) ts->cfg);
-                CPPUNIT_ASSERT_EQUAL((void *) get_timer_sample,
-                                     (void *) ts->get_float_sample);
-                CPPUNIT_ASSERT_EQUAL(SampleData_Float, ts->sampleData);
+                CPPUNIT_ASSERT(NULL != ts->get_float_sample_kernel);
+                CPPUNIT_ASSERT_EQUAL(SampleData_Float_Kernel, ts->sampleData);
                 ts++;
         }
 
@@ -247,9 +257,8 @@ void SampleRecordTest::testInitSampleRecord()
 
                 CPPUNIT_ASSERT_EQUAL((size_t)i, ts->channelIndex);
                 CPPUNIT_ASSERT_EQUAL((void *) &pc->cfg, (void *) ts->cfg);
-                CPPUNIT_ASSERT_EQUAL((void *) get_pwm_sample,
-                                     (void *) ts->get_int_sample);
-                CPPUNIT_ASSERT_EQUAL(SampleData_Int, ts->sampleData);
+                CPPUNIT_ASSERT(NULL != ts->get_float_sample_kernel);
+                CPPUNIT_ASSERT_EQUAL(SampleData_Float_Kernel, ts->sampleData);
                 ts++;
         }
 
@@ -392,31 +401,45 @@ void SampleRecordTest::testInitSampleRecord()
         }
 
         //amount shoud match
-        const size_t size = ts - s.channel_samples;
+        const size_t size = ts - t.channels;
         CPPUNIT_ASSERT_EQUAL(expectedEnabledChannels, size);
 }
 
 
-void SampleRecordTest::testIsValidLoggerMessage() {
-        LoggerMessage lm;
-        struct sample s;
+void SampleRecordTest::testLoggerMessageReferences() {
+        LoggerMessage lm = create_logger_message(LoggerMessageType_Sample, &s);
+
+        CPPUNIT_ASSERT_EQUAL(false, is_sample_in_use(&s));
+
+        /* A message that never makes it onto a queue must not leak a ref */
+        CPPUNIT_ASSERT(pdTRUE != send_logger_message(NULL, &lm));
+        CPPUNIT_ASSERT_EQUAL(false, is_sample_in_use(&s));
 
-        /* Test the non sample case.  This always passes */
-        lm = create_logger_message(LoggerMessageType_Start, NULL);
-        lm.ticks = 42;
-        s.ticks = 42;
-        CPPUNIT_ASSERT_EQUAL(true, is_sample_data_valid(&lm));
-        lm.ticks = 41;
-        CPPUNIT_ASSERT_EQUAL(true,  is_sample_data_valid(&lm));
+        xQueueHandle q = create_logger_message_queue(1);
+        CPPUNIT_ASSERT(pdTRUE != send_logger_message(q, &lm));
+        CPPUNIT_ASSERT_EQUAL(false, is_sample_in_use(&s));
 
-        /* Test the sample case. */
-        lm = create_logger_message(LoggerMessageType_Sample, &s);
-        lm.ticks = 42;
-        s.ticks = 42;
-        CPPUNIT_ASSERT_EQUAL(true, is_sample_data_valid(&lm));
-        lm.ticks = 41;
-        CPPUNIT_ASSERT_EQUAL(false,  is_sample_data_valid(&lm));
+        /* Two consumers holding the sample */
+        s.refs = 2;
 
+        /* Messages without samples carry no reference */
+        LoggerMessage start = create_logger_message(LoggerMessageType_Start,
+                                                    NULL);
+        release_logger_message(&start);
+        CPPUNIT_ASSERT_EQUAL(2, (int) s.refs);
+
+        release_logger_message(&lm);
+        CPPUNIT_ASSERT_EQUAL(true, is_sample_in_use(&s));
+
+        release_logger_message(&lm);
+        CPPUNIT_ASSERT_EQUAL(false, is_sample_in_use(&s));
+
+        /* Extra releases must not wrap around */
+        release_logger_message(&lm);
+        CPPUNIT_ASSERT_EQUAL(false, is_sample_in_use(&s));
+
+        /* Channels with no reader have no queue to flush */
+        CPPUNIT_ASSERT_EQUAL((size_t) 0, flush_logger_message_queue(NULL));
 }
 
 void SampleRecordTest::testLoggerMessageAlwaysHasTime() {
@@ -436,8 +459,320 @@ void SampleRecordTest::testLoggerMessageAlwaysHasTime() {
                         continue;
 
                 ++var;
-                CPPUNIT_ASSERT_EQUAL(true, s.channel_samples->populated);
+                CPPUNIT_ASSERT_EQUAL(true, is_sample_populated(&s, 0));
         }
 
         CPPUNIT_ASSERT_EQUAL(true, tick < 1000);
 }
+
+void SampleRecordTest::testSampleScheduleBuckets()
+{
+        const struct sample_schedule *sched = &t.schedule;
+
+        /* Buckets must be sorted fastest first and cover every channel */
+        size_t scheduled = 0;
+        for (size_t i = 0; i < sched->bucket_count; ++i) {
+                const struct rate_bucket *b = sched->buckets + i;
+                if (i > 0) {
+                        const struct rate_bucket *prev = b - 1;
+                        CPPUNIT_ASSERT(prev->sample_rate <= b->sample_rate);
+                        if (prev->sample_rate == b->sample_rate)
+                                CPPUNIT_ASSERT(prev->phase < b->phase);
+                }
+
+                /* Nothing is staggered by default */
+                CPPUNIT_ASSERT_EQUAL(0, (int) b->phase);
+
+                for (size_t j = 0; j < b->count; ++j) {
+                        const ChannelDescriptor *cs =
+                                t.channels + sched->order[b->first + j];
+                        CPPUNIT_ASSERT_EQUAL((int) b->sample_rate,
+                                             (int) cs->cfg->sampleRate);
+                }
+
+                scheduled += b->count;
+        }
+
+        CPPUNIT_ASSERT_EQUAL(s.channel_count, scheduled);
+
+        /* Interval and Utc are the only always sampled channels */
+        CPPUNIT_ASSERT_EQUAL(2, (int) sched->always_count);
+        CPPUNIT_ASSERT_EQUAL(0, (int) sched->order[sched->always_first]);
+        CPPUNIT_ASSERT_EQUAL(1, (int) sched->order[sched->always_first + 1]);
+}
+
+/*
+ * Rebuilds the channel table and sample after a config change, the
+ * same way the logger task does when the config is updated.
+ */
+static void rebuild_sample_buffer()
+{
+        free_sample_buffer(&s);
+        free_channel_table(&t);
+        init_channel_table(&t, lc);
+        init_sample_buffer(&s, &t);
+}
+
+void SampleRecordTest::testSampleScheduleMatchesRates()
+{
+        lc->ADCConfigs[0].cfg.sampleRate = SAMPLE_200Hz;
+        lc->ADCConfigs[1].cfg.sampleRate = SAMPLE_50Hz;
+        lc->GPIOConfigs[0].cfg.sampleRate = SAMPLE_5Hz;
+        lc->GPSConfigs.speed.sampleRate = SAMPLE_100Hz;
+        rebuild_sample_buffer();
+
+        /*
+         * Walk the ticks the way the logger task does and check that the
+         * schedule populates exactly the channels the sample rates ask for.
+         */
+        for (size_t tick = 0; tick < 2 * TICK_RATE_HZ; ++tick) {
+                const int sr = populate_sample_buffer(&s, tick);
+
+                int expected_sr = SAMPLE_DISABLED;
+                const ChannelDescriptor *cs = t.channels;
+                for (size_t i = 0; i < s.channel_count; ++i, ++cs) {
+                        if (tick % cs->cfg->sampleRate == 0)
+                                expected_sr = getHigherSampleRate(
+                                        cs->cfg->sampleRate, expected_sr);
+                }
+
+                CPPUNIT_ASSERT_EQUAL(expected_sr, sr);
+                if (SAMPLE_DISABLED == sr)
+                        continue;
+
+                cs = t.channels;
+                for (size_t i = 0; i < s.channel_count; ++i, ++cs) {
+                        const bool expected =
+                                (cs->cfg->flags & ALWAYS_SAMPLED) ||
+                                tick % cs->cfg->sampleRate == 0;
+                        CPPUNIT_ASSERT_EQUAL(expected,
+                                             is_sample_populated(&s, i));
+                }
+        }
+}
+
+static size_t count_staggerable(const struct sample *s)
+{
+        size_t count = 0;
+        const ChannelDescriptor *cs = s->table->channels;
+        for (size_t i = 0; i < s->channel_count; ++i, ++cs)
+                if (is_sample_populated(s, i) &&
+                    !(cs->cfg->flags & ALWAYS_SAMPLED))
+                        ++count;
+
+        return count;
+}
+
+static size_t max_channels_per_tick(struct sample *s)
+{
+        size_t max = 0;
+        for (size_t tick = 0; tick < TICK_RATE_HZ; ++tick) {
+                if (SAMPLE_DISABLED == populate_sample_buffer(s, tick))
+                        continue;
+
+                const size_t count = count_staggerable(s);
+                if (count > max)
+                        max = count;
+        }
+
+        return max;
+}
+
+void SampleRecordTest::testStaggeredSampling()
+{
+        for (int i = 0; i < CONFIG_ADC_CHANNELS; ++i)
+                lc->ADCConfigs[i].cfg.sampleRate = SAMPLE_10Hz;
+
+        rebuild_sample_buffer();
+        const size_t aligned_max = max_channels_per_tick(&s);
+
+        set_staggered_sampling(true);
+        rebuild_sample_buffer();
+        const size_t staggered_max = max_channels_per_tick(&s);
+
+        CPPUNIT_ASSERT(staggered_max < aligned_max);
+
+        /*
+         * Every channel must still be sampled exactly at its rate, always
+         * on the same phase of its period, and with the time channels.
+         */
+        size_t samples[s.channel_count];
+        int phases[s.channel_count];
+        for (size_t i = 0; i < s.channel_count; ++i) {
+                samples[i] = 0;
+                phases[i] = -1;
+        }
+
+        for (size_t tick = 0; tick < 2 * TICK_RATE_HZ; ++tick) {
+                if (SAMPLE_DISABLED == populate_sample_buffer(&s, tick))
+                        continue;
+
+                CPPUNIT_ASSERT_EQUAL(true, is_sample_populated(&s, 0));
+                CPPUNIT_ASSERT_EQUAL(true, is_sample_populated(&s, 1));
+
+                const ChannelDescriptor *cs = t.channels;
+                for (size_t i = 0; i < s.channel_count; ++i, ++cs) {
+                        if (!is_sample_populated(&s, i) ||
+                            cs->cfg->flags & ALWAYS_SAMPLED)
+                                continue;
+
+                        const int phase = tick % cs->cfg->sampleRate;
+                        if (phases[i] < 0)
+                                phases[i] = phase;
+
+                        CPPUNIT_ASSERT_EQUAL(phases[i], phase);
+                        ++samples[i];
+                }
+        }
+
+        const ChannelDescriptor *cs = t.channels;
+        for (size_t i = 0; i < s.channel_count; ++i, ++cs) {
+                if (cs->cfg->flags & ALWAYS_SAMPLED)
+                        continue;
+
+                const size_t expected = 2 * TICK_RATE_HZ / cs->cfg->sampleRate;
+                CPPUNIT_ASSERT_EQUAL(expected, samples[i]);
+        }
+}
+
+void SampleRecordTest::testChannelTableReuse()
+{
+        const ChannelDescriptor *channels = t.channels;
+        const ChannelValue *values = s.values;
+        const uint32_t layout = t.layout;
+
+        CPPUNIT_ASSERT(t.capacity >= t.channel_count);
+        CPPUNIT_ASSERT_EQUAL(0, (int) (t.capacity % CHANNEL_TABLE_CHUNK));
+
+        /* Nothing changed, so nothing should move */
+        init_channel_table(&t, lc);
+        init_sample_buffer(&s, &t);
+        CPPUNIT_ASSERT_EQUAL(channels, (const ChannelDescriptor *) t.channels);
+        CPPUNIT_ASSERT_EQUAL(values, (const ChannelValue *) s.values);
+        CPPUNIT_ASSERT_EQUAL(layout, t.layout);
+
+        /* A rate change changes the layout but fits in place */
+        ChannelConfig *cfg = t.channels[2].cfg;
+        cfg->sampleRate = SAMPLE_1Hz == cfg->sampleRate ?
+                SAMPLE_10Hz : SAMPLE_1Hz;
+        init_channel_table(&t, lc);
+        init_sample_buffer(&s, &t);
+        CPPUNIT_ASSERT_EQUAL(channels, (const ChannelDescriptor *) t.channels);
+        CPPUNIT_ASSERT_EQUAL(values, (const ChannelValue *) s.values);
+        CPPUNIT_ASSERT(layout != t.layout);
+
+        /* So does dropping a channel */
+        const size_t count = t.channel_count;
+        cfg->sampleRate = SAMPLE_DISABLED;
+        init_channel_table(&t, lc);
+        init_sample_buffer(&s, &t);
+        CPPUNIT_ASSERT_EQUAL(count - 1, t.channel_count);
+        CPPUNIT_ASSERT_EQUAL(count - 1, s.channel_count);
+        CPPUNIT_ASSERT_EQUAL(channels, (const ChannelDescriptor *) t.channels);
+        CPPUNIT_ASSERT_EQUAL(values, (const ChannelValue *) s.values);
+
+        /* The schedule must be rebuilt for the smaller table */
+        for (size_t tick = 0; tick < TICK_RATE_HZ; ++tick)
+                populate_sample_buffer(&s, tick);
+        size_t scheduled = 0;
+        for (size_t i = 0; i < t.schedule.bucket_count; ++i)
+                scheduled += t.schedule.buckets[i].count;
+        CPPUNIT_ASSERT_EQUAL(t.channel_count, scheduled);
+}
+
+void SampleRecordTest::testChannelTableReaders()
+{
+        struct channel_table table;
+        memset(&table, 0, sizeof(table));
+
+        /* Readers hold off a rebuild until the last one lets go */
+        CPPUNIT_ASSERT(acquire_channel_table(&table));
+        CPPUNIT_ASSERT(acquire_channel_table(&table));
+        CPPUNIT_ASSERT(!begin_channel_table_rebuild(&table));
+        release_channel_table(&table);
+        CPPUNIT_ASSERT(!begin_channel_table_rebuild(&table));
+        release_channel_table(&table);
+
+        /* And a rebuild keeps new readers out until it is done */
+        CPPUNIT_ASSERT(begin_channel_table_rebuild(&table));
+        CPPUNIT_ASSERT(!acquire_channel_table(&table));
+        end_channel_table_rebuild(&table);
+        CPPUNIT_ASSERT(acquire_channel_table(&table));
+
+        /* Extra releases must not wrap the count */
+        release_channel_table(&table);
+        release_channel_table(&table);
+        CPPUNIT_ASSERT_EQUAL(0, (int) table.readers);
+        CPPUNIT_ASSERT(begin_channel_table_rebuild(&table));
+}
+
+static const ChannelDescriptor* find_descriptor(const ChannelConfig *cfg)
+{
+        for (size_t i = 0; i < t.channel_count; ++i)
+                if (t.channels[i].cfg == cfg)
+                        return t.channels + i;
+
+        return NULL;
+}
+
+void SampleRecordTest::testSampleKernels()
+{
+        ADCConfig *ac = lc->ADCConfigs + 7;
+        ADC_mock_set_value(7, 123);
+        ADC_sample_all();
+        const float raw = ADC_read(7);
+
+        ac->scalingMode = SCALING_MODE_LINEAR;
+        ac->linearScaling = 2;
+        ac->linearOffset = 1;
+        init_channel_table(&t, lc);
+        const ChannelDescriptor *cd = find_descriptor(&ac->cfg);
+        CPPUNIT_ASSERT(cd);
+        CPPUNIT_ASSERT_EQUAL((void *) analog_linear_kernel,
+                             (void *) cd->get_float_sample_kernel);
+        CPPUNIT_ASSERT_EQUAL(2 * raw + 1, cd->get_float_sample_kernel(cd));
+
+        /* Config changes only take effect once the table is rebuilt */
+        ac->linearScaling = 3;
+        CPPUNIT_ASSERT_EQUAL(2 * raw + 1, cd->get_float_sample_kernel(cd));
+
+        ac->scalingMode = SCALING_MODE_MAP;
+        for (int i = 0; i < ANALOG_SCALING_BINS; ++i) {
+                ac->scalingMap.rawValues[i] = i * 0.25f;
+                ac->scalingMap.scaledValues[i] = i * i * 10;
+        }
+        init_channel_table(&t, lc);
+        cd = find_descriptor(&ac->cfg);
+        CPPUNIT_ASSERT_EQUAL((void *) analog_map_kernel,
+                             (void *) cd->get_float_sample_kernel);
+        const float mapped = get_mapped_value(raw, &ac->scalingMap);
+        CPPUNIT_ASSERT(fabsf(mapped - cd->get_float_sample_kernel(cd)) <
+                       0.0001f);
+
+        ac->scalingMode = 0xff;
+        init_channel_table(&t, lc);
+        cd = find_descriptor(&ac->cfg);
+        CPPUNIT_ASSERT_EQUAL(-1.0f, cd->get_float_sample_kernel(cd));
+
+        TimerConfig *tc = lc->TimerConfigs;
+        tc->cfg.sampleRate = SAMPLE_10Hz;
+        tc->mode = MODE_LOGGING_TIMER_PERIOD_USEC;
+        tc->pulsePerRevolution = 4;
+        init_channel_table(&t, lc);
+        cd = find_descriptor(&tc->cfg);
+        CPPUNIT_ASSERT(cd);
+        CPPUNIT_ASSERT_EQUAL((void *) timer_usec_kernel,
+                             (void *) cd->get_float_sample_kernel);
+        CPPUNIT_ASSERT_EQUAL(4u, cd->kernel.pulses);
+
+        PWMConfig *pc = lc->PWMConfigs;
+        pc->cfg.sampleRate = SAMPLE_10Hz;
+        pc->loggingMode = MODE_LOGGING_PWM_VOLTS;
+        init_channel_table(&t, lc);
+        cd = find_descriptor(&pc->cfg);
+        CPPUNIT_ASSERT(cd);
+        CPPUNIT_ASSERT_EQUAL((void *) pwm_volts_kernel,
+                             (void *) cd->get_float_sample_kernel);
+
+        init_sample_buffer(&s, &t);
+}
@@ -29,8 +29,14 @@ class SampleRecordTest : public CppUnit::TestFixture
     CPPUNIT_TEST_SUITE( SampleRecordTest );
     CPPUNIT_TEST( testInitSampleRecord );
     CPPUNIT_TEST( testPopulateSampleRecord );
-    CPPUNIT_TEST( testIsValidLoggerMessage );
+    CPPUNIT_TEST( testLoggerMessageReferences );
     CPPUNIT_TEST( testLoggerMessageAlwaysHasTime );
+    CPPUNIT_TEST( testSampleScheduleBuckets );
+    CPPUNIT_TEST( testSampleScheduleMatchesRates );
+    CPPUNIT_TEST( testStaggeredSampling );
+    CPPUNIT_TEST( testChannelTableReuse );
+    CPPUNIT_TEST( testChannelTableReaders );
+    CPPUNIT_TEST( testSampleKernels );
     CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -39,8 +45,14 @@ public:
     void tearDown();
     void testInitSampleRecord();
     void testPopulateSampleRecord();
-    void testIsValidLoggerMessage();
+    void testLoggerMessageReferences();
     void testLoggerMessageAlwaysHasTime();
+    void testSampleScheduleBuckets();
+    void testSampleScheduleMatchesRates();
+    void testStaggeredSampling();
+    void testChannelTableReuse();
+    void testChannelTableReaders();
+    void testSampleKernels();
 
 private:
 
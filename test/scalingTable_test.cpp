@@ -0,0 +1,100 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include "loggerSampleData.h"
+#include "rcp_cpp_unit.hh"
+#include "scalingTable.h"
+#include "scalingTable_test.h"
+
+#include <math.h>
+
+CPPUNIT_TEST_SUITE_REGISTRATION( ScalingTableTest );
+
+/* Something like a thermistor: falling and far from linear */
+static void init_curve(ScalingMap *m)
+{
+        for (int i = 0; i < ANALOG_SCALING_BINS; ++i) {
+                m->rawValues[i] = 0.5f + i;
+                m->scaledValues[i] = 150.0f / (1 + i * i);
+        }
+}
+
+void ScalingTableTest::testMatchesMappedValue()
+{
+        ScalingMap m;
+        struct scaling_table st;
+        init_curve(&m);
+        init_scaling_table(&st, &m);
+
+        /* The two only differ by float rounding */
+        for (float v = -1; v < ANALOG_SCALING_BINS + 1; v += 0.01f) {
+                const float expected = get_mapped_value(v, &m);
+                const float actual = get_scaling_table_value(&st, v);
+                CPPUNIT_ASSERT(fabsf(expected - actual) <
+                               0.00001f * (1 + fabsf(expected)));
+        }
+}
+
+void ScalingTableTest::testBreakPoints()
+{
+        ScalingMap m;
+        struct scaling_table st;
+        init_curve(&m);
+        init_scaling_table(&st, &m);
+
+        for (int i = 0; i < ANALOG_SCALING_BINS; ++i)
+                CPPUNIT_ASSERT_CLOSE_ENOUGH(
+                        get_scaling_table_value(&st, m.rawValues[i]),
+                        m.scaledValues[i]);
+}
+
+void ScalingTableTest::testClamping()
+{
+        ScalingMap m;
+        struct scaling_table st;
+        init_curve(&m);
+        init_scaling_table(&st, &m);
+
+        const int last = ANALOG_SCALING_BINS - 1;
+        CPPUNIT_ASSERT_EQUAL(m.scaledValues[0],
+                             get_scaling_table_value(&st, -1000));
+        CPPUNIT_ASSERT_EQUAL(m.scaledValues[last],
+                             get_scaling_table_value(&st, 1000));
+}
+
+void ScalingTableTest::testDuplicateBreakPoints()
+{
+        ScalingMap m;
+        struct scaling_table st;
+        init_curve(&m);
+
+        /* A step in the curve */
+        m.rawValues[2] = m.rawValues[1];
+        init_scaling_table(&st, &m);
+
+        const float v = m.rawValues[1];
+        CPPUNIT_ASSERT_CLOSE_ENOUGH(get_scaling_table_value(&st, v),
+                                    m.scaledValues[2]);
+        CPPUNIT_ASSERT(!isnan(get_scaling_table_value(&st, v - 0.1f)));
+        CPPUNIT_ASSERT(!isnan(get_scaling_table_value(&st, v + 0.1f)));
+}
@@ -0,0 +1,112 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include "cpu_mock.h"
+#include "sdStats.h"
+#include "sdStats_test.h"
+
+CPPUNIT_TEST_SUITE_REGISTRATION( SdStatsTest );
+
+/* The cpu mock counts one cycle per us */
+
+void SdStatsTest::setUp()
+{
+        cpu_mock_set_cycle_count(0);
+        sd_stats_reset();
+}
+
+void SdStatsTest::testWrite()
+{
+        cpu_mock_set_cycle_count(100);
+        uint32_t start = sd_stats_start();
+        cpu_mock_set_cycle_count(1100);
+        sd_stats_write(start, 512, true);
+
+        start = sd_stats_start();
+        cpu_mock_set_cycle_count(1110);
+        sd_stats_write(start, 0, false);
+
+        const struct sd_stats *ss = get_sd_stats();
+        CPPUNIT_ASSERT_EQUAL(2u, ss->write.count);
+        CPPUNIT_ASSERT_EQUAL(1000u, ss->write.max_us);
+        CPPUNIT_ASSERT_EQUAL(1u, ss->write.buckets[10]);
+        CPPUNIT_ASSERT_EQUAL(512u, ss->bytes);
+        CPPUNIT_ASSERT_EQUAL(1u, ss->errors);
+        CPPUNIT_ASSERT_EQUAL(0u, ss->sync.count);
+}
+
+void SdStatsTest::testSync()
+{
+        /* Syncs can stall long enough to see the cycle counter wrap */
+        cpu_mock_set_cycle_count(UINT32_MAX - 9);
+        const uint32_t start = sd_stats_start();
+        cpu_mock_set_cycle_count(40);
+        sd_stats_sync(start, true);
+
+        const struct sd_stats *ss = get_sd_stats();
+        CPPUNIT_ASSERT_EQUAL(1u, ss->sync.count);
+        CPPUNIT_ASSERT_EQUAL(50u, ss->sync.max_us);
+        CPPUNIT_ASSERT_EQUAL(0u, ss->errors);
+        CPPUNIT_ASSERT_EQUAL(0u, ss->write.count);
+}
+
+void SdStatsTest::testWriteRate()
+{
+        CPPUNIT_ASSERT_EQUAL(0u, get_sd_write_rate(get_sd_stats()));
+
+        /* 4 sectors in 1ms */
+        const uint32_t start = sd_stats_start();
+        cpu_mock_set_cycle_count(1000);
+        sd_stats_write(start, 2048, true);
+
+        CPPUNIT_ASSERT_EQUAL(2048000u, get_sd_write_rate(get_sd_stats()));
+}
+
+void SdStatsTest::testQueueDepth()
+{
+        sd_stats_queue_depth(3);
+        sd_stats_queue_depth(7);
+        sd_stats_queue_depth(1);
+        sd_stats_remount();
+
+        const struct sd_stats *ss = get_sd_stats();
+        CPPUNIT_ASSERT_EQUAL(7u, ss->queue_depth_max);
+        CPPUNIT_ASSERT_EQUAL(1u, ss->remounts);
+}
+
+void SdStatsTest::testReset()
+{
+        sd_stats_write(sd_stats_start(), 512, true);
+        sd_stats_sync(sd_stats_start(), false);
+        sd_stats_remount();
+        sd_stats_queue_depth(5);
+        sd_stats_reset();
+
+        const struct sd_stats *ss = get_sd_stats();
+        CPPUNIT_ASSERT_EQUAL(0u, ss->write.count);
+        CPPUNIT_ASSERT_EQUAL(0u, ss->sync.count);
+        CPPUNIT_ASSERT_EQUAL(0u, ss->bytes);
+        CPPUNIT_ASSERT_EQUAL(0u, ss->errors);
+        CPPUNIT_ASSERT_EQUAL(0u, ss->remounts);
+        CPPUNIT_ASSERT_EQUAL(0u, ss->queue_depth_max);
+}
@@ -0,0 +1,164 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include "mem_mang.h"
+#include "sectorBuffer.h"
+#include "sectorBuffer_test.h"
+
+#include <string>
+#include <vector>
+
+CPPUNIT_TEST_SUITE_REGISTRATION( SectorBufferTest );
+
+#define BLOCK_SIZE	(SECTOR_SIZE * 2)
+
+static struct sector_buffer sb;
+static std::string written;
+static std::vector<size_t> writes;
+static int write_error;
+
+static int test_write(const void *data, const size_t len)
+{
+        if (write_error)
+                return write_error;
+
+        written.append((const char *) data, len);
+        writes.push_back(len);
+        return 0;
+}
+
+static std::string make_data(const size_t len)
+{
+        std::string str;
+        for (size_t i = 0; i < len; ++i)
+                str += (char) ('a' + i % 26);
+
+        return str;
+}
+
+void SectorBufferTest::setUp()
+{
+        init_sector_buffer(&sb, BLOCK_SIZE, 2);
+        reset_sector_buffer(&sb, 0);
+        written.clear();
+        writes.clear();
+        write_error = 0;
+}
+
+void SectorBufferTest::tearDown()
+{
+        portFree(sb.data);
+}
+
+void SectorBufferTest::testWholeBlocks()
+{
+        const std::string data = make_data(BLOCK_SIZE + 100);
+
+        CPPUNIT_ASSERT_EQUAL(data.size(),
+                             put_sector_buffer(&sb, data.c_str(), data.size()));
+        CPPUNIT_ASSERT_EQUAL((size_t) 1, get_sector_buffer_full(&sb));
+        CPPUNIT_ASSERT_EQUAL(data.size(), get_sector_buffer_pending(&sb));
+
+        /* Only the full block goes out */
+        CPPUNIT_ASSERT_EQUAL(0, drain_sector_buffer(&sb, test_write));
+        CPPUNIT_ASSERT_EQUAL((size_t) 1, writes.size());
+        CPPUNIT_ASSERT_EQUAL((size_t) BLOCK_SIZE, writes[0]);
+        CPPUNIT_ASSERT_EQUAL((size_t) 0, get_sector_buffer_full(&sb));
+
+        CPPUNIT_ASSERT_EQUAL(0, flush_sector_buffer(&sb, test_write));
+        CPPUNIT_ASSERT_EQUAL(data, written);
+}
+
+void SectorBufferTest::testFull()
+{
+        const std::string data = make_data(BLOCK_SIZE * 3);
+
+        /* Can only take as much as the blocks hold until drained */
+        CPPUNIT_ASSERT_EQUAL((size_t) BLOCK_SIZE * 2,
+                             put_sector_buffer(&sb, data.c_str(), data.size()));
+        CPPUNIT_ASSERT_EQUAL((size_t) 2, get_sector_buffer_full(&sb));
+        CPPUNIT_ASSERT_EQUAL((size_t) 0,
+                             put_sector_buffer(&sb, data.c_str(), 1));
+
+        CPPUNIT_ASSERT_EQUAL(0, drain_sector_buffer(&sb, test_write));
+        CPPUNIT_ASSERT_EQUAL((size_t) BLOCK_SIZE,
+                             put_sector_buffer(&sb,
+                                               data.c_str() + BLOCK_SIZE * 2,
+                                               BLOCK_SIZE));
+        CPPUNIT_ASSERT_EQUAL(0, drain_sector_buffer(&sb, test_write));
+        CPPUNIT_ASSERT_EQUAL(data, written);
+        CPPUNIT_ASSERT_EQUAL((size_t) 3, writes.size());
+}
+
+void SectorBufferTest::testFlushKeepsAlignment()
+{
+        const std::string data = make_data(BLOCK_SIZE * 2);
+
+        put_sector_buffer(&sb, data.c_str(), 100);
+        CPPUNIT_ASSERT_EQUAL(0, flush_sector_buffer(&sb, test_write));
+        CPPUNIT_ASSERT_EQUAL((size_t) 100, writes.back());
+        CPPUNIT_ASSERT_EQUAL((size_t) 0, get_sector_buffer_pending(&sb));
+
+        /* Nothing new, so nothing to write */
+        CPPUNIT_ASSERT_EQUAL(0, flush_sector_buffer(&sb, test_write));
+        CPPUNIT_ASSERT_EQUAL((size_t) 1, writes.size());
+
+        /* The next write finishes the block at the block boundary */
+        put_sector_buffer(&sb, data.c_str() + 100, data.size() - 100);
+        CPPUNIT_ASSERT_EQUAL(0, drain_sector_buffer(&sb, test_write));
+        CPPUNIT_ASSERT_EQUAL((size_t) 3, writes.size());
+        CPPUNIT_ASSERT_EQUAL((size_t) BLOCK_SIZE - 100, writes[1]);
+        CPPUNIT_ASSERT_EQUAL((size_t) BLOCK_SIZE, writes[2]);
+        CPPUNIT_ASSERT_EQUAL(data, written);
+}
+
+void SectorBufferTest::testResetOffset()
+{
+        const std::string data = make_data(BLOCK_SIZE);
+
+        /* Appending to a file that ends part way into a block */
+        reset_sector_buffer(&sb, BLOCK_SIZE * 3 + 10);
+        CPPUNIT_ASSERT_EQUAL(data.size(),
+                             put_sector_buffer(&sb, data.c_str(), data.size()));
+        CPPUNIT_ASSERT_EQUAL(0, drain_sector_buffer(&sb, test_write));
+        CPPUNIT_ASSERT_EQUAL((size_t) BLOCK_SIZE - 10, writes[0]);
+
+        CPPUNIT_ASSERT_EQUAL(0, flush_sector_buffer(&sb, test_write));
+        CPPUNIT_ASSERT_EQUAL((size_t) 10, writes[1]);
+        CPPUNIT_ASSERT_EQUAL(data, written);
+}
+
+void SectorBufferTest::testWriteError()
+{
+        const std::string data = make_data(BLOCK_SIZE);
+
+        put_sector_buffer(&sb, data.c_str(), data.size());
+        write_error = 5;
+        CPPUNIT_ASSERT_EQUAL(5, drain_sector_buffer(&sb, test_write));
+        CPPUNIT_ASSERT_EQUAL((size_t) 1, get_sector_buffer_full(&sb));
+
+        /* The block is kept for the next try */
+        write_error = 0;
+        CPPUNIT_ASSERT_EQUAL(0, drain_sector_buffer(&sb, test_write));
+        CPPUNIT_ASSERT_EQUAL(data, written);
+}
@@ -0,0 +1,49 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#ifndef SECTORBUFFER_TEST_H_
+#define SECTORBUFFER_TEST_H_
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class SectorBufferTest : public CppUnit::TestFixture
+{
+        CPPUNIT_TEST_SUITE( SectorBufferTest );
+        CPPUNIT_TEST( testWholeBlocks );
+        CPPUNIT_TEST( testFull );
+        CPPUNIT_TEST( testFlushKeepsAlignment );
+        CPPUNIT_TEST( testResetOffset );
+        CPPUNIT_TEST( testWriteError );
+        CPPUNIT_TEST_SUITE_END();
+
+public:
+        void setUp();
+        void tearDown();
+        void testWholeBlocks();
+        void testFull();
+        void testFlushKeepsAlignment();
+        void testResetOffset();
+        void testWriteError();
+};
+
+#endif /* SECTORBUFFER_TEST_H_ */
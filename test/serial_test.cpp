@@ -0,0 +1,116 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "mock_serial.h"
+#include "serial.h"
+#include "serial_test.h"
+
+#include <string>
+#include <string.h>
+
+CPPUNIT_TEST_SUITE_REGISTRATION( SerialTest );
+
+using std::string;
+
+static string tx(void)
+{
+        return string(mock_getTxBuffer(), mock_getTxLength());
+}
+
+static string written(void)
+{
+        return string(mock_getWriteBuffer(), mock_getWriteLength());
+}
+
+void SerialTest::setUp()
+{
+        setupMockSerial();
+        mock_resetTxBuffer();
+}
+
+void SerialTest::testPutBytes()
+{
+        const char data[] = { 'a', '\0', '\n', 'b' };
+
+        put_bytes(getMockSerial(), data, sizeof(data));
+
+        /* Binary data goes out untouched in a single write */
+        CPPUNIT_ASSERT_EQUAL((size_t) 1, mock_getWriteCalls());
+        CPPUNIT_ASSERT_EQUAL(string(data, sizeof(data)), written());
+        CPPUNIT_ASSERT_EQUAL(written(), tx());
+}
+
+void SerialTest::testPutFloat()
+{
+        put_float(getMockSerial(), -12.5f, 3);
+
+        CPPUNIT_ASSERT_EQUAL((size_t) 1, mock_getWriteCalls());
+        CPPUNIT_ASSERT_EQUAL(string("-12.5"), written());
+        CPPUNIT_ASSERT_EQUAL(written(), tx());
+}
+
+void SerialTest::testPutDouble()
+{
+        put_double(getMockSerial(), 47.123456789, 6);
+
+        CPPUNIT_ASSERT_EQUAL((size_t) 1, mock_getWriteCalls());
+        CPPUNIT_ASSERT_EQUAL(string("47.123457"), written());
+        CPPUNIT_ASSERT_EQUAL(written(), tx());
+}
+
+void SerialTest::testEscapedString()
+{
+        const char *s = "ab\ncd\"ef\rgh";
+
+        put_escapedString(getMockSerial(), s, strlen(s));
+
+        CPPUNIT_ASSERT_EQUAL(string("ab\\ncd\\\"ef\\rgh"), tx());
+
+        /* Each plain run is one write; the escapes are not written */
+        CPPUNIT_ASSERT_EQUAL((size_t) 4, mock_getWriteCalls());
+        CPPUNIT_ASSERT_EQUAL(string("abcdefgh"), written());
+}
+
+void SerialTest::testEscapedStringEdges()
+{
+        const char *s = "\"\n\rx\"";
+
+        put_escapedString(getMockSerial(), s, strlen(s));
+
+        CPPUNIT_ASSERT_EQUAL(string("\\\"\\n\\rx\\\""), tx());
+
+        /* Escapes at the ends and back to back leave only empty runs */
+        CPPUNIT_ASSERT_EQUAL(string("x"), written());
+        CPPUNIT_ASSERT_EQUAL((size_t) 5, mock_getWriteCalls());
+}
+
+void SerialTest::testEscapedStringPlain()
+{
+        const char *s = "plain text, no escapes";
+
+        /* Only the first length characters are sent */
+        put_escapedString(getMockSerial(), s, 5);
+
+        CPPUNIT_ASSERT_EQUAL((size_t) 1, mock_getWriteCalls());
+        CPPUNIT_ASSERT_EQUAL(string("plain"), written());
+        CPPUNIT_ASSERT_EQUAL(written(), tx());
+}
@@ -0,0 +1,205 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+
+#include "binaryLog.h"
+#include "loggerConfig.h"
+#include "sampleRecord.h"
+#include "telemetryDelta.h"
+#include "telemetryDelta_test.h"
+
+CPPUNIT_TEST_SUITE_REGISTRATION( TelemetryDeltaTest );
+
+#define KEYFRAME_INTERVAL	10
+
+static struct channel_table table;
+static struct sample sample;
+static struct telemetry_delta delta;
+
+static void fill_sample(void)
+{
+        clear_sample_populated(&sample);
+
+        for (size_t i = 0; i < sample.channel_count; ++i) {
+                sample.values[i].valueLongLong = 0;
+                set_sample_populated(&sample, i);
+        }
+}
+
+static size_t count_populated(const struct sample *s)
+{
+        size_t count = 0;
+
+        for (size_t i = 0; i < s->channel_count; ++i)
+                count += is_sample_populated(s, i);
+
+        return count;
+}
+
+/* Index of a float channel, so the deadband has a precision to go by */
+static size_t find_float_channel(void)
+{
+        for (size_t i = 0; i < table.channel_count; ++i)
+                if (BINARY_LOG_TYPE_FLOAT ==
+                    binary_log_get_type(table.channels + i))
+                        return i;
+
+        CPPUNIT_FAIL("No float channel in the default config");
+        return 0;
+}
+
+static float one_unit(const size_t channel)
+{
+        float unit = 1;
+
+        for (int p = table.channels[channel].cfg->precision; p > 0; --p)
+                unit /= 10;
+
+        return unit;
+}
+
+void TelemetryDeltaTest::setUp()
+{
+        initialize_logger_config();
+        init_channel_table(&table, getWorkingLoggerConfig());
+        init_sample_buffer(&sample, &table);
+        telemetry_delta_init(&delta, KEYFRAME_INTERVAL);
+        fill_sample();
+}
+
+void TelemetryDeltaTest::tearDown()
+{
+        telemetry_delta_free(&delta);
+        free_sample_buffer(&sample);
+        free_channel_table(&table);
+}
+
+void TelemetryDeltaTest::testDisabled()
+{
+        struct sample view;
+
+        telemetry_delta_init(&delta, 0);
+        for (int i = 0; i < 3; ++i)
+                CPPUNIT_ASSERT(&sample == telemetry_delta_filter(
+                                       &delta, &sample, &view, false));
+}
+
+void TelemetryDeltaTest::testUnchangedDropped()
+{
+        struct sample view;
+
+        /* The first sample is always a keyframe */
+        CPPUNIT_ASSERT(&sample ==
+                       telemetry_delta_filter(&delta, &sample, &view, false));
+
+        struct sample *s = telemetry_delta_filter(&delta, &sample, &view,
+                                                  false);
+        CPPUNIT_ASSERT(&view == s);
+        CPPUNIT_ASSERT(s->values == sample.values);
+        CPPUNIT_ASSERT_EQUAL((size_t) 0, count_populated(s));
+
+        sample.values[1].valueLongLong = 1234;
+        s = telemetry_delta_filter(&delta, &sample, &view, false);
+        CPPUNIT_ASSERT_EQUAL((size_t) 1, count_populated(s));
+        CPPUNIT_ASSERT(is_sample_populated(s, 1));
+
+        /* Channels the logger didn't sample this time stay out */
+        sample.values[2].valueLongLong = 5678;
+        clear_sample_populated(&sample);
+        s = telemetry_delta_filter(&delta, &sample, &view, false);
+        CPPUNIT_ASSERT_EQUAL((size_t) 0, count_populated(s));
+}
+
+void TelemetryDeltaTest::testDeadband()
+{
+        struct sample view;
+        const size_t ch = find_float_channel();
+        const float unit = one_unit(ch);
+
+        sample.values[ch].valueFloat = 10;
+        telemetry_delta_filter(&delta, &sample, &view, false);
+
+        /* Less than the channel shows rounds to the same value */
+        sample.values[ch].valueFloat = 10 + unit / 4;
+        struct sample *s = telemetry_delta_filter(&delta, &sample, &view,
+                                                  false);
+        CPPUNIT_ASSERT(!is_sample_populated(s, ch));
+
+        sample.values[ch].valueFloat = 10 + unit;
+        s = telemetry_delta_filter(&delta, &sample, &view, false);
+        CPPUNIT_ASSERT(is_sample_populated(s, ch));
+        CPPUNIT_ASSERT_EQUAL((size_t) 1, count_populated(s));
+}
+
+void TelemetryDeltaTest::testKeyframes()
+{
+        struct sample view;
+
+        for (int i = 0; i < KEYFRAME_INTERVAL; ++i) {
+                struct sample *s = telemetry_delta_filter(&delta, &sample,
+                                                          &view, false);
+                CPPUNIT_ASSERT_EQUAL(0 == i, &sample == s);
+        }
+
+        CPPUNIT_ASSERT(&sample ==
+                       telemetry_delta_filter(&delta, &sample, &view, false));
+        CPPUNIT_ASSERT(&view ==
+                       telemetry_delta_filter(&delta, &sample, &view, false));
+
+        /* Meta going out forces one, and the count starts over */
+        CPPUNIT_ASSERT(&sample ==
+                       telemetry_delta_filter(&delta, &sample, &view, true));
+        for (int i = 1; i < KEYFRAME_INTERVAL; ++i)
+                CPPUNIT_ASSERT(&view == telemetry_delta_filter(
+                                       &delta, &sample, &view, false));
+        CPPUNIT_ASSERT(&sample ==
+                       telemetry_delta_filter(&delta, &sample, &view, false));
+}
+
+void TelemetryDeltaTest::testReset()
+{
+        struct sample view;
+
+        telemetry_delta_filter(&delta, &sample, &view, false);
+        CPPUNIT_ASSERT(&view ==
+                       telemetry_delta_filter(&delta, &sample, &view, false));
+
+        telemetry_delta_reset(&delta);
+        CPPUNIT_ASSERT(&sample ==
+                       telemetry_delta_filter(&delta, &sample, &view, false));
+}
+
+void TelemetryDeltaTest::testLayoutChange()
+{
+        struct sample view;
+
+        telemetry_delta_filter(&delta, &sample, &view, false);
+        CPPUNIT_ASSERT(&view ==
+                       telemetry_delta_filter(&delta, &sample, &view, false));
+
+        ++table.layout;
+        CPPUNIT_ASSERT(&sample ==
+                       telemetry_delta_filter(&delta, &sample, &view, false));
+        CPPUNIT_ASSERT(&view ==
+                       telemetry_delta_filter(&delta, &sample, &view, false));
+}
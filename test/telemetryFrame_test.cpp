@@ -0,0 +1,228 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include "binaryLog.h"
+#include "loggerConfig.h"
+#include "mock_serial.h"
+#include "sampleRecord.h"
+#include "telemetryFrame.h"
+#include "telemetryFrame_test.h"
+
+#include <string.h>
+#include <string>
+
+using std::string;
+
+CPPUNIT_TEST_SUITE_REGISTRATION( TelemetryFrameTest );
+
+static struct channel_table table;
+static struct sample sample;
+
+static string get_tx(void)
+{
+        return string(mock_getTxBuffer(), mock_getTxLength());
+}
+
+static void fill_sample(void)
+{
+        clear_sample_populated(&sample);
+
+        for (size_t i = 0; i < sample.channel_count; i += 2) {
+                sample.values[i].valueLongLong = 0x0102030405060708ll + i;
+                set_sample_populated(&sample, i);
+        }
+}
+
+template <typename T>
+static T get(const uint8_t *buf)
+{
+        T value;
+        memcpy(&value, buf, sizeof(value));
+        return value;
+}
+
+/* Parses the next frame off the front of data, which must hold one */
+static struct telemetry_frame next_frame(string &data)
+{
+        struct telemetry_frame f;
+        const size_t len = telemetry_frame_parse(
+                (const uint8_t *) data.data(), data.size(), &f);
+
+        CPPUNIT_ASSERT(len > 0);
+        CPPUNIT_ASSERT(TELEMETRY_FRAME_NONE != f.type);
+
+        /* Keep the payload valid until the next call */
+        static string frame;
+        frame = data.substr(0, len);
+        f.payload = (const uint8_t *) frame.data() +
+                (f.payload - (const uint8_t *) data.data());
+        data.erase(0, len);
+        return f;
+}
+
+void TelemetryFrameTest::setUp()
+{
+        setupMockSerial();
+        mock_resetTxBuffer();
+        initialize_logger_config();
+        init_channel_table(&table, getWorkingLoggerConfig());
+        init_sample_buffer(&sample, &table);
+        telemetry_set_format(getMockSerial(), TELEMETRY_FORMAT_BINARY);
+}
+
+void TelemetryFrameTest::tearDown()
+{
+        telemetry_set_format(getMockSerial(), TELEMETRY_FORMAT_JSON);
+        free_sample_buffer(&sample);
+        free_channel_table(&table);
+}
+
+void TelemetryFrameTest::testFormat()
+{
+        Serial other;
+
+        CPPUNIT_ASSERT_EQUAL(TELEMETRY_FORMAT_BINARY,
+                             telemetry_get_format(getMockSerial()));
+        CPPUNIT_ASSERT_EQUAL(TELEMETRY_FORMAT_JSON,
+                             telemetry_get_format(&other));
+        CPPUNIT_ASSERT(!telemetry_set_format(getMockSerial(),
+                                             TELEMETRY_FORMATS));
+        CPPUNIT_ASSERT(telemetry_set_format(getMockSerial(),
+                                            TELEMETRY_FORMAT_JSON));
+        CPPUNIT_ASSERT_EQUAL(TELEMETRY_FORMAT_JSON,
+                             telemetry_get_format(getMockSerial()));
+}
+
+void TelemetryFrameTest::testSampleFrames()
+{
+        fill_sample();
+        telemetry_send_sample(getMockSerial(), &sample, 7, false);
+
+        /* Binary frames never start like a JSON reply would */
+        string tx = get_tx();
+        CPPUNIT_ASSERT_EQUAL(string(TELEMETRY_FRAME_SYNC), tx.substr(0, 2));
+
+        const uint32_t hash = telemetry_meta_hash(&table);
+        struct telemetry_frame f = next_frame(tx);
+        CPPUNIT_ASSERT_EQUAL(TELEMETRY_FRAME_META, f.type);
+        CPPUNIT_ASSERT_EQUAL(hash, get<uint32_t>(f.payload));
+        CPPUNIT_ASSERT_EQUAL((uint16_t) table.channel_count,
+                             get<uint16_t>(f.payload + 4));
+
+        /* The first channel as the binary log header would describe it */
+        const ChannelConfig *cfg = table.channels[0].cfg;
+        const uint8_t *desc = f.payload + 6;
+        CPPUNIT_ASSERT_EQUAL((int) binary_log_get_type(table.channels),
+                             (int) desc[0]);
+        CPPUNIT_ASSERT_EQUAL((int) cfg->precision, (int) desc[1]);
+        CPPUNIT_ASSERT_EQUAL(strlen(cfg->label), (size_t) desc[12]);
+        CPPUNIT_ASSERT_EQUAL(string(cfg->label),
+                             string((const char *) desc + 13, desc[12]));
+
+        f = next_frame(tx);
+        CPPUNIT_ASSERT_EQUAL(TELEMETRY_FRAME_SAMPLE, f.type);
+        CPPUNIT_ASSERT_EQUAL(7u, get<uint32_t>(f.payload));
+        CPPUNIT_ASSERT_EQUAL(hash, get<uint32_t>(f.payload + 4));
+        CPPUNIT_ASSERT_EQUAL(sample.populated[0],
+                             get<uint32_t>(f.payload + 8));
+
+        const size_t words = SAMPLE_BITMAP_WORDS(sample.channel_count);
+        const uint8_t *values = f.payload + 8 + words * sizeof(uint32_t);
+        size_t values_len = 0;
+        for (size_t i = 0; i < sample.channel_count; i += 2)
+                values_len += binary_log_type_size(
+                        binary_log_get_type(table.channels + i));
+
+        CPPUNIT_ASSERT_EQUAL(f.payload + f.len, values + values_len);
+        CPPUNIT_ASSERT(0 == memcmp(values, sample.values,
+                                   binary_log_type_size(binary_log_get_type(
+                                                                table.channels))));
+        CPPUNIT_ASSERT(tx.empty());
+
+        /* No meta the second time around, unless asked for */
+        mock_resetTxBuffer();
+        telemetry_send_sample(getMockSerial(), &sample, 8, false);
+        tx = get_tx();
+        CPPUNIT_ASSERT_EQUAL(TELEMETRY_FRAME_SAMPLE, next_frame(tx).type);
+        CPPUNIT_ASSERT(tx.empty());
+
+        mock_resetTxBuffer();
+        telemetry_send_sample(getMockSerial(), &sample, 9, true);
+        tx = get_tx();
+        CPPUNIT_ASSERT_EQUAL(TELEMETRY_FRAME_META, next_frame(tx).type);
+        CPPUNIT_ASSERT_EQUAL(TELEMETRY_FRAME_SAMPLE, next_frame(tx).type);
+}
+
+void TelemetryFrameTest::testLayoutChange()
+{
+        fill_sample();
+        telemetry_send_sample(getMockSerial(), &sample, 0, false);
+
+        mock_resetTxBuffer();
+        ++table.layout;
+        telemetry_send_sample(getMockSerial(), &sample, 1, false);
+
+        string tx = get_tx();
+        CPPUNIT_ASSERT_EQUAL(TELEMETRY_FRAME_META, next_frame(tx).type);
+        CPPUNIT_ASSERT_EQUAL(TELEMETRY_FRAME_SAMPLE, next_frame(tx).type);
+
+        /* Switching format starts the stream over */
+        telemetry_set_format(getMockSerial(), TELEMETRY_FORMAT_BINARY);
+        mock_resetTxBuffer();
+        telemetry_send_sample(getMockSerial(), &sample, 2, false);
+        tx = get_tx();
+        CPPUNIT_ASSERT_EQUAL(TELEMETRY_FRAME_META, next_frame(tx).type);
+}
+
+void TelemetryFrameTest::testParseErrors()
+{
+        fill_sample();
+        telemetry_send_sample(getMockSerial(), &sample, 0, false);
+
+        const string tx = get_tx();
+        struct telemetry_frame f;
+
+        /* A JSON reply ahead of the frame gets skipped up to the sync */
+        string data = "{\"hb\":1}\r\n" + tx;
+        size_t len = telemetry_frame_parse((const uint8_t *) data.data(),
+                                           data.size(), &f);
+        CPPUNIT_ASSERT_EQUAL(TELEMETRY_FRAME_NONE, f.type);
+        CPPUNIT_ASSERT_EQUAL((size_t) 10, len);
+
+        /* Partial frames need more data */
+        const size_t meta_len = telemetry_frame_parse(
+                (const uint8_t *) tx.data(), tx.size(), &f);
+        CPPUNIT_ASSERT_EQUAL((size_t) 0, telemetry_frame_parse(
+                                     (const uint8_t *) tx.data(), 1, &f));
+        CPPUNIT_ASSERT_EQUAL((size_t) 0, telemetry_frame_parse(
+                                     (const uint8_t *) tx.data(),
+                                     meta_len - 1, &f));
+
+        /* A bad CRC drops the sync so the next one can be found */
+        data = tx;
+        data[TELEMETRY_FRAME_HEADER_LEN] ^= 0xff;
+        len = telemetry_frame_parse((const uint8_t *) data.data(),
+                                    data.size(), &f);
+        CPPUNIT_ASSERT_EQUAL(TELEMETRY_FRAME_NONE, f.type);
+        CPPUNIT_ASSERT(len > 0);
+}
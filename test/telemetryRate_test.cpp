@@ -0,0 +1,177 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+
+#include "loggerConfig.h"
+#include "telemetryRate.h"
+#include "telemetryRate_test.h"
+
+CPPUNIT_TEST_SUITE_REGISTRATION( TelemetryRateTest );
+
+#define QUEUE_LENGTH	8
+
+/*
+ * Runs one window in which the sink is offered a sample at its current
+ * rate and drains drain_hz of them, with the queue at depth.
+ * @return true if the rate changed at the end of the window.
+ */
+static bool run_window(struct telemetry_rate *r, size_t *ticks,
+                       const uint32_t drain_hz, const size_t depth,
+                       const bool fail)
+{
+        for (uint32_t i = 0; i < drain_hz; ++i)
+                telemetry_rate_drained(r);
+
+        telemetry_rate_enqueue(r, !fail, depth);
+        *ticks += TELEMETRY_RATE_WINDOW;
+        return telemetry_rate_update(r, *ticks, QUEUE_LENGTH);
+}
+
+void TelemetryRateTest::testInit()
+{
+        struct telemetry_rate r;
+
+        telemetry_rate_init(&r, SAMPLE_50Hz, SAMPLE_1Hz);
+        CPPUNIT_ASSERT_EQUAL(SAMPLE_50Hz, r.rate);
+        CPPUNIT_ASSERT_EQUAL(SAMPLE_1Hz, r.min_rate);
+
+        /* A floor faster than the ceiling is no floor at all */
+        telemetry_rate_init(&r, SAMPLE_5Hz, SAMPLE_10Hz);
+        CPPUNIT_ASSERT_EQUAL(SAMPLE_5Hz, r.min_rate);
+
+        CPPUNIT_ASSERT(NULL != get_telemetry_rate(0));
+        CPPUNIT_ASSERT(NULL == get_telemetry_rate(CONNECTIVITY_CHANNELS));
+}
+
+void TelemetryRateTest::testIsDue()
+{
+        struct telemetry_rate r;
+
+        telemetry_rate_init(&r, SAMPLE_10Hz, SAMPLE_1Hz);
+        CPPUNIT_ASSERT(telemetry_rate_is_due(&r, SAMPLE_50Hz, SAMPLE_10Hz));
+        CPPUNIT_ASSERT(!telemetry_rate_is_due(&r, SAMPLE_50Hz, SAMPLE_50Hz));
+
+        /* Slow channels go out whenever they are sampled */
+        CPPUNIT_ASSERT(telemetry_rate_is_due(&r, SAMPLE_5Hz, 7));
+}
+
+void TelemetryRateTest::testDisabled()
+{
+        struct telemetry_rate r;
+        size_t ticks = 0;
+
+        /* A disabled sink gets nothing, whatever was sampled */
+        telemetry_rate_init(&r, SAMPLE_DISABLED, SAMPLE_1Hz);
+        CPPUNIT_ASSERT(!telemetry_rate_is_due(&r, SAMPLE_1000Hz, 0));
+        CPPUNIT_ASSERT(!telemetry_rate_is_due(&r, SAMPLE_1Hz, SAMPLE_1Hz));
+
+        /* And stays that way, however quiet its queue is */
+        for (int i = 0; i < TELEMETRY_RATE_UP_WINDOWS; ++i)
+                CPPUNIT_ASSERT(!run_window(&r, &ticks, 0, 0, false));
+        CPPUNIT_ASSERT_EQUAL(SAMPLE_DISABLED, r.rate);
+}
+
+void TelemetryRateTest::testThrottleToDrainRate()
+{
+        struct telemetry_rate r;
+        size_t ticks = 0;
+
+        telemetry_rate_init(&r, SAMPLE_50Hz, SAMPLE_1Hz);
+        CPPUNIT_ASSERT(!run_window(&r, &ticks, 50, 1, false));
+        CPPUNIT_ASSERT_EQUAL(SAMPLE_50Hz, r.rate);
+
+        /* The link only managed 12 a second */
+        CPPUNIT_ASSERT(run_window(&r, &ticks, 12, 1, true));
+        CPPUNIT_ASSERT_EQUAL(SAMPLE_10Hz, r.rate);
+}
+
+void TelemetryRateTest::testThrottleOneStep()
+{
+        struct telemetry_rate r;
+        size_t ticks = 0;
+
+        telemetry_rate_init(&r, SAMPLE_50Hz, SAMPLE_1Hz);
+
+        /* Draining at full rate but backing up still costs a step */
+        CPPUNIT_ASSERT(!run_window(&r, &ticks, 50, QUEUE_LENGTH / 2, false));
+        CPPUNIT_ASSERT(run_window(&r, &ticks, 50, QUEUE_LENGTH / 2 + 1,
+                                  false));
+        CPPUNIT_ASSERT_EQUAL(SAMPLE_25Hz, r.rate);
+}
+
+void TelemetryRateTest::testMinRate()
+{
+        struct telemetry_rate r;
+        size_t ticks = 0;
+
+        telemetry_rate_init(&r, SAMPLE_10Hz, SAMPLE_5Hz);
+        CPPUNIT_ASSERT(run_window(&r, &ticks, 0, 1, true));
+        CPPUNIT_ASSERT_EQUAL(SAMPLE_5Hz, r.rate);
+        CPPUNIT_ASSERT(!run_window(&r, &ticks, 0, 1, true));
+        CPPUNIT_ASSERT_EQUAL(SAMPLE_5Hz, r.rate);
+}
+
+void TelemetryRateTest::testStepUp()
+{
+        struct telemetry_rate r;
+        size_t ticks = 0;
+
+        telemetry_rate_init(&r, SAMPLE_25Hz, SAMPLE_1Hz);
+        run_window(&r, &ticks, 3, 1, true);
+        CPPUNIT_ASSERT_EQUAL(SAMPLE_1Hz, r.rate);
+
+        for (int i = 1; i < TELEMETRY_RATE_UP_WINDOWS; ++i)
+                CPPUNIT_ASSERT(!run_window(&r, &ticks, 1, 1, false));
+        CPPUNIT_ASSERT(run_window(&r, &ticks, 1, 1, false));
+        CPPUNIT_ASSERT_EQUAL(SAMPLE_5Hz, r.rate);
+
+        /* A busy window starts the count over */
+        for (int i = 1; i < TELEMETRY_RATE_UP_WINDOWS; ++i)
+                run_window(&r, &ticks, 5, 1, false);
+        CPPUNIT_ASSERT(!run_window(&r, &ticks, 5, 2, false));
+        CPPUNIT_ASSERT_EQUAL(SAMPLE_5Hz, r.rate);
+
+        /* And never past the ceiling */
+        for (int i = 0; i < 10 * TELEMETRY_RATE_UP_WINDOWS; ++i)
+                run_window(&r, &ticks, 25, 0, false);
+        CPPUNIT_ASSERT_EQUAL(SAMPLE_25Hz, r.rate);
+}
+
+void TelemetryRateTest::testStaleWindow()
+{
+        struct telemetry_rate r;
+        size_t ticks = 0;
+
+        telemetry_rate_init(&r, SAMPLE_50Hz, SAMPLE_1Hz);
+        telemetry_rate_enqueue(&r, false, 0);
+        CPPUNIT_ASSERT(!telemetry_rate_update(&r, TELEMETRY_RATE_WINDOW - 1,
+                                              QUEUE_LENGTH));
+
+        ticks = 3 * TELEMETRY_RATE_WINDOW;
+        CPPUNIT_ASSERT(!telemetry_rate_update(&r, ticks, QUEUE_LENGTH));
+        CPPUNIT_ASSERT_EQUAL(SAMPLE_50Hz, r.rate);
+
+        /* The failure went with the stale window */
+        CPPUNIT_ASSERT(!run_window(&r, &ticks, 50, 1, false));
+        CPPUNIT_ASSERT_EQUAL(SAMPLE_50Hz, r.rate);
+}
@@ -0,0 +1,37 @@
+
+#include "checksum.h"
+#include "checksum_test.h"
+
+#include <string.h>
+
+// Registers the fixture into the 'registry'
+CPPUNIT_TEST_SUITE_REGISTRATION( ChecksumTest );
+
+void ChecksumTest::testFnv1aVectors(void)
+{
+	CPPUNIT_ASSERT_EQUAL(0x811c9dc5u,
+			     checksum_fnv1a(CHECKSUM_FNV1A_INIT, "", 0));
+	CPPUNIT_ASSERT_EQUAL(0xe40c292cu,
+			     checksum_fnv1a(CHECKSUM_FNV1A_INIT, "a", 1));
+	CPPUNIT_ASSERT_EQUAL(0xbf9cf968u,
+			     checksum_fnv1a(CHECKSUM_FNV1A_INIT, "foobar", 6));
+}
+
+void ChecksumTest::testFnv1aChaining(void)
+{
+	const uint32_t h = checksum_fnv1a(CHECKSUM_FNV1A_INIT, "foo", 3);
+	CPPUNIT_ASSERT_EQUAL(0xbf9cf968u, checksum_fnv1a(h, "bar", 3));
+}
+
+void ChecksumTest::testCrc32Vectors(void)
+{
+	CPPUNIT_ASSERT_EQUAL(0x00000000u, checksum_crc32(0, "", 0));
+	CPPUNIT_ASSERT_EQUAL(0xe8b7be43u, checksum_crc32(0, "a", 1));
+	CPPUNIT_ASSERT_EQUAL(0xcbf43926u, checksum_crc32(0, "123456789", 9));
+}
+
+void ChecksumTest::testCrc32Chaining(void)
+{
+	const uint32_t crc = checksum_crc32(0, "12345", 5);
+	CPPUNIT_ASSERT_EQUAL(0xcbf43926u, checksum_crc32(crc, "6789", 4));
+}
@@ -0,0 +1,43 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CHECKSUMTEST_H
+#define CHECKSUMTEST_H
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class ChecksumTest : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( ChecksumTest );
+    CPPUNIT_TEST( testFnv1aVectors );
+    CPPUNIT_TEST( testFnv1aChaining );
+    CPPUNIT_TEST( testCrc32Vectors );
+    CPPUNIT_TEST( testCrc32Chaining );
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void testFnv1aVectors(void);
+    void testFnv1aChaining(void);
+    void testCrc32Vectors(void);
+    void testCrc32Chaining(void);
+};
+
+#endif  // CHECKSUMTEST_H
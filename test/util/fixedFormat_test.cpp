@@ -0,0 +1,208 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include "fixedFormat.h"
+#include "fixedFormat_test.h"
+#include "modp_numtoa.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <time.h>
+
+using std::string;
+
+CPPUNIT_TEST_SUITE_REGISTRATION( FixedFormatTest );
+
+#define BENCH_VALUES	1024
+#define BENCH_ROUNDS	200
+
+/* Same values every run, so any mismatch can be chased down */
+static uint32_t next_random(uint32_t *state)
+{
+	*state = *state * 1664525u + 1013904223u;
+	return *state >> 8;
+}
+
+static double random_value(uint32_t *state, const double range)
+{
+	const double unit = (double) next_random(state) / (1u << 24);
+	return (unit * 2 - 1) * range;
+}
+
+static string ftoa(const float value, const int precision)
+{
+	char buf[FIXED_FORMAT_BUF_LEN];
+	const size_t len = fixed_ftoa(value, buf, precision);
+
+	CPPUNIT_ASSERT_EQUAL(strlen(buf), len);
+	return string(buf);
+}
+
+static string dtoa(const double value, const int precision)
+{
+	char buf[FIXED_FORMAT_BUF_LEN];
+	const size_t len = fixed_dtoa(value, buf, precision);
+
+	CPPUNIT_ASSERT_EQUAL(strlen(buf), len);
+	return string(buf);
+}
+
+static string modp_float(const float value, const int precision)
+{
+	char buf[32];
+	modp_ftoa(value, buf, precision);
+	return string(buf);
+}
+
+static string modp_double(const double value, const int precision)
+{
+	char buf[32];
+	modp_dtoa(value, buf, precision);
+	return string(buf);
+}
+
+void FixedFormatTest::testScale(void)
+{
+	CPPUNIT_ASSERT_EQUAL((int64_t) 262, fixed_scale(26.25, 1, true));
+	CPPUNIT_ASSERT_EQUAL((int64_t) 18, fixed_scale(1.75, 1, false));
+	CPPUNIT_ASSERT_EQUAL((int64_t) -12346, fixed_scale(-1.23456, 4, false));
+	CPPUNIT_ASSERT_EQUAL((int64_t) 2, fixed_scale(2.5, 0, false));
+	CPPUNIT_ASSERT_EQUAL((int64_t) 4, fixed_scale(3.5, 0, false));
+	CPPUNIT_ASSERT_EQUAL((int64_t) 0, fixed_scale(0.0 / 0.0, 3, false));
+	CPPUNIT_ASSERT_EQUAL(INT64_MAX, fixed_scale(1e300, 9, false));
+	CPPUNIT_ASSERT_EQUAL(-INT64_MAX, fixed_scale(-1e300, 9, false));
+}
+
+void FixedFormatTest::testFormat(void)
+{
+	CPPUNIT_ASSERT_EQUAL(string("0.123"), ftoa(0.123, 5));
+	CPPUNIT_ASSERT_EQUAL(string("-1.15"), ftoa(-1.15, 5));
+	CPPUNIT_ASSERT_EQUAL(string("1.0"), ftoa(1, 5));
+	CPPUNIT_ASSERT_EQUAL(string("3000"), ftoa(3000, 0));
+	CPPUNIT_ASSERT_EQUAL(string("-0.0"), ftoa(-0.001, 2));
+	CPPUNIT_ASSERT_EQUAL(string("0.05"), ftoa(0.05, 2));
+	CPPUNIT_ASSERT_EQUAL(string("1.0"), ftoa(0.9999, 2));
+	CPPUNIT_ASSERT_EQUAL(string("3735928559"), ftoa(1e10, 2));
+	CPPUNIT_ASSERT_EQUAL(string("-122.123456789"),
+			     dtoa(-122.123456789, 9));
+	CPPUNIT_ASSERT_EQUAL(string("12345678901.5"), dtoa(12345678901.5, 1));
+}
+
+/* The widest doubles must fit the buffer every caller puts on the stack */
+void FixedFormatTest::testLargeDouble(void)
+{
+	static const double values[] = {
+		-123456789012.123456789, -1e18, -9.2e18, 9.2e18,
+	};
+
+	for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); ++i) {
+		char buf[FIXED_FORMAT_BUF_LEN + 8];
+		memset(buf, 'x', sizeof(buf));
+
+		const size_t len = fixed_dtoa(values[i], buf, 9);
+		CPPUNIT_ASSERT(len < FIXED_FORMAT_BUF_LEN);
+		CPPUNIT_ASSERT_EQUAL(strlen(buf), len);
+		CPPUNIT_ASSERT_EQUAL('x', buf[FIXED_FORMAT_BUF_LEN]);
+	}
+
+	CPPUNIT_ASSERT_EQUAL(string("-123456789012.12345"),
+			     dtoa(-123456789012.123456789, 9).substr(0, 19));
+	CPPUNIT_ASSERT_EQUAL(string("-1000000000000000000.0"),
+			     dtoa(-1e18, 9));
+	CPPUNIT_ASSERT_EQUAL(string("3735928559"), dtoa(-1e19, 9));
+	CPPUNIT_ASSERT_EQUAL(string("3735928559"), dtoa(1e300, 0));
+}
+
+void FixedFormatTest::testMatchesModpFloat(void)
+{
+	static const float ties[] = {
+		0.5, 1.5, 2.5, 0.25, 0.75, 26.25, 1.125, -0.5, -3.75, 0.0,
+	};
+	uint32_t state = 1;
+
+	for (int prec = 0; prec <= FIXED_MAX_PRECISION; ++prec) {
+		for (size_t i = 0; i < sizeof(ties) / sizeof(ties[0]); ++i)
+			CPPUNIT_ASSERT_EQUAL(modp_float(ties[i], prec),
+					     ftoa(ties[i], prec));
+
+		const double range = prec > 4 ? 100 : 100000;
+		for (int i = 0; i < 2000; ++i) {
+			const float value = random_value(&state, range);
+			CPPUNIT_ASSERT_EQUAL(modp_float(value, prec),
+					     ftoa(value, prec));
+		}
+	}
+}
+
+void FixedFormatTest::testMatchesModpDouble(void)
+{
+	uint32_t state = 2;
+
+	for (int prec = 0; prec <= FIXED_MAX_PRECISION; ++prec) {
+		for (int i = 0; i < 2000; ++i) {
+			/* Coordinates are the usual doubles */
+			const double value = random_value(&state, 180);
+			CPPUNIT_ASSERT_EQUAL(modp_double(value, prec),
+					     dtoa(value, prec));
+		}
+	}
+}
+
+/*
+ * Not a pass/fail test, just numbers to watch.  The old path is what
+ * the CSV log did: modp into a stack buffer, then a strlen to append it.
+ */
+void FixedFormatTest::testBenchmark(void)
+{
+	static float values[BENCH_VALUES];
+	uint32_t state = 3;
+	char buf[32];
+	size_t total[2] = {0, 0};
+	clock_t ticks[2];
+
+	for (size_t i = 0; i < BENCH_VALUES; ++i)
+		values[i] = random_value(&state, 1000);
+
+	clock_t start = clock();
+	for (int r = 0; r < BENCH_ROUNDS; ++r) {
+		for (size_t i = 0; i < BENCH_VALUES; ++i) {
+			modp_ftoa(values[i], buf, 4);
+			total[0] += strlen(buf);
+		}
+	}
+	ticks[0] = clock() - start;
+
+	start = clock();
+	for (int r = 0; r < BENCH_ROUNDS; ++r)
+		for (size_t i = 0; i < BENCH_VALUES; ++i)
+			total[1] += fixed_ftoa(values[i], buf, 4);
+	ticks[1] = clock() - start;
+
+	const double calls = (double) BENCH_VALUES * BENCH_ROUNDS;
+	printf("\nmodp_ftoa %.1f ns/value, fixed_ftoa %.1f ns/value\n",
+	       ticks[0] * 1e9 / CLOCKS_PER_SEC / calls,
+	       ticks[1] * 1e9 / CLOCKS_PER_SEC / calls);
+
+	CPPUNIT_ASSERT_EQUAL(total[0], total[1]);
+}
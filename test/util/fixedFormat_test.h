@@ -0,0 +1,47 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FIXEDFORMATTEST_H
+#define FIXEDFORMATTEST_H
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class FixedFormatTest : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( FixedFormatTest );
+    CPPUNIT_TEST( testScale );
+    CPPUNIT_TEST( testFormat );
+    CPPUNIT_TEST( testLargeDouble );
+    CPPUNIT_TEST( testMatchesModpFloat );
+    CPPUNIT_TEST( testMatchesModpDouble );
+    CPPUNIT_TEST( testBenchmark );
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void testScale(void);
+    void testFormat(void);
+    void testLargeDouble(void);
+    void testMatchesModpFloat(void);
+    void testMatchesModpDouble(void);
+    void testBenchmark(void);
+};
+
+#endif /* FIXEDFORMATTEST_H */
@@ -0,0 +1,412 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+/*
+ * Host side converter from the binary log format back to CSV so that the
+ * existing analysis tools keep working.  Build it with `make rcb2csv` in
+ * the test directory.
+ *
+ * Usage: rcb2csv [input.rcb [output.csv]]
+ */
+
+#include "binaryLog.h"
+#include "modp_numtoa.h"
+#include "rcb2csv.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_STRING_LEN	255
+
+struct channel {
+        uint8_t type;
+        uint8_t precision;
+        uint16_t sample_rate;
+        float min;
+        float max;
+        char label[MAX_STRING_LEN + 1];
+        char units[MAX_STRING_LEN + 1];
+};
+
+struct header {
+        uint8_t flags;
+        uint16_t channel_count;
+        uint16_t ms_per_tick;
+        /* Only set if the log is part of a rotated session */
+        uint32_t session;
+        uint16_t part;
+        struct channel *channels;
+        /* Running values of packed logs */
+        int64_t *last;
+};
+
+enum records_status {
+        RECORDS_ERROR = -1,
+        RECORDS_END = 0,
+        RECORDS_HEADER,
+};
+
+static bool read_bytes(FILE *in, void *buf, const size_t len)
+{
+        return len == fread(buf, 1, len, in);
+}
+
+static bool read_string(FILE *in, char *str)
+{
+        uint8_t len;
+        if (!read_bytes(in, &len, sizeof(len)) || !read_bytes(in, str, len))
+                return false;
+
+        str[len] = '\0';
+        return true;
+}
+
+static bool read_varint(FILE *in, uint64_t *value)
+{
+        *value = 0;
+        for (unsigned int shift = 0; shift < 64; shift += 7) {
+                const int c = fgetc(in);
+                if (EOF == c)
+                        return false;
+
+                *value |= (uint64_t) (c & 0x7f) << shift;
+                if (!(c & 0x80))
+                        return true;
+        }
+
+        return false;
+}
+
+static bool read_zigzag(FILE *in, int64_t *value)
+{
+        uint64_t raw;
+        if (!read_varint(in, &raw))
+                return false;
+
+        *value = raw & 1 ? (int64_t) ~(raw >> 1) : (int64_t) (raw >> 1);
+        return true;
+}
+
+static bool read_header(FILE *in, struct header *h)
+{
+        char magic[BINARY_LOG_MAGIC_LEN];
+        uint8_t version[2];
+
+        if (!read_bytes(in, magic, sizeof(magic)) ||
+            0 != memcmp(magic, BINARY_LOG_MAGIC, sizeof(magic)) ||
+            !read_bytes(in, version, sizeof(version)) ||
+            BINARY_LOG_VERSION != version[0] ||
+            !read_bytes(in, &h->channel_count, sizeof(h->channel_count)) ||
+            !read_bytes(in, &h->ms_per_tick, sizeof(h->ms_per_tick)))
+                return false;
+
+        h->flags = version[1];
+        if (h->flags & BINARY_LOG_FLAG_SEGMENT &&
+            (!read_bytes(in, &h->session, sizeof(h->session)) ||
+             !read_bytes(in, &h->part, sizeof(h->part))))
+                return false;
+
+        free(h->channels);
+        free(h->last);
+        h->channels = calloc(h->channel_count, sizeof(struct channel));
+        h->last = calloc(h->channel_count, sizeof(int64_t));
+        if (NULL == h->channels || NULL == h->last)
+                return false;
+
+        struct channel *c = h->channels;
+        for (size_t i = 0; i < h->channel_count; ++i, ++c)
+                if (!read_bytes(in, &c->type, sizeof(c->type)) ||
+                    !read_bytes(in, &c->precision, sizeof(c->precision)) ||
+                    !read_bytes(in, &c->sample_rate, sizeof(c->sample_rate)) ||
+                    !read_bytes(in, &c->min, sizeof(c->min)) ||
+                    !read_bytes(in, &c->max, sizeof(c->max)) ||
+                    !read_string(in, c->label) ||
+                    !read_string(in, c->units))
+                        return false;
+
+        return true;
+}
+
+/* Matches write_samples_header in fileWriter.c */
+static void write_csv_header(FILE *out, const struct header *h)
+{
+        const struct channel *c = h->channels;
+        char buf[32];
+
+        for (size_t i = 0; i < h->channel_count; ++i, ++c) {
+                fputs(0 == i ? "" : ",", out);
+                fprintf(out, "\"%s\"|\"%s\"|", c->label, c->units);
+                modp_ftoa(c->min, buf, c->precision);
+                fprintf(out, "%s|", buf);
+                modp_ftoa(c->max, buf, c->precision);
+                fprintf(out, "%s|%u", buf, c->sample_rate);
+        }
+
+        fputs("\n", out);
+}
+
+/* Matches binary_log_type_size, which needs the rest of the firmware */
+static size_t get_value_size(const uint8_t type)
+{
+        switch (type) {
+        case BINARY_LOG_TYPE_LONGLONG:
+                return sizeof(int64_t);
+        case BINARY_LOG_TYPE_DOUBLE:
+                return sizeof(double);
+        case BINARY_LOG_TYPE_FLOAT:
+                return sizeof(float);
+        default:
+                return sizeof(int32_t);
+        }
+}
+
+static bool write_csv_value(FILE *in, FILE *out, const struct channel *c)
+{
+        union {
+                int32_t i;
+                int64_t ll;
+                float f;
+                double d;
+        } value;
+        char buf[32];
+
+        if (!read_bytes(in, &value, get_value_size(c->type)))
+                return false;
+
+        switch (c->type) {
+        case BINARY_LOG_TYPE_LONGLONG:
+                modp_ltoa10(value.ll, buf);
+                break;
+        case BINARY_LOG_TYPE_FLOAT:
+                modp_ftoa(value.f, buf, c->precision);
+                break;
+        case BINARY_LOG_TYPE_DOUBLE:
+                modp_dtoa(value.d, buf, c->precision);
+                break;
+        default:
+                modp_itoa10(value.i, buf);
+                break;
+        }
+
+        fputs(buf, out);
+        return true;
+}
+
+/* Matches write_samples_data in fileWriter.c */
+static bool write_csv_row(FILE *in, FILE *out, const struct header *h)
+{
+        const size_t words = (h->channel_count + 31) / 32;
+        uint32_t populated[words ? words : 1];
+
+        if (!read_bytes(in, populated, sizeof(uint32_t) * words))
+                return false;
+
+        const struct channel *c = h->channels;
+        for (size_t i = 0; i < h->channel_count; ++i, ++c) {
+                fputs(0 == i ? "" : ",", out);
+
+                if (!(populated[i / 32] & (1u << (i % 32))))
+                        continue;
+
+                if (!write_csv_value(in, out, c))
+                        return false;
+        }
+
+        fputs("\n", out);
+        return true;
+}
+
+static enum records_status convert_records(FILE *in, FILE *out,
+                                           const struct header *h)
+{
+        uint16_t delta;
+        while (read_bytes(in, &delta, sizeof(delta))) {
+                if (BINARY_LOG_DELTA_HEADER == delta)
+                        return RECORDS_HEADER;
+
+                uint32_t long_delta;
+                if (BINARY_LOG_DELTA_LONG == delta &&
+                    !read_bytes(in, &long_delta, sizeof(long_delta)))
+                        return RECORDS_ERROR;
+
+                if (!write_csv_row(in, out, h))
+                        return RECORDS_ERROR;
+        }
+
+        return feof(in) ? RECORDS_END : RECORDS_ERROR;
+}
+
+static bool read_keyframe(FILE *in, const struct header *h)
+{
+        char sync[BINARY_LOG_KEYFRAME_SYNC_LEN];
+        if (!read_bytes(in, sync, sizeof(sync)) ||
+            0 != memcmp(sync, BINARY_LOG_KEYFRAME_SYNC, sizeof(sync)))
+                return false;
+
+        for (size_t i = 0; i < h->channel_count; ++i)
+                if (!read_zigzag(in, h->last + i))
+                        return false;
+
+        return true;
+}
+
+static void write_packed_csv_value(FILE *out, const struct channel *c,
+                                   const int64_t value)
+{
+        char buf[32];
+        int precision = c->precision;
+        double scale = 1;
+
+        if (precision > BINARY_LOG_MAX_PRECISION)
+                precision = BINARY_LOG_MAX_PRECISION;
+
+        switch (c->type) {
+        case BINARY_LOG_TYPE_LONGLONG:
+                modp_ltoa10(value, buf);
+                break;
+        case BINARY_LOG_TYPE_FLOAT:
+        case BINARY_LOG_TYPE_DOUBLE:
+                for (int i = 0; i < precision; ++i)
+                        scale *= 10;
+
+                modp_dtoa(value / scale, buf, precision);
+                break;
+        default:
+                modp_itoa10((int32_t) value, buf);
+                break;
+        }
+
+        fputs(buf, out);
+}
+
+static bool write_packed_csv_row(FILE *in, FILE *out, const struct header *h)
+{
+        const size_t count = h->channel_count;
+        uint8_t populated[count / 8 + 1];
+
+        if (!read_bytes(in, populated, (count + 7) / 8))
+                return false;
+
+        size_t npopulated = 0;
+        for (size_t i = 0; i < count; ++i)
+                if (populated[i / 8] & (1u << (i % 8)))
+                        ++npopulated;
+
+        uint8_t changed[npopulated / 8 + 1];
+        if (!read_bytes(in, changed, (npopulated + 7) / 8))
+                return false;
+
+        for (size_t i = 0, bit = 0; i < count; ++i) {
+                if (!(populated[i / 8] & (1u << (i % 8))))
+                        continue;
+
+                int64_t delta = 0;
+                if (changed[bit / 8] & (1u << (bit % 8)) &&
+                    !read_zigzag(in, &delta))
+                        return false;
+
+                h->last[i] += delta;
+                ++bit;
+        }
+
+        const struct channel *c = h->channels;
+        for (size_t i = 0; i < count; ++i, ++c) {
+                fputs(0 == i ? "" : ",", out);
+
+                if (populated[i / 8] & (1u << (i % 8)))
+                        write_packed_csv_value(out, c, h->last[i]);
+        }
+
+        fputs("\n", out);
+        return true;
+}
+
+static enum records_status convert_packed_records(FILE *in, FILE *out,
+                                                  const struct header *h)
+{
+        uint64_t code;
+        while (read_varint(in, &code)) {
+                switch (code & ((1 << BINARY_LOG_RECORD_BITS) - 1)) {
+                case BINARY_LOG_RECORD_HEADER:
+                        return RECORDS_HEADER;
+                case BINARY_LOG_RECORD_KEYFRAME:
+                        if (!read_keyframe(in, h))
+                                return RECORDS_ERROR;
+                        /* Fall through to the row */
+                case BINARY_LOG_RECORD_ROW:
+                        if (!write_packed_csv_row(in, out, h))
+                                return RECORDS_ERROR;
+                        break;
+                default:
+                        return RECORDS_ERROR;
+                }
+        }
+
+        return feof(in) ? RECORDS_END : RECORDS_ERROR;
+}
+
+int rcb2csv(FILE *in, FILE *out)
+{
+        struct header h = { 0 };
+        enum records_status status;
+
+        do {
+                if (!read_header(in, &h)) {
+                        status = RECORDS_ERROR;
+                        break;
+                }
+
+                write_csv_header(out, &h);
+                status = h.flags & BINARY_LOG_FLAG_DELTA ?
+                        convert_packed_records(in, out, &h) :
+                        convert_records(in, out, &h);
+        } while (RECORDS_HEADER == status);
+
+        free(h.channels);
+        free(h.last);
+        return RECORDS_END == status ? 0 : -1;
+}
+
+#ifndef RCP_TESTING
+int main(int argc, char **argv)
+{
+        FILE *in = argc > 1 ? fopen(argv[1], "rb") : stdin;
+        FILE *out = argc > 2 ? fopen(argv[2], "w") : stdout;
+
+        if (NULL == in || NULL == out) {
+                perror("rcb2csv");
+                return 1;
+        }
+
+        const int rc = rcb2csv(in, out);
+        if (rc)
+                fprintf(stderr, "rcb2csv: input is truncated or not a "
+                        "binary log\n");
+
+        fclose(in);
+        fclose(out);
+        return rc ? 1 : 0;
+}
+#endif
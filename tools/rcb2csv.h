@@ -0,0 +1,43 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#ifndef RCB2CSV_H_
+#define RCB2CSV_H_
+
+#include "cpp_guard.h"
+
+#include <stdio.h>
+
+CPP_GUARD_BEGIN
+
+/**
+ * Converts a binary log (see binaryLog.h) into the same CSV that the
+ * logger writes in SD_LOGGING_MODE_CSV.
+ * @return 0 on success, -1 if the input is not a binary log or is
+ * truncated.  Everything decoded up to that point is still written.
+ */
+int rcb2csv(FILE *in, FILE *out);
+
+CPP_GUARD_END
+
+#endif /* RCB2CSV_H_ */
@@ -0,0 +1,78 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*
+ * Host side tool that strips the framing off a journaled log so it can
+ * be read like any other.  Binary logs can then go through rcb2csv.
+ * Build it with `make rcj2log` in the test directory.
+ *
+ * Usage: rcj2log [input.rcj [output]]
+ */
+
+#include "logJournal.h"
+#include "rcj2log.h"
+
+#include <stdint.h>
+
+int rcj2log(FILE *in, FILE *out)
+{
+        struct log_journal_frame frame;
+        uint32_t session = 0;
+        uint32_t seq = 0;
+        size_t got;
+
+        while (sizeof(frame) == (got = fread(&frame, 1, sizeof(frame), in))) {
+                if (0 == seq)
+                        session = frame.session;
+
+                if (!log_journal_frame_valid(&frame, session, seq))
+                        return -1;
+
+                fwrite(frame.payload, 1, frame.len, out);
+                ++seq;
+        }
+
+        /* Anything left over is a frame that was cut short */
+        return seq && 0 == got ? 0 : -1;
+}
+
+#ifndef RCP_TESTING
+int main(int argc, char **argv)
+{
+        FILE *in = argc > 1 ? fopen(argv[1], "rb") : stdin;
+        FILE *out = argc > 2 ? fopen(argv[2], "wb") : stdout;
+
+        if (NULL == in || NULL == out) {
+                perror("rcj2log");
+                return 1;
+        }
+
+        const int rc = rcj2log(in, out);
+        if (rc)
+                fprintf(stderr, "rcj2log: input is damaged or not a "
+                        "journaled log\n");
+
+        fclose(in);
+        fclose(out);
+        return rc ? 1 : 0;
+}
+#endif
@@ -0,0 +1,44 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+
+#ifndef RCJ2LOG_H_
+#define RCJ2LOG_H_
+
+#include "cpp_guard.h"
+
+#include <stdio.h>
+
+CPP_GUARD_BEGIN
+
+/**
+ * Unwraps a journaled log (see logJournal.h) back into the CSV or binary
+ * log it holds.
+ * @return 0 on success, -1 if the input is not a journal or ends in
+ * damaged frames.  Everything up to the damage is still written.
+ */
+int rcj2log(FILE *in, FILE *out);
+
+CPP_GUARD_END
+
+#endif /* RCJ2LOG_H_ */